@@ -0,0 +1,161 @@
+#define HERMES_REPORT_INFO
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This is not a PDE example, it measures the time per time step of the semi-implicit DG scheme
+// of joukowski-profile (assembly and solution, the CFL calculation, the Kuzmin's limiter and the
+// Krivodonova's detector) on the straight-edged domain.xml and on the curved domain-arcs.xml and
+// domain-nurbs.xml, without and with the cache of the geometry of the elements (CurvedGeometryCache)
+// shared by the CFL calculation and the detectors. The first step (which fills the cache) is reported
+// separately from the following ones, the times are also relative to the straight-edged mesh.
+//
+// The following parameters can be changed:
+
+// Polynomial degree.
+const int P_INIT = 1;
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM_VERTEX = 2;
+// Number of initial mesh refinements towards the profile.
+const int INIT_REF_NUM_BOUNDARY_ANISO = 4;
+// CFL value.
+const double CFL_NUMBER = 0.1;
+// Number of time steps.
+const int STEPS = 10;
+// Matrix solver: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+// SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;
+
+// Equation parameters (see joukowski-profile).
+const double P_EXT = 7142.8571428571428571428571428571;
+const double RHO_EXT = 1.0;
+const double V1_EXT = 0.01;
+const double V2_EXT = 0.0;
+const double KAPPA = 1.4;
+
+// Boundary markers.
+const std::string BDY_INLET = "Inlet";
+const std::string BDY_OUTLET = "Outlet";
+const std::string BDY_SOLID_WALL_PROFILE = "Solid Profile";
+const std::string BDY_SOLID_WALL = "Solid";
+
+// Weak forms.
+#include "../forms_explicit.cpp"
+
+struct Result
+{
+  // The first step, the mean of the following ones.
+  double step_first, step_rest;
+  // The mean of the steps: the assembly and the solution, the CFL calculation and the detectors.
+  double solution, geometry;
+};
+
+Result run(const char* mesh_file, bool cache_geometry)
+{
+  Mesh mesh;
+  MeshReaderH2DXML mloader;
+  mloader.load(mesh_file, &mesh);
+  mesh.refine_towards_boundary(BDY_SOLID_WALL_PROFILE, INIT_REF_NUM_BOUNDARY_ANISO);
+  mesh.refine_towards_vertex(0, INIT_REF_NUM_VERTEX);
+
+  L2Space<double> space_rho(&mesh, P_INIT);
+  L2Space<double> space_rho_v_x(&mesh, P_INIT);
+  L2Space<double> space_rho_v_y(&mesh, P_INIT);
+  L2Space<double> space_e(&mesh, P_INIT);
+  Hermes::vector<Space<double>*> spaces(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e);
+
+  ConstantSolution<double> prev_rho(&mesh, RHO_EXT);
+  ConstantSolution<double> prev_rho_v_x(&mesh, RHO_EXT * V1_EXT);
+  ConstantSolution<double> prev_rho_v_y(&mesh, RHO_EXT * V2_EXT);
+  ConstantSolution<double> prev_e(&mesh, QuantityCalculator::calc_energy(RHO_EXT, RHO_EXT * V1_EXT, RHO_EXT * V2_EXT, P_EXT, KAPPA));
+  Hermes::vector<Solution<double>*> solutions(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e);
+
+  VijayasundaramNumericalFlux num_flux(KAPPA);
+  EulerEquationsWeakFormSemiImplicitMultiComponent wf(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, BDY_SOLID_WALL, BDY_SOLID_WALL_PROFILE,
+    BDY_INLET, BDY_OUTLET, &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e);
+  DiscreteProblem<double> dp(&wf, spaces);
+
+  SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
+  Vector<double>* rhs = create_vector<double>(matrix_solver);
+  LinearSolver<double>* solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
+  FactorizationReuse factorization_reuse(solver, matrix, rhs);
+
+  CFLCalculation CFL(CFL_NUMBER, KAPPA);
+  CurvedGeometryCache geometry_cache;
+  if(cache_geometry)
+    CFL.set_geometry_cache(&geometry_cache);
+
+  Result result;
+  result.solution = result.geometry = result.step_rest = 0.0;
+  Hermes::TimePeriod cpu_time;
+  double time_step = 1E-6;
+  int discontinuous_count = 0;
+  for(int step = 0; step < STEPS; step++)
+  {
+    cpu_time.tick(Hermes::HERMES_SKIP);
+    wf.set_time_step(time_step);
+    dp.assemble(matrix, rhs);
+    if(!factorization_reuse.solve(time_step))
+      error ("Matrix solver failed.\n");
+    cpu_time.tick();
+    double solution_time = cpu_time.last();
+
+    FluxLimiter flux_limiter(FluxLimiter::Kuzmin, factorization_reuse.get_sln_vector(), spaces);
+    if(cache_geometry)
+      flux_limiter.set_geometry_cache(&geometry_cache);
+    flux_limiter.limit_according_to_detector();
+    flux_limiter.get_limited_solutions(solutions);
+
+    KrivodonovaDiscontinuityDetector detector(spaces, solutions);
+    if(cache_geometry)
+      detector.set_geometry_cache(&geometry_cache);
+    discontinuous_count = detector.get_discontinuous_element_ids().size();
+
+    CFL.calculate_semi_implicit(factorization_reuse.get_sln_vector(), spaces, time_step);
+    cpu_time.tick();
+    double geometry_time = cpu_time.last();
+
+    result.solution += solution_time / STEPS;
+    result.geometry += geometry_time / STEPS;
+    if(step == 0)
+      result.step_first = solution_time + geometry_time;
+    else
+      result.step_rest += (solution_time + geometry_time) / (STEPS - 1);
+  }
+
+  int curved_count = 0;
+  Element* e;
+  for_all_active_elements(e, &mesh)
+    if(e->is_curved())
+      curved_count++;
+
+  info("%s, %s: %d elements (%d curved), %d flagged by Krivodonova, geometry cache %d hits, %d misses.", mesh_file,
+    cache_geometry ? "cached geometry" : "no cache", mesh.get_num_active_elements(), curved_count, discontinuous_count,
+    geometry_cache.get_hits(), geometry_cache.get_misses());
+
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  // The straight-edged mesh is the first one.
+  const char* mesh_files[3] = { "domain.xml", "domain-arcs.xml", "domain-nurbs.xml" };
+
+  Result results[3][2];
+  for(int mesh_i = 0; mesh_i < 3; mesh_i++)
+    for(int cache_i = 0; cache_i < 2; cache_i++)
+      results[mesh_i][cache_i] = run(mesh_files[mesh_i], cache_i == 1);
+
+  for(int mesh_i = 0; mesh_i < 3; mesh_i++)
+    for(int cache_i = 0; cache_i < 2; cache_i++)
+    {
+      Result& result = results[mesh_i][cache_i];
+      info("%s, %s: first step %g s, following steps %g s (%g of domain.xml), of which assembly and solution %g s, CFL and detectors %g s.",
+        mesh_files[mesh_i], cache_i == 1 ? "cached geometry" : "no cache", result.step_first, result.step_rest,
+        result.step_rest / results[0][cache_i].step_rest, result.solution, result.geometry);
+    }
+
+  return 0;
+}
@@ -224,6 +224,13 @@ int main(int argc, char* argv[])
   L2ProjBasedSelector<double> l2selector_flow(CAND_LIST_FLOW, CONV_EXP, H2DRS_DEFAULT_ORDER);
   L2ProjBasedSelector<double> l2selector_concentration(CAND_LIST_CONCENTRATION, CONV_EXP, H2DRS_DEFAULT_ORDER);
 
+  // Reference spaces of the adaptivity, the flow spaces share one reference mesh.
+  ReferenceSpaceManager ref_space_manager(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e, &space_c), 
+    CAND_LIST_FLOW == H2D_HP_ANISO ? 1 : 0);
+
+  // Transfer of the previous time level solutions onto the reference spaces (the flow element by element).
+  L2Transfer l2_transfer(matrix_solver);
+
   // Set up CFL calculation class.
   CFLCalculation CFL(CFL_NUMBER, KAPPA);
 
@@ -267,19 +274,17 @@ int main(int argc, char* argv[])
     {
       info("---- Adaptivity step %d:", as);
 
-      // Construct globally refined reference mesh and setup reference space.
-      int order_increase = 0;
-      if(CAND_LIST_FLOW == H2D_HP_ANISO)
-        order_increase = 1;
-      Hermes::vector<Space<double> *>* ref_spaces = Space<double>::construct_refined_spaces(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-        &space_rho_v_y, &space_e, &space_c), order_increase);
-      if(CAND_LIST_FLOW != H2D_HP_ANISO)
+      // Globally refined reference mesh and reference spaces (rebuilt only if the coarse ones changed).
+      Hermes::vector<Space<double> *>* ref_spaces = ref_space_manager.get_ref_spaces();
+      if(CAND_LIST_FLOW != H2D_HP_ANISO && !ref_space_manager.get_last_reused())
         (*ref_spaces)[4]->adjust_element_order(+1, P_INIT_CONCENTRATION);
 
       // Project the previous time level solution onto the new fine mesh.
       info("Projecting the previous time level solution onto the new fine mesh.");
-      OGProjection<double>::project_global(*ref_spaces, Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_c), 
-        Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_c), matrix_solver);
+      l2_transfer.transfer(*ref_spaces, Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_c), 
+        Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_c));
+      info("%d elements copied, %d projected, %d components projected globally in %g s.", l2_transfer.get_copied_elements(), 
+        l2_transfer.get_projected_elements(), l2_transfer.get_global_components(), l2_transfer.get_last_time());
 
       /*
       if(iteration == 1) {
@@ -294,23 +299,11 @@ int main(int argc, char* argv[])
       }
       */
 
-      if(as > 1) {
-        delete rsln_rho.get_mesh();
-        delete rsln_rho_v_x.get_mesh();
-        delete rsln_rho_v_y.get_mesh();
-        delete rsln_e.get_mesh();
-        delete rsln_c.get_mesh();
-      }
-
       // Report NDOFs.
-      info("ndof_coarse: %d, ndof_fine: %d.", 
+      info("ndof_coarse: %d, ndof_fine: %d (reference spaces %s in %g s).", 
         Space<double>::get_num_dofs(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-        &space_rho_v_y, &space_e, &space_c)), Space<double>::get_num_dofs(*ref_spaces));
-
-      // Very imporant, set the meshes for the flow as the same.
-      (*ref_spaces)[1]->get_mesh()->set_seq((*ref_spaces)[0]->get_mesh()->get_seq());
-      (*ref_spaces)[2]->get_mesh()->set_seq((*ref_spaces)[0]->get_mesh()->get_seq());
-      (*ref_spaces)[3]->get_mesh()->set_seq((*ref_spaces)[0]->get_mesh()->get_seq());
+        &space_rho_v_y, &space_e, &space_c)), Space<double>::get_num_dofs(*ref_spaces), 
+        ref_space_manager.get_last_reused() ? "reused" : "built", ref_space_manager.get_last_time());
 
       // Set up the solver, matrix, and rhs according to the solver selection.
       SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
@@ -351,6 +344,10 @@ int main(int argc, char* argv[])
 			
       if(SHOCK_CAPTURING)
         flux_limiter.get_limited_solutions(Hermes::vector<Solution<double>*>(&rsln_rho, &rsln_rho_v_x, &rsln_rho_v_y, &rsln_e));
+
+      // The coefficients of the limited flow solution (the flow spaces come first in the reference spaces).
+      std::vector<double> limited_coefficients(solver->get_sln_vector(), solver->get_sln_vector() + Space<double>::get_num_dofs(*ref_spaces));
+      std::copy(flow_solution_vector, flow_solution_vector + Space<double>::get_num_dofs(flow_spaces), limited_coefficients.begin());
       
       // Project the fine mesh solution onto the coarse mesh.
       info("Projecting reference solution on coarse mesh.");
@@ -447,12 +444,14 @@ int main(int argc, char* argv[])
         }
       }
 
+      // The coefficients of the previous time level solutions in the next transfer (the reference solution ones if done).
+      l2_transfer.set_coefficients(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_c), 
+        *ref_spaces, (done && !SHOCK_CAPTURING) ? solver->get_sln_vector() : &limited_coefficients[0]);
+
       // Clean up.
       delete solver;
       delete matrix;
       delete rhs;
-      for(unsigned int i = 0; i < ref_spaces->size(); i++)
-        delete (*ref_spaces)[i];
     }
     while (done == false);
 
@@ -463,11 +462,6 @@ int main(int argc, char* argv[])
     prev_rho_v_y.copy(&rsln_rho_v_y);
     prev_e.copy(&rsln_e);
     prev_c.copy(&rsln_c);
-    delete rsln_rho.get_mesh();
-    delete rsln_rho_v_x.get_mesh();
-    delete rsln_rho_v_y.get_mesh();
-    delete rsln_e.get_mesh();
-    delete rsln_c.get_mesh();
 
     // Visualization.
     if((iteration - 1) % EVERY_NTH_STEP == 0) {
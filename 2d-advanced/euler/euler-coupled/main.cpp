@@ -10,6 +10,11 @@ using namespace Hermes::Hermes2D::Views;
 // using a basic piecewise-constant finite volume method for the flow and continuous FEM for the concentration
 // being advected by the flow.
 //
+// The flow and the concentration are advanced by the multirate coupling: each of them by its own
+// time step (the CFL condition for the flow, the advection and diffusion conditions for the concentration),
+// the faster one subcycled within a macro step as long as the slower one. The flow is advanced first,
+// the concentration then reads the flow interpolated linearly in time within the macro step.
+//
 // Equations: Compressible Euler equations, perfect gas state equation, advection-diffusion equation.
 //
 // Domains: Various
@@ -46,11 +51,19 @@ const int P_INIT_FLOW = 0;
 const int P_INIT_CONCENTRATION = 1;                    
 // CFL value.
 double CFL_NUMBER = 1.0;                               
-// Initial and utility time step.
-double time_step = 1E-5, util_time_step;               
+// Initial time step of the flow.
+double time_step = 1E-5;               
+// Maximum number of substeps of the faster subsystem in one macro step.
+const int MAX_SUBSTEPS = 100;
 // Matrix solver: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
 // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
 const MatrixSolverType matrix_solver = SOLVER_UMFPACK; 
+// Reuse of the factorization over the time steps: the symbolic analysis only in the first step,
+// and if STALE_FACTORIZATION_STEPS > 0, reuse of a factorization (as a preconditioner of an iterative refinement)
+// in up to STALE_FACTORIZATION_STEPS following steps, in which the time step changed relatively by less than STALE_FACTORIZATION_THRESHOLD.
+const bool REUSE_SYMBOLIC_FACTORIZATION = true;
+const int STALE_FACTORIZATION_STEPS = 0;
+const double STALE_FACTORIZATION_THRESHOLD = 0.05;
 // Number of initial uniform mesh refinements of the mesh for the flow.
 unsigned int INIT_REF_NUM_FLOW = 3;                    
 // Number of initial uniform mesh refinements of the mesh for the concentration.
@@ -155,10 +168,20 @@ int main(int argc, char* argv[])
   
   ScalarView s5("Concentration", new WinGeom(700, 400, 600, 300));
 
-  // Set up the solver, matrix, and rhs according to the solver selection.
-  SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
-  Vector<double>* rhs = create_vector<double>(matrix_solver);
-  LinearSolver<double>* solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
+  // Set up the solvers, matrices, and rhs according to the solver selection, for the flow and for the concentration.
+  SparseMatrix<double>* matrix_flow = create_matrix<double>(matrix_solver);
+  Vector<double>* rhs_flow = create_vector<double>(matrix_solver);
+  LinearSolver<double>* solver_flow = create_linear_solver<double>(matrix_solver, matrix_flow, rhs_flow);
+  FactorizationReuse factorization_reuse_flow(solver_flow, matrix_flow, rhs_flow, REUSE_SYMBOLIC_FACTORIZATION);
+  SparseMatrix<double>* matrix_concentration = create_matrix<double>(matrix_solver);
+  Vector<double>* rhs_concentration = create_vector<double>(matrix_solver);
+  LinearSolver<double>* solver_concentration = create_linear_solver<double>(matrix_solver, matrix_concentration, rhs_concentration);
+  FactorizationReuse factorization_reuse_concentration(solver_concentration, matrix_concentration, rhs_concentration, REUSE_SYMBOLIC_FACTORIZATION);
+  if(STALE_FACTORIZATION_STEPS > 0)
+  {
+    factorization_reuse_flow.set_stale_factorization_reuse(STALE_FACTORIZATION_STEPS, STALE_FACTORIZATION_THRESHOLD);
+    factorization_reuse_concentration.set_stale_factorization_reuse(STALE_FACTORIZATION_STEPS, STALE_FACTORIZATION_THRESHOLD);
+  }
 
   // Set up CFL calculation class.
   CFLCalculation CFL(CFL_NUMBER, KAPPA);
@@ -166,42 +189,70 @@ int main(int argc, char* argv[])
   // Set up Advection-Diffusion-Equation stability calculation class.
   ADEStabilityCalculation ADES(ADVECTION_STABILITY_CONSTANT, DIFFUSION_STABILITY_CONSTANT, EPSILON);
 
-  // Initialize weak formulation.
-  EulerEquationsWeakFormSemiImplicitCoupled wf(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, BDY_SOLID_WALL_BOTTOM,
-    BDY_SOLID_WALL_TOP, BDY_INLET, BDY_OUTLET, BDY_NATURAL_CONCENTRATION, &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_c, EPSILON, (P_INIT_FLOW == 0));
+  Hermes::vector<Space<double>*> flow_spaces(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e);
 
-  // Initialize the FE problem.
-  DiscreteProblem<double> dp(&wf, Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e, &space_c));
+  // The flow interpolated in time, for the concentration.
+  Solution<double> interpolated_rho(&mesh_flow), interpolated_rho_v_x(&mesh_flow), interpolated_rho_v_y(&mesh_flow), interpolated_e(&mesh_flow);
+  MultirateCoupling multirate(flow_spaces, Hermes::vector<Solution<double>*>(&interpolated_rho, &interpolated_rho_v_x, &interpolated_rho_v_y, &interpolated_e), MAX_SUBSTEPS);
 
-  // Time stepping loop.
-  int iteration = 0; double t = 0;
-  for(; t < 10.0; t += time_step)
-  {
-    info("---- Time step %d, time %3.5f.", iteration++, t);
+  // Initialize weak formulations.
+  EulerEquationsWeakFormSemiImplicitMultiComponent wf_flow(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, BDY_SOLID_WALL_BOTTOM,
+    BDY_SOLID_WALL_TOP, BDY_INLET, BDY_OUTLET, &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, (P_INIT_FLOW == 0));
+  ConcentrationWeakFormSemiImplicit wf_concentration(BDY_NATURAL_CONCENTRATION, &interpolated_rho, &interpolated_rho_v_x, &interpolated_rho_v_y, &interpolated_e, &prev_c, EPSILON);
+
+  // Initialize the FE problems.
+  DiscreteProblem<double> dp_flow(&wf_flow, flow_spaces);
+  if(P_INIT_FLOW == 0)
+    dp_flow.set_fvm();
+  DiscreteProblem<double> dp_concentration(&wf_concentration, &space_c);
 
-    // Set the current time step.
-    wf.set_time_step(time_step);
-    Space<double>::update_essential_bc_values(&space_c, t);
+  // The coefficients of the flow prev_* (the limited solution with shock capturing), initially the projection of the initial state.
+  int flow_ndof = Space<double>::get_num_dofs(flow_spaces);
+  double* flow_vector = new double[flow_ndof];
+  OGProjection<double>::project_global(flow_spaces, Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e),
+    flow_vector, matrix_solver);
+
+  // Timer for the whole macro step.
+  Hermes::TimePeriod step_time;
+
+  // Time stepping loop (over the macro steps).
+  int iteration = 0; double t = 0, macro_step = 0;
+  for(; t < 10.0; t += macro_step)
+  {
+    info("---- Macro step %d, time %3.5f.", iteration++, t);
+    step_time.tick(Hermes::HERMES_SKIP);
+
+    // The stable time steps of the subsystems at the beginning of the macro step.
+    double concentration_time_step;
+    ADES.calculate(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y), &mesh_concentration, concentration_time_step);
+    macro_step = multirate.begin_macro_step(time_step, concentration_time_step);
+    multirate.set_flow_start(flow_vector);
+    int flow_steps = multirate.get_steps(MultirateCoupling::FLOW);
+    int concentration_steps = multirate.get_steps(MultirateCoupling::CONCENTRATION);
+
+    // The flow, to the end of the macro step.
+    double step;
+    while((step = multirate.next_step(MultirateCoupling::FLOW, time_step)) > 0.0)
+    {
+      wf_flow.set_time_step(step);
+      dp_flow.assemble(matrix_flow, rhs_flow);
 
-    // Assemble the stiffness matrix and rhs.
-    info("Assembling the stiffness matrix and right-hand side vector.");
-    dp.assemble(matrix, rhs);
+      if(!factorization_reuse_flow.solve(step))
+        error ("Matrix solver failed.\n");
 
-    // Solve the matrix problem.
-    info("Solving the matrix problem.");
-    if(solver->solve())
       if(!SHOCK_CAPTURING)
-        Solution<double>::vector_to_solutions(solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-        &space_rho_v_y, &space_e, &space_c), Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_c));
+      {
+        memcpy(flow_vector, factorization_reuse_flow.get_sln_vector(), flow_ndof * sizeof(double));
+        Solution<double>::vector_to_solutions(flow_vector, flow_spaces, 
+        Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+      }
       else
       {      
         FluxLimiter* flux_limiter;
         if(SHOCK_CAPTURING_TYPE == KUZMIN)
-          flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-          &space_rho_v_y, &space_e));
+          flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, factorization_reuse_flow.get_sln_vector(), flow_spaces);
         else
-          flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-          &space_rho_v_y, &space_e));
+          flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, factorization_reuse_flow.get_sln_vector(), flow_spaces);
 
         if(SHOCK_CAPTURING_TYPE == KUZMIN)
           flux_limiter->limit_second_orders_according_to_detector();
@@ -209,18 +260,37 @@ int main(int argc, char* argv[])
         flux_limiter->limit_according_to_detector();
 
         flux_limiter->get_limited_solutions(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+        delete flux_limiter;
+
+        // The coefficients of the limited solution, for the time step and the concentration.
+        OGProjection<double>::project_global(flow_spaces, Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e),
+          flow_vector, matrix_solver);
       }
-    else
-      error ("Matrix solver failed.\n");
 
-    CFL.calculate_semi_implicit(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), &mesh_flow, time_step);
+      CFL.calculate_semi_implicit(flow_vector, flow_spaces, time_step);
+    }
+    multirate.set_flow_end(flow_vector);
 
-    util_time_step = time_step;
+    // The concentration, with the flow in the middle of each of its steps.
+    while((step = multirate.next_step(MultirateCoupling::CONCENTRATION, concentration_time_step)) > 0.0)
+    {
+      double step_start = multirate.get_subsystem_time(MultirateCoupling::CONCENTRATION) - step;
+      multirate.interpolate_flow(step_start + step / 2.0);
 
-    ADES.calculate(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y), &mesh_concentration, util_time_step);
+      wf_concentration.set_time_step(step);
+      Space<double>::update_essential_bc_values(&space_c, t + step_start);
+      dp_concentration.assemble(matrix_concentration, rhs_concentration);
 
-    if(util_time_step < time_step)
-      time_step = util_time_step;
+      if(!factorization_reuse_concentration.solve(step))
+        error ("Matrix solver failed.\n");
+      Solution<double>::vector_to_solution(factorization_reuse_concentration.get_sln_vector(), &space_c, &prev_c);
+    }
+
+    // Time of the macro step (without the output).
+    step_time.tick();
+    info("Macro step %g: %d flow steps, %d concentration steps, %g s.", macro_step, multirate.get_steps(MultirateCoupling::FLOW) - flow_steps,
+      multirate.get_steps(MultirateCoupling::CONCENTRATION) - concentration_steps, step_time.last());
+    info("Solutions: flow %g s, concentration %g s.", factorization_reuse_flow.get_last_time(), factorization_reuse_concentration.get_last_time());
 
     // Visualization.
     if((iteration - 1) % EVERY_NTH_STEP == 0) 
@@ -257,6 +327,15 @@ int main(int argc, char* argv[])
     }
   }
 
+  // Per-subsystem step statistics.
+  info("%d macro steps.", multirate.get_macro_steps());
+  info("Flow: %d steps, min %g, max %g, mean %g.", multirate.get_steps(MultirateCoupling::FLOW), multirate.get_min_step(MultirateCoupling::FLOW), 
+    multirate.get_max_step(MultirateCoupling::FLOW), multirate.get_mean_step(MultirateCoupling::FLOW));
+  info("Concentration: %d steps, min %g, max %g, mean %g.", multirate.get_steps(MultirateCoupling::CONCENTRATION), multirate.get_min_step(MultirateCoupling::CONCENTRATION), 
+    multirate.get_max_step(MultirateCoupling::CONCENTRATION), multirate.get_mean_step(MultirateCoupling::CONCENTRATION));
+
+  delete [] flow_vector;
+
   pressure_view.close();
   entropy_production_view.close();
   Mach_number_view.close();
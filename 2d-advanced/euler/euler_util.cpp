@@ -1,6 +1,24 @@
 #include "euler_util.h"
+#include "numerical_flux.h"
 #include "limits.h"
 #include <limits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 // Calculates energy from other quantities.
 double QuantityCalculator::calc_energy(double rho, double rho_v_x, double rho_v_y, double pressure, double kappa)
@@ -29,8 +47,218 @@ double QuantityCalculator::calc_sound_speed(double rho, double rho_v_x, double r
   return to_return;
 }
 
-CFLCalculation::CFLCalculation(double CFL_number, double kappa) : CFL_number(CFL_number), kappa(kappa)
+int EulerFormsOrder::nonlinearity_increase = 2;
+int EulerFormsOrder::max_order = 24;
+int EulerFormsOrder::fixed_order = 0;
+
+Ord EulerFormsOrder::limit(Ord polynomial_order)
+{
+  if(fixed_order > 0)
+    return Ord(fixed_order);
+  Ord order = polynomial_order * Ord(nonlinearity_increase);
+  if(order.get_order() > max_order)
+    return Ord(max_order);
+  return order;
+}
+
+Ord EulerFormsOrder::exact(Ord polynomial_order)
+{
+  if(fixed_order > 0)
+    return Ord(fixed_order);
+  return polynomial_order;
+}
+
+CurvedGeometryCache::CurvedGeometryCache() : cached_mesh(NULL), cached_mesh_seq(0), hits(0), misses(0)
+{
+}
+
+CurvedGeometryCache::~CurvedGeometryCache()
+{
+  clear();
+}
+
+void CurvedGeometryCache::clear()
+{
+  for(unsigned int id = 0; id < entries.size(); id++)
+    for(unsigned int entry_i = 0; entry_i < entries[id].size(); entry_i++)
+      delete entries[id][entry_i].geometry;
+  entries.clear();
+  reference_points.clear();
+}
+
+void CurvedGeometryCache::update(Mesh* mesh)
+{
+  if(mesh != cached_mesh || mesh->get_seq() != cached_mesh_seq)
+  {
+    clear();
+    cached_mesh = mesh;
+    cached_mesh_seq = mesh->get_seq();
+  }
+  entries.resize(mesh->get_max_element_id() + 1);
+  reference_points.resize(mesh->get_max_element_id() + 1);
+}
+
+void CurvedGeometryCache::check_element(Element* e) const
+{
+  if(cached_mesh == NULL)
+    error("CurvedGeometryCache: update() has to be called first.");
+  if(e->id >= (int)entries.size())
+    error("CurvedGeometryCache: the element %d is not in the mesh.", e->id);
+}
+
+const CurvedGeometryCache::Geometry& CurvedGeometryCache::get_volume(Element* e, int order)
+{
+  return get_geometry(e, -1, order);
+}
+
+const CurvedGeometryCache::Geometry& CurvedGeometryCache::get_edge(Element* e, int edge_i, int order)
+{
+  return get_geometry(e, edge_i, order);
+}
+
+const CurvedGeometryCache::Geometry& CurvedGeometryCache::get_geometry(Element* e, int edge, int order)
+{
+  check_element(e);
+  std::vector<Entry>& element_entries = entries[e->id];
+  for(unsigned int entry_i = 0; entry_i < element_entries.size(); entry_i++)
+    if(element_entries[entry_i].edge == edge && element_entries[entry_i].order == order)
+    {
+#pragma omp atomic
+      hits++;
+      return *element_entries[entry_i].geometry;
+    }
+
+  Entry entry;
+  entry.edge = edge;
+  entry.order = order;
+  entry.geometry = new Geometry;
+  if(edge == -1)
+    calculate_volume(e, order, entry.geometry);
+  else
+    calculate_edge(e, edge, order, entry.geometry);
+  element_entries.push_back(entry);
+#pragma omp atomic
+  misses++;
+  return *entry.geometry;
+}
+
+void CurvedGeometryCache::calculate_volume(Element* e, int order, Geometry* geometry)
+{
+  Quad2D* quad = &g_quad_2d_std;
+  update_limit_table(e->get_mode());
+  RefMap refmap;
+  refmap.set_quad_2d(quad);
+  refmap.set_active_element(e);
+
+  int np = quad->get_num_points(order);
+  double3* pt = quad->get_points(order);
+  double* x = refmap.get_phys_x(order);
+  double* y = refmap.get_phys_y(order);
+  bool jacobian_const = refmap.is_jacobian_const();
+  double* jac = jacobian_const ? NULL : refmap.get_jacobian(order);
+  double2x2* m = jacobian_const ? refmap.get_const_inv_ref_map() : refmap.get_inv_ref_map(order);
+
+  geometry->np = np;
+  geometry->x.resize(np);
+  geometry->y.resize(np);
+  geometry->jwt.resize(np);
+  geometry->inv_ref_map.resize(4 * np);
+  for(int point_i = 0; point_i < np; point_i++)
+  {
+    geometry->x[point_i] = x[point_i];
+    geometry->y[point_i] = y[point_i];
+    geometry->jwt[point_i] = pt[point_i][2] * (jacobian_const ? refmap.get_const_jacobian() : jac[point_i]);
+    double2x2& m_point = m[jacobian_const ? 0 : point_i];
+    geometry->inv_ref_map[4 * point_i] = m_point[0][0];
+    geometry->inv_ref_map[4 * point_i + 1] = m_point[0][1];
+    geometry->inv_ref_map[4 * point_i + 2] = m_point[1][0];
+    geometry->inv_ref_map[4 * point_i + 3] = m_point[1][1];
+  }
+}
+
+void CurvedGeometryCache::calculate_edge(Element* e, int edge_i, int order, Geometry* geometry)
+{
+  Quad2D* quad = &g_quad_2d_std;
+  update_limit_table(e->get_mode());
+  RefMap refmap;
+  refmap.set_quad_2d(quad);
+  refmap.set_active_element(e);
+
+  SurfPos surf_pos;
+  surf_pos.marker = e->marker;
+  surf_pos.surf_num = edge_i;
+  int eo = quad->get_edge_points(edge_i, order);
+  int np = quad->get_num_points(eo);
+  double3* pt = quad->get_points(eo);
+  Geom<double>* geom = init_geom_surf(&refmap, &surf_pos, eo);
+  double3* tan = refmap.get_tangent(edge_i, eo);
+
+  geometry->np = np;
+  geometry->x.resize(np);
+  geometry->y.resize(np);
+  geometry->jwt.resize(np);
+  geometry->nx.resize(np);
+  geometry->ny.resize(np);
+  for(int point_i = 0; point_i < np; point_i++)
+  {
+    geometry->x[point_i] = geom->x[point_i];
+    geometry->y[point_i] = geom->y[point_i];
+    geometry->jwt[point_i] = pt[point_i][2] * tan[point_i][2];
+    geometry->nx[point_i] = geom->nx[point_i];
+    geometry->ny[point_i] = geom->ny[point_i];
+  }
+
+  geom->free();
+  delete geom;
+}
+
+const double* CurvedGeometryCache::get_reference_points(Element* e)
+{
+  check_element(e);
+  std::vector<double>& points = reference_points[e->id];
+  if(!points.empty())
+  {
+#pragma omp atomic
+    hits++;
+    return &points[0];
+  }
+
+  RefMap refmap;
+  refmap.set_quad_2d(&g_quad_2d_std);
+  refmap.set_active_element(e);
+
+  int vertex_count = e->get_num_surf();
+  points.resize(2 * (vertex_count + 1));
+  double c_x = 0.0, c_y = 0.0;
+  for(int vertex_i = 0; vertex_i < vertex_count; vertex_i++)
+  {
+    refmap.untransform(e, e->vn[vertex_i]->x, e->vn[vertex_i]->y, points[2 * vertex_i], points[2 * vertex_i + 1]);
+    c_x += e->vn[vertex_i]->x / vertex_count;
+    c_y += e->vn[vertex_i]->y / vertex_count;
+  }
+  refmap.untransform(e, c_x, c_y, points[2 * vertex_count], points[2 * vertex_count + 1]);
+#pragma omp atomic
+  misses++;
+  return &points[0];
+}
+
+int CurvedGeometryCache::get_hits() const
+{
+  return hits;
+}
+
+int CurvedGeometryCache::get_misses() const
 {
+  return misses;
+}
+
+CFLCalculation::CFLCalculation(double CFL_number, double kappa) : CFL_number(CFL_number), kappa(kappa), geometry_cache(NULL), cached_mesh(NULL), cached_mesh_seq(-1)
+{
+  for(int i = 0; i < 4; i++)
+  {
+    cached_spaces[i] = NULL;
+    cached_space_seqs[i] = -1;
+  }
 }
 
 void CFLCalculation::calculate(Hermes::vector<Solution<double>*> solutions, Mesh* mesh, double & time_step) const
@@ -156,11 +384,275 @@ AsmList<double> al;
   delete [] sln_vector;
 }
 
+void CFLCalculation::calculate(double* sln_vector, Hermes::vector<Space<double>*> spaces, double & time_step)
+{
+  update_cache(spaces);
+
+  // Determine the time step according to the CFL condition.
+  int element_count = elements.size();
+  double min_condition = std::numeric_limits<double>::max();
+
+#pragma omp parallel
+  {
+    double thread_min_condition = std::numeric_limits<double>::max();
+    double w[4];
+
+#pragma omp for
+    for(int element_i = 0; element_i < element_count; element_i++)
+    {
+      get_averages(sln_vector, element_i, w);
+      double v1 = w[1] / w[0];
+      double v2 = w[2] / w[0];
+
+      double condition = areas[element_i] * CFL_number / (std::sqrt(v1*v1 + v2*v2) + QuantityCalculator::calc_sound_speed(w[0], w[1], w[2], w[3], kappa));
+
+      if(condition < thread_min_condition)
+        thread_min_condition = condition;
+    }
+
+#pragma omp critical (CFLCalculation_min)
+    if(thread_min_condition < min_condition)
+      min_condition = thread_min_condition;
+  }
+
+  time_step = min_condition;
+}
+
+void CFLCalculation::calculate_semi_implicit(double* sln_vector, Hermes::vector<Space<double>*> spaces, double & time_step)
+{
+  update_cache(spaces);
+
+  // Determine the time step according to the CFL condition.
+  int element_count = elements.size();
+  double min_condition = std::numeric_limits<double>::max();
+
+#pragma omp parallel
+  {
+    double thread_min_condition = std::numeric_limits<double>::max();
+    double w[4];
+
+#pragma omp for
+    for(int element_i = 0; element_i < element_count; element_i++)
+    {
+      get_averages(sln_vector, element_i, w);
+
+      double edge_length_max_lambda = 0.0;
+      for(int edge_i = edge_offsets[element_i]; edge_i < edge_offsets[element_i + 1]; edge_i++)
+      {
+        // Calculation of the maximum eigenvalue of the matrix P.
+        double max_eigen_value = 0.0;
+        for(int normal_i = normal_offsets[edge_i]; normal_i < normal_offsets[edge_i + 1]; normal_i++)
+        {
+          // Transform to the local coordinates.
+          double transformed[4];
+          transformed[0] = w[0];
+          transformed[1] = normals_x[normal_i] * w[1] + normals_y[normal_i] * w[2];
+          transformed[2] = -normals_y[normal_i] * w[1] + normals_x[normal_i] * w[2];
+          transformed[3] = w[3];
+
+          // Calc sound speed.
+          double a = QuantityCalculator::calc_sound_speed(transformed[0], transformed[1], transformed[2], transformed[3], kappa);
+
+          // Calc max eigenvalue.
+          if(transformed[1] / transformed[0] - a > max_eigen_value || normal_i == normal_offsets[edge_i])
+            max_eigen_value = transformed[1] / transformed[0] - a;
+          if(transformed[1] / transformed[0] > max_eigen_value)
+            max_eigen_value = transformed[1] / transformed[0];
+          if(transformed[1] / transformed[0] + a > max_eigen_value)
+            max_eigen_value = transformed[1] / transformed[0] + a;
+        }
+
+        if(edge_lengths[edge_i] * max_eigen_value > edge_length_max_lambda || edge_i == edge_offsets[element_i])
+          edge_length_max_lambda = edge_lengths[edge_i] * max_eigen_value;
+      }
+
+      double condition = areas[element_i] * CFL_number / edge_length_max_lambda;
+
+      if(condition < thread_min_condition)
+        thread_min_condition = condition;
+    }
+
+#pragma omp critical (CFLCalculation_min)
+    if(thread_min_condition < min_condition)
+      min_condition = thread_min_condition;
+  }
+
+  time_step = min_condition;
+}
+
+void CFLCalculation::update_cache(Hermes::vector<Space<double>*> spaces)
+{
+  if(spaces.size() < 4)
+    error("CFLCalculation needs the spaces of all four conserved quantities.");
+
+  Mesh* mesh = spaces[0]->get_mesh();
+
+  bool geometry_valid = (mesh == cached_mesh && mesh->get_seq() == cached_mesh_seq);
+  bool averages_valid = geometry_valid;
+  for(int i = 0; i < 4; i++)
+    if(spaces[i] != cached_spaces[i] || spaces[i]->get_seq() != cached_space_seqs[i])
+      averages_valid = false;
+  if(averages_valid)
+    return;
+
+  RefMap refmap;
+  refmap.set_quad_2d(&g_quad_2d_std);
+  Quad2D* quad = &g_quad_2d_std;
+  Element* e;
+
+  if(geometry_cache != NULL)
+    geometry_cache->update(mesh);
+
+  if(!geometry_valid)
+  {
+    elements.clear();
+    areas.clear();
+    edge_offsets.clear();
+    edge_lengths.clear();
+    normal_offsets.clear();
+    normals_x.clear();
+    normals_y.clear();
+
+    for_all_active_elements(e, mesh)
+    {
+      elements.push_back(e);
+      areas.push_back(e->get_area());
+      edge_offsets.push_back(edge_lengths.size());
+
+      update_limit_table(e->get_mode());
+      refmap.set_active_element(e);
+      for(unsigned int edge_i = 0; edge_i < e->get_num_surf(); edge_i++)
+      {
+        // Calculation of the edge length.
+        unsigned int next_i = (edge_i + 1) % e->get_num_surf();
+        edge_lengths.push_back(std::sqrt(std::pow(e->vn[next_i]->x - e->vn[edge_i]->x, 2) + std::pow(e->vn[next_i]->y - e->vn[edge_i]->y, 2)));
+
+        // Normals, constant along a straight edge.
+        normal_offsets.push_back(normals_x.size());
+        if(geometry_cache != NULL)
+        {
+          const CurvedGeometryCache::Geometry& geometry = geometry_cache->get_edge(e, edge_i, 20);
+          int np = e->is_curved() ? geometry.np : 1;
+          normals_x.insert(normals_x.end(), geometry.nx.begin(), geometry.nx.begin() + np);
+          normals_y.insert(normals_y.end(), geometry.ny.begin(), geometry.ny.begin() + np);
+          continue;
+        }
+        SurfPos surf_pos;
+        surf_pos.marker = e->marker;
+        surf_pos.surf_num = edge_i;
+        int eo = quad->get_edge_points(surf_pos.surf_num, 20);
+        Geom<double>* geom = init_geom_surf(&refmap, &surf_pos, eo);
+        int np = e->is_curved() ? quad->get_num_points(eo) : 1;
+        for(int point_i = 0; point_i < np; point_i++)
+        {
+          normals_x.push_back(geom->nx[point_i]);
+          normals_y.push_back(geom->ny[point_i]);
+        }
+        geom->free();
+        delete geom;
+      }
+    }
+    edge_offsets.push_back(edge_lengths.size());
+    normal_offsets.push_back(normals_x.size());
+
+    cached_mesh = mesh;
+    cached_mesh_seq = mesh->get_seq();
+  }
+
+  // Weights of the basis functions in the element averages, i.e. their integrals over the element divided by its area.
+  for(int space_i = 0; space_i < 4; space_i++)
+  {
+    if(spaces[space_i]->get_mesh()->get_seq() != cached_mesh_seq)
+      error("CFLCalculation needs all four spaces defined on the same mesh.");
+
+    average_offsets[space_i].clear();
+    average_dofs[space_i].clear();
+    average_weights[space_i].clear();
+
+    PrecalcShapeset pss(spaces[space_i]->get_shapeset());
+    pss.set_quad_2d(quad);
+
+    for(unsigned int element_i = 0; element_i < elements.size(); element_i++)
+    {
+      e = elements[element_i];
+      average_offsets[space_i].push_back(average_dofs[space_i].size());
+
+      AsmList<double> al;
+      spaces[space_i]->get_element_assembly_list(e, &al);
+
+      update_limit_table(e->get_mode());
+      refmap.set_active_element(e);
+      pss.set_active_element(e);
+
+      // Exact for the jacobian of a bilinear map.
+      int order = spaces[space_i]->get_element_order(e->id);
+      int o = e->is_triangle() ? H2D_GET_H_ORDER(order) + 2 : H2D_MAKE_QUAD_ORDER(H2D_GET_H_ORDER(order) + 2, H2D_GET_V_ORDER(order) + 2);
+      double3* pt = quad->get_points(o);
+      int np = quad->get_num_points(o);
+
+      // The weights multiplied by the jacobian.
+      std::vector<double> jwt(np);
+      if(geometry_cache != NULL)
+        jwt = geometry_cache->get_volume(e, o).jwt;
+      else
+      {
+        double* jac = NULL;
+        if(!refmap.is_jacobian_const())
+          jac = refmap.get_jacobian(o);
+        double const_jac = refmap.is_jacobian_const() ? refmap.get_const_jacobian() : 0.0;
+        for(int point_i = 0; point_i < np; point_i++)
+          jwt[point_i] = pt[point_i][2] * (jac == NULL ? const_jac : jac[point_i]);
+      }
+
+      double area = 0.0;
+      for(int point_i = 0; point_i < np; point_i++)
+        area += jwt[point_i];
+
+      for(unsigned int shape_i = 0; shape_i < al.get_cnt(); shape_i++)
+      {
+        pss.set_active_shape(al.get_idx()[shape_i]);
+        pss.set_quad_order(o, H2D_FN_VAL);
+        double* val = pss.get_fn_values();
+
+        double integral = 0.0;
+        for(int point_i = 0; point_i < np; point_i++)
+          integral += jwt[point_i] * val[point_i];
+
+        // Functions with zero mean (all but the constant one in the Legendre shapeset) do not contribute.
+        if(std::abs(integral) > 1E-12 * area)
+        {
+          average_dofs[space_i].push_back(al.get_dof()[shape_i]);
+          average_weights[space_i].push_back(al.get_coef()[shape_i] * integral / area);
+        }
+      }
+    }
+    average_offsets[space_i].push_back(average_dofs[space_i].size());
+
+    cached_spaces[space_i] = spaces[space_i];
+    cached_space_seqs[space_i] = spaces[space_i]->get_seq();
+  }
+}
+
+void CFLCalculation::get_averages(double* sln_vector, int element_i, double w[4]) const
+{
+  for(int i = 0; i < 4; i++)
+  {
+    w[i] = 0.0;
+    for(int k = average_offsets[i][element_i]; k < average_offsets[i][element_i + 1]; k++)
+      w[i] += sln_vector[average_dofs[i][k]] * average_weights[i][k];
+  }
+}
+
 void CFLCalculation::set_number(double new_CFL_number)
 {
   this->CFL_number = new_CFL_number;
 }
 
+void CFLCalculation::set_geometry_cache(CurvedGeometryCache* geometry_cache)
+{
+  this->geometry_cache = geometry_cache;
+}
+
 ADEStabilityCalculation::ADEStabilityCalculation(double AdvectionRelativeConstant, double DiffusionRelativeConstant, double epsilon) 
   : AdvectionRelativeConstant(AdvectionRelativeConstant), DiffusionRelativeConstant(DiffusionRelativeConstant), epsilon(epsilon)
 {
@@ -217,13 +709,177 @@ double ADEStabilityCalculation::approximate_inscribed_circle_radius(Element * e)
   return h / 2;
 }
 
+VertexPatches::VertexPatches() : mesh(NULL), mesh_seq(-1)
+{
+}
+
+void VertexPatches::update(Mesh* mesh)
+{
+  if(mesh == this->mesh && mesh->get_seq() == this->mesh_seq)
+    return;
+
+  std::vector<std::vector<int> > patches(mesh->get_max_node_id() + 1);
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    for(unsigned int i = 0; i < e->get_num_surf(); i++)
+    {
+      patches[e->vn[i]->id].push_back(e->id);
+      add_to_hanging_vertex_patches(mesh, e, e->vn[i]->id, e->vn[e->next_vert(i)]->id, patches);
+    }
+  }
+
+  // Flatten.
+  offsets.resize(patches.size() + 1);
+  element_ids.clear();
+  for(unsigned int i = 0; i < patches.size(); i++)
+  {
+    offsets[i] = element_ids.size();
+    element_ids.insert(element_ids.end(), patches[i].begin(), patches[i].end());
+  }
+  offsets[patches.size()] = element_ids.size();
+
+  this->mesh = mesh;
+  this->mesh_seq = mesh->get_seq();
+}
+
+void VertexPatches::add_to_hanging_vertex_patches(Mesh* mesh, Element* e, int id1, int id2, std::vector<std::vector<int> >& patches)
+{
+  // The midpoint of an active edge exists only if the neighbor across the edge is refined.
+  Node* node = mesh->peek_vertex_node(id1, id2);
+  if(node == NULL)
+    return;
+  patches[node->id].push_back(e->id);
+  add_to_hanging_vertex_patches(mesh, e, id1, node->id, patches);
+  add_to_hanging_vertex_patches(mesh, e, node->id, id2, patches);
+}
+
+const int* VertexPatches::get_patch(int vertex_id, int& count) const
+{
+  count = offsets[vertex_id + 1] - offsets[vertex_id];
+  return &element_ids[0] + offsets[vertex_id];
+}
+
+ReferenceBasisTable::ReferenceBasisTable(Shapeset* shapeset) : shapeset(shapeset)
+{
+}
+
+void ReferenceBasisTable::prepare(int mode, int index)
+{
+  if((int)tables[mode].size() <= index)
+    tables[mode].resize(index + 1);
+  if(!tables[mode][index].empty())
+    return;
+
+  tables[mode][index].resize(POINT_COUNT * VALUE_COUNT, 0.0);
+  shapeset->set_mode(mode);
+  int vertex_count = (mode == HERMES_MODE_TRIANGLE) ? 3 : 4;
+  for(int point_i = 0; point_i < POINT_COUNT; point_i++)
+  {
+    if(point_i >= vertex_count && point_i != CENTROID)
+      continue;
+    double x, y;
+    get_point(mode, point_i, x, y);
+    for(int value_i = 0; value_i < VALUE_COUNT; value_i++)
+      tables[mode][index][point_i * VALUE_COUNT + value_i] = shapeset->get_value(value_i, index, x, y, 0);
+  }
+}
+
+const double* ReferenceBasisTable::get(int mode, int index) const
+{
+  return &tables[mode][index][0];
+}
+
+void ReferenceBasisTable::get_point(int mode, int point_i, double& x, double& y)
+{
+  // Vertices in the order of Element::vn, the centroid is the last one.
+  static const double triangle_points[POINT_COUNT][2] = { { -1.0, -1.0 }, { 1.0, -1.0 }, { -1.0, 1.0 }, { 0.0, 0.0 }, { -1.0 / 3.0, -1.0 / 3.0 } };
+  static const double quad_points[POINT_COUNT][2] = { { -1.0, -1.0 }, { 1.0, -1.0 }, { 1.0, 1.0 }, { -1.0, 1.0 }, { 0.0, 0.0 } };
+  if(mode == HERMES_MODE_TRIANGLE)
+  {
+    x = triangle_points[point_i][0];
+    y = triangle_points[point_i][1];
+  }
+  else
+  {
+    x = quad_points[point_i][0];
+    y = quad_points[point_i][1];
+  }
+}
+
 DiscontinuityDetector::DiscontinuityDetector(Hermes::vector<Space<double>*> spaces, 
-  Hermes::vector<Solution<double>*> solutions) : spaces(spaces), solutions(solutions)
+  Hermes::vector<Solution<double>*> solutions) : spaces(spaces), solutions(solutions), geometry_cache(NULL)
 {
 };
 
 DiscontinuityDetector::~DiscontinuityDetector()
-{};
+{
+  // The first thread uses the original solutions.
+  for(unsigned int thread_i = 1; thread_i < thread_solutions.size(); thread_i++)
+    for(unsigned int sol_i = 0; sol_i < thread_solutions[thread_i].size(); sol_i++)
+      delete thread_solutions[thread_i][sol_i];
+};
+
+bool DiscontinuityDetector::is_discontinuous(int element_id) const
+{
+  return element_id < (int)discontinuous_element_flags.size() && discontinuous_element_flags[element_id];
+}
+
+void DiscontinuityDetector::set_geometry_cache(CurvedGeometryCache* geometry_cache)
+{
+  this->geometry_cache = geometry_cache;
+}
+
+void DiscontinuityDetector::init_parallel_pass()
+{
+  active_elements.clear();
+  Element* e;
+  for_all_active_elements(e, mesh)
+    active_elements.push_back(e);
+
+  // The threads only add the geometry of their elements.
+  if(geometry_cache != NULL)
+    geometry_cache->update(mesh);
+
+  if(thread_solutions.empty())
+  {
+    int thread_count = 1;
+#ifdef _OPENMP
+    thread_count = omp_get_max_threads();
+#endif
+
+    thread_solutions.push_back(solutions);
+    for(int thread_i = 1; thread_i < thread_count; thread_i++)
+    {
+      Hermes::vector<Solution<double>*> solution_copies;
+      for(unsigned int sol_i = 0; sol_i < solutions.size(); sol_i++)
+        solution_copies.push_back(new Solution<double>(solutions[sol_i]->get_mesh()));
+      thread_solutions.push_back(solution_copies);
+    }
+  }
+
+  // The solutions may have changed since the last pass (a detector reused over the time steps).
+  for(unsigned int thread_i = 1; thread_i < thread_solutions.size(); thread_i++)
+    for(unsigned int sol_i = 0; sol_i < solutions.size(); sol_i++)
+      thread_solutions[thread_i][sol_i]->copy(solutions[sol_i]);
+}
+
+Hermes::vector<Solution<double>*>& DiscontinuityDetector::get_thread_solutions()
+{
+  int thread_num = 0;
+#ifdef _OPENMP
+  thread_num = omp_get_thread_num();
+#endif
+  return thread_solutions[thread_num];
+}
+
+void DiscontinuityDetector::flags_to_ids(const std::vector<char>& flags, std::vector<int>& element_ids)
+{
+  element_ids.clear();
+  for(unsigned int element_id = 0; element_id < flags.size(); element_id++)
+    if(flags[element_id])
+      element_ids.push_back(element_id);
+}
 
 KrivodonovaDiscontinuityDetector::KrivodonovaDiscontinuityDetector(Hermes::vector<Space<double>*> spaces, 
   Hermes::vector<Solution<double>*> solutions) : DiscontinuityDetector(spaces, solutions)
@@ -253,16 +909,21 @@ double KrivodonovaDiscontinuityDetector::calculate_h(Element* e, int polynomial_
     + 1) / 2);
 }
 
-std::set<int>& KrivodonovaDiscontinuityDetector::get_discontinuous_element_ids()
+std::vector<int>& KrivodonovaDiscontinuityDetector::get_discontinuous_element_ids()
 {
   return get_discontinuous_element_ids(1.0);
 };
 
-std::set<int>& KrivodonovaDiscontinuityDetector::get_discontinuous_element_ids(double threshold)
+std::vector<int>& KrivodonovaDiscontinuityDetector::get_discontinuous_element_ids(double threshold)
 {
-  Element* e;
-  for_all_active_elements(e, mesh)
+  init_parallel_pass();
+  discontinuous_element_flags.assign(mesh->get_max_element_id() + 1, 0);
+
+  int element_count = active_elements.size();
+#pragma omp parallel for schedule(dynamic, 16)
+  for(int element_i = 0; element_i < element_count; element_i++)
   {
+    Element* e = active_elements[element_i];
     bool element_inserted = false;
     for(int edge_i = 0; edge_i < e->get_num_surf() && !element_inserted; edge_i++)
       if(calculate_relative_flow_direction(e, edge_i) < 0 && !e->en[edge_i]->bnd)
@@ -282,18 +943,23 @@ std::set<int>& KrivodonovaDiscontinuityDetector::get_discontinuous_element_ids(d
           double discontinuity_detector = jumps[component_i] / (diameter_indicator * edge_length * norms[component_i]);
           if(discontinuity_detector > threshold)
           {
-            discontinuous_element_ids.insert(e->id);
+            discontinuous_element_flags[e->id] = 1;
             element_inserted = true;
             break;
           }
         }
       }
   }
+
+  flags_to_ids(discontinuous_element_flags, discontinuous_element_ids);
   return discontinuous_element_ids;
 };
 
 double KrivodonovaDiscontinuityDetector::calculate_relative_flow_direction(Element* e, int edge_i)
 {
+  // This thread's solutions.
+  Hermes::vector<Solution<double>*>& solutions = get_thread_solutions();
+
   // Set active element to the two solutions (density_vel_x, density_vel_y).
   solutions[1]->set_active_element(e);
   solutions[2]->set_active_element(e);
@@ -307,11 +973,29 @@ double KrivodonovaDiscontinuityDetector::calculate_relative_flow_direction(Eleme
   double3* pt = solutions[1]->get_quad_2d()->get_points(eo);
   int np = solutions[1]->get_quad_2d()->get_num_points(eo);
 
-  Geom<double>* geom = init_geom_surf(solutions[1]->get_refmap(), &surf_pos, eo);
-  double3* tan = solutions[1]->get_refmap()->get_tangent(surf_pos.surf_num, eo);
-  double* jwt = new double[np];
-  for(int i = 0; i < np; i++)
-    jwt[i] = pt[i][2] * tan[i][2];
+  Geom<double>* geom = NULL;
+  double* jwt_calculated = NULL;
+  const double* jwt;
+  const double* nx;
+  const double* ny;
+  if(geometry_cache != NULL)
+  {
+    const CurvedGeometryCache::Geometry& geometry = geometry_cache->get_edge(e, edge_i, 20);
+    jwt = &geometry.jwt[0];
+    nx = &geometry.nx[0];
+    ny = &geometry.ny[0];
+  }
+  else
+  {
+    geom = init_geom_surf(solutions[1]->get_refmap(), &surf_pos, eo);
+    double3* tan = solutions[1]->get_refmap()->get_tangent(surf_pos.surf_num, eo);
+    jwt_calculated = new double[np];
+    for(int i = 0; i < np; i++)
+      jwt_calculated[i] = pt[i][2] * tan[i][2];
+    jwt = jwt_calculated;
+    nx = geom->nx;
+    ny = geom->ny;
+  }
 
   // Calculate.
   Func<double>* density_vel_x = init_fn(solutions[1], eo);
@@ -319,11 +1003,14 @@ double KrivodonovaDiscontinuityDetector::calculate_relative_flow_direction(Eleme
 
   double result = 0.0;
   for(int point_i = 0; point_i < np; point_i++)
-    result += jwt[point_i] * density_vel_x->val[point_i] * geom->nx[point_i] + density_vel_y->val[point_i] * geom->ny[point_i];
+    result += jwt[point_i] * density_vel_x->val[point_i] * nx[point_i] + density_vel_y->val[point_i] * ny[point_i];
 
-  geom->free();
-  delete geom;
-  delete [] jwt;
+  if(geom != NULL)
+  {
+    geom->free();
+    delete geom;
+    delete [] jwt_calculated;
+  }
   density_vel_x->free_fn();
   density_vel_y->free_fn();
   delete density_vel_x;
@@ -334,6 +1021,9 @@ double KrivodonovaDiscontinuityDetector::calculate_relative_flow_direction(Eleme
 
 void KrivodonovaDiscontinuityDetector::calculate_jumps(Element* e, int edge_i, double result[4])
 {
+  // This thread's solutions.
+  Hermes::vector<Solution<double>*>& solutions = get_thread_solutions();
+
   // Set Geometry.
   SurfPos surf_pos;
   surf_pos.marker = e->marker;
@@ -445,6 +1135,9 @@ void KrivodonovaDiscontinuityDetector::calculate_jumps(Element* e, int edge_i, d
 
 void KrivodonovaDiscontinuityDetector::calculate_norms(Element* e, int edge_i, double result[4])
 {
+  // This thread's solutions.
+  Hermes::vector<Solution<double>*>& solutions = get_thread_solutions();
+
   // Set active element to the solutions.
   solutions[0]->set_active_element(e);
   solutions[1]->set_active_element(e);
@@ -462,16 +1155,10 @@ void KrivodonovaDiscontinuityDetector::calculate_norms(Element* e, int edge_i, d
   surf_pos.marker = e->marker;
   surf_pos.surf_num = edge_i;
 
+  // Only the values are needed, not the geometry of the edge.
   int eo = solutions[0]->get_quad_2d()->get_edge_points(surf_pos.surf_num, 8);
-  double3* pt = solutions[0]->get_quad_2d()->get_points(eo);
   int np = solutions[0]->get_quad_2d()->get_num_points(eo);
 
-  Geom<double>* geom = init_geom_surf(solutions[0]->get_refmap(), &surf_pos, eo);
-  double3* tan = solutions[0]->get_refmap()->get_tangent(surf_pos.surf_num, eo);
-  double* jwt = new double[np];
-  for(int i = 0; i < np; i++)
-    jwt[i] = pt[i][2] * tan[i][2];
-
   // Calculate.
   Func<double>* density = init_fn(solutions[0], eo);
   Func<double>* density_vel_x = init_fn(solutions[1], eo);
@@ -485,10 +1172,6 @@ void KrivodonovaDiscontinuityDetector::calculate_norms(Element* e, int edge_i, d
     result[3] = std::max(result[3], std::abs(energy->val[point_i]));
   }
 
-  geom->free();
-  delete geom;
-  delete [] jwt;
-
   density->free_fn();
   density_vel_x->free_fn();
   density_vel_y->free_fn();
@@ -500,8 +1183,11 @@ void KrivodonovaDiscontinuityDetector::calculate_norms(Element* e, int edge_i, d
   delete energy;
 };
 
+VertexPatches KuzminDiscontinuityDetector::vertex_patches;
+
 KuzminDiscontinuityDetector::KuzminDiscontinuityDetector(Hermes::vector<Space<double>*> spaces, 
-  Hermes::vector<Solution<double>*> solutions, bool limit_all_orders_independently) : DiscontinuityDetector(spaces, solutions), limit_all_orders_independently(limit_all_orders_independently)
+  Hermes::vector<Solution<double>*> solutions, bool limit_all_orders_independently, double* solution_vector) : DiscontinuityDetector(spaces, solutions), 
+  solution_vector(solution_vector), limit_all_orders_independently(limit_all_orders_independently)
 {
   // A check that all meshes are the same in the spaces.
   unsigned int mesh0_seq = spaces[0]->get_mesh()->get_seq();
@@ -514,20 +1200,33 @@ KuzminDiscontinuityDetector::KuzminDiscontinuityDetector(Hermes::vector<Space<do
 KuzminDiscontinuityDetector::~KuzminDiscontinuityDetector()
 {};
 
-std::set<int>& KuzminDiscontinuityDetector::get_discontinuous_element_ids()
+std::vector<int>& KuzminDiscontinuityDetector::get_discontinuous_element_ids()
 {
-  Element* e;
-
-  for_all_active_elements(e, mesh)
+  init_parallel_pass();
+  prepare_tabulation();
+  vertex_patches.update(mesh);
+  find_all_centroid_values();
+  // Already there if the second order discontinuous elements were searched for.
+  if(centroid_derivatives.empty())
+    find_all_centroid_derivatives();
+
+  discontinuous_element_flags.assign(mesh->get_max_element_id() + 1, 0);
+
+  int element_count = active_elements.size();
+#pragma omp parallel for schedule(dynamic, 16)
+  for(int element_i = 0; element_i < element_count; element_i++)
   {
+    Element* e = active_elements[element_i];
     if(!limit_all_orders_independently)
-      if(this->second_order_discontinuous_element_ids.find(e->id) == this->second_order_discontinuous_element_ids.end())
+      if(this->second_order_discontinuous_element_flags.empty() || !this->second_order_discontinuous_element_flags[e->id])
         continue;
-    if(e->get_num_surf() == 3)
-      error("So far this limiter is implemented just for quads.");
     double u_c[4], u_dx_c[4], u_dy_c[4];
-    find_centroid_values(e, u_c);
-    find_centroid_derivatives(e, u_dx_c, u_dy_c);
+    for(unsigned int i = 0; i < 4; i++)
+    {
+      u_c[i] = centroid_values[4 * e->id + i];
+      u_dx_c[i] = centroid_derivatives[8 * e->id + i];
+      u_dy_c[i] = centroid_derivatives[8 * e->id + 4 + i];
+    }
 
     // Vertex values.
     double u_i[4][4];
@@ -546,7 +1245,7 @@ std::set<int>& KuzminDiscontinuityDetector::get_discontinuous_element_ids()
 
     // alpha_i calculation.
     double alpha_i_first_order[4];
-    find_alpha_i_first_order(u_i_min_first_order, u_i_max_first_order, u_c, u_i, alpha_i_first_order);
+    find_alpha_i_first_order(e, u_i_min_first_order, u_i_max_first_order, u_c, u_i, alpha_i_first_order);
 
     // measure.
     for(unsigned int i = 0; i < 4; i++)
@@ -554,23 +1253,34 @@ std::set<int>& KuzminDiscontinuityDetector::get_discontinuous_element_ids()
       {
         // check for sanity.
         if(std::abs(u_c[i]) > 1E-12 && (std::abs(u_dx_c[i]) > 1E-12 || std::abs(u_dy_c[i]) > 1E-12))
-          discontinuous_element_ids.insert(e->id);
+          discontinuous_element_flags[e->id] = 1;
       }
   }
 
+  flags_to_ids(discontinuous_element_flags, discontinuous_element_ids);
   return discontinuous_element_ids;
 }
 
-std::set<int>& KuzminDiscontinuityDetector::get_second_order_discontinuous_element_ids()
+std::vector<int>& KuzminDiscontinuityDetector::get_second_order_discontinuous_element_ids()
 {
-  Element* e;
+  init_parallel_pass();
+  prepare_tabulation();
+  vertex_patches.update(mesh);
+  find_all_centroid_derivatives();
 
-  for_all_active_elements(e, mesh)
+  second_order_discontinuous_element_flags.assign(mesh->get_max_element_id() + 1, 0);
+
+  int element_count = active_elements.size();
+#pragma omp parallel for schedule(dynamic, 16)
+  for(int element_i = 0; element_i < element_count; element_i++)
   {
-    if(e->get_num_surf() == 3)
-      error("So far this limiter is implemented just for quads.");
+    Element* e = active_elements[element_i];
     double u_dx_c[4], u_dy_c[4], u_dxx_c[4], u_dxy_c[4], u_dyy_c[4];
-    find_centroid_derivatives(e, u_dx_c, u_dy_c);
+    for(unsigned int i = 0; i < 4; i++)
+    {
+      u_dx_c[i] = centroid_derivatives[8 * e->id + i];
+      u_dy_c[i] = centroid_derivatives[8 * e->id + 4 + i];
+    }
     find_second_centroid_derivatives(e, u_dxx_c, u_dxy_c, u_dyy_c);
 
     // Vertex values.
@@ -591,7 +1301,7 @@ std::set<int>& KuzminDiscontinuityDetector::get_second_order_discontinuous_eleme
 
     // alpha_i calculation.
     double alpha_i_second_order[4];
-    find_alpha_i_second_order(u_d_i_min_second_order, u_d_i_max_second_order, u_dx_c, u_dy_c, u_d_i, alpha_i_second_order);
+    find_alpha_i_second_order(e, u_d_i_min_second_order, u_d_i_max_second_order, u_dx_c, u_dy_c, u_d_i, alpha_i_second_order);
 
     // measure.
     for(unsigned int i = 0; i < 4; i++)
@@ -599,10 +1309,11 @@ std::set<int>& KuzminDiscontinuityDetector::get_second_order_discontinuous_eleme
       {
         // check for sanity.
         if((std::abs(u_dx_c[i]) > 1E-12 || std::abs(u_dy_c[i]) > 1E-12) && (std::abs(u_dxx_c[i]) > 1E-12 || std::abs(u_dxy_c[i]) > 1E-12 || std::abs(u_dyy_c[i]) > 1E-12))
-          second_order_discontinuous_element_ids.insert(e->id);
+          second_order_discontinuous_element_flags[e->id] = 1;
       }
   }
 
+  flags_to_ids(second_order_discontinuous_element_flags, second_order_discontinuous_element_ids);
   return second_order_discontinuous_element_ids;
 }
 
@@ -611,48 +1322,181 @@ bool KuzminDiscontinuityDetector::get_limit_all_orders_independently()
   return this->limit_all_orders_independently;
 }
 
-void KuzminDiscontinuityDetector::find_centroid_values(Hermes::Hermes2D::Element* e, double u_c[4])
+void KuzminDiscontinuityDetector::prepare_tabulation()
 {
-  double c_x, c_y;
-  double c_ref_x, c_ref_y;
-  if(e->get_num_surf() == 3)
+  if(solution_vector == NULL || !tabulated_elements.empty())
+    return;
+
+  int id_count = mesh->get_max_element_id() + 1;
+  tabulated_elements.assign(id_count, 0);
+  inverse_jacobians.resize(4 * id_count);
+  basis_starts.resize(spaces.size());
+  basis_counts.resize(spaces.size());
+  basis_dofs.resize(spaces.size());
+  basis_indices.resize(spaces.size());
+  for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+  {
+    basis_tables.push_back(ReferenceBasisTable(spaces[space_i]->get_shapeset()));
+    basis_starts[space_i].assign(id_count, 0);
+    basis_counts[space_i].assign(id_count, 0);
+  }
+
+  for(unsigned int element_i = 0; element_i < active_elements.size(); element_i++)
+  {
+    Element* e = active_elements[element_i];
+
+    // Curved elements and general quads go through the reference mapping.
+    if(e->is_curved())
+      continue;
+    Node** vn = e->vn;
+    double a = 0.5 * (vn[1]->x - vn[0]->x);
+    double c = 0.5 * (vn[1]->y - vn[0]->y);
+    int last = e->is_triangle() ? 2 : 3;
+    double b = 0.5 * (vn[last]->x - vn[0]->x);
+    double d = 0.5 * (vn[last]->y - vn[0]->y);
+    if(e->is_quad())
+    {
+      double size = std::abs(a) + std::abs(b) + std::abs(c) + std::abs(d);
+      if(std::abs(vn[0]->x + vn[2]->x - vn[1]->x - vn[3]->x) > 1E-10 * size || std::abs(vn[0]->y + vn[2]->y - vn[1]->y - vn[3]->y) > 1E-10 * size)
+        continue;
+    }
+
+    // Basis, the tabulation needs all dofs to be in the coefficient vector.
+    bool all_dofs_free = true;
+    for(unsigned int space_i = 0; space_i < spaces.size() && all_dofs_free; space_i++)
+    {
+      AsmList<double> al;
+      spaces[space_i]->get_element_assembly_list(e, &al);
+      basis_starts[space_i][e->id] = basis_dofs[space_i].size();
+      basis_counts[space_i][e->id] = al.get_cnt();
+      for(unsigned int shape_i = 0; shape_i < al.get_cnt(); shape_i++)
+      {
+        if(al.get_dof()[shape_i] < 0)
+          all_dofs_free = false;
+        basis_dofs[space_i].push_back(al.get_dof()[shape_i]);
+        basis_indices[space_i].push_back(al.get_idx()[shape_i]);
+        basis_tables[space_i].prepare(e->get_mode(), al.get_idx()[shape_i]);
+      }
+    }
+    if(!all_dofs_free)
+      continue;
+
+    double det = a * d - b * c;
+    inverse_jacobians[4 * e->id] = d / det;
+    inverse_jacobians[4 * e->id + 1] = -b / det;
+    inverse_jacobians[4 * e->id + 2] = -c / det;
+    inverse_jacobians[4 * e->id + 3] = a / det;
+    tabulated_elements[e->id] = 1;
+  }
+}
+
+bool KuzminDiscontinuityDetector::is_tabulated(Hermes::Hermes2D::Element* e) const
+{
+  return !tabulated_elements.empty() && tabulated_elements[e->id];
+}
+
+void KuzminDiscontinuityDetector::evaluate_tabulated(Hermes::Hermes2D::Element* e, int sol_i, int point_i, double result[6]) const
+{
+  // Derivatives w.r.t. the reference coordinates.
+  double ref[ReferenceBasisTable::VALUE_COUNT] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  int start = basis_starts[sol_i][e->id];
+  int end = start + basis_counts[sol_i][e->id];
+  for(int k = start; k < end; k++)
+  {
+    const double* table = basis_tables[sol_i].get(e->get_mode(), basis_indices[sol_i][k]) + point_i * ReferenceBasisTable::VALUE_COUNT;
+    double coefficient = solution_vector[basis_dofs[sol_i][k]];
+    for(int value_i = 0; value_i < ReferenceBasisTable::VALUE_COUNT; value_i++)
+      ref[value_i] += coefficient * table[value_i];
+  }
+
+  // Transformation to the physical derivatives, the map is affine.
+  const double* m = &inverse_jacobians[4 * e->id];
+  result[0] = ref[0];
+  result[1] = ref[1] * m[0] + ref[2] * m[2];
+  result[2] = ref[1] * m[1] + ref[2] * m[3];
+  result[3] = ref[3] * m[0] * m[0] + 2 * ref[5] * m[0] * m[2] + ref[4] * m[2] * m[2];
+  result[4] = ref[3] * m[1] * m[1] + 2 * ref[5] * m[1] * m[3] + ref[4] * m[3] * m[3];
+  result[5] = ref[3] * m[0] * m[1] + ref[5] * (m[0] * m[3] + m[1] * m[2]) + ref[4] * m[2] * m[3];
+}
+
+void KuzminDiscontinuityDetector::find_reference_point(Hermes::Hermes2D::Element* e, RefMap* refmap, int point_i, double& xi, double& eta)
+{
+  if(geometry_cache != NULL)
+  {
+    const double* points = geometry_cache->get_reference_points(e);
+    xi = points[2 * point_i];
+    eta = points[2 * point_i + 1];
+    return;
+  }
+
+  double x, y;
+  if(point_i < (int)e->get_num_surf())
   {
-      c_x = (0.33333333333333333) * (e->vn[0]->x + e->vn[1]->x + e->vn[2]->x);
-      c_y = (0.33333333333333333) * (e->vn[0]->y + e->vn[1]->y + e->vn[2]->y);
+    x = e->vn[point_i]->x;
+    y = e->vn[point_i]->y;
+  }
+  else if(e->get_num_surf() == 3)
+  {
+    x = (0.33333333333333333) * (e->vn[0]->x + e->vn[1]->x + e->vn[2]->x);
+    y = (0.33333333333333333) * (e->vn[0]->y + e->vn[1]->y + e->vn[2]->y);
   }
   else
   {
-      c_x = (0.25) * (e->vn[0]->x + e->vn[1]->x + e->vn[2]->x + e->vn[3]->x);
-      c_y = (0.25) * (e->vn[0]->y + e->vn[1]->y + e->vn[2]->y + e->vn[3]->y);
+    x = (0.25) * (e->vn[0]->x + e->vn[1]->x + e->vn[2]->x + e->vn[3]->x);
+    y = (0.25) * (e->vn[0]->y + e->vn[1]->y + e->vn[2]->y + e->vn[3]->y);
+  }
+  refmap->untransform(e, x, y, xi, eta);
+}
+
+void KuzminDiscontinuityDetector::find_centroid_values(Hermes::Hermes2D::Element* e, double u_c[4])
+{
+  if(is_tabulated(e))
+  {
+    double result[ReferenceBasisTable::VALUE_COUNT];
+    for(unsigned int i = 0; i < this->solutions.size(); i++)
+    {
+      evaluate_tabulated(e, i, ReferenceBasisTable::CENTROID, result);
+      u_c[i] = result[0];
+    }
+    return;
   }
 
+  // This thread's solutions.
+  Hermes::vector<Solution<double>*>& solutions = get_thread_solutions();
+
+  double c_ref_x, c_ref_y;
+
   for(unsigned int i = 0; i < this->solutions.size(); i++)
   {
     solutions[i]->set_active_element(e);
-    solutions[i]->get_refmap()->untransform(e, c_x, c_y, c_ref_x, c_ref_y);
+    find_reference_point(e, solutions[i]->get_refmap(), e->get_num_surf(), c_ref_x, c_ref_y);
     u_c[i] = solutions[i]->get_ref_value_transformed(e, c_ref_x, c_ref_y, 0, 0);
   }
 }
 
 void KuzminDiscontinuityDetector::find_centroid_derivatives(Hermes::Hermes2D::Element* e, double u_dx_c[4], double u_dy_c[4])
 {
-  double c_x, c_y;
-  double c_ref_x, c_ref_y;
-  if(e->get_num_surf() == 3)
+  if(is_tabulated(e))
   {
-      c_x = (0.33333333333333333) * (e->vn[0]->x + e->vn[1]->x + e->vn[2]->x);
-      c_y = (0.33333333333333333) * (e->vn[0]->y + e->vn[1]->y + e->vn[2]->y);
-  }
-  else
-  {
-      c_x = (0.25) * (e->vn[0]->x + e->vn[1]->x + e->vn[2]->x + e->vn[3]->x);
-      c_y = (0.25) * (e->vn[0]->y + e->vn[1]->y + e->vn[2]->y + e->vn[3]->y);
+    double result[ReferenceBasisTable::VALUE_COUNT];
+    for(unsigned int i = 0; i < this->solutions.size(); i++)
+    {
+      evaluate_tabulated(e, i, ReferenceBasisTable::CENTROID, result);
+      u_dx_c[i] = result[1];
+      u_dy_c[i] = result[2];
+    }
+    return;
   }
 
+  // This thread's solutions.
+  Hermes::vector<Solution<double>*>& solutions = get_thread_solutions();
+
+  double c_ref_x, c_ref_y;
+
   for(unsigned int i = 0; i < this->solutions.size(); i++)
   {
     solutions[i]->set_active_element(e);
-    solutions[i]->get_refmap()->untransform(e, c_x, c_y, c_ref_x, c_ref_y);
+    find_reference_point(e, solutions[i]->get_refmap(), e->get_num_surf(), c_ref_x, c_ref_y);
     u_dx_c[i] = solutions[i]->get_ref_value_transformed(e, c_ref_x, c_ref_y, 0, 1);
     u_dy_c[i] = solutions[i]->get_ref_value_transformed(e, c_ref_x, c_ref_y, 0, 2);
   }
@@ -660,38 +1504,82 @@ void KuzminDiscontinuityDetector::find_centroid_derivatives(Hermes::Hermes2D::El
 
 void KuzminDiscontinuityDetector::find_second_centroid_derivatives(Hermes::Hermes2D::Element* e, double u_dxx_c[4], double u_dxy_c[4], double u_dyy_c[4])
 {
-  double c_x, c_y;
-  double c_ref_x, c_ref_y;
-  if(e->get_num_surf() == 3)
-  {
-      c_x = (0.33333333333333333) * (e->vn[0]->x + e->vn[1]->x + e->vn[2]->x);
-      c_y = (0.33333333333333333) * (e->vn[0]->y + e->vn[1]->y + e->vn[2]->y);
-  }
-  else
+  if(is_tabulated(e))
   {
-      c_x = (0.25) * (e->vn[0]->x + e->vn[1]->x + e->vn[2]->x + e->vn[3]->x);
-      c_y = (0.25) * (e->vn[0]->y + e->vn[1]->y + e->vn[2]->y + e->vn[3]->y);
+    double result[ReferenceBasisTable::VALUE_COUNT];
+    for(unsigned int i = 0; i < this->solutions.size(); i++)
+    {
+      evaluate_tabulated(e, i, ReferenceBasisTable::CENTROID, result);
+      u_dxx_c[i] = result[3];
+      u_dyy_c[i] = result[4];
+      u_dxy_c[i] = result[5];
+    }
+    return;
   }
 
+  // This thread's solutions.
+  Hermes::vector<Solution<double>*>& solutions = get_thread_solutions();
+
+  double c_ref_x, c_ref_y;
+
   for(unsigned int i = 0; i < this->solutions.size(); i++)
   {
     solutions[i]->set_active_element(e);
-    solutions[i]->get_refmap()->untransform(e, c_x, c_y, c_ref_x, c_ref_y);
+    find_reference_point(e, solutions[i]->get_refmap(), e->get_num_surf(), c_ref_x, c_ref_y);
     u_dxx_c[i] = solutions[i]->get_ref_value_transformed(e, c_ref_x, c_ref_y, 0, 3);
     u_dyy_c[i] = solutions[i]->get_ref_value_transformed(e, c_ref_x, c_ref_y, 0, 4);
     u_dxy_c[i] = solutions[i]->get_ref_value_transformed(e, c_ref_x, c_ref_y, 0, 5);
   }
 }
 
+void KuzminDiscontinuityDetector::find_all_centroid_values()
+{
+  centroid_values.resize(4 * (mesh->get_max_element_id() + 1));
+  int element_count = active_elements.size();
+#pragma omp parallel for schedule(dynamic, 16)
+  for(int element_i = 0; element_i < element_count; element_i++)
+  {
+    Element* e = active_elements[element_i];
+    find_centroid_values(e, &centroid_values[4 * e->id]);
+  }
+}
+
+void KuzminDiscontinuityDetector::find_all_centroid_derivatives()
+{
+  centroid_derivatives.resize(8 * (mesh->get_max_element_id() + 1));
+  int element_count = active_elements.size();
+#pragma omp parallel for schedule(dynamic, 16)
+  for(int element_i = 0; element_i < element_count; element_i++)
+  {
+    Element* e = active_elements[element_i];
+    find_centroid_derivatives(e, &centroid_derivatives[8 * e->id], &centroid_derivatives[8 * e->id + 4]);
+  }
+}
+
 void KuzminDiscontinuityDetector::find_vertex_values(Hermes::Hermes2D::Element* e, double vertex_values[4][4])
 {
+  if(is_tabulated(e))
+  {
+    double result[ReferenceBasisTable::VALUE_COUNT];
+    for(unsigned int i = 0; i < this->solutions.size(); i++)
+      for(unsigned int j = 0; j < e->get_num_surf(); j++)
+      {
+        evaluate_tabulated(e, i, j, result);
+        vertex_values[i][j] = result[0];
+      }
+    return;
+  }
+
+  // This thread's solutions.
+  Hermes::vector<Solution<double>*>& solutions = get_thread_solutions();
+
   double c_ref_x, c_ref_y;
   for(unsigned int i = 0; i < this->solutions.size(); i++)
   {
     for(unsigned int j = 0; j < e->get_num_surf(); j++)
     {
       solutions[i]->get_refmap()->set_active_element(e);
-      solutions[i]->get_refmap()->untransform(e, e->vn[j]->x, e->vn[j]->y, c_ref_x, c_ref_y);
+      find_reference_point(e, solutions[i]->get_refmap(), j, c_ref_x, c_ref_y);
       vertex_values[i][j] = solutions[i]->get_ref_value_transformed(e, c_ref_x, c_ref_y, 0, 0);
     }
   }
@@ -699,13 +1587,29 @@ void KuzminDiscontinuityDetector::find_vertex_values(Hermes::Hermes2D::Element*
 
 void KuzminDiscontinuityDetector::find_vertex_derivatives(Hermes::Hermes2D::Element* e, double vertex_derivatives[4][4][2])
 {
+  if(is_tabulated(e))
+  {
+    double result[ReferenceBasisTable::VALUE_COUNT];
+    for(unsigned int i = 0; i < this->solutions.size(); i++)
+      for(unsigned int j = 0; j < e->get_num_surf(); j++)
+      {
+        evaluate_tabulated(e, i, j, result);
+        vertex_derivatives[i][j][0] = result[1];
+        vertex_derivatives[i][j][1] = result[2];
+      }
+    return;
+  }
+
+  // This thread's solutions.
+  Hermes::vector<Solution<double>*>& solutions = get_thread_solutions();
+
   double c_ref_x, c_ref_y;
   for(unsigned int i = 0; i < this->solutions.size(); i++)
   {
     for(unsigned int j = 0; j < e->get_num_surf(); j++)
     {
       solutions[i]->get_refmap()->set_active_element(e);
-      solutions[i]->get_refmap()->untransform(e, e->vn[j]->x, e->vn[j]->y, c_ref_x, c_ref_y);
+      find_reference_point(e, solutions[i]->get_refmap(), j, c_ref_x, c_ref_y);
       vertex_derivatives[i][j][0] = solutions[i]->get_ref_value_transformed(e, c_ref_x, c_ref_y, 0, 1);
       vertex_derivatives[i][j][1] = solutions[i]->get_ref_value_transformed(e, c_ref_x, c_ref_y, 0, 2);
     }
@@ -716,56 +1620,28 @@ void KuzminDiscontinuityDetector::find_u_i_min_max_first_order(Hermes::Hermes2D:
 {
   for(unsigned int j = 0; j < e->get_num_surf(); j++)
   {
-    Hermes::Hermes2D::NeighborSearch<double> ns(e, mesh);
-    if(e->en[j]->bnd)
-      continue;
-    ns.set_active_edge(j);
-
-    // First beginning neighbors on every edge.
-    double u_c[4];
-    ns.set_active_segment(0);
-    find_centroid_values(ns.get_neighb_el(), u_c);
-    for(unsigned int min_i = 0; min_i < 4; min_i++)
-      if(u_i_min[min_i][j] > u_c[min_i])
-        u_i_min[min_i][j] = u_c[min_i];
-    for(unsigned int max_i = 0; max_i < 4; max_i++)
-      if(u_i_max[max_i][j] < u_c[max_i])
-        u_i_max[max_i][j] = u_c[max_i];
-
-    // Second end neighbors on every edge.
-    ns.set_active_segment(ns.get_num_neighbors() - 1);
-    find_centroid_values(ns.get_neighb_el(), u_c);
-    for(unsigned int min_i = 0; min_i < 4; min_i++)
-      if(u_i_min[min_i][(j + 1) % e->get_num_surf()] > u_c[min_i])
-        u_i_min[min_i][(j + 1) % e->get_num_surf()] = u_c[min_i];
-    for(unsigned int max_i = 0; max_i < 4; max_i++)
-      if(u_i_max[max_i][(j + 1) % e->get_num_surf()] < u_c[max_i])
-        u_i_max[max_i][(j + 1) % e->get_num_surf()] = u_c[max_i];
-
-    // Now the hard part, neighbors' neighbors.
-    /// \todo This is where it fails for triangles, where it is much more complicated to look for elements sharing a vertex.
-    ns.set_active_segment(0);
-    Hermes::Hermes2D::NeighborSearch<double> ns_1(ns.get_neighb_el(), mesh);
-    if(ns.get_neighb_el()->en[(ns.get_neighbor_edge().local_num_of_edge + 1) % ns.get_neighb_el()->get_num_surf()]->bnd)
-      continue;
-    ns_1.set_active_edge((ns.get_neighbor_edge().local_num_of_edge + 1) % ns.get_neighb_el()->get_num_surf());
-    ns_1.set_active_segment(0);
-    find_centroid_values(ns_1.get_neighb_el(), u_c);
-    for(unsigned int min_i = 0; min_i < 4; min_i++)
-      if(u_i_min[min_i][j] > u_c[min_i])
-        u_i_min[min_i][j] = u_c[min_i];
-    for(unsigned int max_i = 0; max_i < 4; max_i++)
-      if(u_i_max[max_i][j] < u_c[max_i])
-        u_i_max[max_i][j] = u_c[max_i];
+    // All elements sharing the vertex j (including e).
+    int patch_count;
+    const int* patch = vertex_patches.get_patch(e->vn[j]->id, patch_count);
+    for(int patch_i = 0; patch_i < patch_count; patch_i++)
+    {
+      const double* u_c = &centroid_values[4 * patch[patch_i]];
+      for(unsigned int min_i = 0; min_i < 4; min_i++)
+        if(u_i_min[min_i][j] > u_c[min_i])
+          u_i_min[min_i][j] = u_c[min_i];
+      for(unsigned int max_i = 0; max_i < 4; max_i++)
+        if(u_i_max[max_i][j] < u_c[max_i])
+          u_i_max[max_i][j] = u_c[max_i];
+    }
   }
 }
 
-void KuzminDiscontinuityDetector::find_alpha_i_first_order(double u_i_min[4][4], double u_i_max[4][4], double u_c[4], double u_i[4][4], double alpha_i[4])
+void KuzminDiscontinuityDetector::find_alpha_i_first_order(Hermes::Hermes2D::Element* e, double u_i_min[4][4], double u_i_max[4][4], double u_c[4], double u_i[4][4], double alpha_i[4])
 {
   for(unsigned int sol_i = 0; sol_i < 4; sol_i++)
   {
     alpha_i[sol_i] = 1;
-    for(unsigned int vertex_i = 0; vertex_i < 4; vertex_i++)
+    for(unsigned int vertex_i = 0; vertex_i < e->get_num_surf(); vertex_i++)
     {
       // Sanity checks.
       if(std::abs(u_i[sol_i][vertex_i] - u_c[sol_i]) < 1E-6)
@@ -814,80 +1690,37 @@ void KuzminDiscontinuityDetector::find_u_i_min_max_second_order(Hermes::Hermes2D
 {
   for(unsigned int j = 0; j < e->get_num_surf(); j++)
   {
-    Hermes::Hermes2D::NeighborSearch<double> ns(e, mesh);
-    if(e->en[j]->bnd)
-      continue;
-
-    ns.set_active_edge(j);
-
-    // First beginning neighbors on every edge.
-    double u_dx_c[4], u_dy_c[4];
-    ns.set_active_segment(0);
-    find_centroid_derivatives(ns.get_neighb_el(), u_dx_c, u_dy_c);
-    for(unsigned int min_i = 0; min_i < 4; min_i++)
-    {
-      if(u_d_i_min[min_i][j][0] > u_dx_c[min_i])
-        u_d_i_min[min_i][j][0] = u_dx_c[min_i];
-      if(u_d_i_min[min_i][j][1] > u_dy_c[min_i])
-        u_d_i_min[min_i][j][1] = u_dy_c[min_i];
-    }
-    for(unsigned int max_i = 0; max_i < 4; max_i++)
-    {
-      if(u_d_i_max[max_i][j][0] < u_dx_c[max_i])
-        u_d_i_max[max_i][j][0] = u_dx_c[max_i];
-      if(u_d_i_max[max_i][j][1] < u_dy_c[max_i])
-        u_d_i_max[max_i][j][1] = u_dy_c[max_i];
-    }
-    // Second end neighbors on every edge.
-    ns.set_active_segment(ns.get_num_neighbors() - 1);
-    find_centroid_derivatives(ns.get_neighb_el(), u_dx_c, u_dy_c);
-    for(unsigned int min_i = 0; min_i < 4; min_i++)
-    {
-      if(u_d_i_min[min_i][(j + 1) % e->get_num_surf()][0] > u_dx_c[min_i])
-        u_d_i_min[min_i][(j + 1) % e->get_num_surf()][0] = u_dx_c[min_i];
-      if(u_d_i_min[min_i][(j + 1) % e->get_num_surf()][1] > u_dy_c[min_i])
-        u_d_i_min[min_i][(j + 1) % e->get_num_surf()][1] = u_dy_c[min_i];
-    }
-    for(unsigned int max_i = 0; max_i < 4; max_i++)
-    {
-      if(u_d_i_max[max_i][(j + 1) % e->get_num_surf()][0] < u_dx_c[max_i])
-        u_d_i_max[max_i][(j + 1) % e->get_num_surf()][0] = u_dx_c[max_i];
-      if(u_d_i_max[max_i][(j + 1) % e->get_num_surf()][1] < u_dy_c[max_i])
-        u_d_i_max[max_i][(j + 1) % e->get_num_surf()][1] = u_dy_c[max_i];
-    }
-
-    // Now the hard part, neighbors' neighbors.
-    /// \todo This is where it fails for triangles, where it is much more complicated to look for elements sharing a vertex.
-    ns.set_active_segment(0);
-    Hermes::Hermes2D::NeighborSearch<double> ns_1(ns.get_neighb_el(), mesh);
-    if(ns.get_neighb_el()->en[(ns.get_neighbor_edge().local_num_of_edge + 1) % ns.get_neighb_el()->get_num_surf()]->bnd)
-      continue;
-    ns_1.set_active_edge((ns.get_neighbor_edge().local_num_of_edge + 1) % ns.get_neighb_el()->get_num_surf());
-    ns_1.set_active_segment(0);
-    find_centroid_derivatives(ns_1.get_neighb_el(), u_dx_c, u_dy_c);
-    for(unsigned int min_i = 0; min_i < 4; min_i++)
-    {
-      if(u_d_i_min[min_i][j][0] > u_dx_c[min_i])
-        u_d_i_min[min_i][j][0] = u_dx_c[min_i];
-      if(u_d_i_min[min_i][j][1] > u_dy_c[min_i])
-        u_d_i_min[min_i][j][1] = u_dy_c[min_i];
-    }
-    for(unsigned int max_i = 0; max_i < 4; max_i++)
+    // All elements sharing the vertex j (including e).
+    int patch_count;
+    const int* patch = vertex_patches.get_patch(e->vn[j]->id, patch_count);
+    for(int patch_i = 0; patch_i < patch_count; patch_i++)
     {
-      if(u_d_i_max[max_i][j][0] < u_dx_c[max_i])
-        u_d_i_max[max_i][j][0] = u_dx_c[max_i];
-      if(u_d_i_max[max_i][j][1] < u_dy_c[max_i])
-        u_d_i_max[max_i][j][1] = u_dy_c[max_i];
+      const double* u_dx_c = &centroid_derivatives[8 * patch[patch_i]];
+      const double* u_dy_c = &centroid_derivatives[8 * patch[patch_i] + 4];
+      for(unsigned int min_i = 0; min_i < 4; min_i++)
+      {
+        if(u_d_i_min[min_i][j][0] > u_dx_c[min_i])
+          u_d_i_min[min_i][j][0] = u_dx_c[min_i];
+        if(u_d_i_min[min_i][j][1] > u_dy_c[min_i])
+          u_d_i_min[min_i][j][1] = u_dy_c[min_i];
+      }
+      for(unsigned int max_i = 0; max_i < 4; max_i++)
+      {
+        if(u_d_i_max[max_i][j][0] < u_dx_c[max_i])
+          u_d_i_max[max_i][j][0] = u_dx_c[max_i];
+        if(u_d_i_max[max_i][j][1] < u_dy_c[max_i])
+          u_d_i_max[max_i][j][1] = u_dy_c[max_i];
+      }
     }
   }
 }
 
-void KuzminDiscontinuityDetector::find_alpha_i_second_order(double u_d_i_min[4][4][2], double u_d_i_max[4][4][2], double u_dx_c[4], double u_dy_c[4], double u_d_i[4][4][2], double alpha_i[4])
+void KuzminDiscontinuityDetector::find_alpha_i_second_order(Hermes::Hermes2D::Element* e, double u_d_i_min[4][4][2], double u_d_i_max[4][4][2], double u_dx_c[4], double u_dy_c[4], double u_d_i[4][4][2], double alpha_i[4])
 {
   for(unsigned int sol_i = 0; sol_i < 4; sol_i++)
   {
     alpha_i[sol_i] = 1;
-    for(unsigned int vertex_i = 0; vertex_i < 4; vertex_i++)
+    for(unsigned int vertex_i = 0; vertex_i < e->get_num_surf(); vertex_i++)
     {
       // Sanity checks.
       if(std::abs(u_dx_c[sol_i]) < 1E-5)
@@ -970,7 +1803,7 @@ FluxLimiter::FluxLimiter(FluxLimiter::LimitingType type, double* solution_vector
       this->detector = new KrivodonovaDiscontinuityDetector(spaces, limited_solutions);
       break;
     case Kuzmin:
-      this->detector = new KuzminDiscontinuityDetector(spaces, limited_solutions, Kuzmin_limit_all_orders_independently);
+      this->detector = new KuzminDiscontinuityDetector(spaces, limited_solutions, Kuzmin_limit_all_orders_independently, solution_vector);
       break;
   }
 };
@@ -988,15 +1821,23 @@ void FluxLimiter::get_limited_solutions(Hermes::vector<Solution<double>*> soluti
     solutions_to_limit[i]->copy(this->limited_solutions[i]);
 }
 
+void FluxLimiter::set_geometry_cache(CurvedGeometryCache* geometry_cache)
+{
+  detector->set_geometry_cache(geometry_cache);
+}
+
 void FluxLimiter::limit_according_to_detector(Hermes::vector<Space<double> *> coarse_spaces_to_limit)
 {
-  std::set<int> discontinuous_elements = this->detector->get_discontinuous_element_ids();
+  std::vector<int> discontinuous_elements = this->detector->get_discontinuous_element_ids();
+  int discontinuous_count = discontinuous_elements.size();
 
   // First adjust the solution_vector.
+  // The elements do not share dofs (L2 spaces), so they can be processed in parallel.
   for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
-    for(std::set<int>::iterator it = discontinuous_elements.begin(); it != discontinuous_elements.end(); it++) {
+#pragma omp parallel for
+    for(int discontinuous_i = 0; discontinuous_i < discontinuous_count; discontinuous_i++) {
       AsmList<double> al;
-      spaces[space_i]->get_element_assembly_list(spaces[space_i]->get_mesh()->get_element(*it), &al);
+      spaces[space_i]->get_element_assembly_list(spaces[space_i]->get_mesh()->get_element(discontinuous_elements[discontinuous_i]), &al);
       for(unsigned int shape_i = 0; shape_i < al.get_cnt(); shape_i++)
         if(H2D_GET_H_ORDER(spaces[space_i]->get_shapeset()->get_order(al.get_idx()[shape_i])) > 0 || H2D_GET_V_ORDER(spaces[space_i]->get_shapeset()->get_order(al.get_idx()[shape_i])) > 0)
           solution_vector[al.get_dof()[shape_i]] = 0.0;
@@ -1012,7 +1853,7 @@ void FluxLimiter::limit_according_to_detector(Hermes::vector<Space<double> *> co
       for_all_elements(e, spaces[0]->get_mesh())
         e->visited = false;
 
-      for(std::set<int>::iterator it = discontinuous_elements.begin(); it != discontinuous_elements.end(); it++) {
+      for(std::vector<int>::iterator it = discontinuous_elements.begin(); it != discontinuous_elements.end(); it++) {
         AsmList<double> al;
         spaces[0]->get_element_assembly_list(spaces[0]->get_mesh()->get_element(*it), &al);
         for(unsigned int shape_i = 0; shape_i < al.get_cnt(); shape_i++) {
@@ -1038,17 +1879,20 @@ void FluxLimiter::limit_according_to_detector(Hermes::vector<Space<double> *> co
 
 void FluxLimiter::limit_second_orders_according_to_detector(Hermes::vector<Space<double> *> coarse_spaces_to_limit)
 {
-  std::set<int> discontinuous_elements;
+  std::vector<int> discontinuous_elements;
   if(dynamic_cast<KuzminDiscontinuityDetector*>(this->detector))
     discontinuous_elements = static_cast<KuzminDiscontinuityDetector*>(this->detector)->get_second_order_discontinuous_element_ids();
   else
     error("limit_second_orders_according_to_detector() is to be used only with Kuzmin's vertex based detector.");
+  int discontinuous_count = discontinuous_elements.size();
 
   // First adjust the solution_vector.
+  // The elements do not share dofs (L2 spaces), so they can be processed in parallel.
   for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
-    for(std::set<int>::iterator it = discontinuous_elements.begin(); it != discontinuous_elements.end(); it++) {
+#pragma omp parallel for
+    for(int discontinuous_i = 0; discontinuous_i < discontinuous_count; discontinuous_i++) {
       AsmList<double> al;
-      spaces[space_i]->get_element_assembly_list(spaces[space_i]->get_mesh()->get_element(*it), &al);
+      spaces[space_i]->get_element_assembly_list(spaces[space_i]->get_mesh()->get_element(discontinuous_elements[discontinuous_i]), &al);
       for(unsigned int shape_i = 0; shape_i < al.get_cnt(); shape_i++)
         if(H2D_GET_H_ORDER(spaces[space_i]->get_shapeset()->get_order(al.get_idx()[shape_i])) > 1 || H2D_GET_V_ORDER(spaces[space_i]->get_shapeset()->get_order(al.get_idx()[shape_i])) > 1)
           solution_vector[al.get_dof()[shape_i]] = 0.0;
@@ -1060,7 +1904,7 @@ void FluxLimiter::limit_second_orders_according_to_detector(Hermes::vector<Space
     {
       bool Kuzmin_limit_all_orders_independently = dynamic_cast<KuzminDiscontinuityDetector*>(this->detector)->get_limit_all_orders_independently();
       delete detector;
-      this->detector = new KuzminDiscontinuityDetector(spaces, limited_solutions, Kuzmin_limit_all_orders_independently);
+      this->detector = new KuzminDiscontinuityDetector(spaces, limited_solutions, Kuzmin_limit_all_orders_independently, solution_vector);
     }
     else
     {
@@ -1075,7 +1919,7 @@ void FluxLimiter::limit_second_orders_according_to_detector(Hermes::vector<Space
       for_all_elements(e, spaces[0]->get_mesh())
         e->visited = false;
 
-      for(std::set<int>::iterator it = discontinuous_elements.begin(); it != discontinuous_elements.end(); it++) {
+      for(std::vector<int>::iterator it = discontinuous_elements.begin(); it != discontinuous_elements.end(); it++) {
         AsmList<double> al;
         spaces[0]->get_element_assembly_list(spaces[0]->get_mesh()->get_element(*it), &al);
         for(unsigned int shape_i = 0; shape_i < al.get_cnt(); shape_i++) {
@@ -1101,6 +1945,2952 @@ void FluxLimiter::limit_second_orders_according_to_detector(Hermes::vector<Space
     }
 };
 
+ExplicitSSPRungeKutta::ExplicitSSPRungeKutta(int stages, DiscreteProblem<double>* dp, Hermes::vector<Space<double>*> spaces, 
+  Hermes::vector<Solution<double>*> solutions, MatrixSolverType matrix_solver) : stages(stages), dp(dp), spaces(spaces), solutions(solutions), 
+  limiting(false), limiting_type(FluxLimiter::Kuzmin), Kuzmin_limit_all_orders_independently(true), cached_mesh(NULL), cached_mesh_seq(-1),
+  cached_spaces(spaces.size(), NULL), cached_space_seqs(spaces.size(), -1), ndof(0), element_count(0), element_updates(0.0)
+{
+  if(stages < 1 || stages > 3)
+    error("ExplicitSSPRungeKutta: only the methods with 1, 2 and 3 stages are available.");
+  if(spaces.size() != solutions.size())
+    error("ExplicitSSPRungeKutta: the numbers of spaces and solutions differ.");
+  rhs = create_vector<double>(matrix_solver);
+}
+
+ExplicitSSPRungeKutta::~ExplicitSSPRungeKutta()
+{
+  delete rhs;
+}
+
+void ExplicitSSPRungeKutta::set_limiting(FluxLimiter::LimitingType type, bool Kuzmin_limit_all_orders_independently)
+{
+  this->limiting = true;
+  this->limiting_type = type;
+  this->Kuzmin_limit_all_orders_independently = Kuzmin_limit_all_orders_independently;
+}
+
+void ExplicitSSPRungeKutta::unset_limiting()
+{
+  this->limiting = false;
+}
+
+void ExplicitSSPRungeKutta::step(double* sln_vector)
+{
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  update_mass_blocks();
+
+  // Shu-Osher coefficients: the stage stage_i is alpha * w^n + (1 - alpha) * (forward Euler step from the previous stage).
+  static const double alphas[3][3] = { { 0.0 }, { 0.0, 0.5 }, { 0.0, 0.75, 1.0 / 3.0 } };
+
+  Solution<double>::vector_to_solutions(sln_vector, spaces, solutions);
+  memcpy(&initial_state[0], sln_vector, ndof * sizeof(double));
+
+  for(int stage_i = 0; stage_i < stages; stage_i++)
+  {
+    euler_step(&update[0]);
+
+    double alpha = alphas[stages - 1][stage_i];
+#pragma omp parallel for
+    for(int i = 0; i < ndof; i++)
+      sln_vector[i] = alpha * initial_state[i] + (1.0 - alpha) * update[i];
+
+    limit(sln_vector);
+  }
+
+  element_updates += (double)stages * element_count;
+  cpu_time.tick();
+}
+
+double ExplicitSSPRungeKutta::get_element_updates() const
+{
+  return element_updates;
+}
+
+double ExplicitSSPRungeKutta::get_time() const
+{
+  return cpu_time.accumulated();
+}
+
+void ExplicitSSPRungeKutta::euler_step(double* result)
+{
+  dp->assemble(rhs);
+
+  // The blocks do not share dofs (L2 spaces), so they can be processed in parallel.
+  int block_count = dof_offsets.size() - 1;
+#pragma omp parallel
+  {
+    std::vector<double> local_rhs;
+
+#pragma omp for
+    for(int block_i = 0; block_i < block_count; block_i++)
+    {
+      int n = dof_offsets[block_i + 1] - dof_offsets[block_i];
+      const int* dofs = &block_dofs[dof_offsets[block_i]];
+      const double* inverse_mass = &inverse_masses[mass_offsets[block_i]];
+
+      local_rhs.resize(n);
+      for(int i = 0; i < n; i++)
+        local_rhs[i] = rhs->get(dofs[i]);
+
+      for(int i = 0; i < n; i++)
+      {
+        double value = 0.0;
+        for(int j = 0; j < n; j++)
+          value += inverse_mass[i * n + j] * local_rhs[j];
+        result[dofs[i]] = value;
+      }
+    }
+  }
+}
+
+void ExplicitSSPRungeKutta::limit(double* sln_vector)
+{
+  if(!limiting)
+  {
+    Solution<double>::vector_to_solutions(sln_vector, spaces, solutions);
+    return;
+  }
+
+  FluxLimiter flux_limiter(limiting_type, sln_vector, spaces, Kuzmin_limit_all_orders_independently);
+
+  if(limiting_type == FluxLimiter::Kuzmin)
+    flux_limiter.limit_second_orders_according_to_detector();
+
+  flux_limiter.limit_according_to_detector();
+
+  flux_limiter.get_limited_solutions(solutions);
+}
+
+void ExplicitSSPRungeKutta::update_mass_blocks()
+{
+  Mesh* mesh = spaces[0]->get_mesh();
+
+  bool valid = (mesh == cached_mesh && mesh->get_seq() == cached_mesh_seq);
+  for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+    if(spaces[space_i] != cached_spaces[space_i] || spaces[space_i]->get_seq() != cached_space_seqs[space_i])
+      valid = false;
+  if(valid)
+    return;
+
+  dof_offsets.clear();
+  block_dofs.clear();
+  mass_offsets.clear();
+  inverse_masses.clear();
+
+  ndof = Space<double>::get_num_dofs(spaces);
+  element_count = mesh->get_num_active_elements();
+
+  RefMap refmap;
+  refmap.set_quad_2d(&g_quad_2d_std);
+  Quad2D* quad = &g_quad_2d_std;
+  Element* e;
+
+  for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+  {
+    if(spaces[space_i]->get_mesh() != mesh)
+      error("ExplicitSSPRungeKutta needs all spaces defined on the same mesh.");
+
+    PrecalcShapeset pss(spaces[space_i]->get_shapeset());
+    pss.set_quad_2d(quad);
+
+    for_all_active_elements(e, mesh)
+    {
+      AsmList<double> al;
+      spaces[space_i]->get_element_assembly_list(e, &al);
+      int n = al.get_cnt();
+
+      dof_offsets.push_back(block_dofs.size());
+      mass_offsets.push_back(inverse_masses.size());
+      for(int i = 0; i < n; i++)
+        block_dofs.push_back(al.get_dof()[i]);
+
+      update_limit_table(e->get_mode());
+      refmap.set_active_element(e);
+      pss.set_active_element(e);
+
+      // Exact for the products of two basis functions and the jacobian of a bilinear map.
+      int order = spaces[space_i]->get_element_order(e->id);
+      int max_order = quad->get_max_order(e->get_mode());
+      int o = e->is_triangle() ? std::min(2 * H2D_GET_H_ORDER(order) + 2, max_order) 
+        : H2D_MAKE_QUAD_ORDER(std::min(2 * H2D_GET_H_ORDER(order) + 2, max_order), std::min(2 * H2D_GET_V_ORDER(order) + 2, max_order));
+      double3* pt = quad->get_points(o);
+      int np = quad->get_num_points(o);
+
+      double* jac = NULL;
+      if(!refmap.is_jacobian_const())
+        jac = refmap.get_jacobian(o);
+      double const_jac = refmap.is_jacobian_const() ? refmap.get_const_jacobian() : 0.0;
+
+      // Basis functions (with the assembly list coefficients) in the quadrature points.
+      std::vector<double> values(n * np);
+      for(int shape_i = 0; shape_i < n; shape_i++)
+      {
+        pss.set_active_shape(al.get_idx()[shape_i]);
+        pss.set_quad_order(o, H2D_FN_VAL);
+        double* val = pss.get_fn_values();
+        for(int point_i = 0; point_i < np; point_i++)
+          values[shape_i * np + point_i] = al.get_coef()[shape_i] * val[point_i];
+      }
+
+      int start = inverse_masses.size();
+      inverse_masses.resize(start + n * n);
+      double* mass = &inverse_masses[start];
+      for(int i = 0; i < n; i++)
+        for(int j = 0; j <= i; j++)
+        {
+          double integral = 0.0;
+          for(int point_i = 0; point_i < np; point_i++)
+            integral += pt[point_i][2] * (jac == NULL ? const_jac : jac[point_i]) * values[i * np + point_i] * values[j * np + point_i];
+          mass[i * n + j] = mass[j * n + i] = integral;
+        }
+
+      invert(mass, n);
+    }
+
+    cached_spaces[space_i] = spaces[space_i];
+    cached_space_seqs[space_i] = spaces[space_i]->get_seq();
+  }
+  dof_offsets.push_back(block_dofs.size());
+  mass_offsets.push_back(inverse_masses.size());
+
+  cached_mesh = mesh;
+  cached_mesh_seq = mesh->get_seq();
+
+  initial_state.resize(ndof);
+  update.resize(ndof);
+}
+
+void ExplicitSSPRungeKutta::invert(double* matrix, int n)
+{
+  // Gauss-Jordan elimination with partial pivoting on [A | I].
+  std::vector<double> a(matrix, matrix + n * n);
+  for(int i = 0; i < n; i++)
+    for(int j = 0; j < n; j++)
+      matrix[i * n + j] = (i == j) ? 1.0 : 0.0;
+
+  for(int col = 0; col < n; col++)
+  {
+    int pivot = col;
+    for(int row = col + 1; row < n; row++)
+      if(std::abs(a[row * n + col]) > std::abs(a[pivot * n + col]))
+        pivot = row;
+    if(a[pivot * n + col] == 0.0)
+      error("ExplicitSSPRungeKutta::invert: singular matrix.");
+
+    if(pivot != col)
+      for(int k = 0; k < n; k++)
+      {
+        std::swap(a[pivot * n + k], a[col * n + k]);
+        std::swap(matrix[pivot * n + k], matrix[col * n + k]);
+      }
+
+    double factor = 1.0 / a[col * n + col];
+    for(int k = 0; k < n; k++)
+    {
+      a[col * n + k] *= factor;
+      matrix[col * n + k] *= factor;
+    }
+
+    for(int row = 0; row < n; row++)
+    {
+      double coefficient = a[row * n + col];
+      if(row == col || coefficient == 0.0)
+        continue;
+      for(int k = 0; k < n; k++)
+      {
+        a[row * n + k] -= coefficient * a[col * n + k];
+        matrix[row * n + k] -= coefficient * matrix[col * n + k];
+      }
+    }
+  }
+}
+
+FiniteVolumeEuler::FiniteVolumeEuler(NumericalFlux* num_flux, double kappa) : num_flux(num_flux), kappa(kappa), cached_mesh(NULL), cached_mesh_seq(-1), cell_count(0), cell_updates(0.0)
+{
+  for(int i = 0; i < 4; i++)
+  {
+    cached_spaces[i] = NULL;
+    cached_space_seqs[i] = -1;
+  }
+}
+
+void FiniteVolumeEuler::add_solid_wall(std::string marker)
+{
+  bc_markers.push_back(marker);
+  bc_types.push_back(SolidWall);
+  for(int i = 0; i < 4; i++)
+    bc_states[i].push_back(0.0);
+  bc_pressures.push_back(0.0);
+  cached_mesh = NULL;
+}
+
+void FiniteVolumeEuler::add_inlet(std::string marker, double rho, double v1, double v2, double pressure)
+{
+  bc_markers.push_back(marker);
+  bc_types.push_back(Inlet);
+  bc_states[0].push_back(rho);
+  bc_states[1].push_back(rho * v1);
+  bc_states[2].push_back(rho * v2);
+  bc_states[3].push_back(QuantityCalculator::calc_energy(rho, rho * v1, rho * v2, pressure, kappa));
+  bc_pressures.push_back(pressure);
+  cached_mesh = NULL;
+}
+
+void FiniteVolumeEuler::add_outlet(std::string marker, double pressure)
+{
+  bc_markers.push_back(marker);
+  bc_types.push_back(Outlet);
+  for(int i = 0; i < 4; i++)
+    bc_states[i].push_back(0.0);
+  bc_pressures.push_back(pressure);
+  cached_mesh = NULL;
+}
+
+void FiniteVolumeEuler::set_state(double* sln_vector, Hermes::vector<Space<double>*> spaces)
+{
+  if(spaces.size() < 4)
+    error("FiniteVolumeEuler needs the spaces of all four conserved quantities.");
+
+  update_topology(spaces[0]->get_mesh());
+  update_dofs(spaces);
+
+  for(int k = 0; k < 4; k++)
+    for(int cell_i = 0; cell_i < cell_count; cell_i++)
+      w[k][cell_i] = sln_vector[dofs[k][cell_i]] * dof_scales[k][cell_i];
+}
+
+void FiniteVolumeEuler::get_state(double* sln_vector) const
+{
+  for(int k = 0; k < 4; k++)
+    for(int cell_i = 0; cell_i < cell_count; cell_i++)
+      sln_vector[dofs[k][cell_i]] = w[k][cell_i] / dof_scales[k][cell_i];
+}
+
+int FiniteVolumeEuler::get_cell_count() const
+{
+  return cell_count;
+}
+
+double FiniteVolumeEuler::get_cell_updates() const
+{
+  return cell_updates;
+}
+
+const std::vector<int>& FiniteVolumeEuler::get_level_cell_counts() const
+{
+  return level_cell_counts;
+}
+
+void FiniteVolumeEuler::step(double time_step)
+{
+  calculate_inner_fluxes(NULL, inner_left.size(), time_step);
+  calculate_boundary_fluxes(NULL, boundary_cells.size(), time_step);
+
+  // Update of the cells, each one gathers the fluxes of its edges.
+#pragma omp parallel for
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+  {
+    for(int k = 0; k < 4; k++)
+    {
+      double sum = 0.0;
+      for(int j = cell_edge_offsets[cell_i]; j < cell_edge_offsets[cell_i + 1]; j++)
+        sum += cell_edge_signs[j] * edge_fluxes[k][cell_edges[j]];
+      w[k][cell_i] -= sum / areas[cell_i];
+    }
+  }
+  cell_updates += cell_count;
+}
+
+double FiniteVolumeEuler::step_local(double CFL_number, int max_levels)
+{
+  int inner_count = inner_left.size();
+  int boundary_count = boundary_cells.size();
+
+  // Time steps of the cells.
+  std::vector<double> cell_time_steps(cell_count);
+#pragma omp parallel for
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    cell_time_steps[cell_i] = calculate_cell_time_step(cell_i, CFL_number);
+  double time_step_min = *std::min_element(cell_time_steps.begin(), cell_time_steps.end());
+
+  // Levels of the cells.
+  cell_levels.resize(cell_count);
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+  {
+    int level = 0;
+    double level_time_step = time_step_min;
+    while(level < max_levels - 1 && 2.0 * level_time_step <= cell_time_steps[cell_i])
+    {
+      level++;
+      level_time_step *= 2.0;
+    }
+    cell_levels[cell_i] = level;
+  }
+
+  // Neighboring cells differ by at most one level (lowering a level keeps the CFL condition).
+  bool changed = true;
+  while(changed)
+  {
+    changed = false;
+    for(int edge_i = 0; edge_i < inner_count; edge_i++)
+    {
+      int& level_left = cell_levels[inner_left[edge_i]];
+      int& level_right = cell_levels[inner_right[edge_i]];
+      if(level_left > level_right + 1)
+      {
+        level_left = level_right + 1;
+        changed = true;
+      }
+      else if(level_right > level_left + 1)
+      {
+        level_right = level_left + 1;
+        changed = true;
+      }
+    }
+  }
+  int top_level = *std::max_element(cell_levels.begin(), cell_levels.end());
+
+  // Cells by their levels, edges by the levels of their finer cells.
+  level_cells.assign(top_level + 1, std::vector<int>());
+  level_inner_edges.assign(top_level + 1, std::vector<int>());
+  level_boundary_edges.assign(top_level + 1, std::vector<int>());
+  edge_levels.resize(inner_count + boundary_count);
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    level_cells[cell_levels[cell_i]].push_back(cell_i);
+  for(int edge_i = 0; edge_i < inner_count; edge_i++)
+  {
+    edge_levels[edge_i] = std::min(cell_levels[inner_left[edge_i]], cell_levels[inner_right[edge_i]]);
+    level_inner_edges[edge_levels[edge_i]].push_back(edge_i);
+  }
+  for(int edge_i = 0; edge_i < boundary_count; edge_i++)
+  {
+    edge_levels[inner_count + edge_i] = cell_levels[boundary_cells[edge_i]];
+    level_boundary_edges[edge_levels[inner_count + edge_i]].push_back(edge_i);
+  }
+  level_cell_counts.resize(top_level + 1);
+  for(int level = 0; level <= top_level; level++)
+    level_cell_counts[level] = level_cells[level].size();
+
+  for(int k = 0; k < 4; k++)
+    accumulated_fluxes[k].assign(cell_count, 0.0);
+
+  // Substeps of the length time_step_min.
+  int substep_count = 1 << top_level;
+  for(int substep = 0; substep < substep_count; substep++)
+  {
+    // The time steps of the levels 0, ..., starting_level start now (2^level divides substep),
+    // their edges are calculated with the states at this moment.
+    int starting_level = 0;
+    while(starting_level < top_level && ((substep >> starting_level) & 1) == 0)
+      starting_level++;
+    for(int level = 0; level <= starting_level; level++)
+    {
+      double level_time_step = time_step_min * (1 << level);
+      if(!level_inner_edges[level].empty())
+        calculate_inner_fluxes(&level_inner_edges[level][0], level_inner_edges[level].size(), level_time_step);
+      if(!level_boundary_edges[level].empty())
+        calculate_boundary_fluxes(&level_boundary_edges[level][0], level_boundary_edges[level].size(), level_time_step);
+    }
+
+    // Only the cells of the levels up to starting_level + 1 have such edges.
+    for(int level = 0; level <= std::min(starting_level + 1, top_level); level++)
+    {
+      const std::vector<int>& cells_in_level = level_cells[level];
+#pragma omp parallel for
+      for(int i = 0; i < (int)cells_in_level.size(); i++)
+      {
+        int cell_i = cells_in_level[i];
+        for(int j = cell_edge_offsets[cell_i]; j < cell_edge_offsets[cell_i + 1]; j++)
+          if(edge_levels[cell_edges[j]] <= starting_level)
+            for(int k = 0; k < 4; k++)
+              accumulated_fluxes[k][cell_i] += cell_edge_signs[j] * edge_fluxes[k][cell_edges[j]];
+      }
+    }
+
+    // The time steps of the levels 0, ..., ending_level end now (2^level divides substep + 1).
+    int ending_level = 0;
+    while(ending_level < top_level && (((substep + 1) >> ending_level) & 1) == 0)
+      ending_level++;
+    for(int level = 0; level <= ending_level; level++)
+    {
+      const std::vector<int>& cells_in_level = level_cells[level];
+#pragma omp parallel for
+      for(int i = 0; i < (int)cells_in_level.size(); i++)
+      {
+        int cell_i = cells_in_level[i];
+        for(int k = 0; k < 4; k++)
+        {
+          w[k][cell_i] -= accumulated_fluxes[k][cell_i] / areas[cell_i];
+          accumulated_fluxes[k][cell_i] = 0.0;
+        }
+      }
+      cell_updates += cells_in_level.size();
+    }
+  }
+
+  return time_step_min * substep_count;
+}
+
+void FiniteVolumeEuler::calculate_inner_fluxes(const int* edge_ids, int count, double time_step)
+{
+  // In chunks evaluated by one call of the batched flux.
+  const int CHUNK = 256;
+  int chunk_count = (count + CHUNK - 1) / CHUNK;
+#pragma omp parallel
+  {
+    double storage[16 * CHUNK];
+    double* w_L[4], *w_R[4], *flux[4];
+    double* nx = storage + 12 * CHUNK;
+    double* ny = storage + 13 * CHUNK;
+    double* lengths = storage + 14 * CHUNK;
+    int chunk_edges[CHUNK];
+    for(int k = 0; k < 4; k++)
+    {
+      w_L[k] = storage + k * CHUNK;
+      w_R[k] = storage + (4 + k) * CHUNK;
+      flux[k] = storage + (8 + k) * CHUNK;
+    }
+
+#pragma omp for
+    for(int chunk_i = 0; chunk_i < chunk_count; chunk_i++)
+    {
+      int first = chunk_i * CHUNK;
+      int n = std::min(CHUNK, count - first);
+      for(int i = 0; i < n; i++)
+      {
+        int edge_i = (edge_ids == NULL) ? first + i : edge_ids[first + i];
+        chunk_edges[i] = edge_i;
+        nx[i] = inner_nx[edge_i];
+        ny[i] = inner_ny[edge_i];
+        lengths[i] = inner_lengths[edge_i] * time_step;
+      }
+      for(int k = 0; k < 4; k++)
+        for(int i = 0; i < n; i++)
+        {
+          w_L[k][i] = w[k][inner_left[chunk_edges[i]]];
+          w_R[k][i] = w[k][inner_right[chunk_edges[i]]];
+        }
+
+      num_flux->numerical_flux_batch(n, flux, w_L, w_R, nx, ny);
+
+      for(int k = 0; k < 4; k++)
+        for(int i = 0; i < n; i++)
+          edge_fluxes[k][chunk_edges[i]] = flux[k][i] * lengths[i];
+    }
+  }
+}
+
+void FiniteVolumeEuler::calculate_boundary_fluxes(const int* edge_ids, int count, double time_step)
+{
+  int inner_count = inner_left.size();
+
+#pragma omp parallel for
+  for(int i = 0; i < count; i++)
+  {
+    int edge_i = (edge_ids == NULL) ? i : edge_ids[i];
+    int cell = boundary_cells[edge_i];
+    int bc = boundary_conditions[edge_i];
+    double w_in[4], w_B[4], boundary_flux[4];
+    for(int k = 0; k < 4; k++)
+    {
+      w_in[k] = w[k][cell];
+      w_B[k] = bc_states[k][bc];
+    }
+
+    NumericalFluxWorkspace ws;
+    switch(bc_types[bc])
+    {
+    case SolidWall:
+      num_flux->numerical_flux_solid_wall(ws, boundary_flux, w_in, boundary_nx[edge_i], boundary_ny[edge_i]);
+      break;
+    case Inlet:
+      num_flux->numerical_flux_inlet(ws, boundary_flux, w_in, w_B, boundary_nx[edge_i], boundary_ny[edge_i]);
+      break;
+    case Outlet:
+      num_flux->numerical_flux_outlet(ws, boundary_flux, w_in, bc_pressures[bc], boundary_nx[edge_i], boundary_ny[edge_i]);
+      break;
+    }
+
+    for(int k = 0; k < 4; k++)
+      edge_fluxes[k][inner_count + edge_i] = boundary_flux[k] * boundary_lengths[edge_i] * time_step;
+  }
+}
+
+double FiniteVolumeEuler::calculate_time_step(double CFL_number) const
+{
+  double min_condition = std::numeric_limits<double>::max();
+
+#pragma omp parallel
+  {
+    double thread_min_condition = std::numeric_limits<double>::max();
+
+#pragma omp for
+    for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    {
+      double condition = calculate_cell_time_step(cell_i, CFL_number);
+      if(condition < thread_min_condition)
+        thread_min_condition = condition;
+    }
+
+#pragma omp critical (FiniteVolumeEuler_min)
+    if(thread_min_condition < min_condition)
+      min_condition = thread_min_condition;
+  }
+
+  return min_condition;
+}
+
+double FiniteVolumeEuler::calculate_cell_time_step(int cell_i, double CFL_number) const
+{
+  int inner_count = inner_left.size();
+
+  double u = w[1][cell_i] / w[0][cell_i];
+  double v = w[2][cell_i] / w[0][cell_i];
+  double a = QuantityCalculator::calc_sound_speed(w[0][cell_i], w[1][cell_i], w[2][cell_i], w[3][cell_i], kappa);
+
+  double edge_length_max_lambda = 0.0;
+  for(int j = cell_edge_offsets[cell_i]; j < cell_edge_offsets[cell_i + 1]; j++)
+  {
+    int edge_i = cell_edges[j];
+    double nx, ny, length;
+    if(edge_i < inner_count)
+    {
+      nx = inner_nx[edge_i];
+      ny = inner_ny[edge_i];
+      length = inner_lengths[edge_i];
+    }
+    else
+    {
+      nx = boundary_nx[edge_i - inner_count];
+      ny = boundary_ny[edge_i - inner_count];
+      length = boundary_lengths[edge_i - inner_count];
+    }
+    double lambda = length * (std::abs(u * nx + v * ny) + a);
+    if(lambda > edge_length_max_lambda)
+      edge_length_max_lambda = lambda;
+  }
+
+  return areas[cell_i] * CFL_number / edge_length_max_lambda;
+}
+
+void FiniteVolumeEuler::update_topology(Mesh* mesh)
+{
+  if(mesh == cached_mesh && mesh->get_seq() == cached_mesh_seq)
+    return;
+
+  cells.clear();
+  areas.clear();
+  inner_left.clear();
+  inner_right.clear();
+  inner_nx.clear();
+  inner_ny.clear();
+  inner_lengths.clear();
+  boundary_cells.clear();
+  boundary_conditions.clear();
+  boundary_nx.clear();
+  boundary_ny.clear();
+  boundary_lengths.clear();
+
+  // Cells.
+  std::vector<int> element_cells(mesh->get_max_element_id() + 1, -1);
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    element_cells[e->id] = cells.size();
+    cells.push_back(e);
+    areas.push_back(e->get_area());
+  }
+  cell_count = cells.size();
+
+  // Boundary conditions by the internal markers.
+  std::map<int, int> internal_marker_bcs;
+  for(unsigned int bc_i = 0; bc_i < bc_markers.size(); bc_i++)
+    internal_marker_bcs[mesh->get_boundary_markers_conversion().get_internal_marker(bc_markers[bc_i]).marker] = bc_i;
+
+  // Edges.
+  std::map<std::pair<int, int>, int> open_edges;
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+  {
+    e = cells[cell_i];
+    for(unsigned int edge_i = 0; edge_i < e->get_num_surf(); edge_i++)
+    {
+      Node* v1 = e->vn[edge_i];
+      Node* v2 = e->vn[e->next_vert(edge_i)];
+      double length = std::sqrt((v2->x - v1->x) * (v2->x - v1->x) + (v2->y - v1->y) * (v2->y - v1->y));
+      double nx = (v2->y - v1->y) / length;
+      double ny = -(v2->x - v1->x) / length;
+
+      if(e->en[edge_i]->bnd)
+      {
+        std::map<int, int>::iterator it = internal_marker_bcs.find(e->en[edge_i]->marker);
+        if(it == internal_marker_bcs.end())
+          error("FiniteVolumeEuler: no boundary condition for the boundary marker %d.", e->en[edge_i]->marker);
+        boundary_cells.push_back(cell_i);
+        boundary_conditions.push_back(it->second);
+        boundary_nx.push_back(nx);
+        boundary_ny.push_back(ny);
+        boundary_lengths.push_back(length);
+      }
+      else
+        add_inner_edges(mesh, cell_i, v1->id, v2->id, nx, ny, open_edges);
+    }
+  }
+  if(!open_edges.empty())
+    error("FiniteVolumeEuler: an inner edge with one cell only.");
+
+  int inner_count = inner_left.size();
+  int boundary_count = boundary_cells.size();
+  for(int k = 0; k < 4; k++)
+  {
+    w[k].resize(cell_count);
+    edge_fluxes[k].resize(inner_count + boundary_count);
+  }
+
+  // Edges of the cells.
+  cell_edge_offsets.assign(cell_count + 1, 0);
+  for(int edge_i = 0; edge_i < inner_count; edge_i++)
+  {
+    cell_edge_offsets[inner_left[edge_i] + 1]++;
+    cell_edge_offsets[inner_right[edge_i] + 1]++;
+  }
+  for(int edge_i = 0; edge_i < boundary_count; edge_i++)
+    cell_edge_offsets[boundary_cells[edge_i] + 1]++;
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    cell_edge_offsets[cell_i + 1] += cell_edge_offsets[cell_i];
+
+  cell_edges.resize(cell_edge_offsets[cell_count]);
+  cell_edge_signs.resize(cell_edge_offsets[cell_count]);
+  std::vector<int> positions(cell_edge_offsets.begin(), cell_edge_offsets.end() - 1);
+  for(int edge_i = 0; edge_i < inner_count; edge_i++)
+  {
+    cell_edges[positions[inner_left[edge_i]]] = edge_i;
+    cell_edge_signs[positions[inner_left[edge_i]]++] = 1.0;
+    cell_edges[positions[inner_right[edge_i]]] = edge_i;
+    cell_edge_signs[positions[inner_right[edge_i]]++] = -1.0;
+  }
+  for(int edge_i = 0; edge_i < boundary_count; edge_i++)
+  {
+    cell_edges[positions[boundary_cells[edge_i]]] = inner_count + edge_i;
+    cell_edge_signs[positions[boundary_cells[edge_i]]++] = 1.0;
+  }
+
+  cached_mesh = mesh;
+  cached_mesh_seq = mesh->get_seq();
+  for(int i = 0; i < 4; i++)
+    cached_spaces[i] = NULL;
+}
+
+void FiniteVolumeEuler::add_inner_edges(Mesh* mesh, int cell, int vertex_1, int vertex_2, double nx, double ny, std::map<std::pair<int, int>, int>& open_edges)
+{
+  // The neighbor is refined along this edge.
+  Node* middle = mesh->peek_vertex_node(vertex_1, vertex_2);
+  if(middle != NULL)
+  {
+    add_inner_edges(mesh, cell, vertex_1, middle->id, nx, ny, open_edges);
+    add_inner_edges(mesh, cell, middle->id, vertex_2, nx, ny, open_edges);
+    return;
+  }
+
+  std::pair<int, int> key(std::min(vertex_1, vertex_2), std::max(vertex_1, vertex_2));
+  std::map<std::pair<int, int>, int>::iterator it = open_edges.find(key);
+  if(it == open_edges.end())
+  {
+    Node* v1 = mesh->get_node(vertex_1);
+    Node* v2 = mesh->get_node(vertex_2);
+    open_edges[key] = inner_left.size();
+    inner_left.push_back(cell);
+    inner_right.push_back(-1);
+    inner_nx.push_back(nx);
+    inner_ny.push_back(ny);
+    inner_lengths.push_back(std::sqrt((v2->x - v1->x) * (v2->x - v1->x) + (v2->y - v1->y) * (v2->y - v1->y)));
+  }
+  else
+  {
+    inner_right[it->second] = cell;
+    open_edges.erase(it);
+  }
+}
+
+void FiniteVolumeEuler::update_dofs(Hermes::vector<Space<double>*> spaces)
+{
+  for(int k = 0; k < 4; k++)
+  {
+    if(spaces[k] == cached_spaces[k] && spaces[k]->get_seq() == cached_space_seqs[k])
+      continue;
+    if(spaces[k]->get_mesh() != cached_mesh)
+      error("FiniteVolumeEuler needs all four spaces defined on the same mesh.");
+
+    dofs[k].resize(cell_count);
+    dof_scales[k].resize(cell_count);
+    Shapeset* shapeset = spaces[k]->get_shapeset();
+    for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    {
+      AsmList<double> al;
+      spaces[k]->get_element_assembly_list(cells[cell_i], &al);
+      if(al.get_cnt() != 1)
+        error("FiniteVolumeEuler needs piecewise constant (P0) spaces.");
+
+      // The value of the constant basis function (in any point of the reference element).
+      shapeset->set_mode(cells[cell_i]->get_mode());
+      dofs[k][cell_i] = al.get_dof()[0];
+      dof_scales[k][cell_i] = al.get_coef()[0] * shapeset->get_value(0, al.get_idx()[0], -0.5, -0.5, 0);
+    }
+
+    cached_spaces[k] = spaces[k];
+    cached_space_seqs[k] = spaces[k]->get_seq();
+  }
+}
+
+FactorizationReuse::FactorizationReuse(LinearSolver<double>* solver, SparseMatrix<double>* matrix, Vector<double>* rhs, bool reuse_symbolic_factorization) 
+  : solver(solver), matrix(matrix), rhs(rhs), reuse_symbolic_factorization(reuse_symbolic_factorization), 
+  max_stale_steps(0), time_step_threshold(0.0), tolerance(1E-10), max_refinement_iterations(10), 
+  factorized_size(-1), factorized_time_step(0.0), stale_steps(0), stale_solves(0), sln_vector(NULL)
+{
+}
+
+FactorizationReuse::~FactorizationReuse()
+{
+  delete [] sln_vector;
+}
+
+void FactorizationReuse::set_stale_factorization_reuse(int max_stale_steps, double time_step_threshold, double tolerance, int max_refinement_iterations)
+{
+  this->max_stale_steps = max_stale_steps;
+  this->time_step_threshold = time_step_threshold;
+  this->tolerance = tolerance;
+  this->max_refinement_iterations = max_refinement_iterations;
+}
+
+bool FactorizationReuse::solve(double time_step)
+{
+  cpu_time.tick(Hermes::HERMES_SKIP);
+
+  int size = rhs->length();
+  if(size != factorized_size)
+  {
+    delete [] sln_vector;
+    sln_vector = new double[size];
+  }
+
+  bool stale = (size == factorized_size && stale_steps < max_stale_steps 
+    && std::abs(time_step - factorized_time_step) < time_step_threshold * factorized_time_step);
+  if(stale && solve_with_stale_factorization())
+  {
+    stale_steps++;
+    stale_solves++;
+    cpu_time.tick();
+    return true;
+  }
+
+  if(reuse_symbolic_factorization && size == factorized_size)
+    solver->set_factorization_scheme(HERMES_REUSE_MATRIX_REORDERING);
+  else
+    solver->set_factorization_scheme(HERMES_FACTORIZE_FROM_SCRATCH);
+
+  bool solved = solver->solve();
+  if(solved)
+  {
+    memcpy(sln_vector, solver->get_sln_vector(), size * sizeof(double));
+    factorized_size = size;
+    factorized_time_step = time_step;
+    stale_steps = 0;
+  }
+  else
+    factorized_size = -1;
+
+  cpu_time.tick();
+  return solved;
+}
+
+bool FactorizationReuse::solve_with_stale_factorization()
+{
+#ifdef WITH_UMFPACK
+  CSCMatrix<double>* csc_matrix = dynamic_cast<CSCMatrix<double>*>(matrix);
+  if(csc_matrix == NULL)
+    return false;
+
+  int size = rhs->length();
+  std::vector<double> b(size), residual(size), product(size);
+  double b_norm = 0.0;
+  for(int i = 0; i < size; i++)
+  {
+    b[i] = rhs->get(i);
+    b_norm += b[i] * b[i];
+  }
+  b_norm = std::sqrt(b_norm);
+
+  solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
+  bool converged = false;
+  if(solver->solve())
+  {
+    memcpy(sln_vector, solver->get_sln_vector(), size * sizeof(double));
+    for(int iteration = 0; ; iteration++)
+    {
+      // Residual with the current matrix.
+      csc_matrix->multiply_with_vector(sln_vector, &product[0]);
+      double residual_norm = 0.0;
+      for(int i = 0; i < size; i++)
+      {
+        residual[i] = b[i] - product[i];
+        residual_norm += residual[i] * residual[i];
+      }
+      if(std::sqrt(residual_norm) <= tolerance * b_norm)
+      {
+        converged = true;
+        break;
+      }
+      if(iteration == max_refinement_iterations)
+        break;
+
+      // Correction from the stale factorization.
+      for(int i = 0; i < size; i++)
+        rhs->set(i, residual[i]);
+      if(!solver->solve())
+        break;
+      double* correction = solver->get_sln_vector();
+      for(int i = 0; i < size; i++)
+        sln_vector[i] += correction[i];
+    }
+  }
+
+  for(int i = 0; i < size; i++)
+    rhs->set(i, b[i]);
+
+  return converged;
+#else
+  return false;
+#endif
+}
+
+double* FactorizationReuse::get_sln_vector()
+{
+  return sln_vector;
+}
+
+double FactorizationReuse::get_last_time() const
+{
+  return cpu_time.last();
+}
+
+double FactorizationReuse::get_time() const
+{
+  return cpu_time.accumulated();
+}
+
+int FactorizationReuse::get_stale_solves() const
+{
+  return stale_solves;
+}
+
+JacobianFreeNewtonKrylov::JacobianFreeNewtonKrylov(DiscreteProblem<double>* dp, Hermes::vector<Space<double>*> spaces, 
+  PreconditionerType preconditioner_type, MatrixSolverType matrix_solver) : dp(dp), spaces(spaces), preconditioner_type(preconditioner_type), ndof(0),
+  newton_tolerance(1E-6), max_newton_iterations(20), gmres_tolerance(1E-3), krylov_dimension(30), max_restarts(5),
+  factorized(false), factorized_size(-1), newton_iterations(0), gmres_iterations(0), residual_evaluations(0)
+{
+  matrix = create_matrix<double>(matrix_solver);
+  rhs = create_vector<double>(matrix_solver);
+  solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
+}
+
+JacobianFreeNewtonKrylov::~JacobianFreeNewtonKrylov()
+{
+  delete solver;
+  delete matrix;
+  delete rhs;
+}
+
+void JacobianFreeNewtonKrylov::set_newton_parameters(double newton_tolerance, int max_newton_iterations)
+{
+  this->newton_tolerance = newton_tolerance;
+  this->max_newton_iterations = max_newton_iterations;
+}
+
+void JacobianFreeNewtonKrylov::set_gmres_parameters(double gmres_tolerance, int krylov_dimension, int max_restarts)
+{
+  this->gmres_tolerance = gmres_tolerance;
+  this->krylov_dimension = krylov_dimension;
+  this->max_restarts = max_restarts;
+}
+
+bool JacobianFreeNewtonKrylov::solve(double* sln_vector)
+{
+  // Maximum number of halvings of the Newton update.
+  const int MAX_BACKTRACKING = 5;
+
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  ndof = Space<double>::get_num_dofs(spaces);
+  newton_iterations = 0;
+  gmres_iterations = 0;
+  residual_evaluations = 0;
+
+  std::vector<double> F(ndof), update(ndof), trial(ndof), F_trial(ndof);
+  double initial_norm = 0.0;
+  bool converged = false;
+  for(;;)
+  {
+    if(preconditioner_type != NoPreconditioner)
+      update_preconditioner(sln_vector, &F[0]);
+    else if(newton_iterations == 0)
+      residual(sln_vector, &F[0]);
+    else
+      F = F_trial;
+
+    double F_norm = norm(F);
+    if(newton_iterations == 0)
+      initial_norm = F_norm;
+    if(F_norm <= newton_tolerance * initial_norm)
+    {
+      converged = true;
+      break;
+    }
+    if(newton_iterations == max_newton_iterations)
+      break;
+
+    // An unconverged GMRES still gives a descent direction in most cases, the backtracking decides.
+    int iterations;
+    gmres(sln_vector, &F[0], &update[0], iterations);
+    gmres_iterations += iterations;
+
+    // The update is halved while the residual norm does not decrease.
+    double damping = 1.0;
+    for(int backtracking = 0; ; backtracking++)
+    {
+      for(int i = 0; i < ndof; i++)
+        trial[i] = sln_vector[i] + damping * update[i];
+      residual(&trial[0], &F_trial[0]);
+      if(norm(F_trial) < F_norm || backtracking == MAX_BACKTRACKING)
+        break;
+      damping *= 0.5;
+    }
+    memcpy(sln_vector, &trial[0], ndof * sizeof(double));
+    newton_iterations++;
+  }
+
+  cpu_time.tick();
+  return converged;
+}
+
+void JacobianFreeNewtonKrylov::residual(double* coeff_vec, double* result)
+{
+  dp->assemble(coeff_vec, rhs);
+  for(int i = 0; i < ndof; i++)
+    result[i] = rhs->get(i);
+  residual_evaluations++;
+}
+
+void JacobianFreeNewtonKrylov::jacobian_product(double* sln_vector, double* residual_at_sln, double* direction, double* result)
+{
+  double sln_norm = 0.0, direction_norm = 0.0;
+  for(int i = 0; i < ndof; i++)
+  {
+    sln_norm += sln_vector[i] * sln_vector[i];
+    direction_norm += direction[i] * direction[i];
+  }
+  if(direction_norm == 0.0)
+  {
+    memset(result, 0, ndof * sizeof(double));
+    return;
+  }
+
+  // The difference step relative to the magnitude of the state.
+  double epsilon = std::sqrt(std::numeric_limits<double>::epsilon()) * (1.0 + std::sqrt(sln_norm)) / std::sqrt(direction_norm);
+  std::vector<double> perturbed(ndof);
+  for(int i = 0; i < ndof; i++)
+    perturbed[i] = sln_vector[i] + epsilon * direction[i];
+
+  residual(&perturbed[0], result);
+  for(int i = 0; i < ndof; i++)
+    result[i] = -(result[i] - residual_at_sln[i]) / epsilon;
+}
+
+void JacobianFreeNewtonKrylov::update_preconditioner(double* sln_vector, double* result)
+{
+  dp->assemble(sln_vector, matrix, rhs);
+  for(int i = 0; i < ndof; i++)
+    result[i] = rhs->get(i);
+  residual_evaluations++;
+
+  if(preconditioner_type == Factorization)
+  {
+    factorized = false;
+    return;
+  }
+
+  // Block Jacobi: the blocks of all dofs on one element.
+  dof_offsets.clear();
+  block_dofs.clear();
+  block_offsets.clear();
+  inverse_blocks.clear();
+
+  Element* e;
+  for_all_active_elements(e, spaces[0]->get_mesh())
+  {
+    dof_offsets.push_back(block_dofs.size());
+    for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+    {
+      AsmList<double> al;
+      spaces[space_i]->get_element_assembly_list(e, &al);
+      for(int i = 0; i < (int)al.get_cnt(); i++)
+        if(al.get_dof()[i] >= 0)
+          block_dofs.push_back(al.get_dof()[i]);
+    }
+
+    int first = dof_offsets.back();
+    int n = block_dofs.size() - first;
+    int start = inverse_blocks.size();
+    block_offsets.push_back(start);
+    inverse_blocks.resize(start + n * n);
+    for(int i = 0; i < n; i++)
+      for(int j = 0; j < n; j++)
+        inverse_blocks[start + i * n + j] = matrix->get(block_dofs[first + i], block_dofs[first + j]);
+    ExplicitSSPRungeKutta::invert(&inverse_blocks[start], n);
+  }
+  dof_offsets.push_back(block_dofs.size());
+}
+
+void JacobianFreeNewtonKrylov::apply_preconditioner(double* vector, double* result)
+{
+  switch(preconditioner_type)
+  {
+  case NoPreconditioner:
+    memcpy(result, vector, ndof * sizeof(double));
+    break;
+
+  case BlockJacobi:
+    {
+      int block_count = block_offsets.size();
+#pragma omp parallel for
+      for(int block_i = 0; block_i < block_count; block_i++)
+      {
+        int first = dof_offsets[block_i];
+        int n = dof_offsets[block_i + 1] - first;
+        const double* inverse = &inverse_blocks[block_offsets[block_i]];
+        for(int i = 0; i < n; i++)
+        {
+          double sum = 0.0;
+          for(int j = 0; j < n; j++)
+            sum += inverse[i * n + j] * vector[block_dofs[first + j]];
+          result[block_dofs[first + i]] = sum;
+        }
+      }
+    }
+    break;
+
+  case Factorization:
+    for(int i = 0; i < ndof; i++)
+      rhs->set(i, vector[i]);
+    // Factorized once per preconditioner update, the symbolic analysis is kept while the size does not change.
+    if(factorized)
+      solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
+    else if(factorized_size == ndof)
+      solver->set_factorization_scheme(HERMES_REUSE_MATRIX_REORDERING);
+    else
+      solver->set_factorization_scheme(HERMES_FACTORIZE_FROM_SCRATCH);
+    if(!solver->solve())
+      error("JacobianFreeNewtonKrylov: the factorization of the preconditioner failed.");
+    memcpy(result, solver->get_sln_vector(), ndof * sizeof(double));
+    factorized = true;
+    factorized_size = ndof;
+    break;
+  }
+}
+
+bool JacobianFreeNewtonKrylov::gmres(double* sln_vector, double* residual_at_sln, double* update, int& iterations)
+{
+  int m = krylov_dimension;
+  std::vector<std::vector<double> > V(m + 1, std::vector<double>(ndof)), Z(m, std::vector<double>(ndof));
+  std::vector<double> H((m + 1) * m), cs(m), sn(m), g(m + 1), w(ndof), y(m);
+
+  iterations = 0;
+  memset(update, 0, ndof * sizeof(double));
+  double b_norm = 0.0;
+  for(int i = 0; i < ndof; i++)
+    b_norm += residual_at_sln[i] * residual_at_sln[i];
+  b_norm = std::sqrt(b_norm);
+  if(b_norm == 0.0)
+    return true;
+
+  for(int restart = 0; restart <= max_restarts; restart++)
+  {
+    // Residual of the current iterate.
+    if(restart == 0)
+      memcpy(&V[0][0], residual_at_sln, ndof * sizeof(double));
+    else
+    {
+      jacobian_product(sln_vector, residual_at_sln, update, &w[0]);
+      for(int i = 0; i < ndof; i++)
+        V[0][i] = residual_at_sln[i] - w[i];
+    }
+    double beta = norm(V[0]);
+    if(beta <= gmres_tolerance * b_norm)
+      return true;
+    for(int i = 0; i < ndof; i++)
+      V[0][i] /= beta;
+    std::fill(g.begin(), g.end(), 0.0);
+    g[0] = beta;
+
+    // Arnoldi process (modified Gram-Schmidt) with the Givens rotations of the Hessenberg matrix.
+    int size = 0;
+    for(int k = 0; k < m; k++)
+    {
+      apply_preconditioner(&V[k][0], &Z[k][0]);
+      jacobian_product(sln_vector, residual_at_sln, &Z[k][0], &w[0]);
+      iterations++;
+
+      for(int j = 0; j <= k; j++)
+      {
+        double h = 0.0;
+        for(int i = 0; i < ndof; i++)
+          h += w[i] * V[j][i];
+        H[j * m + k] = h;
+        for(int i = 0; i < ndof; i++)
+          w[i] -= h * V[j][i];
+      }
+      double h_next = norm(w);
+      H[(k + 1) * m + k] = h_next;
+      if(h_next != 0.0)
+        for(int i = 0; i < ndof; i++)
+          V[k + 1][i] = w[i] / h_next;
+
+      for(int j = 0; j < k; j++)
+      {
+        double temp = cs[j] * H[j * m + k] + sn[j] * H[(j + 1) * m + k];
+        H[(j + 1) * m + k] = -sn[j] * H[j * m + k] + cs[j] * H[(j + 1) * m + k];
+        H[j * m + k] = temp;
+      }
+      double denominator = std::sqrt(H[k * m + k] * H[k * m + k] + h_next * h_next);
+      cs[k] = (denominator == 0.0) ? 1.0 : H[k * m + k] / denominator;
+      sn[k] = (denominator == 0.0) ? 0.0 : h_next / denominator;
+      H[k * m + k] = denominator;
+      H[(k + 1) * m + k] = 0.0;
+      g[k + 1] = -sn[k] * g[k];
+      g[k] = cs[k] * g[k];
+
+      size = k + 1;
+      if(std::abs(g[k + 1]) <= gmres_tolerance * b_norm || h_next == 0.0)
+        break;
+    }
+
+    // Update by the least squares solution (the rotated Hessenberg matrix is upper triangular).
+    for(int k = size - 1; k >= 0; k--)
+    {
+      double sum = g[k];
+      for(int j = k + 1; j < size; j++)
+        sum -= H[k * m + j] * y[j];
+      y[k] = (H[k * m + k] == 0.0) ? 0.0 : sum / H[k * m + k];
+    }
+    for(int k = 0; k < size; k++)
+      for(int i = 0; i < ndof; i++)
+        update[i] += y[k] * Z[k][i];
+
+    if(std::abs(g[size]) <= gmres_tolerance * b_norm)
+      return true;
+  }
+
+  return false;
+}
+
+double JacobianFreeNewtonKrylov::norm(const std::vector<double>& vector)
+{
+  double sum = 0.0;
+  for(unsigned int i = 0; i < vector.size(); i++)
+    sum += vector[i] * vector[i];
+  return std::sqrt(sum);
+}
+
+int JacobianFreeNewtonKrylov::get_newton_iterations() const
+{
+  return newton_iterations;
+}
+
+int JacobianFreeNewtonKrylov::get_gmres_iterations() const
+{
+  return gmres_iterations;
+}
+
+int JacobianFreeNewtonKrylov::get_residual_evaluations() const
+{
+  return residual_evaluations;
+}
+
+double JacobianFreeNewtonKrylov::get_last_time() const
+{
+  return cpu_time.last();
+}
+
+double JacobianFreeNewtonKrylov::get_time() const
+{
+  return cpu_time.accumulated();
+}
+
+EulerVTUExport::EulerVTUExport(Hermes::vector<Solution<double>*> solutions, double kappa, double rho_ext, double p_ext, int subdivisions)
+  : solutions(solutions), kappa(kappa), rho_ext(rho_ext), p_ext(p_ext), subdivisions(subdivisions), linearized_mesh(NULL), linearized_mesh_seq(-1), writing(false)
+{
+  if(solutions.size() != 4)
+    error("EulerVTUExport needs the four conservative variables.");
+  if(subdivisions < 1)
+    error("EulerVTUExport: at least one subdivision is needed.");
+}
+
+EulerVTUExport::~EulerVTUExport()
+{
+  wait();
+}
+
+void EulerVTUExport::wait()
+{
+  if(writing)
+  {
+    pthread_join(writer, NULL);
+    writing = false;
+  }
+}
+
+void EulerVTUExport::linearize(Mesh* mesh)
+{
+  elements.clear();
+  element_points.clear();
+  ref_points.clear();
+  points.clear();
+  connectivity.clear();
+  offsets.clear();
+  types.clear();
+
+  int s = subdivisions;
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    int first = ref_points.size() / 2;
+    elements.push_back(e);
+    element_points.push_back(first);
+
+    if(e->is_triangle())
+    {
+      // Points (i, j), i + j <= s, row by row; the row j starts at j * (s + 1) - j * (j - 1) / 2.
+      for(int j = 0; j <= s; j++)
+        for(int i = 0; i <= s - j; i++)
+        {
+          double xi = (double)i / s, eta = (double)j / s;
+          ref_points.push_back(2.0 * xi - 1.0);
+          ref_points.push_back(2.0 * eta - 1.0);
+          points.push_back(e->vn[0]->x + (e->vn[1]->x - e->vn[0]->x) * xi + (e->vn[2]->x - e->vn[0]->x) * eta);
+          points.push_back(e->vn[0]->y + (e->vn[1]->y - e->vn[0]->y) * xi + (e->vn[2]->y - e->vn[0]->y) * eta);
+          points.push_back(0.0);
+        }
+      for(int j = 0; j < s; j++)
+      {
+        int row = first + j * (s + 1) - j * (j - 1) / 2;
+        int next_row = row + s + 1 - j;
+        for(int i = 0; i < s - j; i++)
+        {
+          connectivity.push_back(row + i);
+          connectivity.push_back(row + i + 1);
+          connectivity.push_back(next_row + i);
+          offsets.push_back(connectivity.size());
+          types.push_back(5);
+          if(i < s - j - 1)
+          {
+            connectivity.push_back(row + i + 1);
+            connectivity.push_back(next_row + i + 1);
+            connectivity.push_back(next_row + i);
+            offsets.push_back(connectivity.size());
+            types.push_back(5);
+          }
+        }
+      }
+    }
+    else
+    {
+      // Points (i, j), 0 <= i, j <= s, row by row.
+      for(int j = 0; j <= s; j++)
+        for(int i = 0; i <= s; i++)
+        {
+          double xi = (double)i / s, eta = (double)j / s;
+          double shape[4] = { (1.0 - xi) * (1.0 - eta), xi * (1.0 - eta), xi * eta, (1.0 - xi) * eta };
+          ref_points.push_back(2.0 * xi - 1.0);
+          ref_points.push_back(2.0 * eta - 1.0);
+          double x = 0.0, y = 0.0;
+          for(int k = 0; k < 4; k++)
+          {
+            x += shape[k] * e->vn[k]->x;
+            y += shape[k] * e->vn[k]->y;
+          }
+          points.push_back(x);
+          points.push_back(y);
+          points.push_back(0.0);
+        }
+      for(int j = 0; j < s; j++)
+        for(int i = 0; i < s; i++)
+        {
+          connectivity.push_back(first + j * (s + 1) + i);
+          connectivity.push_back(first + j * (s + 1) + i + 1);
+          connectivity.push_back(first + (j + 1) * (s + 1) + i + 1);
+          connectivity.push_back(first + (j + 1) * (s + 1) + i);
+          offsets.push_back(connectivity.size());
+          types.push_back(9);
+        }
+    }
+  }
+  element_points.push_back(ref_points.size() / 2);
+
+  linearized_mesh = mesh;
+  linearized_mesh_seq = mesh->get_seq();
+}
+
+void EulerVTUExport::save(const char* filename)
+{
+  // The buffers are used by the writer of the previous file.
+  wait();
+
+  cpu_time.tick(HERMES_SKIP);
+
+  Mesh* mesh = solutions[0]->get_mesh();
+  if(mesh != linearized_mesh || mesh->get_seq() != linearized_mesh_seq)
+    linearize(mesh);
+
+  int point_count = ref_points.size() / 2;
+  pressure.resize(point_count);
+  Mach_number.resize(point_count);
+  entropy.resize(point_count);
+  velocity.resize(3 * point_count);
+
+  for(unsigned int element_i = 0; element_i < elements.size(); element_i++)
+  {
+    Element* e = elements[element_i];
+    for(int point_i = element_points[element_i]; point_i < element_points[element_i + 1]; point_i++)
+    {
+      double w[4];
+      for(int k = 0; k < 4; k++)
+        w[k] = solutions[k]->get_ref_value_transformed(e, ref_points[2 * point_i], ref_points[2 * point_i + 1], 0, 0);
+
+      double p = QuantityCalculator::calc_pressure(w[0], w[1], w[2], w[3], kappa);
+      double v_x = w[1] / w[0], v_y = w[2] / w[0];
+      pressure[point_i] = p;
+      Mach_number[point_i] = std::sqrt(v_x * v_x + v_y * v_y) / std::sqrt(kappa * p / w[0]);
+      entropy[point_i] = std::log((p / p_ext) / Hermes::pow(w[0] / rho_ext, kappa));
+      velocity[3 * point_i] = v_x;
+      velocity[3 * point_i + 1] = v_y;
+      velocity[3 * point_i + 2] = 0.0;
+    }
+  }
+
+  this->filename = filename;
+  if(pthread_create(&writer, NULL, write, this) == 0)
+    writing = true;
+  else
+  {
+    warning("EulerVTUExport: the writer thread could not be created, writing %s synchronously.", filename);
+    write(this);
+  }
+
+  cpu_time.tick();
+}
+
+// Data of the array of the VTU file, NULL if it is empty (a mesh without active elements).
+template<typename T>
+static const void* vtu_array_data(const std::vector<T>& array)
+{
+  return array.empty() ? NULL : &array[0];
+}
+
+void* EulerVTUExport::write(void* exporter)
+{
+  EulerVTUExport* self = (EulerVTUExport*)exporter;
+
+  FILE* f = fopen(self->filename.c_str(), "wb");
+  if(f == NULL)
+  {
+    warning("EulerVTUExport: cannot open %s.", self->filename.c_str());
+    return NULL;
+  }
+
+  struct DataArray
+  {
+    const char* name;
+    const char* type;
+    int components;
+    const void* data;
+    unsigned int bytes;
+  };
+  DataArray arrays[8] =
+  {
+    { "Pressure", "Float64", 1, vtu_array_data(self->pressure), (unsigned int)(self->pressure.size() * sizeof(double)) },
+    { "MachNumber", "Float64", 1, vtu_array_data(self->Mach_number), (unsigned int)(self->Mach_number.size() * sizeof(double)) },
+    { "Entropy", "Float64", 1, vtu_array_data(self->entropy), (unsigned int)(self->entropy.size() * sizeof(double)) },
+    { "Velocity", "Float64", 3, vtu_array_data(self->velocity), (unsigned int)(self->velocity.size() * sizeof(double)) },
+    { "Points", "Float64", 3, vtu_array_data(self->points), (unsigned int)(self->points.size() * sizeof(double)) },
+    { "connectivity", "Int32", 1, vtu_array_data(self->connectivity), (unsigned int)(self->connectivity.size() * sizeof(int)) },
+    { "offsets", "Int32", 1, vtu_array_data(self->offsets), (unsigned int)(self->offsets.size() * sizeof(int)) },
+    { "types", "UInt8", 1, vtu_array_data(self->types), (unsigned int)(self->types.size() * sizeof(unsigned char)) }
+  };
+
+  // Every appended block is preceded by its size in bytes.
+  unsigned int array_offsets[8];
+  unsigned int offset = 0;
+  for(int i = 0; i < 8; i++)
+  {
+    array_offsets[i] = offset;
+    offset += sizeof(unsigned int) + arrays[i].bytes;
+  }
+
+  int one = 1;
+  fprintf(f, "<?xml version=\"1.0\"?>\n");
+  fprintf(f, "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" byte_order=\"%s\" header_type=\"UInt32\">\n", *(char*)&one ? "LittleEndian" : "BigEndian");
+  fprintf(f, "<UnstructuredGrid>\n");
+  fprintf(f, "<Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n", (int)self->points.size() / 3, (int)self->types.size());
+  fprintf(f, "<PointData Scalars=\"Pressure\" Vectors=\"Velocity\">\n");
+  for(int i = 0; i < 8; i++)
+  {
+    if(i == 4)
+      fprintf(f, "</PointData>\n<Points>\n");
+    if(i == 5)
+      fprintf(f, "</Points>\n<Cells>\n");
+    fprintf(f, "<DataArray type=\"%s\" Name=\"%s\" NumberOfComponents=\"%d\" format=\"appended\" offset=\"%u\"/>\n",
+      arrays[i].type, arrays[i].name, arrays[i].components, array_offsets[i]);
+  }
+  fprintf(f, "</Cells>\n</Piece>\n</UnstructuredGrid>\n");
+  fprintf(f, "<AppendedData encoding=\"raw\">\n_");
+  for(int i = 0; i < 8; i++)
+  {
+    fwrite(&arrays[i].bytes, sizeof(unsigned int), 1, f);
+    if(arrays[i].bytes > 0)
+      fwrite(arrays[i].data, 1, arrays[i].bytes, f);
+  }
+  fprintf(f, "\n</AppendedData>\n</VTKFile>\n");
+  fclose(f);
+
+  return NULL;
+}
+
+double EulerVTUExport::get_last_time() const
+{
+  return cpu_time.last();
+}
+
+double EulerVTUExport::get_time() const
+{
+  return cpu_time.accumulated();
+}
+
+// Layout of a record: the header, the description of the spaces (padded to 8 bytes), the coefficients
+// (raw doubles, or the zlib stream of them). Native byte order.
+struct BinaryCheckpointHeader
+{
+  char magic[4];
+  unsigned int version;
+  unsigned int flags;
+  int space_count;
+  double time;
+  double time_step;
+  long long description_size;
+  long long coefficient_count;
+  long long stored_size;
+};
+
+static const char binary_checkpoint_magic[4] = { 'H', 'E', 'C', 'P' };
+static const unsigned int binary_checkpoint_compressed = 1;
+
+static size_t binary_checkpoint_data_offset(long long description_size)
+{
+  size_t description_bytes = description_size * sizeof(int);
+  return sizeof(BinaryCheckpointHeader) + (description_bytes + 7) / 8 * 8;
+}
+
+BinaryCheckpoint::BinaryCheckpoint(bool compress) : compress(compress), writing(false), mapped(NULL), mapped_size(0)
+{
+#ifndef WITH_ZLIB
+  if(compress)
+  {
+    warning("BinaryCheckpoint: built without zlib, the records are not compressed.");
+    this->compress = false;
+  }
+#endif
+}
+
+BinaryCheckpoint::~BinaryCheckpoint()
+{
+  wait();
+  close();
+}
+
+void BinaryCheckpoint::describe_spaces(Hermes::vector<Space<double>*> spaces, std::vector<int>& description)
+{
+  description.clear();
+  for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+  {
+    Mesh* mesh = spaces[space_i]->get_mesh();
+    description.push_back(spaces[space_i]->get_num_dofs());
+    description.push_back(mesh->get_num_active_elements());
+    Element* e;
+    for_all_active_elements(e, mesh)
+    {
+      description.push_back(e->id);
+      description.push_back(spaces[space_i]->get_element_order(e->id));
+    }
+  }
+}
+
+void BinaryCheckpoint::save(const char* filename, double time, double time_step, Hermes::vector<Space<double>*> spaces, double* coeff_vec)
+{
+  // The buffers are used by the writer of the previous record.
+  wait();
+
+  this->filename = filename;
+  this->time = time;
+  this->time_step = time_step;
+  space_count = spaces.size();
+  describe_spaces(spaces, description);
+  coefficients.assign(coeff_vec, coeff_vec + Space<double>::get_num_dofs(spaces));
+
+  if(pthread_create(&writer, NULL, write, this) == 0)
+    writing = true;
+  else
+  {
+    warning("BinaryCheckpoint: the writer thread could not be created, writing %s synchronously.", filename);
+    write(this);
+  }
+}
+
+void BinaryCheckpoint::wait()
+{
+  if(writing)
+  {
+    pthread_join(writer, NULL);
+    writing = false;
+  }
+}
+
+void* BinaryCheckpoint::write(void* checkpoint)
+{
+  BinaryCheckpoint* self = (BinaryCheckpoint*)checkpoint;
+
+  BinaryCheckpointHeader header;
+  memcpy(header.magic, binary_checkpoint_magic, 4);
+  header.version = format_version;
+  header.flags = 0;
+  header.space_count = self->space_count;
+  header.time = self->time;
+  header.time_step = self->time_step;
+  header.description_size = self->description.size();
+  header.coefficient_count = self->coefficients.size();
+
+  const char* data = (const char*)&self->coefficients[0];
+  header.stored_size = self->coefficients.size() * sizeof(double);
+#ifdef WITH_ZLIB
+  std::vector<Bytef> compressed;
+  if(self->compress)
+  {
+    uLongf compressed_size = compressBound(header.stored_size);
+    compressed.resize(compressed_size);
+    if(compress2(&compressed[0], &compressed_size, (const Bytef*)data, header.stored_size, Z_DEFAULT_COMPRESSION) == Z_OK)
+    {
+      header.flags |= binary_checkpoint_compressed;
+      header.stored_size = compressed_size;
+      data = (const char*)&compressed[0];
+    }
+    else
+      warning("BinaryCheckpoint: compression failed, %s is not compressed.", self->filename.c_str());
+  }
+#endif
+
+  // Written under a temporary name, so that an interrupted run does not leave a broken record.
+  std::string temporary_filename = self->filename + ".tmp";
+  FILE* f = fopen(temporary_filename.c_str(), "wb");
+  if(f == NULL)
+  {
+    warning("BinaryCheckpoint: cannot open %s.", temporary_filename.c_str());
+    return NULL;
+  }
+  size_t padding = binary_checkpoint_data_offset(header.description_size) - sizeof(BinaryCheckpointHeader) - self->description.size() * sizeof(int);
+  const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  bool written = fwrite(&header, sizeof(BinaryCheckpointHeader), 1, f) == 1
+    && fwrite(&self->description[0], sizeof(int), self->description.size(), f) == self->description.size()
+    && fwrite(zeros, 1, padding, f) == padding
+    && fwrite(data, 1, header.stored_size, f) == (size_t)header.stored_size;
+  if(fclose(f) != 0 || !written)
+  {
+    warning("BinaryCheckpoint: writing %s failed.", temporary_filename.c_str());
+    return NULL;
+  }
+  remove(self->filename.c_str());
+  if(rename(temporary_filename.c_str(), self->filename.c_str()) != 0)
+    warning("BinaryCheckpoint: cannot rename %s.", temporary_filename.c_str());
+
+  return NULL;
+}
+
+void BinaryCheckpoint::open(const char* filename)
+{
+  close();
+  // The record may still be being written.
+  wait();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    error("BinaryCheckpoint: cannot open %s.", filename);
+  LARGE_INTEGER size;
+  GetFileSizeEx(file, &size);
+  mapped_size = (size_t)size.QuadPart;
+  mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  CloseHandle(file);
+  if(mapping == NULL)
+    error("BinaryCheckpoint: cannot map %s.", filename);
+  mapped = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  if(mapped == NULL)
+    error("BinaryCheckpoint: cannot map %s.", filename);
+#else
+  int file = ::open(filename, O_RDONLY);
+  if(file < 0)
+    error("BinaryCheckpoint: cannot open %s.", filename);
+  struct stat file_stat;
+  fstat(file, &file_stat);
+  mapped_size = file_stat.st_size;
+  // Private mapping, the solutions may get the coefficients as non-const.
+  void* address = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if(address == MAP_FAILED)
+    error("BinaryCheckpoint: cannot map %s.", filename);
+  mapped = (char*)address;
+#endif
+
+  const BinaryCheckpointHeader* header = (const BinaryCheckpointHeader*)mapped;
+  if(mapped_size < sizeof(BinaryCheckpointHeader) || memcmp(header->magic, binary_checkpoint_magic, 4) != 0)
+    error("BinaryCheckpoint: %s is not a checkpoint.", filename);
+  if(header->version != format_version)
+    error("BinaryCheckpoint: %s has the version %u of the format, %u is supported.", filename, header->version, format_version);
+  if(mapped_size < binary_checkpoint_data_offset(header->description_size) + header->stored_size)
+    error("BinaryCheckpoint: %s is truncated.", filename);
+}
+
+void BinaryCheckpoint::close()
+{
+  if(mapped == NULL)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(mapped);
+  CloseHandle(mapping);
+#else
+  munmap(mapped, mapped_size);
+#endif
+  mapped = NULL;
+  mapped_size = 0;
+}
+
+double BinaryCheckpoint::get_record_time() const
+{
+  if(mapped == NULL)
+    error("BinaryCheckpoint: no record is opened.");
+  return ((const BinaryCheckpointHeader*)mapped)->time;
+}
+
+double BinaryCheckpoint::get_record_time_step() const
+{
+  if(mapped == NULL)
+    error("BinaryCheckpoint: no record is opened.");
+  return ((const BinaryCheckpointHeader*)mapped)->time_step;
+}
+
+bool BinaryCheckpoint::load(Hermes::vector<Space<double>*> spaces, Hermes::vector<Solution<double>*> solutions, MatrixSolverType matrix_solver)
+{
+  if(mapped == NULL)
+    error("BinaryCheckpoint: no record is opened.");
+  const BinaryCheckpointHeader* header = (const BinaryCheckpointHeader*)mapped;
+  if(header->space_count != (int)spaces.size())
+    error("BinaryCheckpoint: the record has %d spaces, %d given.", header->space_count, (int)spaces.size());
+
+  const int* saved_description = (const int*)(mapped + sizeof(BinaryCheckpointHeader));
+  char* data = mapped + binary_checkpoint_data_offset(header->description_size);
+
+  double* coeff_vec = (double*)data;
+  std::vector<double> uncompressed;
+  if(header->flags & binary_checkpoint_compressed)
+  {
+#ifdef WITH_ZLIB
+    uncompressed.resize(header->coefficient_count);
+    uLongf uncompressed_size = header->coefficient_count * sizeof(double);
+    if(uncompress((Bytef*)&uncompressed[0], &uncompressed_size, (const Bytef*)data, header->stored_size) != Z_OK 
+      || uncompressed_size != header->coefficient_count * sizeof(double))
+      error("BinaryCheckpoint: the coefficients cannot be decompressed.");
+    coeff_vec = &uncompressed[0];
+#else
+    error("BinaryCheckpoint: the record is compressed, but the build is without zlib.");
+#endif
+  }
+
+  // The saved spaces: the coefficients are used directly.
+  std::vector<int> current_description;
+  describe_spaces(spaces, current_description);
+  if(current_description.size() == (size_t)header->description_size 
+    && std::equal(current_description.begin(), current_description.end(), saved_description))
+  {
+    Solution<double>::vector_to_solutions(coeff_vec, spaces, solutions);
+    return true;
+  }
+
+  // The same elements with other orders: the coefficients are set on the saved orders and projected.
+  Hermes::vector<Space<double>*> saved_spaces;
+  int position = 0;
+  for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+  {
+    Mesh* mesh = spaces[space_i]->get_mesh();
+    int element_count = saved_description[position + 1];
+    position += 2;
+    if(element_count != mesh->get_num_active_elements())
+      error("BinaryCheckpoint: the record does not match the mesh of the space %d.", space_i);
+    L2Space<double>* saved_space = new L2Space<double>(mesh, 0);
+    for(int element_i = 0; element_i < element_count; element_i++, position += 2)
+    {
+      int id = saved_description[position];
+      if(id < 0 || id >= mesh->get_max_element_id() || !mesh->get_element(id)->active)
+        error("BinaryCheckpoint: the record does not match the mesh of the space %d.", space_i);
+      saved_space->set_element_order(id, saved_description[position + 1]);
+    }
+    saved_spaces.push_back(saved_space);
+  }
+  Space<double>::assign_dofs(saved_spaces);
+  if(Space<double>::get_num_dofs(saved_spaces) != header->coefficient_count)
+    error("BinaryCheckpoint: the record does not match the spaces.");
+
+  Solution<double>::vector_to_solutions(coeff_vec, saved_spaces, solutions);
+  OGProjection<double>::project_global(spaces, solutions, solutions, matrix_solver, Hermes::vector<ProjNormType>());
+
+  for(unsigned int space_i = 0; space_i < saved_spaces.size(); space_i++)
+    delete saved_spaces[space_i];
+
+  return false;
+}
+
+static const char shock_indicator_log_magic[4] = { 'S', 'I', 'L', 'B' };
+
+ShockIndicatorLog::ShockIndicatorLog(const char* filename, bool append, int flush_every) : filename(filename), flush_every(flush_every)
+{
+  FILE* f = fopen(filename, append ? "ab" : "wb");
+  if(f == NULL)
+    error("ShockIndicatorLog: cannot open %s.", filename);
+  fclose(f);
+}
+
+ShockIndicatorLog::~ShockIndicatorLog()
+{
+  flush();
+}
+
+void ShockIndicatorLog::add(int iteration, int indicator, const std::vector<int>& element_ids)
+{
+  std::vector<int> ids(element_ids);
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  IndexEntry entry;
+  entry.iteration = iteration;
+  entry.indicator = indicator;
+  entry.count = ids.size();
+  entry.offset = data.size();
+
+  // Runs of consecutive ids (first id, length).
+  std::vector<int> runs;
+  for(unsigned int i = 0; i < ids.size(); i++)
+    if(i > 0 && ids[i] == ids[i - 1] + 1)
+      runs.back()++;
+    else
+    {
+      runs.push_back(ids[i]);
+      runs.push_back(1);
+    }
+  size_t runs_size = runs.size() * sizeof(int);
+  // Bitmap from the smallest id (stored first).
+  size_t bitmap_size = ids.empty() ? 0 : sizeof(int) + (ids.back() - ids.front()) / 8 + 1;
+
+  if(ids.empty() || runs_size <= bitmap_size)
+  {
+    entry.encoding = Runs;
+    entry.size = runs_size;
+    if(!runs.empty())
+      data.insert(data.end(), (const char*)&runs[0], (const char*)&runs[0] + runs_size);
+  }
+  else
+  {
+    entry.encoding = Bitmap;
+    entry.size = bitmap_size;
+    data.resize(data.size() + bitmap_size, 0);
+    char* bitmap = &data[entry.offset];
+    memcpy(bitmap, &ids.front(), sizeof(int));
+    for(unsigned int i = 0; i < ids.size(); i++)
+    {
+      int bit = ids[i] - ids.front();
+      bitmap[sizeof(int) + bit / 8] |= (char)(1 << (bit % 8));
+    }
+  }
+  entries.push_back(entry);
+
+  if((int)entries.size() >= flush_every)
+    flush();
+}
+
+void ShockIndicatorLog::flush()
+{
+  if(entries.empty())
+    return;
+
+  BlockHeader header;
+  memcpy(header.magic, shock_indicator_log_magic, 4);
+  header.version = format_version;
+  header.entry_count = entries.size();
+  header.reserved = 0;
+  header.data_size = data.size();
+
+  FILE* f = fopen(filename.c_str(), "ab");
+  if(f == NULL)
+    error("ShockIndicatorLog: cannot open %s.", filename.c_str());
+  fwrite(&header, sizeof(BlockHeader), 1, f);
+  fwrite(&entries[0], sizeof(IndexEntry), entries.size(), f);
+  if(!data.empty())
+    fwrite(&data[0], 1, data.size(), f);
+  if(fclose(f) != 0)
+    error("ShockIndicatorLog: writing %s failed.", filename.c_str());
+
+  entries.clear();
+  data.clear();
+}
+
+ShockIndicatorLogReader::ShockIndicatorLogReader(const char* filename)
+{
+  file = fopen(filename, "rb");
+  if(file == NULL)
+    error("ShockIndicatorLogReader: cannot open %s.", filename);
+
+  // Only the block headers and indices are read, the data are skipped.
+  ShockIndicatorLog::BlockHeader header;
+  while(fread(&header, sizeof(ShockIndicatorLog::BlockHeader), 1, file) == 1)
+  {
+    if(memcmp(header.magic, shock_indicator_log_magic, 4) != 0)
+      error("ShockIndicatorLogReader: %s is not a shock indicator log.", filename);
+    if(header.version != ShockIndicatorLog::format_version)
+      error("ShockIndicatorLogReader: %s has the version %d of the format, %d is supported.", filename, header.version, ShockIndicatorLog::format_version);
+
+    std::vector<ShockIndicatorLog::IndexEntry> entries(header.entry_count);
+    if(fread(&entries[0], sizeof(ShockIndicatorLog::IndexEntry), header.entry_count, file) != (size_t)header.entry_count)
+      error("ShockIndicatorLogReader: %s is truncated.", filename);
+    long long data_position = ftell(file);
+    for(int i = 0; i < header.entry_count; i++)
+      index[std::pair<int, int>(entries[i].iteration, entries[i].indicator)] = std::pair<long long, ShockIndicatorLog::IndexEntry>(data_position + entries[i].offset, entries[i]);
+    if(fseek(file, header.data_size, SEEK_CUR) != 0)
+      error("ShockIndicatorLogReader: %s is truncated.", filename);
+  }
+}
+
+ShockIndicatorLogReader::~ShockIndicatorLogReader()
+{
+  fclose(file);
+}
+
+std::vector<int> ShockIndicatorLogReader::get_iterations() const
+{
+  std::vector<int> iterations;
+  for(std::map<std::pair<int, int>, std::pair<long long, ShockIndicatorLog::IndexEntry> >::const_iterator it = index.begin(); it != index.end(); it++)
+    if(iterations.empty() || iterations.back() != it->first.first)
+      iterations.push_back(it->first.first);
+  return iterations;
+}
+
+bool ShockIndicatorLogReader::get_element_ids(int iteration, int indicator, std::vector<int>& element_ids)
+{
+  element_ids.clear();
+  std::map<std::pair<int, int>, std::pair<long long, ShockIndicatorLog::IndexEntry> >::iterator it = index.find(std::pair<int, int>(iteration, indicator));
+  if(it == index.end())
+    return false;
+  const ShockIndicatorLog::IndexEntry& entry = it->second.second;
+  if(entry.size == 0)
+    return true;
+
+  std::vector<char> data(entry.size);
+  if(fseek(file, it->second.first, SEEK_SET) != 0 || fread(&data[0], 1, entry.size, file) != (size_t)entry.size)
+    error("ShockIndicatorLogReader: the entry of the time step %d cannot be read.", iteration);
+
+  element_ids.reserve(entry.count);
+  if(entry.encoding == ShockIndicatorLog::Runs)
+  {
+    const int* runs = (const int*)&data[0];
+    for(unsigned int run_i = 0; run_i < entry.size / (2 * sizeof(int)); run_i++)
+      for(int i = 0; i < runs[2 * run_i + 1]; i++)
+        element_ids.push_back(runs[2 * run_i] + i);
+  }
+  else
+  {
+    int first;
+    memcpy(&first, &data[0], sizeof(int));
+    for(unsigned int bit = 0; bit < 8 * (entry.size - sizeof(int)); bit++)
+      if(data[sizeof(int) + bit / 8] & (1 << (bit % 8)))
+        element_ids.push_back(first + bit);
+  }
+  return true;
+}
+
+ReferenceSpaceManager::ReferenceSpaceManager(Hermes::vector<Space<double>*> coarse_spaces, int order_increase) 
+  : coarse_spaces(coarse_spaces), order_increase(order_increase), current(-1), last_reused(false)
+{
+}
+
+ReferenceSpaceManager::~ReferenceSpaceManager()
+{
+  for(int set_i = 0; set_i < 2; set_i++)
+  {
+    for(unsigned int i = 0; i < ref_spaces[set_i].size(); i++)
+      delete ref_spaces[set_i][i];
+    for(unsigned int i = 0; i < ref_meshes[set_i].size(); i++)
+      delete ref_meshes[set_i][i];
+  }
+}
+
+void ReferenceSpaceManager::describe_coarse_spaces(std::vector<int>& description) const
+{
+  description.clear();
+  for(unsigned int space_i = 0; space_i < coarse_spaces.size(); space_i++)
+  {
+    Mesh* mesh = coarse_spaces[space_i]->get_mesh();
+    description.push_back(mesh->get_num_active_elements());
+    Element* e;
+    for_all_active_elements(e, mesh)
+    {
+      description.push_back(e->id);
+      for(unsigned int i = 0; i < e->get_num_surf(); i++)
+        description.push_back(e->vn[i]->id);
+      description.push_back(coarse_spaces[space_i]->get_element_order(e->id));
+    }
+  }
+}
+
+Hermes::vector<Space<double>*>* ReferenceSpaceManager::get_ref_spaces()
+{
+  cpu_time.tick(HERMES_SKIP);
+
+  std::vector<int> current_description;
+  describe_coarse_spaces(current_description);
+  last_reused = (current != -1 && current_description == description);
+
+  if(!last_reused)
+  {
+    // The other set of the pool, the current one may still be in use.
+    int set_i = (current == -1) ? 0 : 1 - current;
+    for(unsigned int i = 0; i < ref_spaces[set_i].size(); i++)
+      delete ref_spaces[set_i][i];
+    ref_spaces[set_i].clear();
+
+    unsigned int mesh_count = 0;
+    for(unsigned int space_i = 0; space_i < coarse_spaces.size(); space_i++)
+    {
+      Mesh* coarse_mesh = coarse_spaces[space_i]->get_mesh();
+      Mesh* ref_mesh = NULL;
+      for(unsigned int space_j = 0; space_j < space_i; space_j++)
+        if(coarse_spaces[space_j]->get_mesh() == coarse_mesh)
+          ref_mesh = ref_spaces[set_i][space_j]->get_mesh();
+      if(ref_mesh == NULL)
+      {
+        if(mesh_count == ref_meshes[set_i].size())
+          ref_meshes[set_i].push_back(NULL);
+        ref_mesh = ref_meshes[set_i][mesh_count++];
+        if(ref_mesh == NULL || ref_mesh->get_num_base_elements() != coarse_mesh->get_num_base_elements())
+        {
+          delete ref_mesh;
+          ref_mesh = ref_meshes[set_i][mesh_count - 1] = new Mesh;
+          ref_mesh->copy(coarse_mesh);
+          ref_mesh->refine_all_elements();
+        }
+        else
+        {
+          // The base elements of both meshes are the same (the reference mesh is a copy of the coarse one).
+          for(int id = 0; id < coarse_mesh->get_num_base_elements(); id++)
+            if(coarse_mesh->get_element(id)->used)
+              mirror_refinements(ref_mesh, coarse_mesh->get_element(id), ref_mesh->get_element(id));
+        }
+      }
+      ref_spaces[set_i].push_back(coarse_spaces[space_i]->dup(ref_mesh, order_increase));
+    }
+    Space<double>::assign_dofs(ref_spaces[set_i]);
+
+    description.swap(current_description);
+    current = set_i;
+  }
+
+  cpu_time.tick();
+  return &ref_spaces[current];
+}
+
+void ReferenceSpaceManager::mirror_refinements(Mesh* ref_mesh, Element* coarse_e, Element* ref_e)
+{
+  // The sons are only valid in inactive elements (they share the memory with the edge nodes).
+  int refinement = coarse_e->active ? 0 : get_refinement(coarse_e);
+  if(!ref_e->active && get_refinement(ref_e) != refinement)
+    unrefine_element(ref_mesh, ref_e);
+  if(ref_e->active)
+    ref_mesh->refine_element_id(ref_e->id, refinement);
+
+  for(int i = 0; i < H2D_MAX_ELEMENT_SONS; i++)
+  {
+    if(ref_e->sons[i] == NULL)
+      continue;
+    if(!coarse_e->active)
+      mirror_refinements(ref_mesh, coarse_e->sons[i], ref_e->sons[i]);
+    else if(!ref_e->sons[i]->active)
+      unrefine_element(ref_mesh, ref_e->sons[i]);
+  }
+}
+
+void ReferenceSpaceManager::unrefine_element(Mesh* mesh, Element* e)
+{
+  for(int i = 0; i < H2D_MAX_ELEMENT_SONS; i++)
+    if(e->sons[i] != NULL && !e->sons[i]->active)
+      unrefine_element(mesh, e->sons[i]);
+  mesh->unrefine_element_id(e->id);
+}
+
+int ReferenceSpaceManager::get_refinement(Element* e)
+{
+  if(e->is_triangle() || (e->sons[0] != NULL && e->sons[2] != NULL))
+    return 0;
+  return (e->sons[0] != NULL) ? 1 : 2;
+}
+
+bool ReferenceSpaceManager::get_last_reused() const
+{
+  return last_reused;
+}
+
+double ReferenceSpaceManager::get_last_time() const
+{
+  return cpu_time.last();
+}
+
+double ReferenceSpaceManager::get_time() const
+{
+  return cpu_time.accumulated();
+}
+
+void L2Transfer::ElementGrid::init(Mesh* mesh)
+{
+  // Bounding boxes, enlarged for the curved edges.
+  std::vector<Element*> elements;
+  std::vector<double> boxes;
+  x_min = y_min = std::numeric_limits<double>::max();
+  double x_max = -std::numeric_limits<double>::max(), y_max = -std::numeric_limits<double>::max();
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    double box[4] = { e->vn[0]->x, e->vn[0]->y, e->vn[0]->x, e->vn[0]->y };
+    for(unsigned int i = 1; i < e->get_num_surf(); i++)
+    {
+      box[0] = std::min(box[0], e->vn[i]->x);
+      box[1] = std::min(box[1], e->vn[i]->y);
+      box[2] = std::max(box[2], e->vn[i]->x);
+      box[3] = std::max(box[3], e->vn[i]->y);
+    }
+    double margin = 0.1 * std::max(box[2] - box[0], box[3] - box[1]);
+    box[0] -= margin;
+    box[1] -= margin;
+    box[2] += margin;
+    box[3] += margin;
+    x_min = std::min(x_min, box[0]);
+    y_min = std::min(y_min, box[1]);
+    x_max = std::max(x_max, box[2]);
+    y_max = std::max(y_max, box[3]);
+    elements.push_back(e);
+    boxes.insert(boxes.end(), box, box + 4);
+  }
+
+  nx = ny = std::max(1, (int)std::sqrt((double)elements.size()));
+  cell_size_x = (x_max - x_min) / nx;
+  cell_size_y = (y_max - y_min) / ny;
+
+  // Counting sort of the (element, cell) pairs by the cells.
+  std::vector<int> counts(nx * ny + 1, 0);
+  for(int pass = 0; pass < 2; pass++)
+  {
+    for(unsigned int element_i = 0; element_i < elements.size(); element_i++)
+    {
+      double* box = &boxes[4 * element_i];
+      int i_start = std::min(nx - 1, (int)((box[0] - x_min) / cell_size_x)), i_end = std::min(nx - 1, (int)((box[2] - x_min) / cell_size_x));
+      int j_start = std::min(ny - 1, (int)((box[1] - y_min) / cell_size_y)), j_end = std::min(ny - 1, (int)((box[3] - y_min) / cell_size_y));
+      for(int j = j_start; j <= j_end; j++)
+        for(int i = i_start; i <= i_end; i++)
+          if(pass == 0)
+            counts[j * nx + i + 1]++;
+          else
+            cell_elements[counts[j * nx + i]++] = elements[element_i];
+    }
+    if(pass == 0)
+    {
+      for(int cell_i = 0; cell_i < nx * ny; cell_i++)
+        counts[cell_i + 1] += counts[cell_i];
+      cell_offsets = counts;
+      cell_elements.resize(counts[nx * ny]);
+    }
+  }
+}
+
+bool L2Transfer::ElementGrid::contains(Element* e, double xi, double eta)
+{
+  const double tolerance = 1E-10;
+  if(e->is_triangle())
+    return xi >= -1.0 - tolerance && eta >= -1.0 - tolerance && xi + eta <= tolerance;
+  return std::abs(xi) <= 1.0 + tolerance && std::abs(eta) <= 1.0 + tolerance;
+}
+
+Element* L2Transfer::ElementGrid::locate(RefMap* refmap, double x, double y, double& xi, double& eta, Element* guess) const
+{
+  if(guess != NULL)
+  {
+    refmap->untransform(guess, x, y, xi, eta);
+    if(contains(guess, xi, eta))
+      return guess;
+  }
+
+  int i = std::max(0, std::min(nx - 1, (int)((x - x_min) / cell_size_x)));
+  int j = std::max(0, std::min(ny - 1, (int)((y - y_min) / cell_size_y)));
+
+  // If no element contains the point (it is on a curved boundary), the closest one is taken, with the point moved inside.
+  Element* closest = NULL;
+  double closest_distance = std::numeric_limits<double>::max();
+  double closest_xi = 0.0, closest_eta = 0.0;
+  for(int k = cell_offsets[j * nx + i]; k < cell_offsets[j * nx + i + 1]; k++)
+  {
+    Element* e = cell_elements[k];
+    refmap->untransform(e, x, y, xi, eta);
+    if(contains(e, xi, eta))
+      return e;
+    double distance = e->is_triangle() ? std::max(std::max(-1.0 - xi, -1.0 - eta), xi + eta) : std::max(std::abs(xi), std::abs(eta)) - 1.0;
+    if(distance < closest_distance)
+    {
+      closest = e;
+      closest_distance = distance;
+      closest_xi = xi;
+      closest_eta = eta;
+    }
+  }
+  if(closest == NULL)
+    error("L2Transfer: no element found at (%g, %g).", x, y);
+
+  xi = closest_xi;
+  eta = closest_eta;
+  if(closest->is_triangle())
+  {
+    xi = std::max(xi, -1.0);
+    eta = std::max(eta, -1.0);
+    if(xi + eta > 0.0)
+    {
+      double shift = 0.5 * (xi + eta);
+      xi -= shift;
+      eta -= shift;
+    }
+  }
+  else
+  {
+    xi = std::max(-1.0, std::min(1.0, xi));
+    eta = std::max(-1.0, std::min(1.0, eta));
+  }
+  return closest;
+}
+
+L2Transfer::L2Transfer(MatrixSolverType matrix_solver) : matrix_solver(matrix_solver), copied_elements(0), projected_elements(0), global_components(0)
+{
+}
+
+bool L2Transfer::same_geometry(Element* e, Element* f)
+{
+  if(e->get_num_surf() != f->get_num_surf())
+    return false;
+  double tolerance = 1E-12 * (std::abs(e->vn[0]->x) + std::abs(e->vn[0]->y) + 1.0);
+  for(unsigned int i = 0; i < e->get_num_surf(); i++)
+    if(std::abs(e->vn[i]->x - f->vn[i]->x) > tolerance || std::abs(e->vn[i]->y - f->vn[i]->y) > tolerance)
+      return false;
+  return true;
+}
+
+void L2Transfer::set_coefficients(Hermes::vector<Solution<double>*> solutions, Hermes::vector<Space<double>*> spaces, double* coeff_vec)
+{
+  coefficient_solutions = solutions;
+  coefficient_spaces = spaces;
+  coefficients.assign(coeff_vec, coeff_vec + Space<double>::get_num_dofs(spaces));
+}
+
+void L2Transfer::set_coefficients(Hermes::vector<Solution<double>*> solutions, const L2Transfer& other)
+{
+  coefficient_solutions = solutions;
+  coefficient_spaces = other.coefficient_spaces;
+  coefficients = other.coefficients;
+}
+
+void L2Transfer::transfer(Hermes::vector<Space<double>*> spaces, Hermes::vector<Solution<double>*> source, Hermes::vector<Solution<double>*> target, 
+  bool delete_old_meshes)
+{
+  cpu_time.tick(HERMES_SKIP);
+  copied_elements = projected_elements = global_components = 0;
+
+  // The components projected element by element.
+  std::vector<bool> local(spaces.size(), true);
+  for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+  {
+    if(spaces[space_i]->get_type() != HERMES_L2_SPACE)
+      local[space_i] = false;
+    else if(source[space_i]->get_type() == HERMES_EXACT && dynamic_cast<ExactSolutionScalar<double>*>(source[space_i]) == NULL)
+      local[space_i] = false;
+    if(!local[space_i])
+      global_components++;
+  }
+
+  // The meshes of the source solutions (as OGProjection::project_global does), before the targets (may be the same) change,
+  // except those of the spaces.
+  std::vector<Mesh*> old_meshes;
+  if(delete_old_meshes)
+    for(unsigned int space_i = 0; space_i < source.size(); space_i++)
+    {
+      Mesh* mesh = source[space_i]->get_mesh();
+      bool used = (std::find(old_meshes.begin(), old_meshes.end(), mesh) != old_meshes.end());
+      for(unsigned int space_j = 0; space_j < spaces.size() && !used; space_j++)
+        used = (spaces[space_j]->get_mesh() == mesh);
+      if(!used)
+        old_meshes.push_back(mesh);
+    }
+
+  int ndof = Space<double>::assign_dofs(spaces);
+  std::vector<double> new_coefficients(ndof, 0.0);
+
+  RefMap refmap, source_refmap;
+  refmap.set_quad_2d(&g_quad_2d_std);
+  Quad2D* quad = &g_quad_2d_std;
+
+  for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+  {
+    if(!local[space_i])
+      continue;
+
+    Mesh* mesh = spaces[space_i]->get_mesh();
+    PrecalcShapeset pss(spaces[space_i]->get_shapeset());
+    pss.set_quad_2d(quad);
+
+    ExactSolutionScalar<double>* exact = NULL;
+    if(source[space_i]->get_type() == HERMES_EXACT)
+      exact = dynamic_cast<ExactSolutionScalar<double>*>(source[space_i]);
+
+    // The source elements; the coefficients can be copied if the source solution is the last transferred one.
+    ElementGrid grid;
+    if(exact == NULL)
+      grid.init(source[space_i]->get_mesh());
+    Space<double>* coefficient_space = NULL;
+    if(exact == NULL && coefficient_solutions.size() == spaces.size() && coefficient_solutions[space_i] == source[space_i] 
+      && source[space_i]->get_space() == coefficient_spaces[space_i])
+      coefficient_space = coefficient_spaces[space_i];
+
+    Element* e;
+    Element* source_e = NULL;
+    for_all_active_elements(e, mesh)
+    {
+      AsmList<double> al;
+      spaces[space_i]->get_element_assembly_list(e, &al);
+      int n = al.get_cnt();
+      int order = spaces[space_i]->get_element_order(e->id);
+
+      // The same element in the source.
+      if(coefficient_space != NULL)
+      {
+        double c_x = 0.0, c_y = 0.0, xi, eta;
+        for(unsigned int i = 0; i < e->get_num_surf(); i++)
+        {
+          c_x += e->vn[i]->x / e->get_num_surf();
+          c_y += e->vn[i]->y / e->get_num_surf();
+        }
+        source_e = grid.locate(&source_refmap, c_x, c_y, xi, eta, source_e);
+        if(same_geometry(e, source_e) && coefficient_space->get_element_order(source_e->id) == order)
+        {
+          AsmList<double> source_al;
+          coefficient_space->get_element_assembly_list(source_e, &source_al);
+          bool same_basis = (source_al.get_cnt() == n);
+          for(int i = 0; i < n && same_basis; i++)
+            same_basis = (source_al.get_idx()[i] == al.get_idx()[i] && source_al.get_coef()[i] == al.get_coef()[i]);
+          if(same_basis)
+          {
+            for(int i = 0; i < n; i++)
+              new_coefficients[al.get_dof()[i]] = coefficients[source_al.get_dof()[i]];
+            copied_elements++;
+            continue;
+          }
+        }
+      }
+
+      // Element-local projection, (sum_j c_j phi_j, phi_i) = (u, phi_i).
+      refmap.set_active_element(e);
+      pss.set_active_element(e);
+      int max_order = quad->get_max_order(e->get_mode());
+      int o = e->is_triangle() ? std::min(2 * H2D_GET_H_ORDER(order) + 2, max_order) 
+        : H2D_MAKE_QUAD_ORDER(std::min(2 * H2D_GET_H_ORDER(order) + 2, max_order), std::min(2 * H2D_GET_V_ORDER(order) + 2, max_order));
+      double3* pt = quad->get_points(o);
+      int np = quad->get_num_points(o);
+      double* x = refmap.get_phys_x(o);
+      double* y = refmap.get_phys_y(o);
+
+      std::vector<double> weights(np);
+      double* jac = refmap.is_jacobian_const() ? NULL : refmap.get_jacobian(o);
+      for(int point_i = 0; point_i < np; point_i++)
+        weights[point_i] = pt[point_i][2] * (jac == NULL ? refmap.get_const_jacobian() : jac[point_i]);
+
+      std::vector<double> source_values(np);
+      for(int point_i = 0; point_i < np; point_i++)
+        if(exact != NULL)
+          source_values[point_i] = exact->value(x[point_i], y[point_i]);
+        else
+        {
+          double xi, eta;
+          source_e = grid.locate(&source_refmap, x[point_i], y[point_i], xi, eta, source_e);
+          source_values[point_i] = source[space_i]->get_ref_value_transformed(source_e, xi, eta, 0, 0);
+        }
+
+      std::vector<double> values(n * np);
+      for(int shape_i = 0; shape_i < n; shape_i++)
+      {
+        pss.set_active_shape(al.get_idx()[shape_i]);
+        pss.set_quad_order(o, H2D_FN_VAL);
+        double* val = pss.get_fn_values();
+        for(int point_i = 0; point_i < np; point_i++)
+          values[shape_i * np + point_i] = al.get_coef()[shape_i] * val[point_i];
+      }
+
+      std::vector<double> mass(n * n), rhs(n, 0.0);
+      for(int i = 0; i < n; i++)
+      {
+        for(int j = 0; j <= i; j++)
+        {
+          double integral = 0.0;
+          for(int point_i = 0; point_i < np; point_i++)
+            integral += weights[point_i] * values[i * np + point_i] * values[j * np + point_i];
+          mass[i * n + j] = mass[j * n + i] = integral;
+        }
+        for(int point_i = 0; point_i < np; point_i++)
+          rhs[i] += weights[point_i] * values[i * np + point_i] * source_values[point_i];
+      }
+
+      ExplicitSSPRungeKutta::invert(&mass[0], n);
+      for(int i = 0; i < n; i++)
+      {
+        double coefficient = 0.0;
+        for(int j = 0; j < n; j++)
+          coefficient += mass[i * n + j] * rhs[j];
+        new_coefficients[al.get_dof()[i]] = coefficient;
+      }
+      projected_elements++;
+    }
+  }
+
+  Hermes::vector<Space<double>*> global_spaces;
+  Hermes::vector<Solution<double>*> global_source, global_target;
+  for(unsigned int space_i = 0; space_i < spaces.size(); space_i++)
+    if(local[space_i])
+      Solution<double>::vector_to_solution(&new_coefficients[0], spaces[space_i], target[space_i]);
+    else
+    {
+      global_spaces.push_back(spaces[space_i]);
+      global_source.push_back(source[space_i]);
+      global_target.push_back(target[space_i]);
+    }
+
+  // The other components together (their coefficients are not kept, they are never copied), then the dofs of all spaces again.
+  if(global_components > 0)
+  {
+    OGProjection<double>::project_global(global_spaces, global_source, global_target, matrix_solver, Hermes::vector<ProjNormType>());
+    Space<double>::assign_dofs(spaces);
+  }
+
+  for(unsigned int i = 0; i < old_meshes.size(); i++)
+    delete old_meshes[i];
+
+  coefficient_solutions = target;
+  coefficient_spaces = spaces;
+  coefficients.swap(new_coefficients);
+
+  cpu_time.tick();
+}
+
+int L2Transfer::get_copied_elements() const
+{
+  return copied_elements;
+}
+
+int L2Transfer::get_projected_elements() const
+{
+  return projected_elements;
+}
+
+int L2Transfer::get_global_components() const
+{
+  return global_components;
+}
+
+double L2Transfer::get_last_time() const
+{
+  return cpu_time.last();
+}
+
+double L2Transfer::get_time() const
+{
+  return cpu_time.accumulated();
+}
+
+StabilizationIndicator::StabilizationIndicator(Solution<double>* prev_density, double threshold) : prev_density(prev_density), threshold(threshold), 
+  cached_mesh(NULL), cached_mesh_seq(0), cached_space(NULL), cached_space_seq(-1), coefficients_valid(false), discontinuous_count(0), last_evaluated(0)
+{
+}
+
+StabilizationIndicator::~StabilizationIndicator()
+{
+  // The first thread uses the density itself.
+  for(unsigned int thread_i = 1; thread_i < thread_densities.size(); thread_i++)
+    delete thread_densities[thread_i];
+}
+
+void StabilizationIndicator::update_topology(Mesh* mesh, int order)
+{
+  if(mesh == cached_mesh && mesh->get_seq() == cached_mesh_seq && (int)points.size() == order + 1)
+    return;
+
+  // Gauss points exact for the squared jumps of the polynomials of the order.
+  int n = order + 1;
+  points.resize(n);
+  weights.resize(n);
+  for(int i = 0; i < n; i++)
+  {
+    double x = std::cos(M_PI * (i + 0.75) / (n + 0.5)), dp = 1.0;
+    for(int newton_i = 0; newton_i < 100; newton_i++)
+    {
+      double p0 = 1.0, p1 = x;
+      for(int k = 2; k <= n; k++)
+      {
+        double p2 = ((2 * k - 1) * x * p1 - (k - 1) * p0) / k;
+        p0 = p1;
+        p1 = p2;
+      }
+      dp = n * (x * p1 - p0) / (x * x - 1.0);
+      double dx = p1 / dp;
+      x -= dx;
+      if(std::abs(dx) < 1E-15)
+        break;
+    }
+    points[i] = 0.5 * (1.0 - x);
+    weights[i] = 1.0 / ((1.0 - x * x) * dp * dp);
+  }
+
+  cells.clear();
+  edge_lengths.clear();
+  for(int side = 0; side < 2; side++)
+  {
+    edge_cells[side].clear();
+    edge_x[side].clear();
+    edge_y[side].clear();
+  }
+
+  // Cells.
+  Element* e;
+  for_all_active_elements(e, mesh)
+    cells.push_back(e);
+  int cell_count = cells.size();
+
+  // Inner edges, split at the hanging nodes.
+  std::map<std::pair<int, int>, int> open_edges;
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+  {
+    e = cells[cell_i];
+    for(unsigned int edge_i = 0; edge_i < e->get_num_surf(); edge_i++)
+      if(!e->en[edge_i]->bnd)
+        add_inner_edges(mesh, cell_i, e->vn[edge_i]->id, e->vn[e->next_vert(edge_i)]->id, open_edges);
+  }
+  if(!open_edges.empty())
+    error("StabilizationIndicator: an inner edge with one element only.");
+
+  // Edges of the cells.
+  int edge_count = edge_lengths.size();
+  cell_edge_offsets.assign(cell_count + 1, 0);
+  for(int edge_i = 0; edge_i < edge_count; edge_i++)
+    for(int side = 0; side < 2; side++)
+      cell_edge_offsets[edge_cells[side][edge_i] + 1]++;
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    cell_edge_offsets[cell_i + 1] += cell_edge_offsets[cell_i];
+  cell_edges.resize(cell_edge_offsets[cell_count]);
+  cell_edge_sides.resize(cell_edge_offsets[cell_count]);
+  std::vector<int> positions(cell_edge_offsets.begin(), cell_edge_offsets.end() - 1);
+  for(int edge_i = 0; edge_i < edge_count; edge_i++)
+    for(int side = 0; side < 2; side++)
+    {
+      int cell_i = edge_cells[side][edge_i];
+      cell_edges[positions[cell_i]] = edge_i;
+      cell_edge_sides[positions[cell_i]++] = side;
+    }
+
+  for(int side = 0; side < 2; side++)
+    edge_values[side].assign(edge_count * n, 0.0);
+  edge_integrals.assign(edge_count, 0.0);
+  flags.assign(mesh->get_max_element_id() + 1, 0);
+  discontinuous_count = 0;
+
+  cached_mesh = mesh;
+  cached_mesh_seq = mesh->get_seq();
+  cached_space = NULL;
+}
+
+void StabilizationIndicator::add_inner_edges(Mesh* mesh, int cell, int vertex_1, int vertex_2, std::map<std::pair<int, int>, int>& open_edges)
+{
+  // The neighbor is refined along this edge.
+  Node* middle = mesh->peek_vertex_node(vertex_1, vertex_2);
+  if(middle != NULL)
+  {
+    add_inner_edges(mesh, cell, vertex_1, middle->id, open_edges);
+    add_inner_edges(mesh, cell, middle->id, vertex_2, open_edges);
+    return;
+  }
+
+  std::pair<int, int> key(std::min(vertex_1, vertex_2), std::max(vertex_1, vertex_2));
+  std::map<std::pair<int, int>, int>::iterator it = open_edges.find(key);
+  if(it == open_edges.end())
+  {
+    Node* v1 = mesh->get_node(vertex_1);
+    Node* v2 = mesh->get_node(vertex_2);
+    open_edges[key] = edge_lengths.size();
+    edge_cells[0].push_back(cell);
+    edge_cells[1].push_back(-1);
+    for(int side = 0; side < 2; side++)
+    {
+      edge_x[side].push_back(side == 0 ? v1->x : v2->x);
+      edge_y[side].push_back(side == 0 ? v1->y : v2->y);
+    }
+    edge_lengths.push_back(std::sqrt((v2->x - v1->x) * (v2->x - v1->x) + (v2->y - v1->y) * (v2->y - v1->y)));
+  }
+  else
+  {
+    edge_cells[1][it->second] = cell;
+    open_edges.erase(it);
+  }
+}
+
+void StabilizationIndicator::evaluate_side(Solution<double>* density, RefMap* refmap, int edge_i, int side)
+{
+  Element* e = cells[edge_cells[side][edge_i]];
+  ExactSolutionScalar<double>* exact = NULL;
+  if(density->get_type() == HERMES_EXACT)
+    exact = static_cast<ExactSolutionScalar<double>*>(density);
+  else
+  {
+    density->set_active_element(e);
+    refmap->set_active_element(e);
+  }
+
+  int n = points.size();
+  for(int point_i = 0; point_i < n; point_i++)
+  {
+    double x = edge_x[0][edge_i] + points[point_i] * (edge_x[1][edge_i] - edge_x[0][edge_i]);
+    double y = edge_y[0][edge_i] + points[point_i] * (edge_y[1][edge_i] - edge_y[0][edge_i]);
+    double& value = edge_values[side][edge_i * n + point_i];
+    if(exact != NULL)
+      value = exact->value(x, y);
+    else
+    {
+      double xi, eta;
+      refmap->untransform(e, x, y, xi, eta);
+      value = density->get_ref_value_transformed(e, xi, eta, 0, 0);
+    }
+  }
+}
+
+void StabilizationIndicator::update(Space<double>* space, double* coeff_vec)
+{
+  cpu_time.tick(HERMES_SKIP);
+
+  Mesh* mesh = space->get_mesh();
+  int order = 0;
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    int element_order = space->get_element_order(e->id);
+    order = std::max(order, std::max(H2D_GET_H_ORDER(element_order), H2D_GET_V_ORDER(element_order)));
+  }
+  update_topology(mesh, order);
+  int cell_count = cells.size();
+  int edge_count = edge_lengths.size();
+
+  // The cells evaluated again.
+  std::vector<char> changed_cells(cell_count, 1);
+  if(space != cached_space || space->get_seq() != cached_space_seq)
+  {
+    cell_dof_offsets.assign(1, 0);
+    cell_dofs.clear();
+    cell_scales.resize(cell_count);
+    Shapeset* shapeset = space->get_shapeset();
+    for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    {
+      AsmList<double> al;
+      space->get_element_assembly_list(cells[cell_i], &al);
+
+      // The test function of the indicator is the constant basis function.
+      double basis_value = 1.0;
+      shapeset->set_mode(cells[cell_i]->get_mode());
+      for(unsigned int shape_i = 0; shape_i < al.get_cnt(); shape_i++)
+      {
+        cell_dofs.push_back(al.get_dof()[shape_i]);
+        int shape_order = shapeset->get_order(al.get_idx()[shape_i]);
+        if(H2D_GET_H_ORDER(shape_order) == 0 && H2D_GET_V_ORDER(shape_order) == 0)
+          basis_value = al.get_coef()[shape_i] * shapeset->get_value(0, al.get_idx()[shape_i], -0.5, -0.5, 0);
+      }
+      cell_dof_offsets.push_back(cell_dofs.size());
+      cell_scales[cell_i] = basis_value / (cells[cell_i]->get_diameter() * std::pow(cells[cell_i]->get_area(), 0.75));
+    }
+    cell_coefficients.assign(cell_dofs.size(), 0.0);
+    coefficients_valid = false;
+    cached_space = space;
+    cached_space_seq = space->get_seq();
+  }
+  else if(coeff_vec != NULL && coefficients_valid)
+    for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    {
+      changed_cells[cell_i] = 0;
+      for(int k = cell_dof_offsets[cell_i]; k < cell_dof_offsets[cell_i + 1] && !changed_cells[cell_i]; k++)
+        changed_cells[cell_i] = (coeff_vec[cell_dofs[k]] != cell_coefficients[k]);
+    }
+  if(coeff_vec != NULL)
+    for(unsigned int k = 0; k < cell_dofs.size(); k++)
+      cell_coefficients[k] = coeff_vec[cell_dofs[k]];
+  coefficients_valid = (coeff_vec != NULL);
+
+  std::vector<int> evaluated_cells;
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    if(changed_cells[cell_i])
+      evaluated_cells.push_back(cell_i);
+  last_evaluated = evaluated_cells.size();
+
+  // Copies of the density for the threads (the solutions are not thread-safe).
+  if(thread_densities.empty())
+  {
+    int thread_count = 1;
+#ifdef _OPENMP
+    thread_count = omp_get_max_threads();
+#endif
+    thread_densities.push_back(prev_density);
+    for(int thread_i = 1; thread_i < thread_count; thread_i++)
+      thread_densities.push_back(new Solution<double>(prev_density->get_mesh()));
+  }
+  bool parallel = (prev_density->get_type() != HERMES_EXACT);
+  if(parallel)
+    for(unsigned int thread_i = 1; thread_i < thread_densities.size(); thread_i++)
+      thread_densities[thread_i]->copy(prev_density);
+
+  // Values on the edges of the changed cells.
+  int evaluated_count = evaluated_cells.size();
+#pragma omp parallel if(parallel)
+  {
+    int thread_num = 0;
+#ifdef _OPENMP
+    thread_num = omp_get_thread_num();
+#endif
+    Solution<double>* density = thread_densities[thread_num];
+    RefMap refmap;
+#pragma omp for schedule(dynamic, 16)
+    for(int evaluated_i = 0; evaluated_i < evaluated_count; evaluated_i++)
+    {
+      int cell_i = evaluated_cells[evaluated_i];
+      for(int k = cell_edge_offsets[cell_i]; k < cell_edge_offsets[cell_i + 1]; k++)
+        evaluate_side(density, &refmap, cell_edges[k], cell_edge_sides[k]);
+    }
+  }
+
+  // Integrals over the edges of the changed cells, the flags of the cells on these edges.
+  std::vector<char> changed_edges(edge_count, 0);
+  std::vector<char> updated_cells(cell_count, 0);
+  for(int evaluated_i = 0; evaluated_i < evaluated_count; evaluated_i++)
+  {
+    int cell_i = evaluated_cells[evaluated_i];
+    updated_cells[cell_i] = 1;
+    for(int k = cell_edge_offsets[cell_i]; k < cell_edge_offsets[cell_i + 1]; k++)
+    {
+      int edge_i = cell_edges[k];
+      changed_edges[edge_i] = updated_cells[edge_cells[0][edge_i]] = updated_cells[edge_cells[1][edge_i]] = 1;
+    }
+  }
+  int n = points.size();
+#pragma omp parallel for
+  for(int edge_i = 0; edge_i < edge_count; edge_i++)
+    if(changed_edges[edge_i])
+    {
+      double integral = 0.0;
+      for(int point_i = 0; point_i < n; point_i++)
+      {
+        double jump = edge_values[0][edge_i * n + point_i] - edge_values[1][edge_i * n + point_i];
+        integral += weights[point_i] * jump * jump;
+      }
+      edge_integrals[edge_i] = integral * edge_lengths[edge_i];
+    }
+
+#pragma omp parallel for
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    if(updated_cells[cell_i])
+    {
+      double indicator = 0.0;
+      for(int k = cell_edge_offsets[cell_i]; k < cell_edge_offsets[cell_i + 1]; k++)
+        indicator += edge_integrals[cell_edges[k]];
+      flags[cells[cell_i]->id] = (indicator * cell_scales[cell_i] >= threshold);
+    }
+
+  discontinuous_count = 0;
+  for(int cell_i = 0; cell_i < cell_count; cell_i++)
+    discontinuous_count += flags[cells[cell_i]->id];
+
+  cpu_time.tick();
+}
+
+bool StabilizationIndicator::is_discontinuous(int element_id) const
+{
+  return flags[element_id] != 0;
+}
+
+int StabilizationIndicator::get_discontinuous_count() const
+{
+  return discontinuous_count;
+}
+
+int StabilizationIndicator::get_last_evaluated() const
+{
+  return last_evaluated;
+}
+
+double StabilizationIndicator::get_last_time() const
+{
+  return cpu_time.last();
+}
+
+double StabilizationIndicator::get_time() const
+{
+  return cpu_time.accumulated();
+}
+
+MultirateCoupling::MultirateCoupling(Hermes::vector<Space<double>*> flow_spaces, Hermes::vector<Solution<double>*> interpolated_flow, int max_substeps) : 
+  flow_spaces(flow_spaces), interpolated_flow(interpolated_flow), max_substeps(max_substeps), ndof(0), flow_start(NULL), flow_end(NULL), flow_interpolated(NULL), 
+  macro_step(0.0), macro_steps(0)
+{
+  if(flow_spaces.size() != interpolated_flow.size())
+    error("MultirateCoupling: the numbers of the flow spaces and solutions differ.");
+  if(max_substeps < 1)
+    error("MultirateCoupling: at least one substep is necessary.");
+
+  for(int subsystem = 0; subsystem < 2; subsystem++)
+  {
+    subsystem_time[subsystem] = 0.0;
+    steps[subsystem] = 0;
+    min_step[subsystem] = std::numeric_limits<double>::max();
+    max_step[subsystem] = 0.0;
+    step_sum[subsystem] = 0.0;
+  }
+}
+
+MultirateCoupling::~MultirateCoupling()
+{
+  delete [] flow_start;
+  delete [] flow_end;
+  delete [] flow_interpolated;
+}
+
+double MultirateCoupling::begin_macro_step(double flow_time_step, double concentration_time_step)
+{
+  double shorter = std::min(flow_time_step, concentration_time_step);
+  double longer = std::max(flow_time_step, concentration_time_step);
+  if(shorter <= 0.0)
+    error("MultirateCoupling: the time steps have to be positive.");
+
+  macro_step = std::min(longer, max_substeps * shorter);
+  subsystem_time[FLOW] = subsystem_time[CONCENTRATION] = 0.0;
+  macro_steps++;
+  return macro_step;
+}
+
+double MultirateCoupling::next_step(Subsystem subsystem, double stable_time_step)
+{
+  double remaining = macro_step - subsystem_time[subsystem];
+  // Round-off of the sum of the substeps.
+  if(remaining <= 1e-12 * macro_step)
+    return 0.0;
+
+  // The step that would leave a remainder shorter than the round-off ends the macro step.
+  double step = stable_time_step < remaining * (1.0 - 1e-12) ? stable_time_step : remaining;
+  subsystem_time[subsystem] += step;
+
+  steps[subsystem]++;
+  min_step[subsystem] = std::min(min_step[subsystem], step);
+  max_step[subsystem] = std::max(max_step[subsystem], step);
+  step_sum[subsystem] += step;
+  return step;
+}
+
+double MultirateCoupling::get_subsystem_time(Subsystem subsystem) const
+{
+  return subsystem_time[subsystem];
+}
+
+void MultirateCoupling::set_flow_start(double* coeff_vec)
+{
+  // The flow spaces may change between the macro steps (adaptivity).
+  int new_ndof = Space<double>::get_num_dofs(flow_spaces);
+  if(new_ndof != ndof)
+  {
+    delete [] flow_start;
+    delete [] flow_end;
+    delete [] flow_interpolated;
+    ndof = new_ndof;
+    flow_start = new double[ndof];
+    flow_end = new double[ndof];
+    flow_interpolated = new double[ndof];
+  }
+  memcpy(flow_start, coeff_vec, ndof * sizeof(double));
+  // Until set_flow_end(), the flow is constant.
+  memcpy(flow_end, coeff_vec, ndof * sizeof(double));
+}
+
+void MultirateCoupling::set_flow_end(double* coeff_vec)
+{
+  if(flow_end == NULL)
+    error("MultirateCoupling: set_flow_start() has to be called first.");
+  memcpy(flow_end, coeff_vec, ndof * sizeof(double));
+}
+
+void MultirateCoupling::interpolate_flow(double theta)
+{
+  if(flow_end == NULL)
+    error("MultirateCoupling: set_flow_start() has to be called first.");
+
+  double ratio = macro_step > 0.0 ? theta / macro_step : 0.0;
+  for(int i = 0; i < ndof; i++)
+    flow_interpolated[i] = (1.0 - ratio) * flow_start[i] + ratio * flow_end[i];
+
+  Solution<double>::vector_to_solutions(flow_interpolated, flow_spaces, interpolated_flow);
+}
+
+int MultirateCoupling::get_macro_steps() const
+{
+  return macro_steps;
+}
+
+int MultirateCoupling::get_steps(Subsystem subsystem) const
+{
+  return steps[subsystem];
+}
+
+double MultirateCoupling::get_min_step(Subsystem subsystem) const
+{
+  return steps[subsystem] > 0 ? min_step[subsystem] : 0.0;
+}
+
+double MultirateCoupling::get_max_step(Subsystem subsystem) const
+{
+  return max_step[subsystem];
+}
+
+double MultirateCoupling::get_mean_step(Subsystem subsystem) const
+{
+  return steps[subsystem] > 0 ? step_sum[subsystem] / steps[subsystem] : 0.0;
+}
+
 void MachNumberFilter::filter_fn(int n, Hermes::vector<double*> values, double* result) 
 {
   for (int i = 0; i < n; i++)
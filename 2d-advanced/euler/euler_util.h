@@ -2,6 +2,7 @@
 #define EULER_UTIL_H
 
 #include "hermes2d.h"
+#include <pthread.h>
 
 using namespace Hermes;
 using namespace Hermes::Hermes2D;
@@ -20,6 +21,119 @@ public:
   static double calc_sound_speed(double rho, double rho_v_x, double rho_v_y, double energy, double kappa);
 };
 
+// Integration order of the Euler forms.
+// The fluxes are rational functions of the state, so the order of an integrand is taken as the polynomial
+// order of its factors increased by nonlinearity_increase, and capped by max_order.
+class EulerFormsOrder
+{
+public:
+  // Accounts for the rational dependence of the fluxes on the state.
+  static int nonlinearity_increase;
+
+  // Over-integration cap (the forms used to integrate everything with order 24).
+  static int max_order;
+
+  // If positive, all the Euler forms are integrated with this order instead (24 - the former behaviour, for timing comparisons).
+  static int fixed_order;
+
+  // Returns the order for an integrand whose polynomial part has the order polynomial_order.
+  static Ord limit(Ord polynomial_order);
+
+  // Returns the order for an integrand polynomial in the state (the time and the stabilization forms).
+  static Ord exact(Ord polynomial_order);
+};
+
+// Bounds of the number of quadrature points of the Euler forms (the Gauss quadratures of the order 24,
+// 13 points on an edge, 13 x 13 on a quadrilateral) for the scratch arrays below.
+const int EULER_MAX_EDGE_POINTS = 13;
+const int EULER_MAX_VOLUME_POINTS = 169;
+
+// Scratch array of the form evaluations, on the stack up to N items, on the heap above it (higher orders).
+template<typename T, int N>
+class FormScratch
+{
+public:
+  FormScratch(int size) : data(size <= N ? stack_data : new T[size]) {}
+  ~FormScratch() { if(data != stack_data) delete [] data; }
+
+  T* get() { return data; }
+
+private:
+  FormScratch(const FormScratch&);
+  FormScratch& operator=(const FormScratch&);
+
+  T stack_data[N];
+  T* data;
+};
+
+// Geometry of the elements in the quadrature points, kept by the element id, the quadrature order (and the edge)
+// until the mesh (its seq) changes. Meant for the curved (arc, NURBS) elements, whose reference map is expensive
+// to evaluate, one instance can be shared by CFLCalculation and the discontinuity detectors (FluxLimiter).
+// Concurrent calls are safe for different elements.
+class CurvedGeometryCache
+{
+public:
+  // Geometry in the points of a quadrature: the physical points, the weights multiplied by the jacobian
+  // (on an edge by the length of the tangent), the outer normals (edges only) and the inverse reference map
+  // (volume only, the four entries m[0][0], m[0][1], m[1][0], m[1][1] of RefMap::get_inv_ref_map() in every point).
+  struct Geometry
+  {
+    int np;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> jwt;
+    std::vector<double> nx;
+    std::vector<double> ny;
+    std::vector<double> inv_ref_map;
+  };
+
+  CurvedGeometryCache();
+  ~CurvedGeometryCache();
+
+  // Drops the geometry if the mesh changed, to be called before every pass over the elements of the mesh.
+  void update(Mesh* mesh);
+
+  // In the volume quadrature points of the order.
+  const Geometry& get_volume(Element* e, int order);
+  // In the points of the edge quadrature of the order (see Quad2D::get_edge_points()).
+  const Geometry& get_edge(Element* e, int edge_i, int order);
+
+  // Reference coordinates of the vertices (in the order of Element::vn) and of the centroid (the last one),
+  // the pairs xi, eta.
+  const double* get_reference_points(Element* e);
+
+  int get_hits() const;
+  int get_misses() const;
+
+protected:
+  void clear();
+
+  // Edge -1 is the volume.
+  struct Entry
+  {
+    int edge;
+    int order;
+    Geometry* geometry;
+  };
+
+  // Finds the entry of the element, calculates it if there is none.
+  const Geometry& get_geometry(Element* e, int edge, int order);
+  void check_element(Element* e) const;
+
+  void calculate_volume(Element* e, int order, Geometry* geometry);
+  void calculate_edge(Element* e, int edge_i, int order, Geometry* geometry);
+
+  Mesh* cached_mesh;
+  unsigned int cached_mesh_seq;
+
+  // By the element id.
+  std::vector<std::vector<Entry> > entries;
+  std::vector<std::vector<double> > reference_points;
+
+  int hits;
+  int misses;
+};
+
 class CFLCalculation
 {
 public:
@@ -29,11 +143,53 @@ public:
   void calculate(Hermes::vector<Solution<double>*> solutions, Mesh* mesh, double & time_step) const;
   void calculate_semi_implicit(Hermes::vector<Solution<double>*> solutions, Mesh* mesh, double & time_step) const;
 
+  // Versions without the projection to constants.
+  // The element averages are read directly from the coefficient vector sln_vector of the (L2) spaces,
+  // the element geometry is cached and recalculated only when the mesh or the spaces change.
+  void calculate(double* sln_vector, Hermes::vector<Space<double>*> spaces, double & time_step);
+  void calculate_semi_implicit(double* sln_vector, Hermes::vector<Space<double>*> spaces, double & time_step);
+
   void set_number(double new_CFL_number);
+
+  // The geometry of the elements is then taken from (and stored to) the cache.
+  void set_geometry_cache(CurvedGeometryCache* geometry_cache);
   
 protected:
   double CFL_number;
   double kappa;
+  CurvedGeometryCache* geometry_cache;
+
+  // Recalculates the cached geometry and averaging weights if the mesh or the spaces changed.
+  void update_cache(Hermes::vector<Space<double>*> spaces);
+
+  // Element averages of the four conserved quantities on the element elements[element_i].
+  void get_averages(double* sln_vector, int element_i, double w[4]) const;
+
+  // Mesh and spaces the cache was built for.
+  Mesh* cached_mesh;
+  int cached_mesh_seq;
+  Space<double>* cached_spaces[4];
+  int cached_space_seqs[4];
+
+  // Active elements and their areas.
+  std::vector<Element*> elements;
+  std::vector<double> areas;
+
+  // Edges of elements[i] are edge_offsets[i], ..., edge_offsets[i + 1] - 1.
+  std::vector<int> edge_offsets;
+  std::vector<double> edge_lengths;
+
+  // Normals of the edge edge_i are normal_offsets[edge_i], ..., normal_offsets[edge_i + 1] - 1.
+  // A straight edge has one normal, a curved one the normals in its quadrature points.
+  std::vector<int> normal_offsets;
+  std::vector<double> normals_x;
+  std::vector<double> normals_y;
+
+  // The average of the quantity i on elements[j] is the sum of sln_vector[average_dofs[i][k]] * average_weights[i][k]
+  // for k = average_offsets[i][j], ..., average_offsets[i][j + 1] - 1.
+  std::vector<int> average_offsets[4];
+  std::vector<int> average_dofs[4];
+  std::vector<double> average_weights[4];
 };
 
 class ADEStabilityCalculation
@@ -53,6 +209,65 @@ protected:
   double epsilon;
 };
 
+/// Vertex patches - for every vertex, the active elements that contain it.
+/// Built once per mesh, rebuilt only when the mesh (its sequence number) changes.
+/// Works for triangles, quads and hanging nodes (a hanging vertex belongs also to the patch
+/// of the element on whose edge it lies).
+class VertexPatches
+{
+public:
+  /// Constructor.
+  VertexPatches();
+
+  /// Rebuilds the patches if the mesh changed.
+  void update(Mesh* mesh);
+
+  /// Returns the ids of the elements in the patch of the vertex node vertex_id, count is their number.
+  const int* get_patch(int vertex_id, int& count) const;
+
+protected:
+  /// Adds the element e to the patches of the hanging vertices on its edge (id1, id2), recursively.
+  void add_to_hanging_vertex_patches(Mesh* mesh, Element* e, int id1, int id2, std::vector<std::vector<int> >& patches);
+
+  /// Members.
+  Mesh* mesh;
+  int mesh_seq;
+  /// The patch of the vertex node vertex_id is element_ids[offsets[vertex_id]], ..., element_ids[offsets[vertex_id + 1] - 1].
+  std::vector<int> offsets;
+  std::vector<int> element_ids;
+};
+
+/// Values and derivatives of the shape functions of a shapeset at the reference vertices and the reference centroid,
+/// tabulated per element mode and shape function index.
+class ReferenceBasisTable
+{
+public:
+  /// Constructor.
+  ReferenceBasisTable(Shapeset* shapeset);
+
+  /// Points - the reference vertices (3 for triangles, 4 for quads) and the reference centroid.
+  static const int CENTROID = 4;
+  static const int POINT_COUNT = 5;
+
+  /// Value, dx, dy, dxx, dyy, dxy (the numbering of Solution::get_ref_value_transformed()).
+  static const int VALUE_COUNT = 6;
+
+  /// Tabulates the shape function index in the mode, if not yet done.
+  /// Not thread-safe, to be called before the parallel loops.
+  void prepare(int mode, int index);
+
+  /// The table of the shape function index in the mode, [point * VALUE_COUNT + value].
+  const double* get(int mode, int index) const;
+
+  /// Reference coordinates of the point point_i in the mode.
+  static void get_point(int mode, int point_i, double& x, double& y);
+
+protected:
+  /// Members.
+  Shapeset* shapeset;
+  std::vector<std::vector<double> > tables[2];
+};
+
 class DiscontinuityDetector
 {
 public:
@@ -61,17 +276,41 @@ public:
                         Hermes::vector<Solution<double> *> solutions);
 
   /// Destructor.
-   ~DiscontinuityDetector();
+  virtual ~DiscontinuityDetector();
 
   /// Return a reference to the inner structures.
-  virtual std::set<int>& get_discontinuous_element_ids() = 0;
+  /// The ids are sorted, the same for any number of threads.
+  virtual std::vector<int>& get_discontinuous_element_ids() = 0;
+
+  /// Whether the element with the id element_id was found discontinuous by the last get_discontinuous_element_ids().
+  bool is_discontinuous(int element_id) const;
+
+  /// The geometry of the (central) elements is then taken from (and stored to) the cache.
+  void set_geometry_cache(CurvedGeometryCache* geometry_cache);
 
 protected:
+  /// Collects the active elements of the mesh (the parallel loops go over them),
+  /// and copies the current solutions for the threads (the copies are created at the first call).
+  void init_parallel_pass();
+
+  /// Solutions to be used by the calling thread.
+  /// The solutions keep the active element and the transformations, so each thread (but the first one,
+  /// which uses the original solutions) works with its own copies.
+  Hermes::vector<Solution<double> *>& get_thread_solutions();
+
+  /// Fills the sorted element_ids from the flags (indexed by element id).
+  static void flags_to_ids(const std::vector<char>& flags, std::vector<int>& element_ids);
+
   /// Members.
   Hermes::vector<Space<double> *> spaces;
   Hermes::vector<Solution<double> *> solutions;
-  std::set<int> discontinuous_element_ids;
+  std::vector<int> discontinuous_element_ids;
+  /// Dense flags indexed by element id, written by the threads, element_ids are made out of them.
+  std::vector<char> discontinuous_element_flags;
+  std::vector<Element*> active_elements;
+  std::vector<Hermes::vector<Solution<double> *> > thread_solutions;
   Mesh* mesh;
+  CurvedGeometryCache* geometry_cache;
 };
 
 class KrivodonovaDiscontinuityDetector : public DiscontinuityDetector
@@ -85,8 +324,8 @@ public:
    ~KrivodonovaDiscontinuityDetector();
 
   /// Return a reference to the inner structures.
-  std::set<int>& get_discontinuous_element_ids();
-  std::set<int>& get_discontinuous_element_ids(double threshold);
+  std::vector<int>& get_discontinuous_element_ids();
+  std::vector<int>& get_discontinuous_element_ids(double threshold);
 
 protected:
   /// Calculates relative (w.r.t. the boundary edge_i of the Element e).
@@ -106,41 +345,85 @@ class KuzminDiscontinuityDetector : public DiscontinuityDetector
 {
 public:
   /// Constructor.
+  /// If the coefficient vector of the solutions is given, the values and derivatives on affine elements are
+  /// evaluated from the tabulated reference basis instead of the (inverse) reference mapping.
   KuzminDiscontinuityDetector(Hermes::vector<Space<double> *> spaces, 
-                        Hermes::vector<Solution<double> *> solutions, bool limit_all_orders_independently = false);
+                        Hermes::vector<Solution<double> *> solutions, bool limit_all_orders_independently = false,
+                        double* solution_vector = NULL);
 
   /// Destructor.
    ~KuzminDiscontinuityDetector();
 
   /// Return a reference to the inner structures.
-  std::set<int>& get_discontinuous_element_ids();
+  std::vector<int>& get_discontinuous_element_ids();
 
   /// Return a reference to the inner structures.
-  std::set<int>& get_second_order_discontinuous_element_ids();
+  std::vector<int>& get_second_order_discontinuous_element_ids();
 
   /// Returns info about the method.
   bool get_limit_all_orders_independently();
-  std::set<int> second_order_discontinuous_element_ids;
+  std::vector<int> second_order_discontinuous_element_ids;
 protected:
+  /// Dense flags indexed by element id.
+  std::vector<char> second_order_discontinuous_element_flags;
+
   /// Center.
   void find_centroid_values(Hermes::Hermes2D::Element* e, double u_c[4]);
   void find_centroid_derivatives(Hermes::Hermes2D::Element* e, double u_dx_c[4], double u_dy_c[4]);
   void find_second_centroid_derivatives(Hermes::Hermes2D::Element* e, double u_dxx_c[4], double u_dxy_c[4], double u_dyy_c[4]);
 
+  /// Reference coordinates of the vertex point_i, or of the centroid (point_i = the number of the vertices).
+  /// From the geometry cache if there is one, by the inverse reference mapping otherwise.
+  void find_reference_point(Hermes::Hermes2D::Element* e, RefMap* refmap, int point_i, double& xi, double& eta);
+
   /// Vertices.
   void find_vertex_values(Hermes::Hermes2D::Element* e, double vertex_values[4][4]);
   void find_vertex_derivatives(Hermes::Hermes2D::Element* e, double vertex_derivatives[4][4][2]);
 
+  /// Centroid values / derivatives of all active elements, indexed by element id.
+  void find_all_centroid_values();
+  void find_all_centroid_derivatives();
+
   /// Logic - 1st order.
   void find_u_i_min_max_first_order(Hermes::Hermes2D::Element* e, double u_i_min[4][4], double u_i_max[4][4]);
-  void find_alpha_i_first_order(double u_i_min[4][4], double u_i_max[4][4], double u_c[4], double u_i[4][4], double alpha_i[4]);
+  void find_alpha_i_first_order(Hermes::Hermes2D::Element* e, double u_i_min[4][4], double u_i_max[4][4], double u_c[4], double u_i[4][4], double alpha_i[4]);
   void find_alpha_i_first_order_real(Hermes::Hermes2D::Element* e, double u_i[4][4], double u_c[4], double u_dx_c[4], double u_dy_c[4], double alpha_i_real[4]);
 
   /// Logic - 2nd order.
   void find_u_i_min_max_second_order(Hermes::Hermes2D::Element* e, double u_d_i_min[4][4][2], double u_d_i_max[4][4][2]);
-  void find_alpha_i_second_order(double u_d_i_min[4][4][2], double u_d_i_max[4][4][2], double u_dx_c[4], double u_dy_c[4], double u_d_i[4][4][2], double alpha_i[4]);
+  void find_alpha_i_second_order(Hermes::Hermes2D::Element* e, double u_d_i_min[4][4][2], double u_d_i_max[4][4][2], double u_dx_c[4], double u_dy_c[4], double u_d_i[4][4][2], double alpha_i[4]);
   void find_alpha_i_second_order_real(Hermes::Hermes2D::Element* e, double u_i[4][4][2], double u_dx_c[4], double u_dy_c[4], double u_dxx_c[4], double u_dxy_c[4], double u_dyy_c[4], double alpha_i_real[4]);
 
+  /// Centroid values (4 per element) and derivatives (dx, dy for each of the 4 solutions, 8 per element).
+  std::vector<double> centroid_values;
+  std::vector<double> centroid_derivatives;
+
+  /// Shared by all instances, the detector is typically recreated in every time step on the same mesh.
+  static VertexPatches vertex_patches;
+
+  /// Tabulated evaluation.
+  /// Collects the basis of the affine elements and tabulates it, once per detector.
+  void prepare_tabulation();
+
+  /// Whether the element is evaluated through the tables.
+  bool is_tabulated(Hermes::Hermes2D::Element* e) const;
+
+  /// Value and physical derivatives (see ReferenceBasisTable::VALUE_COUNT) of the solution sol_i in the point point_i of the element e.
+  void evaluate_tabulated(Hermes::Hermes2D::Element* e, int sol_i, int point_i, double result[6]) const;
+
+  double* solution_vector;
+  std::vector<ReferenceBasisTable> basis_tables;
+  /// Indexed by element id.
+  std::vector<char> tabulated_elements;
+  /// Inverse of the (constant) jacobian of the reference map - dxi/dx, dxi/dy, deta/dx, deta/dy.
+  std::vector<double> inverse_jacobians;
+  /// Basis of the element e in the space i - basis_dofs[i][k], basis_indices[i][k]
+  /// for k = basis_starts[i][e->id], ..., basis_starts[i][e->id] + basis_counts[i][e->id] - 1.
+  std::vector<std::vector<int> > basis_starts;
+  std::vector<std::vector<int> > basis_counts;
+  std::vector<std::vector<int> > basis_dofs;
+  std::vector<std::vector<int> > basis_indices;
+
 private:
   /// For limiting of second order terms.
   bool limit_all_orders_independently;
@@ -170,6 +453,10 @@ public:
   virtual void limit_second_orders_according_to_detector(Hermes::vector<Space<double> *> coarse_spaces_to_limit = Hermes::vector<Space<double> *>());
   
   void get_limited_solutions(Hermes::vector<Solution<double>*> solutions_to_limit);
+
+  /// For the detector.
+  void set_geometry_cache(CurvedGeometryCache* geometry_cache);
+
   DiscontinuityDetector* detector;
 protected:
   /// Members.
@@ -178,6 +465,798 @@ protected:
   Hermes::vector<Solution<double>*> limited_solutions;
 };
 
+// Matrix-free explicit time integration of the DG discretization by the strong stability preserving
+// Runge-Kutta methods (SSP-RK1 = forward Euler, SSP-RK2, SSP-RK3, in the Shu-Osher form), to be used with
+// the explicit weak forms, which assemble the vector (w, v) + tau * R(w, v) from their external solutions w.
+// Only this vector is assembled in each stage, the global matrix is never formed: the element blocks of the
+// (block-diagonal) DG mass matrix are inverted once per mesh and spaces and applied element by element.
+// Each stage can be limited by the Kuzmin's or the Krivodonova's detector.
+class ExplicitSSPRungeKutta
+{
+public:
+  // The discrete problem dp has to be set up with an explicit weak form, with the solutions as its external functions.
+  ExplicitSSPRungeKutta(int stages, DiscreteProblem<double>* dp, Hermes::vector<Space<double>*> spaces, 
+    Hermes::vector<Solution<double>*> solutions, MatrixSolverType matrix_solver = SOLVER_UMFPACK);
+
+  ~ExplicitSSPRungeKutta();
+
+  // Limit each stage (the default is no limiting).
+  void set_limiting(FluxLimiter::LimitingType type, bool Kuzmin_limit_all_orders_independently = true);
+  void unset_limiting();
+
+  // One time step, the time step length has to be set in the weak form.
+  // sln_vector holds the coefficients of the current time level on input, and of the new one on output.
+  // The solutions are set to the new time level.
+  void step(double* sln_vector);
+
+  // Number of element updates (active elements times stages) done in all steps so far.
+  double get_element_updates() const;
+
+  // Time spent in all steps so far.
+  double get_time() const;
+
+  // Inverts the dense n x n matrix (row-wise) in place.
+  static void invert(double* matrix, int n);
+
+protected:
+  // Recalculates the inverse mass blocks if the mesh or the spaces changed.
+  void update_mass_blocks();
+
+  // Forward Euler step from the state in the solutions: result = M^{-1} ((w, v) + tau * R(w, v)).
+  void euler_step(double* result);
+
+  // Limits sln_vector (if limiting is set), and sets the solutions from it.
+  void limit(double* sln_vector);
+
+  int stages;
+  DiscreteProblem<double>* dp;
+  Hermes::vector<Space<double>*> spaces;
+  Hermes::vector<Solution<double>*> solutions;
+  Vector<double>* rhs;
+
+  bool limiting;
+  FluxLimiter::LimitingType limiting_type;
+  bool Kuzmin_limit_all_orders_independently;
+
+  // Mesh and spaces the mass blocks were calculated for.
+  Mesh* cached_mesh;
+  int cached_mesh_seq;
+  std::vector<Space<double>*> cached_spaces;
+  std::vector<int> cached_space_seqs;
+
+  // The block block_i acts on the dofs block_dofs[dof_offsets[block_i]], ..., block_dofs[dof_offsets[block_i + 1] - 1],
+  // its inverse mass matrix (row-wise, basis functions including the assembly list coefficients) starts at inverse_masses[mass_offsets[block_i]].
+  std::vector<int> dof_offsets;
+  std::vector<int> block_dofs;
+  std::vector<int> mass_offsets;
+  std::vector<double> inverse_masses;
+  int ndof;
+  int element_count;
+
+  // Work vectors: the initial state of the step and the forward Euler update.
+  std::vector<double> initial_state;
+  std::vector<double> update;
+
+  double element_updates;
+  Hermes::TimePeriod cpu_time;
+};
+
+class NumericalFlux;
+
+// Cell-centered finite volume method (piecewise constant approximation, forward Euler time stepping)
+// working directly on the mesh topology, replacing the DiscreteProblem assembly (dp.set_fvm()) and the linear solver for P0.
+// The conservative variables are stored component-wise over the cells (the active elements),
+// the edges are precomputed with their normals and lengths, and the fluxes are evaluated by the NumericalFlux
+// (on the inner edges in batches). Hanging nodes are supported, curved edges are treated as straight.
+class FiniteVolumeEuler
+{
+public:
+  FiniteVolumeEuler(NumericalFlux* num_flux, double kappa);
+
+  // Boundary conditions, the markers are those of the mesh file.
+  void add_solid_wall(std::string marker);
+  void add_inlet(std::string marker, double rho, double v1, double v2, double pressure);
+  void add_outlet(std::string marker, double pressure);
+
+  // Sets the state from the coefficient vector of the P0 spaces of the four conserved quantities.
+  // The cells and edges are rebuilt if the mesh changed.
+  void set_state(double* sln_vector, Hermes::vector<Space<double>*> spaces);
+
+  // Writes the state into the coefficient vector of the spaces passed to set_state().
+  void get_state(double* sln_vector) const;
+
+  // One time step.
+  void step(double time_step);
+
+  // Time step according to the CFL condition (|K| * CFL_number / max over the edges of |e| * (|v . n| + a)).
+  double calculate_time_step(double CFL_number) const;
+
+  // Local time stepping. The cells are grouped into the levels 0, ..., max_levels - 1 with the time steps 2^level * time_step_min
+  // according to their own CFL condition (time_step_min being the smallest one over the cells), the levels of neighboring cells
+  // differ by at most one. The flux through an edge is calculated with the time step of the finer of its cells, and accumulated
+  // in both cells until they are updated at the end of their own time steps, so that the scheme stays conservative across
+  // the level interfaces. All cells are advanced by 2^(the highest level) * time_step_min, which is returned.
+  double step_local(double CFL_number, int max_levels);
+
+  int get_cell_count() const;
+
+  // Number of cell updates done by step() and step_local() so far.
+  double get_cell_updates() const;
+
+  // Number of cells in the levels of the last step_local().
+  const std::vector<int>& get_level_cell_counts() const;
+
+protected:
+  // Rebuilds the cells and edges if the mesh changed.
+  void update_topology(Mesh* mesh);
+
+  // Adds the inner edge (vertex_1, vertex_2) of the cell, split at the hanging nodes, so that each edge has exactly two cells.
+  void add_inner_edges(Mesh* mesh, int cell, int vertex_1, int vertex_2, double nx, double ny, std::map<std::pair<int, int>, int>& open_edges);
+
+  // Dofs and the values of the constant basis functions of the cells.
+  void update_dofs(Hermes::vector<Space<double>*> spaces);
+
+  // Time step of the cell according to its CFL condition.
+  double calculate_cell_time_step(int cell_i, double CFL_number) const;
+
+  // Fluxes times the lengths and time_step of the inner (boundary) edges edge_ids[0], ..., edge_ids[count - 1],
+  // or of the edges 0, ..., count - 1 if edge_ids is NULL.
+  void calculate_inner_fluxes(const int* edge_ids, int count, double time_step);
+  void calculate_boundary_fluxes(const int* edge_ids, int count, double time_step);
+
+  NumericalFlux* num_flux;
+  double kappa;
+
+  // Boundary conditions.
+  enum BoundaryType
+  {
+    SolidWall,
+    Inlet,
+    Outlet
+  };
+  std::vector<std::string> bc_markers;
+  std::vector<BoundaryType> bc_types;
+  std::vector<double> bc_states[4];
+  std::vector<double> bc_pressures;
+
+  // Mesh and spaces the topology and dofs were calculated for.
+  Mesh* cached_mesh;
+  int cached_mesh_seq;
+  Space<double>* cached_spaces[4];
+  int cached_space_seqs[4];
+
+  // Cells.
+  int cell_count;
+  std::vector<Element*> cells;
+  std::vector<double> areas;
+  std::vector<double> w[4];
+
+  // Inner edges (normals pointing from the left cell to the right one).
+  std::vector<int> inner_left;
+  std::vector<int> inner_right;
+  std::vector<double> inner_nx;
+  std::vector<double> inner_ny;
+  std::vector<double> inner_lengths;
+
+  // Boundary edges (outer normals) and their boundary conditions.
+  std::vector<int> boundary_cells;
+  std::vector<int> boundary_conditions;
+  std::vector<double> boundary_nx;
+  std::vector<double> boundary_ny;
+  std::vector<double> boundary_lengths;
+
+  // Fluxes times the lengths and the time steps of all edges, the inner ones first.
+  std::vector<double> edge_fluxes[4];
+
+  // The edges of the cell i are cell_edges[cell_edge_offsets[i]], ..., cell_edges[cell_edge_offsets[i + 1] - 1],
+  // with the sign +1 if the cell is on the left (or the edge is on the boundary), -1 otherwise.
+  std::vector<int> cell_edge_offsets;
+  std::vector<int> cell_edges;
+  std::vector<double> cell_edge_signs;
+
+  // The coefficient of the quantity k on the cell i is w[k][i] / dof_scales[k][i], at the position dofs[k][i].
+  std::vector<int> dofs[4];
+  std::vector<double> dof_scales[4];
+
+  // Local time stepping: levels of the cells and of the edges (the inner ones first), the cells and edges
+  // in each level, and the fluxes accumulated in the cells since their last update.
+  std::vector<int> cell_levels;
+  std::vector<int> edge_levels;
+  std::vector<std::vector<int> > level_cells;
+  std::vector<std::vector<int> > level_inner_edges;
+  std::vector<std::vector<int> > level_boundary_edges;
+  std::vector<int> level_cell_counts;
+  std::vector<double> accumulated_fluxes[4];
+
+  double cell_updates;
+};
+
+// Solution of the linear systems of the semi-implicit scheme over the time steps on fixed spaces.
+// The DiscreteProblem keeps the sparsity pattern as long as the spaces do not change; here the symbolic analysis
+// of the matrix is done only in the first step (and when the size changes), afterwards only the numerical factorization is redone.
+// Optionally, a factorization is reused in up to max_stale_steps following steps in which the time step length differs
+// (relatively) by less than time_step_threshold from the factorized one, as a preconditioner of an iterative refinement
+// with the current matrix. If the refinement does not converge, the matrix is factorized.
+// The stale reuse needs a CSC matrix (UMFPACK), with other matrices the matrix is always factorized.
+class FactorizationReuse
+{
+public:
+  FactorizationReuse(LinearSolver<double>* solver, SparseMatrix<double>* matrix, Vector<double>* rhs, bool reuse_symbolic_factorization = true);
+  ~FactorizationReuse();
+
+  void set_stale_factorization_reuse(int max_stale_steps, double time_step_threshold, double tolerance = 1E-10, int max_refinement_iterations = 10);
+
+  // Solves the system assembled for the time step length time_step.
+  bool solve(double time_step);
+
+  // Solution of the last solve().
+  double* get_sln_vector();
+
+  // Time of the last solve(), and of all of them.
+  double get_last_time() const;
+  double get_time() const;
+
+  // Number of solves done with a stale factorization.
+  int get_stale_solves() const;
+
+protected:
+  // Tries the iterative refinement preconditioned by the current factorization, the rhs is left intact.
+  bool solve_with_stale_factorization();
+
+  LinearSolver<double>* solver;
+  SparseMatrix<double>* matrix;
+  Vector<double>* rhs;
+  bool reuse_symbolic_factorization;
+
+  int max_stale_steps;
+  double time_step_threshold;
+  double tolerance;
+  int max_refinement_iterations;
+
+  // Size and time step of the last factorization, and the number of steps it has been reused in.
+  int factorized_size;
+  double factorized_time_step;
+  int stale_steps;
+  int stale_solves;
+
+  double* sln_vector;
+  Hermes::TimePeriod cpu_time;
+};
+
+// Jacobian-free Newton-Krylov solution of the nonlinear systems of the implicit scheme, to be used with the implicit
+// weak forms, which assemble the residual F(w) = (w_prev - w, v) + tau * R(w, v) from the coefficient vector w.
+// The products of the Jacobian with vectors are approximated by finite differences of the residual, so the Jacobian
+// is never assembled; the linear systems of the Newton's method are solved by the restarted GMRES method,
+// right-preconditioned by the matrix of the preconditioning forms of the weak form (an approximation of -dF/dw),
+// either by its inverted element blocks (block Jacobi), or by its factorization.
+class JacobianFreeNewtonKrylov
+{
+public:
+  enum PreconditionerType
+  {
+    NoPreconditioner,
+    BlockJacobi,
+    Factorization
+  };
+
+  // With a preconditioner, the weak form of dp has to contain the preconditioning forms.
+  JacobianFreeNewtonKrylov(DiscreteProblem<double>* dp, Hermes::vector<Space<double>*> spaces, 
+    PreconditionerType preconditioner_type = BlockJacobi, MatrixSolverType matrix_solver = SOLVER_UMFPACK);
+  ~JacobianFreeNewtonKrylov();
+
+  // The Newton's method stops when the residual norm decreased relatively by newton_tolerance,
+  // each linear system is solved by GMRES up to the relative residual gmres_tolerance.
+  void set_newton_parameters(double newton_tolerance, int max_newton_iterations);
+  void set_gmres_parameters(double gmres_tolerance, int krylov_dimension, int max_restarts);
+
+  // Solves F(w) = 0, sln_vector holds the initial guess on input, and the solution on output.
+  bool solve(double* sln_vector);
+
+  // Statistics of the last solve(): Newton iterations, GMRES iterations (in all Newton iterations), residual assemblies.
+  int get_newton_iterations() const;
+  int get_gmres_iterations() const;
+  int get_residual_evaluations() const;
+
+  // Time of the last solve(), and of all of them.
+  double get_last_time() const;
+  double get_time() const;
+
+protected:
+  // Residual F(coeff_vec).
+  void residual(double* coeff_vec, double* result);
+
+  // result = -dF/dw (sln_vector) * direction, by the finite difference of the residual (residual_at_sln = F(sln_vector)).
+  void jacobian_product(double* sln_vector, double* residual_at_sln, double* direction, double* result);
+
+  // Assembles the preconditioning matrix in sln_vector (together with the residual F(sln_vector) into result), and prepares the preconditioner.
+  void update_preconditioner(double* sln_vector, double* result);
+
+  // result = P^{-1} vector.
+  void apply_preconditioner(double* vector, double* result);
+
+  // Solves -dF/dw (sln_vector) * update = residual_at_sln, returns false if GMRES did not converge (update is then its last iterate).
+  bool gmres(double* sln_vector, double* residual_at_sln, double* update, int& iterations);
+
+  static double norm(const std::vector<double>& vector);
+
+  DiscreteProblem<double>* dp;
+  Hermes::vector<Space<double>*> spaces;
+  PreconditionerType preconditioner_type;
+  int ndof;
+
+  double newton_tolerance;
+  int max_newton_iterations;
+  double gmres_tolerance;
+  int krylov_dimension;
+  int max_restarts;
+
+  SparseMatrix<double>* matrix;
+  Vector<double>* rhs;
+  LinearSolver<double>* solver;
+  // The preconditioning matrix was factorized (and the size of the last factorization).
+  bool factorized;
+  int factorized_size;
+
+  // The block block_i of the block Jacobi preconditioner acts on the dofs block_dofs[dof_offsets[block_i]], ..., 
+  // block_dofs[dof_offsets[block_i + 1] - 1] (the dofs of all spaces on one element), its inverse (row-wise) 
+  // starts at inverse_blocks[block_offsets[block_i]].
+  std::vector<int> dof_offsets;
+  std::vector<int> block_dofs;
+  std::vector<int> block_offsets;
+  std::vector<double> inverse_blocks;
+
+  int newton_iterations;
+  int gmres_iterations;
+  int residual_evaluations;
+  Hermes::TimePeriod cpu_time;
+};
+
+// Output of the flow into one VTU file per call: pressure, Mach number, entropy estimate and velocity as point data,
+// instead of the separate linearizations (and files) of the filters. The mesh is linearized only when it changes:
+// every element is split uniformly into subdivisions^2 linear cells (curved edges are taken as straight), which
+// keep their own vertices, so that the discontinuities of the DG solutions are preserved. In save() the solutions
+// are evaluated once in the vertices, the derived fields are calculated, and the file (binary, raw appended data)
+// is written by a background thread, which is joined in the next save(), in wait(), or in the destructor.
+class EulerVTUExport
+{
+public:
+  EulerVTUExport(Hermes::vector<Solution<double>*> solutions, double kappa, double rho_ext, double p_ext, int subdivisions = 2);
+  ~EulerVTUExport();
+
+  // Evaluates the solutions and starts writing the file.
+  void save(const char* filename);
+
+  // Waits until the last file is written.
+  void wait();
+
+  // Time spent in save() (without the writing), last and all.
+  double get_last_time() const;
+  double get_time() const;
+
+protected:
+  void linearize(Mesh* mesh);
+
+  // Writes the file, run by the background thread.
+  static void* write(void* exporter);
+
+  Hermes::vector<Solution<double>*> solutions;
+  double kappa;
+  double rho_ext;
+  double p_ext;
+  int subdivisions;
+
+  // Linearized mesh.
+  Mesh* linearized_mesh;
+  int linearized_mesh_seq;
+  std::vector<Element*> elements;
+  // Points of the element i are element_points[i], ..., element_points[i + 1] - 1.
+  std::vector<int> element_points;
+  std::vector<double> ref_points;
+  std::vector<double> points;
+  std::vector<int> connectivity;
+  std::vector<int> offsets;
+  std::vector<unsigned char> types;
+
+  // Point data.
+  std::vector<double> pressure;
+  std::vector<double> Mach_number;
+  std::vector<double> entropy;
+  std::vector<double> velocity;
+
+  std::string filename;
+  pthread_t writer;
+  bool writing;
+  Hermes::TimePeriod cpu_time;
+};
+
+// Binary checkpoint of a coefficient vector and the description of its spaces, for restarts of long runs
+// (next to the Continuity records of the coarse mesh and spaces, which are small). The record is versioned,
+// the coefficients are optionally compressed (by zlib, if built WITH_ZLIB), and the file is written by a background
+// thread from the copy taken in save(). A record is read through a memory mapping; if the spaces it is loaded on
+// are the saved ones (the same elements, orders and numbers of DOFs), the solutions are set directly from the record,
+// otherwise the coefficients are set on the saved orders on the elements of the given meshes and projected.
+class BinaryCheckpoint
+{
+public:
+  BinaryCheckpoint(bool compress = false);
+  ~BinaryCheckpoint();
+
+  // Copies the coefficients and the description of the spaces, and starts writing the record.
+  void save(const char* filename, double time, double time_step, Hermes::vector<Space<double>*> spaces, double* coeff_vec);
+
+  // Waits until the last record is written.
+  void wait();
+
+  // Maps the record into memory.
+  void open(const char* filename);
+
+  // Time and time step length of the opened record.
+  double get_record_time() const;
+  double get_record_time_step() const;
+
+  // Sets the solutions from the opened record, returns true if the spaces were the saved ones (no projection was needed).
+  bool load(Hermes::vector<Space<double>*> spaces, Hermes::vector<Solution<double>*> solutions, MatrixSolverType matrix_solver = SOLVER_UMFPACK);
+
+  void close();
+
+  // Version of the format, records of other versions are refused.
+  static const unsigned int format_version = 1;
+
+protected:
+  // For every space the number of DOFs, the number of active elements, and the ids and orders of the elements.
+  static void describe_spaces(Hermes::vector<Space<double>*> spaces, std::vector<int>& description);
+
+  // Writes the file, run by the background thread.
+  static void* write(void* checkpoint);
+
+  bool compress;
+
+  // The record being written.
+  std::string filename;
+  double time;
+  double time_step;
+  int space_count;
+  std::vector<int> description;
+  std::vector<double> coefficients;
+  pthread_t writer;
+  bool writing;
+
+  // The opened record.
+  char* mapped;
+  size_t mapped_size;
+#ifdef _WIN32
+  void* mapping;
+#endif
+};
+
+// Log of the elements flagged by the shock indicators (discontinuity detectors) over the time steps.
+// The sorted element ids of every entry are kept in memory either as runs of consecutive ids or as a bitmap
+// (whichever is smaller), and every flush_every entries they are appended to one binary file as a block,
+// which starts with the index of its entries (time step, indicator, offset). Read by ShockIndicatorLogReader.
+class ShockIndicatorLog
+{
+public:
+  // The file is created anew, or appended to (e.g. when a run is restarted).
+  ShockIndicatorLog(const char* filename, bool append = false, int flush_every = 100);
+  ~ShockIndicatorLog();
+
+  // Records the elements flagged by the indicator (e.g. 0 for the limiting to the constants, 1 to the linear functions)
+  // in the time step iteration. A later entry of the same time step and indicator replaces the earlier one.
+  void add(int iteration, int indicator, const std::vector<int>& element_ids);
+
+  // Appends the entries kept in memory to the file.
+  void flush();
+
+  // Encodings of the element ids.
+  enum Encoding
+  {
+    Runs,
+    Bitmap
+  };
+
+  // Entry of the index of a block.
+  struct IndexEntry
+  {
+    int iteration;
+    int indicator;
+    int encoding;
+    int count;
+    // Position of the data within the data of the block, and their size in bytes.
+    long long offset;
+    long long size;
+  };
+
+  // Header of a block, followed by entry_count IndexEntries and data_size bytes of the data.
+  struct BlockHeader
+  {
+    char magic[4];
+    int version;
+    int entry_count;
+    int reserved;
+    long long data_size;
+  };
+
+  static const int format_version = 1;
+
+protected:
+  std::string filename;
+  int flush_every;
+  std::vector<IndexEntry> entries;
+  std::vector<char> data;
+};
+
+// Reader of the files of ShockIndicatorLog, for post-processing.
+class ShockIndicatorLogReader
+{
+public:
+  ShockIndicatorLogReader(const char* filename);
+  ~ShockIndicatorLogReader();
+
+  // Time steps with an entry of any indicator, ascending.
+  std::vector<int> get_iterations() const;
+
+  // The elements flagged by the indicator in the time step iteration; returns false if there is no such entry.
+  bool get_element_ids(int iteration, int indicator, std::vector<int>& element_ids);
+
+protected:
+  FILE* file;
+  // Position of the data in the file and the index entry, by the time step and the indicator.
+  std::map<std::pair<int, int>, std::pair<long long, ShockIndicatorLog::IndexEntry> > index;
+};
+
+// Reference spaces of the space-time adaptivity, kept over the adaptivity steps and the time steps, instead of
+// Space::construct_refined_spaces in every adaptivity step. If the coarse spaces (their active elements, the vertices
+// and the orders) did not change since the last call, the last reference spaces, with their DOF numbering, are returned
+// as they are; otherwise they are built anew, on the recycled meshes of a pool. The pool has two sets, so that
+// the solutions on the last reference spaces can still be projected onto the new ones. Spaces on the same coarse
+// mesh share one reference mesh.
+// A recycled reference mesh is not copied and refined again: only its elements whose coarse elements were refined
+// or unrefined since it was built are refined or unrefined (the element trees are walked from the base elements).
+// The spaces on it are still duplicated from the coarse ones, and the DOFs numbered anew (in the order of the element
+// ids), so the DOF numbering of the unchanged elements is not kept - L2Transfer matches the elements by geometry.
+class ReferenceSpaceManager
+{
+public:
+  ReferenceSpaceManager(Hermes::vector<Space<double>*> coarse_spaces, int order_increase = 1);
+  ~ReferenceSpaceManager();
+
+  // Reference spaces of the current coarse spaces, owned by the manager. They stay valid until the next but one rebuild.
+  Hermes::vector<Space<double>*>* get_ref_spaces();
+
+  // Whether the last get_ref_spaces() returned the reference spaces of the previous call.
+  bool get_last_reused() const;
+
+  // Time of the last get_ref_spaces(), and of all of them.
+  double get_last_time() const;
+  double get_time() const;
+
+protected:
+  // For every coarse space the number of active elements, and the id, the vertex ids and the order of each of them.
+  void describe_coarse_spaces(std::vector<int>& description) const;
+
+  // Refines and unrefines ref_e and its descendants in ref_mesh so that they are coarse_e and its descendants
+  // refined once more.
+  static void mirror_refinements(Mesh* ref_mesh, Element* coarse_e, Element* ref_e);
+  // Unrefines the (inactive) element e with all its descendants.
+  static void unrefine_element(Mesh* mesh, Element* e);
+  // Refinement of the inactive element e (0 - isotropic, 1, 2 - anisotropic of quads).
+  static int get_refinement(Element* e);
+
+  Hermes::vector<Space<double>*> coarse_spaces;
+  int order_increase;
+
+  // Description of the coarse spaces of the current reference spaces.
+  std::vector<int> description;
+
+  // Pool: two sets of the reference meshes and spaces, current is the last built one (-1 before the first build).
+  std::vector<Mesh*> ref_meshes[2];
+  Hermes::vector<Space<double>*> ref_spaces[2];
+  int current;
+
+  bool last_reused;
+  Hermes::TimePeriod cpu_time;
+};
+
+// Transfer of solutions onto (new) discontinuous spaces without the global projection: with L2 spaces, the L2 projection
+// decouples into the elements, so it is done element by element (with the local mass matrices); the coefficients of
+// the elements which did not change (the same geometry and order as the element of the source space) are copied from
+// the coefficients of the last transfer, or of set_coefficients(), if the source solutions are those ones.
+// The components on other spaces (or with sources other than solutions and exact functions) are projected
+// by OGProjection::project_global, the L2 ones are still projected element by element.
+// The source elements are located through a uniform grid of their bounding boxes.
+class L2Transfer
+{
+public:
+  L2Transfer(MatrixSolverType matrix_solver = SOLVER_UMFPACK);
+
+  // Transfers the source solutions into the target ones (may be the same) on the spaces; delete_old_meshes deletes
+  // the meshes of the sources other than those of the spaces.
+  void transfer(Hermes::vector<Space<double>*> spaces, Hermes::vector<Solution<double>*> source, Hermes::vector<Solution<double>*> target, 
+    bool delete_old_meshes = false);
+
+  // Coefficients of the solutions on the spaces, to be set if the solutions were changed other than by transfer()
+  // (e.g. the previous time level solutions set to the new ones).
+  void set_coefficients(Hermes::vector<Solution<double>*> solutions, Hermes::vector<Space<double>*> spaces, double* coeff_vec);
+  // The same, with the coefficients of the solutions of the last transfer of other (the solutions are copies of those).
+  void set_coefficients(Hermes::vector<Solution<double>*> solutions, const L2Transfer& other);
+
+  // Numbers of the elements copied and projected by the last transfer(), and of its globally projected components.
+  int get_copied_elements() const;
+  int get_projected_elements() const;
+  int get_global_components() const;
+
+  // Time of the last transfer(), and of all of them.
+  double get_last_time() const;
+  double get_time() const;
+
+protected:
+  // Uniform grid of the active elements of a mesh, by their bounding boxes.
+  struct ElementGrid
+  {
+    void init(Mesh* mesh);
+    // The element containing the point (x, y) and the reference coordinates, the guess is tried first.
+    Element* locate(RefMap* refmap, double x, double y, double& xi, double& eta, Element* guess = NULL) const;
+    static bool contains(Element* e, double xi, double eta);
+
+    double x_min, y_min, cell_size_x, cell_size_y;
+    int nx, ny;
+    std::vector<int> cell_offsets;
+    std::vector<Element*> cell_elements;
+  };
+
+  // Whether all vertices of the elements coincide.
+  static bool same_geometry(Element* e, Element* f);
+
+  MatrixSolverType matrix_solver;
+
+  // Coefficients of the last transfer (or set_coefficients()), with the solutions and the spaces.
+  Hermes::vector<Solution<double>*> coefficient_solutions;
+  Hermes::vector<Space<double>*> coefficient_spaces;
+  std::vector<double> coefficients;
+
+  int copied_elements;
+  int projected_elements;
+  int global_components;
+  Hermes::TimePeriod cpu_time;
+};
+
+// The Feistauer's shock indicator of the semi-implicit stabilization: an element is discontinuous if the integral
+// of the squared jump of the density over its inner edges, divided by diam * area^0.75, is at least the threshold.
+// The flags are kept by the element ids over the time steps. The inner edges (split at the hanging nodes) are found
+// once per mesh, and only the elements whose density coefficients changed since the last update are evaluated again,
+// in parallel.
+class StabilizationIndicator
+{
+public:
+  StabilizationIndicator(Solution<double>* prev_density, double threshold = 1.0);
+  ~StabilizationIndicator();
+
+  // Updates the flags from the density on its space. coeff_vec are the coefficients the density was set from
+  // (the density ones by the dofs of the space), NULL evaluates all elements.
+  void update(Space<double>* space, double* coeff_vec = NULL);
+
+  // For the forms.
+  bool is_discontinuous(int element_id) const;
+
+  int get_discontinuous_count() const;
+  // Number of the elements evaluated by the last update().
+  int get_last_evaluated() const;
+
+  // Time of the last update(), and of all of them.
+  double get_last_time() const;
+  double get_time() const;
+
+protected:
+  void update_topology(Mesh* mesh, int order);
+  void add_inner_edges(Mesh* mesh, int cell, int vertex_1, int vertex_2, std::map<std::pair<int, int>, int>& open_edges);
+
+  // Values of the density in the points of the edge, from the side side.
+  void evaluate_side(Solution<double>* density, RefMap* refmap, int edge_i, int side);
+
+  Solution<double>* prev_density;
+  double threshold;
+
+  Mesh* cached_mesh;
+  unsigned int cached_mesh_seq;
+  Space<double>* cached_space;
+  int cached_space_seq;
+  bool coefficients_valid;
+
+  // Cells (active elements) and the inner edges, the edges of the cells.
+  std::vector<Element*> cells;
+  std::vector<double> cell_scales;
+  std::vector<int> edge_cells[2];
+  std::vector<double> edge_x[2];
+  std::vector<double> edge_y[2];
+  std::vector<double> edge_lengths;
+  std::vector<int> cell_edge_offsets;
+  std::vector<int> cell_edges;
+  std::vector<int> cell_edge_sides;
+
+  // Gauss points and weights on [0, 1].
+  std::vector<double> points;
+  std::vector<double> weights;
+
+  // Density values in the points of the edges (from both sides), the integrals of the squared jumps.
+  std::vector<double> edge_values[2];
+  std::vector<double> edge_integrals;
+
+  // Density dofs and coefficients of the cells.
+  std::vector<int> cell_dof_offsets;
+  std::vector<int> cell_dofs;
+  std::vector<double> cell_coefficients;
+
+  // By the element ids.
+  std::vector<char> flags;
+  int discontinuous_count;
+  int last_evaluated;
+
+  // Copies of the density for the threads, the first one is the density itself.
+  std::vector<Solution<double>*> thread_densities;
+  Hermes::TimePeriod cpu_time;
+};
+
+// Multirate time stepping of the flow and the concentration of the coupled problem. Each macro step is as long
+// as the longer of the two stable time steps (at most max_substeps times the shorter one), and both subsystems
+// are advanced to its end by their own (sub)steps, the flow first. The concentration forms then read the flow
+// interpolated linearly in time between the beginning and the end of the macro step.
+class MultirateCoupling
+{
+public:
+  enum Subsystem
+  {
+    FLOW = 0,
+    CONCENTRATION = 1
+  };
+
+  // interpolated_flow are the solutions the concentration forms read the flow from.
+  MultirateCoupling(Hermes::vector<Space<double>*> flow_spaces, Hermes::vector<Solution<double>*> interpolated_flow, int max_substeps = 100);
+  ~MultirateCoupling();
+
+  // Starts a macro step from the stable time steps of the subsystems, returns its length.
+  double begin_macro_step(double flow_time_step, double concentration_time_step);
+
+  // The next (sub)step of the subsystem within the macro step, given its stable time step,
+  // the last one shortened to end with the macro step, 0 after the end of the macro step.
+  double next_step(Subsystem subsystem, double stable_time_step);
+
+  // Time of the subsystem since the beginning of the macro step.
+  double get_subsystem_time(Subsystem subsystem) const;
+
+  // Flow coefficients at the beginning and at the end of the macro step.
+  void set_flow_start(double* coeff_vec);
+  void set_flow_end(double* coeff_vec);
+
+  // Sets the interpolated flow to the time theta (relative to the beginning of the macro step).
+  void interpolate_flow(double theta);
+
+  // Statistics.
+  int get_macro_steps() const;
+  int get_steps(Subsystem subsystem) const;
+  double get_min_step(Subsystem subsystem) const;
+  double get_max_step(Subsystem subsystem) const;
+  double get_mean_step(Subsystem subsystem) const;
+
+protected:
+  Hermes::vector<Space<double>*> flow_spaces;
+  Hermes::vector<Solution<double>*> interpolated_flow;
+  int max_substeps;
+  int ndof;
+
+  double* flow_start;
+  double* flow_end;
+  double* flow_interpolated;
+
+  double macro_step;
+  double subsystem_time[2];
+
+  int macro_steps;
+  int steps[2];
+  double min_step[2];
+  double max_step[2];
+  double step_sum[2];
+};
+
 // Filters.
 class MachNumberFilter : public Hermes::Hermes2D::SimpleFilter<double>
 {
@@ -384,6 +1463,55 @@ public:
   Scalar A_2_3_3(Scalar rho, Scalar rho_v_x, Scalar rho_v_y, Scalar energy){
     return Scalar(kappa * rho_v_y / rho);
   }
+
+  // Both Jacobians A_1, A_2 in n points at once, the common subexpressions are evaluated once per point.
+  // A_1[i][j][k] (A_2[i][j][k]) equals A_1_j_k (A_2_j_k) in the i-th point.
+  // Only for the values, the orders of the forms are given by EulerFormsOrder.
+  void A(int n, double* rho, double* rho_v_x, double* rho_v_y, double* energy, double (*A_1)[4][4], double (*A_2)[4][4]) {
+    for(int i = 0; i < n; i++)
+    {
+      double u = rho_v_x[i] / rho[i];
+      double v = rho_v_y[i] / rho[i];
+      double kappa_e = kappa * energy[i] / rho[i];
+      double q = u * u + v * v;
+      double half_p_q = 0.5 * (kappa - 1.0) * q;
+      double uv = u * v;
+
+      A_1[i][0][0] = 0.0;
+      A_1[i][0][1] = 1.0;
+      A_1[i][0][2] = 0.0;
+      A_1[i][0][3] = 0.0;
+      A_1[i][1][0] = - u * u + half_p_q;
+      A_1[i][1][1] = (3.0 - kappa) * u;
+      A_1[i][1][2] = (1.0 - kappa) * v;
+      A_1[i][1][3] = kappa - 1.0;
+      A_1[i][2][0] = - uv;
+      A_1[i][2][1] = v;
+      A_1[i][2][2] = u;
+      A_1[i][2][3] = 0.0;
+      A_1[i][3][0] = u * ((kappa - 1.0) * q - kappa_e);
+      A_1[i][3][1] = kappa_e - (kappa - 1.0) * u * u - half_p_q;
+      A_1[i][3][2] = (1.0 - kappa) * uv;
+      A_1[i][3][3] = kappa * u;
+
+      A_2[i][0][0] = 0.0;
+      A_2[i][0][1] = 0.0;
+      A_2[i][0][2] = 1.0;
+      A_2[i][0][3] = 0.0;
+      A_2[i][1][0] = - uv;
+      A_2[i][1][1] = v;
+      A_2[i][1][2] = u;
+      A_2[i][1][3] = 0.0;
+      A_2[i][2][0] = - v * v + half_p_q;
+      A_2[i][2][1] = (1.0 - kappa) * u;
+      A_2[i][2][2] = (3.0 - kappa) * v;
+      A_2[i][2][3] = kappa - 1.0;
+      A_2[i][3][0] = v * ((kappa - 1.0) * q - kappa_e);
+      A_2[i][3][1] = (1.0 - kappa) * uv;
+      A_2[i][3][2] = kappa_e - half_p_q - (kappa - 1.0) * v * v;
+      A_2[i][3][3] = kappa * v;
+    }
+  }
   protected:
     double kappa;
 };
@@ -65,34 +65,25 @@ public:
         add_vector_form(new EulerEquationsLinearFormEnergy(kappa));
       }
 
-      add_vector_form_surf(new EulerEquationsLinearFormInterface(0, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormInterface(1, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormInterface(2, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormInterface(3, num_flux));
-
-      add_vector_form_surf(new EulerEquationsLinearFormSolidWall(0, solid_wall_bottom_marker, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormSolidWall(1, solid_wall_bottom_marker, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormSolidWall(2, solid_wall_bottom_marker, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormSolidWall(3, solid_wall_bottom_marker, num_flux));
-
-      if(solid_wall_bottom_marker != solid_wall_top_marker) {
-        add_vector_form_surf(new EulerEquationsLinearFormSolidWall(0, solid_wall_top_marker, num_flux));
-        add_vector_form_surf(new EulerEquationsLinearFormSolidWall(1, solid_wall_top_marker, num_flux));
-        add_vector_form_surf(new EulerEquationsLinearFormSolidWall(2, solid_wall_top_marker, num_flux));
-        add_vector_form_surf(new EulerEquationsLinearFormSolidWall(3, solid_wall_top_marker, num_flux));
-      }
+      // All four components of the numerical flux are calculated in one go.
+      Hermes::vector<unsigned int> vector_coordinates;
+      vector_coordinates.push_back(0);
+      vector_coordinates.push_back(1);
+      vector_coordinates.push_back(2);
+      vector_coordinates.push_back(3);
+
+      add_multicomponent_vector_form_surf(new EulerEquationsLinearFormInterface(vector_coordinates, num_flux));
+
+      add_multicomponent_vector_form_surf(new EulerEquationsLinearFormSolidWall(vector_coordinates, solid_wall_bottom_marker, num_flux));
+
+      if(solid_wall_bottom_marker != solid_wall_top_marker)
+        add_multicomponent_vector_form_surf(new EulerEquationsLinearFormSolidWall(vector_coordinates, solid_wall_top_marker, num_flux));
       else
         warning("Are you sure that solid wall top and bottom markers should coincide?");
 
-      add_vector_form_surf(new EulerEquationsLinearFormInlet(0, inlet_marker, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormInlet(1, inlet_marker, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormInlet(2, inlet_marker, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormInlet(3, inlet_marker, num_flux));
+      add_multicomponent_vector_form_surf(new EulerEquationsLinearFormInlet(vector_coordinates, inlet_marker, num_flux));
 
-      add_vector_form_surf(new EulerEquationsLinearFormOutlet(0, outlet_marker, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormOutlet(1, outlet_marker, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormOutlet(2, outlet_marker, num_flux));
-      add_vector_form_surf(new EulerEquationsLinearFormOutlet(3, outlet_marker, num_flux));
+      add_multicomponent_vector_form_surf(new EulerEquationsLinearFormOutlet(vector_coordinates, outlet_marker, num_flux));
 
       for(unsigned int vector_form_i = 0;vector_form_i < this->vfvol.size();vector_form_i++) {
         vfvol.at(vector_form_i)->ext.push_back(prev_density);
@@ -101,11 +92,11 @@ public:
         vfvol.at(vector_form_i)->ext.push_back(prev_energy);
       }
 
-      for(unsigned int vector_form_i = 0;vector_form_i < this->vfsurf.size();vector_form_i++) {
-        vfsurf.at(vector_form_i)->ext.push_back(prev_density);
-        vfsurf.at(vector_form_i)->ext.push_back(prev_density_vel_x);
-        vfsurf.at(vector_form_i)->ext.push_back(prev_density_vel_y);
-        vfsurf.at(vector_form_i)->ext.push_back(prev_energy);
+      for(unsigned int vector_form_i = 0;vector_form_i < this->vfsurf_mc.size();vector_form_i++) {
+        vfsurf_mc.at(vector_form_i)->ext.push_back(prev_density);
+        vfsurf_mc.at(vector_form_i)->ext.push_back(prev_density_vel_x);
+        vfsurf_mc.at(vector_form_i)->ext.push_back(prev_density_vel_y);
+        vfsurf_mc.at(vector_form_i)->ext.push_back(prev_energy);
       }
   };
 
@@ -373,33 +364,46 @@ protected:
     int component_i;
   };
 
-  class EulerEquationsLinearFormInterface : public VectorFormSurf<double>
+  class EulerEquationsLinearFormInterface : public MultiComponentVectorFormSurf<double>
   {
   public:
-    EulerEquationsLinearFormInterface(int i, NumericalFlux* num_flux) 
-      : VectorFormSurf<double>(i, H2D_DG_INNER_EDGE), element(i), num_flux(num_flux) {}
-
-    double value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, 
-      Geom<double> *e, ExtData<double> *ext) const {
-        double result = 0;
-        double w_L[4], w_R[4];
-        for (int i = 0;i < n;i++) {
-          w_L[0] = ext->fn[0]->get_val_central(i);
-          w_R[0] = ext->fn[0]->get_val_neighbor(i);
+    EulerEquationsLinearFormInterface(Hermes::vector<unsigned int> coordinates, NumericalFlux* num_flux) 
+      : MultiComponentVectorFormSurf<double>(coordinates, H2D_DG_INNER_EDGE), num_flux(num_flux) {}
 
-          w_L[1] = ext->fn[1]->get_val_central(i);
-          w_R[1] = ext->fn[1]->get_val_neighbor(i);
+    void value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, 
+      Geom<double> *e, ExtData<double> *ext, Hermes::vector<double>& result) const {
+        double result_0 = 0;
+        double result_1 = 0;
+        double result_2 = 0;
+        double result_3 = 0;
 
-          w_L[2] = ext->fn[2]->get_val_central(i);
-          w_R[2] = ext->fn[2]->get_val_neighbor(i);
+        // States in all points of the edge, stored component-wise, so that the flux is evaluated in one call.
+        FormScratch<double, 12 * EULER_MAX_EDGE_POINTS> scratch(12 * n);
+        double* storage = scratch.get();
+        double* w_L[4], *w_R[4], *flux[4];
+        for(unsigned int k = 0; k < 4; k++) {
+          w_L[k] = storage + k * n;
+          w_R[k] = storage + (4 + k) * n;
+          flux[k] = storage + (8 + k) * n;
+          for (int i = 0;i < n;i++) {
+            w_L[k][i] = ext->fn[k]->get_val_central(i);
+            w_R[k][i] = ext->fn[k]->get_val_neighbor(i);
+          }
+        }
 
-          w_L[3] = ext->fn[3]->get_val_central(i);
-          w_R[3] = ext->fn[3]->get_val_neighbor(i);
+        num_flux->numerical_flux_batch(n, flux, w_L, w_R, e->nx, e->ny);
 
-          result -= wt[i] * v->val[i] 
-          * num_flux->numerical_flux_i(element, w_L, w_R, e->nx[i], e->ny[i]);
+        for (int i = 0;i < n;i++) {
+          result_0 -= wt[i] * v->val[i] * flux[0][i];
+          result_1 -= wt[i] * v->val[i] * flux[1][i];
+          result_2 -= wt[i] * v->val[i] * flux[2][i];
+          result_3 -= wt[i] * v->val[i] * flux[3][i];
         }
-        return result * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
+        double tau = static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
+        result.push_back(result_0 * tau);
+        result.push_back(result_1 * tau);
+        result.push_back(result_2 * tau);
+        result.push_back(result_3 * tau);
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, 
@@ -408,30 +412,42 @@ protected:
     }
 
     // Members.
-    int element;
     NumericalFlux* num_flux;
   };
 
-  class EulerEquationsLinearFormSolidWall : public VectorFormSurf<double>
+  class EulerEquationsLinearFormSolidWall : public MultiComponentVectorFormSurf<double>
   {
   public:
-    EulerEquationsLinearFormSolidWall(int i, std::string marker, NumericalFlux* num_flux) 
-      : VectorFormSurf<double>(i, marker), element(i), num_flux(num_flux) {}
+    EulerEquationsLinearFormSolidWall(Hermes::vector<unsigned int> coordinates, std::string marker, NumericalFlux* num_flux) 
+      : MultiComponentVectorFormSurf<double>(coordinates, marker), num_flux(num_flux) {}
 
-    double value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, 
-      Geom<double> *e, ExtData<double> *ext) const {
-        double result = 0;
+    void value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, 
+      Geom<double> *e, ExtData<double> *ext, Hermes::vector<double>& result) const {
+        double result_0 = 0;
+        double result_1 = 0;
+        double result_2 = 0;
+        double result_3 = 0;
+        double w_L[4];
+        double flux[4];
+        NumericalFluxWorkspace ws;
         for (int i = 0;i < n;i++) {
-          double w_L[4];
           w_L[0] = ext->fn[0]->val[i];
           w_L[1] = ext->fn[1]->val[i];
           w_L[2] = ext->fn[2]->val[i];
           w_L[3] = ext->fn[3]->val[i];
 
-          result -= wt[i] * v->val[i] * num_flux->numerical_flux_solid_wall_i(element, 
-            w_L, e->nx[i], e->ny[i]);
+          num_flux->numerical_flux_solid_wall(ws, flux, w_L, e->nx[i], e->ny[i]);
+
+          result_0 -= wt[i] * v->val[i] * flux[0];
+          result_1 -= wt[i] * v->val[i] * flux[1];
+          result_2 -= wt[i] * v->val[i] * flux[2];
+          result_3 -= wt[i] * v->val[i] * flux[3];
         }
-        return result * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
+        double tau = static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
+        result.push_back(result_0 * tau);
+        result.push_back(result_1 * tau);
+        result.push_back(result_2 * tau);
+        result.push_back(result_3 * tau);
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, 
@@ -440,20 +456,32 @@ protected:
     }
 
     // Members.
-    int element;
     NumericalFlux* num_flux;
   };
 
-  class EulerEquationsLinearFormInlet : public VectorFormSurf<double>
+  class EulerEquationsLinearFormInlet : public MultiComponentVectorFormSurf<double>
   {
   public:
-    EulerEquationsLinearFormInlet(int i, std::string marker, NumericalFlux* num_flux) 
-      : VectorFormSurf<double>(i, marker), element(i), num_flux(num_flux) {}
+    EulerEquationsLinearFormInlet(Hermes::vector<unsigned int> coordinates, std::string marker, NumericalFlux* num_flux) 
+      : MultiComponentVectorFormSurf<double>(coordinates, marker), num_flux(num_flux) {}
 
-    double value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, Geom<double> *e, 
-      ExtData<double> *ext) const {
-        double result = 0;
+    void value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, 
+      Geom<double> *e, ExtData<double> *ext, Hermes::vector<double>& result) const {
+        double result_0 = 0;
+        double result_1 = 0;
+        double result_2 = 0;
+        double result_3 = 0;
         double w_L[4], w_B[4];
+        double flux[4];
+        NumericalFluxWorkspace ws;
+
+        // The boundary state does not depend on the integration point.
+        w_B[0] = static_cast<EulerEquationsWeakFormExplicit*>(wf)->rho_ext;
+        w_B[1] = static_cast<EulerEquationsWeakFormExplicit*>(wf)->rho_ext 
+          * static_cast<EulerEquationsWeakFormExplicit*>(wf)->v1_ext;
+        w_B[2] = static_cast<EulerEquationsWeakFormExplicit*>(wf)->rho_ext 
+          * static_cast<EulerEquationsWeakFormExplicit*>(wf)->v2_ext;
+        w_B[3] = static_cast<EulerEquationsWeakFormExplicit*>(wf)->energy_ext;
 
         for (int i = 0;i < n;i++) {
           // Left (inner) state from the previous time level solution.
@@ -462,17 +490,18 @@ protected:
           w_L[2] = ext->fn[2]->val[i];
           w_L[3] = ext->fn[3]->val[i];
 
-          w_B[0] = static_cast<EulerEquationsWeakFormExplicit*>(wf)->rho_ext;
-          w_B[1] = static_cast<EulerEquationsWeakFormExplicit*>(wf)->rho_ext 
-            * static_cast<EulerEquationsWeakFormExplicit*>(wf)->v1_ext;
-          w_B[2] = static_cast<EulerEquationsWeakFormExplicit*>(wf)->rho_ext 
-            * static_cast<EulerEquationsWeakFormExplicit*>(wf)->v2_ext;
-          w_B[3] = static_cast<EulerEquationsWeakFormExplicit*>(wf)->energy_ext;
+          num_flux->numerical_flux_inlet(ws, flux, w_L, w_B, e->nx[i], e->ny[i]);
 
-          result -= wt[i] * v->val[i] * num_flux->numerical_flux_inlet_i(element, 
-            w_L, w_B, e->nx[i], e->ny[i]);
+          result_0 -= wt[i] * v->val[i] * flux[0];
+          result_1 -= wt[i] * v->val[i] * flux[1];
+          result_2 -= wt[i] * v->val[i] * flux[2];
+          result_3 -= wt[i] * v->val[i] * flux[3];
         }
-        return result * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
+        double tau = static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
+        result.push_back(result_0 * tau);
+        result.push_back(result_1 * tau);
+        result.push_back(result_2 * tau);
+        result.push_back(result_3 * tau);
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, 
@@ -481,42 +510,55 @@ protected:
     }
 
     // Members.
-    int element;
     NumericalFlux* num_flux;
   };
 
-  class EulerEquationsLinearFormOutlet : public VectorFormSurf<double>
+  class EulerEquationsLinearFormOutlet : public MultiComponentVectorFormSurf<double>
   {
   public:
-    EulerEquationsLinearFormOutlet(int i, std::string marker, NumericalFlux* num_flux) : 
-        VectorFormSurf<double>(i, marker), element(i), num_flux(num_flux) {}
-
-        double value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, 
-          Geom<double> *e, ExtData<double> *ext) const {
-            double result = 0;
-            double w_L[4];
-            for (int i = 0;i < n;i++) {
-              w_L[0] = ext->fn[0]->val[i];
-              w_L[1] = ext->fn[1]->val[i];
-              w_L[2] = ext->fn[2]->val[i];
-              w_L[3] = ext->fn[3]->val[i];
-              result -= wt[i] * v->val[i] 
-              * num_flux->numerical_flux_outlet_i(element, w_L, 
-                static_cast<EulerEquationsWeakFormExplicit*>(wf)->pressure_ext, 
-                e->nx[i], e->ny[i]);
-            }
-            return result * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
-        }
+    EulerEquationsLinearFormOutlet(Hermes::vector<unsigned int> coordinates, std::string marker, NumericalFlux* num_flux) 
+      : MultiComponentVectorFormSurf<double>(coordinates, marker), num_flux(num_flux) {}
 
-        Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, 
-          ExtData<Ord> *ext) const {
-            return v->val[0];
+    void value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, 
+      Geom<double> *e, ExtData<double> *ext, Hermes::vector<double>& result) const {
+        double result_0 = 0;
+        double result_1 = 0;
+        double result_2 = 0;
+        double result_3 = 0;
+        double w_L[4];
+        double flux[4];
+        NumericalFluxWorkspace ws;
+        for (int i = 0;i < n;i++) {
+          w_L[0] = ext->fn[0]->val[i];
+          w_L[1] = ext->fn[1]->val[i];
+          w_L[2] = ext->fn[2]->val[i];
+          w_L[3] = ext->fn[3]->val[i];
+
+          num_flux->numerical_flux_outlet(ws, flux, w_L, 
+            static_cast<EulerEquationsWeakFormExplicit*>(wf)->pressure_ext, 
+            e->nx[i], e->ny[i]);
+
+          result_0 -= wt[i] * v->val[i] * flux[0];
+          result_1 -= wt[i] * v->val[i] * flux[1];
+          result_2 -= wt[i] * v->val[i] * flux[2];
+          result_3 -= wt[i] * v->val[i] * flux[3];
         }
+        double tau = static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
+        result.push_back(result_0 * tau);
+        result.push_back(result_1 * tau);
+        result.push_back(result_2 * tau);
+        result.push_back(result_3 * tau);
+    }
+
+    Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, 
+      ExtData<Ord> *ext) const {
+        return v->val[0];
+    }
 
-        // Members.
-        int element;
-        NumericalFlux* num_flux;
+    // Members.
+    NumericalFlux* num_flux;
   };
+
   // Members.
   double rho_ext;
   double v1_ext;
@@ -531,6 +573,7 @@ protected:
   friend class EulerEquationsWeakFormExplicitMultiComponent;
   friend class EulerEquationsWeakFormSemiImplicitMultiComponent;
   friend class EulerEquationsWeakFormSemiImplicitCoupled;
+  friend class ConcentrationWeakFormSemiImplicit;
 };
 
 class EulerEquationsWeakFormExplicitMultiComponent : public WeakForm<double>
@@ -620,7 +663,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
       ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(u->val[0] * v->val[0]);
     }
   };
 
@@ -632,119 +675,27 @@ protected:
 
     void value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, Geom<double> *e, 
       ExtData<double> *ext, Hermes::vector<double>& result) const {
-        double result_0 = 0;
-        double result_1 = 0;
-        double result_2 = 0;
-        double result_3 = 0;
-        for (int i = 0;i < n;i++) {
-          result_0 += wt[i] * ext->fn[0]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_0_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0 += wt[i] * ext->fn[0]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_0_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0 += wt[i] * ext->fn[1]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_0_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0 += wt[i] * ext->fn[1]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_0_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0 += wt[i] * ext->fn[2]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_0_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0 += wt[i] * ext->fn[2]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_0_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0 += wt[i] * ext->fn[3]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_0_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0 += wt[i] * ext->fn[3]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_0_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        double result_j[4];
+        for (int j = 0; j < 4; j++)
+          result_j[j] = 0;
 
-          result_1 += wt[i] * ext->fn[0]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_1_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1 += wt[i] * ext->fn[0]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_1_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1 += wt[i] * ext->fn[1]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_1_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1 += wt[i] * ext->fn[1]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_1_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1 += wt[i] * ext->fn[2]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_1_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1 += wt[i] * ext->fn[2]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_1_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1 += wt[i] * ext->fn[3]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_1_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1 += wt[i] * ext->fn[3]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_1_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        // Both flux Jacobians in all points at once.
+        FormScratch<double[4][4], 2 * EULER_MAX_VOLUME_POINTS> scratch(2 * n);
+        double (*A_1)[4][4] = scratch.get();
+        double (*A_2)[4][4] = A_1 + n;
+        (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A(n, ext->fn[0]->val, ext->fn[1]->val, ext->fn[2]->val, ext->fn[3]->val, A_1, A_2);
 
-          result_2 += wt[i] * ext->fn[0]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_2_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2 += wt[i] * ext->fn[0]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_2_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2 += wt[i] * ext->fn[1]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_2_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2 += wt[i] * ext->fn[1]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_2_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2 += wt[i] * ext->fn[2]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_2_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2 += wt[i] * ext->fn[2]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_2_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2 += wt[i] * ext->fn[3]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_2_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2 += wt[i] * ext->fn[3]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_2_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        for (int i = 0;i < n;i++)
+          for (int j = 0; j < 4; j++)
+            for (int k = 0; k < 4; k++)
+              result_j[j] += wt[i] * ext->fn[k]->val[i] * (A_1[i][j][k] * v->dx[i] + A_2[i][j][k] * v->dy[i]);
 
-          result_3 += wt[i] * ext->fn[0]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_3_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dx[i];
-          result_3 += wt[i] * ext->fn[0]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dy[i];
-          result_3 += wt[i] * ext->fn[1]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_3_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dx[i];
-          result_3 += wt[i] * ext->fn[1]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_3 += wt[i] * ext->fn[2]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_3_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_3 += wt[i] * ext->fn[2]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dy[i];
-          result_3 += wt[i] * ext->fn[3]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_1_3_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_3 += wt[i] * ext->fn[3]->val[i] 
-          * (static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-        }
-        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
+        for (int j = 0; j < 4; j++)
+          result.push_back(result_j[j] * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
-      return Ord(24);
+      return EulerFormsOrder::limit(v->val[0] * ext->fn[0]->val[0]);
     }
 
     double kappa;
@@ -766,7 +717,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, 
       ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(v->val[0] * ext->fn[0]->val[0]);
     }
   };
 
@@ -783,36 +734,37 @@ protected:
         double result_1 = 0;
         double result_2 = 0;
         double result_3 = 0;
-        double w_L[4], w_R[4];
-        for (int i = 0;i < n;i++) {
-          w_L[0] = ext->fn[0]->get_val_central(i);
-          w_R[0] = ext->fn[0]->get_val_neighbor(i);
 
-          w_L[1] = ext->fn[1]->get_val_central(i);
-          w_R[1] = ext->fn[1]->get_val_neighbor(i);
-
-          w_L[2] = ext->fn[2]->get_val_central(i);
-          w_R[2] = ext->fn[2]->get_val_neighbor(i);
-
-          w_L[3] = ext->fn[3]->get_val_central(i);
-          w_R[3] = ext->fn[3]->get_val_neighbor(i);
+        // States in all points of the edge, stored component-wise, so that the flux is evaluated in one call.
+        FormScratch<double, 12 * EULER_MAX_EDGE_POINTS> scratch(12 * n);
+        double* storage = scratch.get();
+        double* w_L[4], *w_R[4], *flux[4];
+        for(unsigned int k = 0; k < 4; k++) {
+          w_L[k] = storage + k * n;
+          w_R[k] = storage + (4 + k) * n;
+          flux[k] = storage + (8 + k) * n;
+          for (int i = 0;i < n;i++) {
+            w_L[k][i] = ext->fn[k]->get_val_central(i);
+            w_R[k][i] = ext->fn[k]->get_val_neighbor(i);
+          }
+        }
 
-          double flux[4];
-          num_flux->numerical_flux(flux, w_L, w_R, e->nx[i], e->ny[i]);
+        num_flux->numerical_flux_batch(n, flux, w_L, w_R, e->nx, e->ny);
 
-          result_0 -= wt[i] * v->val[i] * flux[0];
-          result_1 -= wt[i] * v->val[i] * flux[1];
-          result_2 -= wt[i] * v->val[i] * flux[2];
-          result_3 -= wt[i] * v->val[i] * flux[3];
+        for (int i = 0;i < n;i++) {
+          result_0 -= wt[i] * v->val[i] * flux[0][i];
+          result_1 -= wt[i] * v->val[i] * flux[1][i];
+          result_2 -= wt[i] * v->val[i] * flux[2][i];
+          result_3 -= wt[i] * v->val[i] * flux[3][i];
         }
-        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
+        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
-      return Ord(24);
+      return EulerFormsOrder::limit(v->val[0] * v->val[0]);
     }
 
     // Members.
@@ -840,21 +792,22 @@ protected:
           w_L[3] = ext->fn[3]->val[i];
 
           double flux[4];
-          num_flux->numerical_flux_solid_wall(flux, w_L, e->nx[i], e->ny[i]);
+          NumericalFluxWorkspace ws;
+          num_flux->numerical_flux_solid_wall(ws, flux, w_L, e->nx[i], e->ny[i]);
 
           result_0 -= wt[i] * v->val[i] * flux[0];
           result_1 -= wt[i] * v->val[i] * flux[1];
           result_2 -= wt[i] * v->val[i] * flux[2];
           result_3 -= wt[i] * v->val[i] * flux[3];
         }
-        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
+        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
-      return Ord(24);
+      return EulerFormsOrder::limit(v->val[0] * v->val[0]);
     }
 
     // Members.
@@ -891,21 +844,22 @@ protected:
           w_B[3] = static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->energy_ext;
 
           double flux[4];
-          num_flux->numerical_flux(flux, w_L, w_B, e->nx[i], e->ny[i]);
+          NumericalFluxWorkspace ws;
+          num_flux->numerical_flux_inlet(ws, flux, w_L, w_B, e->nx[i], e->ny[i]);
 
           result_0 -= wt[i] * v->val[i] * flux[0];
           result_1 -= wt[i] * v->val[i] * flux[1];
           result_2 -= wt[i] * v->val[i] * flux[2];
           result_3 -= wt[i] * v->val[i] * flux[3];
         }
-        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
+        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
-      return Ord(24);
+      return EulerFormsOrder::limit(v->val[0] * v->val[0]);
     }
 
     // Members.
@@ -933,7 +887,8 @@ protected:
           w_L[3] = ext->fn[3]->val[i];
 
           double flux[4];
-          num_flux->numerical_flux_outlet(flux, w_L, 
+          NumericalFluxWorkspace ws;
+          num_flux->numerical_flux_outlet(ws, flux, w_L, 
             static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->pressure_ext, e->nx[i], e->ny[i]);
           result_0 -= wt[i] * v->val[i] * flux[0];
           result_1 -= wt[i] * v->val[i] * flux[1];
@@ -941,14 +896,14 @@ protected:
           result_3 -= wt[i] * v->val[i] * flux[3];
         }
 
-        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
-        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau());
+        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
-      return Ord(24);
+      return EulerFormsOrder::limit(v->val[0] * v->val[0]);
     }
 
     // Members.
@@ -965,6 +920,95 @@ protected:
   EulerFluxes* euler_fluxes;
 };
 
+class EulerEquationsWeakFormExplicitMultiComponentTwoInflows : public EulerEquationsWeakFormExplicitMultiComponent
+{
+public:
+  // Constructor.
+  // The outlet uses the pressure of the first inflow.
+  EulerEquationsWeakFormExplicitMultiComponentTwoInflows(NumericalFlux* num_flux, double kappa, double rho_ext1, double v1_ext1, double v2_ext1, double pressure_ext1, double rho_ext2, double v1_ext2, double v2_ext2, double pressure_ext2, 
+    std::string wall_marker, std::string inlet_marker1, std::string inlet_marker2, std::string outlet_marker,
+    Solution<double>* prev_density, Solution<double>* prev_density_vel_x, Solution<double>* prev_density_vel_y, Solution<double>* prev_energy, bool fvm_only = false) :
+  EulerEquationsWeakFormExplicitMultiComponent(num_flux, kappa, rho_ext1, v1_ext1, v2_ext1, pressure_ext1, wall_marker, wall_marker, inlet_marker1, outlet_marker,
+    prev_density, prev_density_vel_x, prev_density_vel_y, prev_energy, fvm_only), 
+    rho_ext2(rho_ext2), v1_ext2(v1_ext2), v2_ext2(v2_ext2), 
+    energy_ext2(QuantityCalculator::calc_energy(rho_ext2, rho_ext2 * v1_ext2, rho_ext2 * v2_ext2, pressure_ext2, kappa))
+  {
+    Hermes::vector<unsigned int> vector_coordinates;
+    vector_coordinates.push_back(0);
+    vector_coordinates.push_back(1);
+    vector_coordinates.push_back(2);
+    vector_coordinates.push_back(3);
+
+    add_multicomponent_vector_form_surf(new EulerEquationsLinearFormInlet2(vector_coordinates, 
+      inlet_marker2, num_flux));
+    vfsurf_mc.back()->ext.push_back(prev_density);
+    vfsurf_mc.back()->ext.push_back(prev_density_vel_x);
+    vfsurf_mc.back()->ext.push_back(prev_density_vel_y);
+    vfsurf_mc.back()->ext.push_back(prev_energy);
+  };
+
+  // Destructor.
+  ~EulerEquationsWeakFormExplicitMultiComponentTwoInflows() {};
+protected:
+  class EulerEquationsLinearFormInlet2 : public MultiComponentVectorFormSurf<double>
+  {
+  public:
+    EulerEquationsLinearFormInlet2(Hermes::vector<unsigned int> coordinates, 
+      std::string marker, NumericalFlux* num_flux) : 
+    MultiComponentVectorFormSurf<double>(coordinates, marker), num_flux(num_flux) {}
+
+    void value(int n, double *wt, Func<double> *u_ext[], Func<double> *v, Geom<double> *e, 
+      ExtData<double> *ext, Hermes::vector<double>& result) const {
+        double result_0 = 0;
+        double result_1 = 0;
+        double result_2 = 0;
+        double result_3 = 0;
+        double w_L[4], w_B[4];
+
+        w_B[0] = static_cast<EulerEquationsWeakFormExplicitMultiComponentTwoInflows*>(wf)->rho_ext2;
+        w_B[1] = static_cast<EulerEquationsWeakFormExplicitMultiComponentTwoInflows*>(wf)->rho_ext2 
+          * static_cast<EulerEquationsWeakFormExplicitMultiComponentTwoInflows*>(wf)->v1_ext2;
+        w_B[2] = static_cast<EulerEquationsWeakFormExplicitMultiComponentTwoInflows*>(wf)->rho_ext2 
+          * static_cast<EulerEquationsWeakFormExplicitMultiComponentTwoInflows*>(wf)->v2_ext2;
+        w_B[3] = static_cast<EulerEquationsWeakFormExplicitMultiComponentTwoInflows*>(wf)->energy_ext2;
+
+        for (int i = 0;i < n;i++) {
+          // Left (inner) state from the previous time level solution.
+          w_L[0] = ext->fn[0]->val[i];
+          w_L[1] = ext->fn[1]->val[i];
+          w_L[2] = ext->fn[2]->val[i];
+          w_L[3] = ext->fn[3]->val[i];
+
+          double flux[4];
+          NumericalFluxWorkspace ws;
+          num_flux->numerical_flux_inlet(ws, flux, w_L, w_B, e->nx[i], e->ny[i]);
+
+          result_0 -= wt[i] * v->val[i] * flux[0];
+          result_1 -= wt[i] * v->val[i] * flux[1];
+          result_2 -= wt[i] * v->val[i] * flux[2];
+          result_3 -= wt[i] * v->val[i] * flux[3];
+        }
+        result.push_back(result_0 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_1 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_2 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+        result.push_back(result_3 * static_cast<EulerEquationsWeakFormExplicitMultiComponent*>(wf)->get_tau());
+    }
+
+    Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
+      return EulerFormsOrder::limit(v->val[0] * v->val[0]);
+    }
+
+    // Members.
+    NumericalFlux* num_flux;
+  };
+
+  // Members.
+  double rho_ext2;
+  double v1_ext2;
+  double v2_ext2;
+  double energy_ext2;
+};
+
 class EulerEquationsWeakFormSemiImplicitMultiComponent : public WeakForm<double>
 {
 public:
@@ -973,7 +1017,7 @@ public:
     std::string solid_wall_bottom_marker, std::string solid_wall_top_marker, std::string inlet_marker, std::string outlet_marker, 
     Solution<double>* prev_density, Solution<double>* prev_density_vel_x, Solution<double>* prev_density_vel_y, Solution<double>* prev_energy, bool fvm_only = false, int num_of_equations = 4) :
   WeakForm<double>(num_of_equations), rho_ext(rho_ext), v1_ext(v1_ext), v2_ext(v2_ext), pressure_ext(pressure_ext), 
-    energy_ext(QuantityCalculator::calc_energy(rho_ext, rho_ext * v1_ext, rho_ext * v2_ext, pressure_ext, kappa)), euler_fluxes(new EulerFluxes(kappa))
+    energy_ext(QuantityCalculator::calc_energy(rho_ext, rho_ext * v1_ext, rho_ext * v2_ext, pressure_ext, kappa)), euler_fluxes(new EulerFluxes(kappa)), stabilization_indicator(NULL)
   {
     Hermes::vector<std::pair<unsigned int, unsigned int> > matrix_coordinates;
     matrix_coordinates.push_back(std::pair<unsigned int, unsigned int>(0, 0));
@@ -1118,11 +1162,25 @@ public:
     surf_form->ext.push_back(prev_energy_1);
 
     add_multicomponent_matrix_form_surf(surf_form);
+
+    delete stabilization_indicator;
+    stabilization_indicator = new StabilizationIndicator(prev_density_1);
+  }
+
+  ~EulerEquationsWeakFormSemiImplicitMultiComponent()
+  {
+    delete stabilization_indicator;
   }
 
-  void set_discreteIndicator(bool* discreteIndicator)
+  // Updates the shock indicator of the stabilization, coeff_vec are the coefficients the density was set from (NULL if none).
+  void update_stabilization_indicator(Space<double>* density_space, double* coeff_vec = NULL)
   {
-    this->discreteIndicator = discreteIndicator;
+    stabilization_indicator->update(density_space, coeff_vec);
+  }
+
+  const StabilizationIndicator* get_stabilization_indicator() const
+  {
+    return stabilization_indicator;
   }
 
 protected:
@@ -1142,7 +1200,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
       ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(u->val[0] * v->val[0]);
     }
   };
 
@@ -1154,150 +1212,29 @@ protected:
 
     void value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, Geom<double> *e, 
       ExtData<double> *ext, Hermes::vector<double>& result) const {
-        double result_0_0 = 0;
-        double result_0_1 = 0;
-        double result_0_2 = 0;
-        double result_0_3 = 0;
-
-        double result_1_0 = 0;
-        double result_1_1 = 0;
-        double result_1_2 = 0;
-        double result_1_3 = 0;
-
-        double result_2_0 = 0;
-        double result_2_1 = 0;
-        double result_2_2 = 0;
-        double result_2_3 = 0;
-
-        double result_3_0 = 0;
-        double result_3_1 = 0;
-        double result_3_2 = 0;
-        double result_3_3 = 0;
-
-        for (int i = 0;i < n;i++) {
-          result_0_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_0_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_0_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_0_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_0_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_0_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_0_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_0_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_0_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        // Both flux Jacobians in all points at once.
+        FormScratch<double[4][4], 2 * EULER_MAX_VOLUME_POINTS> scratch(2 * n);
+        double (*A_1)[4][4] = scratch.get();
+        double (*A_2)[4][4] = A_1 + n;
+        (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A(n, ext->fn[0]->val, ext->fn[1]->val, ext->fn[2]->val, ext->fn[3]->val, A_1, A_2);
 
-          result_1_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_1_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_1_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_1_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_1_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_1_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_1_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_1_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_1_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        double result_j_k[4][4];
+        for (int j = 0; j < 4; j++)
+          for (int k = 0; k < 4; k++)
+            result_j_k[j][k] = 0;
 
-          result_2_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_2_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_2_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_2_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_2_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_2_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_2_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_2_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_2_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        for (int i = 0;i < n;i++)
+          for (int j = 0; j < 4; j++)
+            for (int k = 0; k < 4; k++)
+              result_j_k[j][k] += wt[i] * u->val[i] * (A_1[i][j][k] * v->dx[i] + A_2[i][j][k] * v->dy[i]);
 
-          result_3_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_3_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dx[i];
-          result_3_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dy[i];
-          result_3_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_3_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dx[i];
-          result_3_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_3_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_3_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_3_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dy[i];
-          result_3_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_1_3_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_3_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-        }
-        result.push_back(-result_0_0 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_0_1 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_0_2 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_0_3 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-
-        result.push_back(-result_1_0 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_1_1 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_1_2 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_1_3 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-
-        result.push_back(-result_2_0 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_2_1 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_2_2 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_2_3 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-
-        result.push_back(-result_3_0 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_3_1 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_3_2 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
-        result.push_back(-result_3_3 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
+        for (int j = 0; j < 4; j++)
+          for (int k = 0; k < 4; k++)
+            result.push_back(-result_j_k[j][k] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
-      return Ord(24);
+      return EulerFormsOrder::limit(u->val[0] * v->val[0] * ext->fn[0]->val[0]);
     }
 
     double kappa;
@@ -1342,60 +1279,36 @@ protected:
           w[2] = ext->fn[2]->get_val_central(i);
           w[3] = ext->fn[3]->get_val_central(i);
 
-          double e_1_1[4] = {1, 0, 0, 0};
-          double e_2_1[4] = {0, 1, 0, 0};
-          double e_3_1[4] = {0, 0, 1, 0};
-          double e_4_1[4] = {0, 0, 0, 1};
-
-          double P_plus_1[4];
-          double P_plus_2[4];
-          double P_plus_3[4];
-          double P_plus_4[4];
-
-          num_flux->P_plus(P_plus_1, w, e_1_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_2, w, e_2_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_3, w, e_3_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_4, w, e_4_1, e->nx[i], e->ny[i]);
+          double P_plus_cols[4][4];
+          num_flux->P_plus_columns(P_plus_cols, w, e->nx[i], e->ny[i]);
 
           w[0] = ext->fn[0]->get_val_neighbor(i);
           w[1] = ext->fn[1]->get_val_neighbor(i);
           w[2] = ext->fn[2]->get_val_neighbor(i);
           w[3] = ext->fn[3]->get_val_neighbor(i);
 
-          double e_1_2[4] = {1, 0, 0, 0};
-          double e_2_2[4] = {0, 1, 0, 0};
-          double e_3_2[4] = {0, 0, 1, 0};
-          double e_4_2[4] = {0, 0, 0, 1};
-
-          double P_minus_1[4];
-          double P_minus_2[4];
-          double P_minus_3[4];
-          double P_minus_4[4];
-
-          num_flux->P_minus(P_minus_1, w, e_1_2, e->nx[i], e->ny[i]);
-          num_flux->P_minus(P_minus_2, w, e_2_2, e->nx[i], e->ny[i]);
-          num_flux->P_minus(P_minus_3, w, e_3_2, e->nx[i], e->ny[i]);
-          num_flux->P_minus(P_minus_4, w, e_4_2, e->nx[i], e->ny[i]);
-
-          result_0_0 += wt[i] * (P_plus_1[0] * u->get_val_central(i) + P_minus_1[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_0_1 += wt[i] * (P_plus_2[0] * u->get_val_central(i) + P_minus_2[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_0_2 += wt[i] * (P_plus_3[0] * u->get_val_central(i) + P_minus_3[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_0_3 += wt[i] * (P_plus_4[0] * u->get_val_central(i) + P_minus_4[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-
-          result_1_0 += wt[i] * (P_plus_1[1] * u->get_val_central(i) + P_minus_1[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_1_1 += wt[i] * (P_plus_2[1] * u->get_val_central(i) + P_minus_2[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_1_2 += wt[i] * (P_plus_3[1] * u->get_val_central(i) + P_minus_3[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_1_3 += wt[i] * (P_plus_4[1] * u->get_val_central(i) + P_minus_4[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-
-          result_2_0 += wt[i] * (P_plus_1[2] * u->get_val_central(i) + P_minus_1[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_2_1 += wt[i] * (P_plus_2[2] * u->get_val_central(i) + P_minus_2[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_2_2 += wt[i] * (P_plus_3[2] * u->get_val_central(i) + P_minus_3[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_2_3 += wt[i] * (P_plus_4[2] * u->get_val_central(i) + P_minus_4[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-
-          result_3_0 += wt[i] * (P_plus_1[3] * u->get_val_central(i) + P_minus_1[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_3_1 += wt[i] * (P_plus_2[3] * u->get_val_central(i) + P_minus_2[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_3_2 += wt[i] * (P_plus_3[3] * u->get_val_central(i) + P_minus_3[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_3_3 += wt[i] * (P_plus_4[3] * u->get_val_central(i) + P_minus_4[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          double P_minus_cols[4][4];
+          num_flux->P_minus_columns(P_minus_cols, w, e->nx[i], e->ny[i]);
+
+          result_0_0 += wt[i] * (P_plus_cols[0][0] * u->get_val_central(i) + P_minus_cols[0][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_0_1 += wt[i] * (P_plus_cols[1][0] * u->get_val_central(i) + P_minus_cols[1][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_0_2 += wt[i] * (P_plus_cols[2][0] * u->get_val_central(i) + P_minus_cols[2][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_0_3 += wt[i] * (P_plus_cols[3][0] * u->get_val_central(i) + P_minus_cols[3][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+
+          result_1_0 += wt[i] * (P_plus_cols[0][1] * u->get_val_central(i) + P_minus_cols[0][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_1_1 += wt[i] * (P_plus_cols[1][1] * u->get_val_central(i) + P_minus_cols[1][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_1_2 += wt[i] * (P_plus_cols[2][1] * u->get_val_central(i) + P_minus_cols[2][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_1_3 += wt[i] * (P_plus_cols[3][1] * u->get_val_central(i) + P_minus_cols[3][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+
+          result_2_0 += wt[i] * (P_plus_cols[0][2] * u->get_val_central(i) + P_minus_cols[0][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_2_1 += wt[i] * (P_plus_cols[1][2] * u->get_val_central(i) + P_minus_cols[1][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_2_2 += wt[i] * (P_plus_cols[2][2] * u->get_val_central(i) + P_minus_cols[2][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_2_3 += wt[i] * (P_plus_cols[3][2] * u->get_val_central(i) + P_minus_cols[3][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+
+          result_3_0 += wt[i] * (P_plus_cols[0][3] * u->get_val_central(i) + P_minus_cols[0][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_3_1 += wt[i] * (P_plus_cols[1][3] * u->get_val_central(i) + P_minus_cols[1][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_3_2 += wt[i] * (P_plus_cols[2][3] * u->get_val_central(i) + P_minus_cols[2][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_3_3 += wt[i] * (P_plus_cols[3][3] * u->get_val_central(i) + P_minus_cols[3][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
         }
 
         result.push_back(result_0_0);
@@ -1421,7 +1334,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, 
       Geom<Ord> *e, ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::limit(u->get_val_central(0) * v->get_val_central(0) + u->get_val_neighbor(0) * v->get_val_neighbor(0));
     }
 
     StegerWarmingNumericalFlux* num_flux;
@@ -1469,7 +1382,8 @@ protected:
           w_L[3] = ext->fn[3]->val[i];
 
           // Transformation of the inner state to the local coordinates.
-          num_flux->Q(num_flux->get_q(), w_L, e->nx[i], e->ny[i]);
+          NumericalFluxWorkspace ws;
+          num_flux->Q(ws.q, w_L, e->nx[i], e->ny[i]);
 
           // Initialize the matrices.
           double T[4][4];
@@ -1487,15 +1401,15 @@ protected:
           }
 
           // Calculate Lambda^-.
-          num_flux->Lambda(eigenvalues);
-          num_flux->T_1(T);
-          num_flux->T_2(T);
-          num_flux->T_3(T);
-          num_flux->T_4(T);
-          num_flux->T_inv_1(T_inv);
-          num_flux->T_inv_2(T_inv);
-          num_flux->T_inv_3(T_inv);
-          num_flux->T_inv_4(T_inv);
+          num_flux->Lambda(ws, eigenvalues);
+          num_flux->T_1(ws, T);
+          num_flux->T_2(ws, T);
+          num_flux->T_3(ws, T);
+          num_flux->T_4(ws, T);
+          num_flux->T_inv_1(ws, T_inv);
+          num_flux->T_inv_2(ws, T_inv);
+          num_flux->T_inv_3(ws, T_inv);
+          num_flux->T_inv_4(ws, T_inv);
 
           // "Prescribed" boundary state.
           w_B[0] = static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->rho_ext;
@@ -1509,7 +1423,7 @@ protected:
 
           for(unsigned int ai = 0; ai < 4; ai++)
             for(unsigned int aj = 0; aj < 4; aj++)
-              alpha[ai] += T_inv[ai][aj] * num_flux->get_q()[aj];
+              alpha[ai] += T_inv[ai][aj] * ws.q[aj];
 
           for(unsigned int bi = 0; bi < 4; bi++)
             for(unsigned int bj = 0; bj < 4; bj++)
@@ -1532,40 +1446,28 @@ protected:
           w_temp[2] = (w_ji[2] + w_L[2]) / 2;
           w_temp[3] = (w_ji[3] + w_L[3]) / 2;
 
-          double e_1[4] = {1, 0, 0, 0};
-          double e_2[4] = {0, 1, 0, 0};
-          double e_3[4] = {0, 0, 1, 0};
-          double e_4[4] = {0, 0, 0, 1};
-
-          double P_plus_1[4];
-          double P_plus_2[4];
-          double P_plus_3[4];
-          double P_plus_4[4];
-
-          num_flux->P_plus(P_plus_1, w_temp, e_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_2, w_temp, e_2, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_3, w_temp, e_3, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_4, w_temp, e_4, e->nx[i], e->ny[i]);
-
-          result_0_0 += wt[i] * P_plus_1[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_0_1 += wt[i] * P_plus_2[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_0_2 += wt[i] * P_plus_3[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_0_3 += wt[i] * P_plus_4[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-
-          result_1_0 += wt[i] * P_plus_1[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_1_1 += wt[i] * P_plus_2[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_1_2 += wt[i] * P_plus_3[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_1_3 += wt[i] * P_plus_4[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-
-          result_2_0 += wt[i] * P_plus_1[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_2_1 += wt[i] * P_plus_2[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_2_2 += wt[i] * P_plus_3[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_2_3 += wt[i] * P_plus_4[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-
-          result_3_0 += wt[i] * P_plus_1[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_3_1 += wt[i] * P_plus_2[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_3_2 += wt[i] * P_plus_3[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
-          result_3_3 += wt[i] * P_plus_4[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          double P_plus_cols[4][4];
+          num_flux->P_plus_columns(P_plus_cols, w_temp, e->nx[i], e->ny[i]);
+
+          result_0_0 += wt[i] * P_plus_cols[0][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_0_1 += wt[i] * P_plus_cols[1][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_0_2 += wt[i] * P_plus_cols[2][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_0_3 += wt[i] * P_plus_cols[3][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+
+          result_1_0 += wt[i] * P_plus_cols[0][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_1_1 += wt[i] * P_plus_cols[1][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_1_2 += wt[i] * P_plus_cols[2][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_1_3 += wt[i] * P_plus_cols[3][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+
+          result_2_0 += wt[i] * P_plus_cols[0][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_2_1 += wt[i] * P_plus_cols[1][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_2_2 += wt[i] * P_plus_cols[2][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_2_3 += wt[i] * P_plus_cols[3][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+
+          result_3_0 += wt[i] * P_plus_cols[0][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_3_1 += wt[i] * P_plus_cols[1][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_3_2 += wt[i] * P_plus_cols[2][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
+          result_3_3 += wt[i] * P_plus_cols[3][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->get_tau();
         }
 
         result.push_back(result_0_0);
@@ -1591,7 +1493,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, 
       Geom<Ord> *e, ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::limit(u->val[0] * v->val[0]);
     }
 
     StegerWarmingNumericalFlux* num_flux;
@@ -1624,7 +1526,8 @@ protected:
           w_L[3] = ext->fn[3]->val[i];
 
           // Transformation of the inner state to the local coordinates.
-          num_flux->Q(num_flux->get_q(), w_L, e->nx[i], e->ny[i]);
+          NumericalFluxWorkspace ws;
+          num_flux->Q(ws.q, w_L, e->nx[i], e->ny[i]);
 
           // Initialize the matrices.
           double T[4][4];
@@ -1642,15 +1545,15 @@ protected:
           }
 
           // Calculate Lambda^-.
-          num_flux->Lambda(eigenvalues);
-          num_flux->T_1(T);
-          num_flux->T_2(T);
-          num_flux->T_3(T);
-          num_flux->T_4(T);
-          num_flux->T_inv_1(T_inv);
-          num_flux->T_inv_2(T_inv);
-          num_flux->T_inv_3(T_inv);
-          num_flux->T_inv_4(T_inv);
+          num_flux->Lambda(ws, eigenvalues);
+          num_flux->T_1(ws, T);
+          num_flux->T_2(ws, T);
+          num_flux->T_3(ws, T);
+          num_flux->T_4(ws, T);
+          num_flux->T_inv_1(ws, T_inv);
+          num_flux->T_inv_2(ws, T_inv);
+          num_flux->T_inv_3(ws, T_inv);
+          num_flux->T_inv_4(ws, T_inv);
 
           // "Prescribed" boundary state.
           w_B[0] = static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->rho_ext;
@@ -1664,7 +1567,7 @@ protected:
 
           for(unsigned int ai = 0; ai < 4; ai++)
             for(unsigned int aj = 0; aj < 4; aj++)
-              alpha[ai] += T_inv[ai][aj] * num_flux->get_q()[aj];
+              alpha[ai] += T_inv[ai][aj] * ws.q[aj];
 
           for(unsigned int bi = 0; bi < 4; bi++)
             for(unsigned int bj = 0; bj < 4; bj++)
@@ -1703,7 +1606,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, 
       Geom<Ord> *e, ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::limit(v->val[0] * v->val[0]);
     }
 
     StegerWarmingNumericalFlux* num_flux;
@@ -1725,7 +1628,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, 
       ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(v->val[0] * ext->fn[0]->val[0]);
     }
   };
 
@@ -1822,7 +1725,7 @@ protected:
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
-      return Ord(24);
+      return EulerFormsOrder::limit(u->val[0] * v->val[0]);
     }
 
     // Members.
@@ -1838,7 +1741,7 @@ protected:
       Geom<double> *e, ExtData<double> *ext, Hermes::vector<double>& result) const 
     {
       double result_i = 0.;
-      if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->discreteIndicator[e->id]) 
+      if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->stabilization_indicator->is_discontinuous(e->id)) 
         result_i = int_grad_u_grad_v<double, double>(n, wt, u, v) * nu_1 * e->diam;
       result.push_back(result_i);
       result.push_back(result_i);
@@ -1848,7 +1751,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
       ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(u->val[0] * v->val[0]);
     }
   private:
     double nu_1;
@@ -1866,7 +1769,7 @@ protected:
       Hermes::vector<double>& result) const {
         double result_i = 0;
 
-        if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->discreteIndicator[e->id] && static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->discreteIndicator[e->get_neighbor_id()])
+        if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->stabilization_indicator->is_discontinuous(e->id) && static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent*>(wf)->stabilization_indicator->is_discontinuous(e->get_neighbor_id()))
           for (int i = 0;i < n;i++)
             result_i += wt[i] * (u->get_val_central(i) - u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * nu_2;
 
@@ -1893,7 +1796,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, 
       Geom<Ord> *e, ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(u->get_val_central(0) * v->get_val_central(0) + u->get_val_neighbor(0) * v->get_val_neighbor(0));
     }
 
     double nu_2;
@@ -1907,7 +1810,7 @@ protected:
   double energy_ext;
   double tau;
   EulerFluxes* euler_fluxes;
-  bool* discreteIndicator;
+  StabilizationIndicator* stabilization_indicator;
 };
 
 class EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder : public WeakForm<double>
@@ -1919,7 +1822,7 @@ public:
     Solution<double>* prev_density_1, Solution<double>* prev_density_vel_x_1, Solution<double>* prev_density_vel_y_1, Solution<double>* prev_energy_1, 
     Solution<double>* prev_density_2, Solution<double>* prev_density_vel_x_2, Solution<double>* prev_density_vel_y_2, Solution<double>* prev_energy_2, bool fvm_only = false) :
   WeakForm<double>(4), rho_ext(rho_ext), v1_ext(v1_ext), v2_ext(v2_ext), pressure_ext(pressure_ext), 
-    energy_ext(QuantityCalculator::calc_energy(rho_ext, rho_ext * v1_ext, rho_ext * v2_ext, pressure_ext, kappa)), euler_fluxes(new EulerFluxes(kappa))
+    energy_ext(QuantityCalculator::calc_energy(rho_ext, rho_ext * v1_ext, rho_ext * v2_ext, pressure_ext, kappa)), euler_fluxes(new EulerFluxes(kappa)), stabilization_indicator(NULL)
   {
     Hermes::vector<std::pair<unsigned int, unsigned int> > matrix_coordinates;
     matrix_coordinates.push_back(std::pair<unsigned int, unsigned int>(0, 0));
@@ -2077,12 +1980,26 @@ public:
     surf_form->ext.push_back(filter_density_vel_y);
     surf_form->ext.push_back(filter_energy);
 
-    add_multicomponent_matrix_form_surf(surf_form);
+    add_multicomponent_matrix_form_surf(surf_form);
+
+    delete stabilization_indicator;
+    stabilization_indicator = new StabilizationIndicator(prev_density_1);
+  }
+
+  ~EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder()
+  {
+    delete stabilization_indicator;
+  }
+
+  // Updates the shock indicator of the stabilization, coeff_vec are the coefficients the density was set from (NULL if none).
+  void update_stabilization_indicator(Space<double>* density_space, double* coeff_vec = NULL)
+  {
+    stabilization_indicator->update(density_space, coeff_vec);
   }
 
-  void set_discreteIndicator(bool* discreteIndicator)
+  const StabilizationIndicator* get_stabilization_indicator() const
   {
-    this->discreteIndicator = discreteIndicator;
+    return stabilization_indicator;
   }
 
   class EulerEquationsBilinearFormTime2ndOrder : public MultiComponentMatrixFormVol<double>
@@ -2101,7 +2018,7 @@ public:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
       ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(u->val[0] * v->val[0]);
     }
   private:
     double* tau_k;
@@ -2116,150 +2033,29 @@ public:
 
     void value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, Geom<double> *e, 
       ExtData<double> *ext, Hermes::vector<double>& result) const {
-        double result_0_0 = 0;
-        double result_0_1 = 0;
-        double result_0_2 = 0;
-        double result_0_3 = 0;
-
-        double result_1_0 = 0;
-        double result_1_1 = 0;
-        double result_1_2 = 0;
-        double result_1_3 = 0;
-
-        double result_2_0 = 0;
-        double result_2_1 = 0;
-        double result_2_2 = 0;
-        double result_2_3 = 0;
-
-        double result_3_0 = 0;
-        double result_3_1 = 0;
-        double result_3_2 = 0;
-        double result_3_3 = 0;
-
-        for (int i = 0;i < n;i++) {
-          result_0_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_0_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_0_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_0_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_0_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_0_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_0_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_0_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_0_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        // Both flux Jacobians in all points at once.
+        FormScratch<double[4][4], 2 * EULER_MAX_VOLUME_POINTS> scratch(2 * n);
+        double (*A_1)[4][4] = scratch.get();
+        double (*A_2)[4][4] = A_1 + n;
+        (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A(n, ext->fn[0]->val, ext->fn[1]->val, ext->fn[2]->val, ext->fn[3]->val, A_1, A_2);
 
-          result_1_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_1_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_1_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_1_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_1_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_1_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_1_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_1_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_1_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        double result_j_k[4][4];
+        for (int j = 0; j < 4; j++)
+          for (int k = 0; k < 4; k++)
+            result_j_k[j][k] = 0;
 
-          result_2_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_2_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_2_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_2_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_2_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_2_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_2_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_2_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_2_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        for (int i = 0;i < n;i++)
+          for (int j = 0; j < 4; j++)
+            for (int k = 0; k < 4; k++)
+              result_j_k[j][k] += wt[i] * u->val[i] * (A_1[i][j][k] * v->dx[i] + A_2[i][j][k] * v->dy[i]);
 
-          result_3_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_3_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dx[i];
-          result_3_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_3_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dy[i];
-          result_3_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_3_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dx[i];
-          result_3_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_3_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_3_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_3_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_3_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_3_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dy[i];
-          result_3_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_1_3_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_3_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf))->euler_fluxes->A_2_3_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-        }
-        result.push_back(-result_0_0);
-        result.push_back(-result_0_1);
-        result.push_back(-result_0_2);
-        result.push_back(-result_0_3);
-
-        result.push_back(-result_1_0);
-        result.push_back(-result_1_1);
-        result.push_back(-result_1_2);
-        result.push_back(-result_1_3);
-
-        result.push_back(-result_2_0);
-        result.push_back(-result_2_1);
-        result.push_back(-result_2_2);
-        result.push_back(-result_2_3);
-
-        result.push_back(-result_3_0);
-        result.push_back(-result_3_1);
-        result.push_back(-result_3_2);
-        result.push_back(-result_3_3);
+        for (int j = 0; j < 4; j++)
+          for (int k = 0; k < 4; k++)
+            result.push_back(-result_j_k[j][k] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
-      return Ord(24);
+      return EulerFormsOrder::limit(u->val[0] * v->val[0] * ext->fn[0]->val[0]);
     }
 
     double kappa;
@@ -2304,60 +2100,36 @@ public:
           w[2] = (ext->fn[2]->get_val_central(i) + ext->fn[2]->get_val_neighbor(i)) / 2;
           w[3] = (ext->fn[3]->get_val_central(i) + ext->fn[3]->get_val_neighbor(i)) / 2;
 
-          double e_1_1[4] = {1, 0, 0, 0};
-          double e_2_1[4] = {0, 1, 0, 0};
-          double e_3_1[4] = {0, 0, 1, 0};
-          double e_4_1[4] = {0, 0, 0, 1};
-
-          double P_plus_1[4];
-          double P_plus_2[4];
-          double P_plus_3[4];
-          double P_plus_4[4];
-
-          num_flux->P_plus(P_plus_1, w, e_1_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_2, w, e_2_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_3, w, e_3_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_4, w, e_4_1, e->nx[i], e->ny[i]);
+          double P_plus_cols[4][4];
+          num_flux->P_plus_columns(P_plus_cols, w, e->nx[i], e->ny[i]);
 
           w[0] = (ext->fn[0]->get_val_central(i) + ext->fn[0]->get_val_neighbor(i)) / 2;
           w[1] = (ext->fn[1]->get_val_central(i) + ext->fn[1]->get_val_neighbor(i)) / 2;
           w[2] = (ext->fn[2]->get_val_central(i) + ext->fn[2]->get_val_neighbor(i)) / 2;
           w[3] = (ext->fn[3]->get_val_central(i) + ext->fn[3]->get_val_neighbor(i)) / 2;
 
-          double e_1_2[4] = {1, 0, 0, 0};
-          double e_2_2[4] = {0, 1, 0, 0};
-          double e_3_2[4] = {0, 0, 1, 0};
-          double e_4_2[4] = {0, 0, 0, 1};
-
-          double P_minus_1[4];
-          double P_minus_2[4];
-          double P_minus_3[4];
-          double P_minus_4[4];
-
-          num_flux->P_minus(P_minus_1, w, e_1_2, e->nx[i], e->ny[i]);
-          num_flux->P_minus(P_minus_2, w, e_2_2, e->nx[i], e->ny[i]);
-          num_flux->P_minus(P_minus_3, w, e_3_2, e->nx[i], e->ny[i]);
-          num_flux->P_minus(P_minus_4, w, e_4_2, e->nx[i], e->ny[i]);
-
-          result_0_0 += wt[i] * (P_plus_1[0] * u->get_val_central(i) + P_minus_1[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_0_1 += wt[i] * (P_plus_2[0] * u->get_val_central(i) + P_minus_2[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_0_2 += wt[i] * (P_plus_3[0] * u->get_val_central(i) + P_minus_3[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_0_3 += wt[i] * (P_plus_4[0] * u->get_val_central(i) + P_minus_4[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-
-          result_1_0 += wt[i] * (P_plus_1[1] * u->get_val_central(i) + P_minus_1[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_1_1 += wt[i] * (P_plus_2[1] * u->get_val_central(i) + P_minus_2[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_1_2 += wt[i] * (P_plus_3[1] * u->get_val_central(i) + P_minus_3[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_1_3 += wt[i] * (P_plus_4[1] * u->get_val_central(i) + P_minus_4[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-
-          result_2_0 += wt[i] * (P_plus_1[2] * u->get_val_central(i) + P_minus_1[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_2_1 += wt[i] * (P_plus_2[2] * u->get_val_central(i) + P_minus_2[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_2_2 += wt[i] * (P_plus_3[2] * u->get_val_central(i) + P_minus_3[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_2_3 += wt[i] * (P_plus_4[2] * u->get_val_central(i) + P_minus_4[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-
-          result_3_0 += wt[i] * (P_plus_1[3] * u->get_val_central(i) + P_minus_1[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_3_1 += wt[i] * (P_plus_2[3] * u->get_val_central(i) + P_minus_2[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_3_2 += wt[i] * (P_plus_3[3] * u->get_val_central(i) + P_minus_3[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-          result_3_3 += wt[i] * (P_plus_4[3] * u->get_val_central(i) + P_minus_4[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          double P_minus_cols[4][4];
+          num_flux->P_minus_columns(P_minus_cols, w, e->nx[i], e->ny[i]);
+
+          result_0_0 += wt[i] * (P_plus_cols[0][0] * u->get_val_central(i) + P_minus_cols[0][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_0_1 += wt[i] * (P_plus_cols[1][0] * u->get_val_central(i) + P_minus_cols[1][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_0_2 += wt[i] * (P_plus_cols[2][0] * u->get_val_central(i) + P_minus_cols[2][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_0_3 += wt[i] * (P_plus_cols[3][0] * u->get_val_central(i) + P_minus_cols[3][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+
+          result_1_0 += wt[i] * (P_plus_cols[0][1] * u->get_val_central(i) + P_minus_cols[0][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_1_1 += wt[i] * (P_plus_cols[1][1] * u->get_val_central(i) + P_minus_cols[1][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_1_2 += wt[i] * (P_plus_cols[2][1] * u->get_val_central(i) + P_minus_cols[2][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_1_3 += wt[i] * (P_plus_cols[3][1] * u->get_val_central(i) + P_minus_cols[3][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+
+          result_2_0 += wt[i] * (P_plus_cols[0][2] * u->get_val_central(i) + P_minus_cols[0][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_2_1 += wt[i] * (P_plus_cols[1][2] * u->get_val_central(i) + P_minus_cols[1][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_2_2 += wt[i] * (P_plus_cols[2][2] * u->get_val_central(i) + P_minus_cols[2][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_2_3 += wt[i] * (P_plus_cols[3][2] * u->get_val_central(i) + P_minus_cols[3][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+
+          result_3_0 += wt[i] * (P_plus_cols[0][3] * u->get_val_central(i) + P_minus_cols[0][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_3_1 += wt[i] * (P_plus_cols[1][3] * u->get_val_central(i) + P_minus_cols[1][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_3_2 += wt[i] * (P_plus_cols[2][3] * u->get_val_central(i) + P_minus_cols[2][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
+          result_3_3 += wt[i] * (P_plus_cols[3][3] * u->get_val_central(i) + P_minus_cols[3][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
         }
 
         result.push_back(result_0_0);
@@ -2383,7 +2155,7 @@ public:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, 
       Geom<Ord> *e, ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::limit(u->get_val_central(0) * v->get_val_central(0) + u->get_val_neighbor(0) * v->get_val_neighbor(0));
     }
 
     StegerWarmingNumericalFlux* num_flux;
@@ -2431,7 +2203,8 @@ public:
           w_L[3] = ext->fn[3]->val[i];
 
           // Transformation of the inner state to the local coordinates.
-          num_flux->Q(num_flux->get_q(), w_L, e->nx[i], e->ny[i]);
+          NumericalFluxWorkspace ws;
+          num_flux->Q(ws.q, w_L, e->nx[i], e->ny[i]);
 
           // Initialize the matrices.
           double T[4][4];
@@ -2449,15 +2222,15 @@ public:
           }
 
           // Calculate Lambda^-.
-          num_flux->Lambda(eigenvalues);
-          num_flux->T_1(T);
-          num_flux->T_2(T);
-          num_flux->T_3(T);
-          num_flux->T_4(T);
-          num_flux->T_inv_1(T_inv);
-          num_flux->T_inv_2(T_inv);
-          num_flux->T_inv_3(T_inv);
-          num_flux->T_inv_4(T_inv);
+          num_flux->Lambda(ws, eigenvalues);
+          num_flux->T_1(ws, T);
+          num_flux->T_2(ws, T);
+          num_flux->T_3(ws, T);
+          num_flux->T_4(ws, T);
+          num_flux->T_inv_1(ws, T_inv);
+          num_flux->T_inv_2(ws, T_inv);
+          num_flux->T_inv_3(ws, T_inv);
+          num_flux->T_inv_4(ws, T_inv);
 
           // "Prescribed" boundary state.
           w_B[0] = static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf)->rho_ext;
@@ -2471,7 +2244,7 @@ public:
 
           for(unsigned int ai = 0; ai < 4; ai++)
             for(unsigned int aj = 0; aj < 4; aj++)
-              alpha[ai] += T_inv[ai][aj] * num_flux->get_q()[aj];
+              alpha[ai] += T_inv[ai][aj] * ws.q[aj];
 
           for(unsigned int bi = 0; bi < 4; bi++)
             for(unsigned int bj = 0; bj < 4; bj++)
@@ -2494,40 +2267,28 @@ public:
           w_temp[2] = (w_ji[2] + w_L[2]) / 2;
           w_temp[3] = (w_ji[3] + w_L[3]) / 2;
 
-          double e_1[4] = {1, 0, 0, 0};
-          double e_2[4] = {0, 1, 0, 0};
-          double e_3[4] = {0, 0, 1, 0};
-          double e_4[4] = {0, 0, 0, 1};
-
-          double P_plus_1[4];
-          double P_plus_2[4];
-          double P_plus_3[4];
-          double P_plus_4[4];
-
-          num_flux->P_plus(P_plus_1, w_temp, e_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_2, w_temp, e_2, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_3, w_temp, e_3, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_4, w_temp, e_4, e->nx[i], e->ny[i]);
-
-          result_0_0 += wt[i] * P_plus_1[0] * u->val[i] * v->val[i];
-          result_0_1 += wt[i] * P_plus_2[0] * u->val[i] * v->val[i];
-          result_0_2 += wt[i] * P_plus_3[0] * u->val[i] * v->val[i];
-          result_0_3 += wt[i] * P_plus_4[0] * u->val[i] * v->val[i];
-
-          result_1_0 += wt[i] * P_plus_1[1] * u->val[i] * v->val[i];
-          result_1_1 += wt[i] * P_plus_2[1] * u->val[i] * v->val[i];
-          result_1_2 += wt[i] * P_plus_3[1] * u->val[i] * v->val[i];
-          result_1_3 += wt[i] * P_plus_4[1] * u->val[i] * v->val[i];
-
-          result_2_0 += wt[i] * P_plus_1[2] * u->val[i] * v->val[i];
-          result_2_1 += wt[i] * P_plus_2[2] * u->val[i] * v->val[i];
-          result_2_2 += wt[i] * P_plus_3[2] * u->val[i] * v->val[i];
-          result_2_3 += wt[i] * P_plus_4[2] * u->val[i] * v->val[i];
-
-          result_3_0 += wt[i] * P_plus_1[3] * u->val[i] * v->val[i];
-          result_3_1 += wt[i] * P_plus_2[3] * u->val[i] * v->val[i];
-          result_3_2 += wt[i] * P_plus_3[3] * u->val[i] * v->val[i];
-          result_3_3 += wt[i] * P_plus_4[3] * u->val[i] * v->val[i];
+          double P_plus_cols[4][4];
+          num_flux->P_plus_columns(P_plus_cols, w_temp, e->nx[i], e->ny[i]);
+
+          result_0_0 += wt[i] * P_plus_cols[0][0] * u->val[i] * v->val[i];
+          result_0_1 += wt[i] * P_plus_cols[1][0] * u->val[i] * v->val[i];
+          result_0_2 += wt[i] * P_plus_cols[2][0] * u->val[i] * v->val[i];
+          result_0_3 += wt[i] * P_plus_cols[3][0] * u->val[i] * v->val[i];
+
+          result_1_0 += wt[i] * P_plus_cols[0][1] * u->val[i] * v->val[i];
+          result_1_1 += wt[i] * P_plus_cols[1][1] * u->val[i] * v->val[i];
+          result_1_2 += wt[i] * P_plus_cols[2][1] * u->val[i] * v->val[i];
+          result_1_3 += wt[i] * P_plus_cols[3][1] * u->val[i] * v->val[i];
+
+          result_2_0 += wt[i] * P_plus_cols[0][2] * u->val[i] * v->val[i];
+          result_2_1 += wt[i] * P_plus_cols[1][2] * u->val[i] * v->val[i];
+          result_2_2 += wt[i] * P_plus_cols[2][2] * u->val[i] * v->val[i];
+          result_2_3 += wt[i] * P_plus_cols[3][2] * u->val[i] * v->val[i];
+
+          result_3_0 += wt[i] * P_plus_cols[0][3] * u->val[i] * v->val[i];
+          result_3_1 += wt[i] * P_plus_cols[1][3] * u->val[i] * v->val[i];
+          result_3_2 += wt[i] * P_plus_cols[2][3] * u->val[i] * v->val[i];
+          result_3_3 += wt[i] * P_plus_cols[3][3] * u->val[i] * v->val[i];
         }
 
         result.push_back(result_0_0);
@@ -2553,7 +2314,7 @@ public:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, 
       Geom<Ord> *e, ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::limit(u->val[0] * v->val[0]);
     }
 
     StegerWarmingNumericalFlux* num_flux;
@@ -2586,7 +2347,8 @@ public:
           w_L[3] = ext->fn[3]->val[i];
 
           // Transformation of the inner state to the local coordinates.
-          num_flux->Q(num_flux->get_q(), w_L, e->nx[i], e->ny[i]);
+          NumericalFluxWorkspace ws;
+          num_flux->Q(ws.q, w_L, e->nx[i], e->ny[i]);
 
           // Initialize the matrices.
           double T[4][4];
@@ -2604,15 +2366,15 @@ public:
           }
 
           // Calculate Lambda^-.
-          num_flux->Lambda(eigenvalues);
-          num_flux->T_1(T);
-          num_flux->T_2(T);
-          num_flux->T_3(T);
-          num_flux->T_4(T);
-          num_flux->T_inv_1(T_inv);
-          num_flux->T_inv_2(T_inv);
-          num_flux->T_inv_3(T_inv);
-          num_flux->T_inv_4(T_inv);
+          num_flux->Lambda(ws, eigenvalues);
+          num_flux->T_1(ws, T);
+          num_flux->T_2(ws, T);
+          num_flux->T_3(ws, T);
+          num_flux->T_4(ws, T);
+          num_flux->T_inv_1(ws, T_inv);
+          num_flux->T_inv_2(ws, T_inv);
+          num_flux->T_inv_3(ws, T_inv);
+          num_flux->T_inv_4(ws, T_inv);
 
           // "Prescribed" boundary state.
           w_B[0] = static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf)->rho_ext;
@@ -2626,7 +2388,7 @@ public:
 
           for(unsigned int ai = 0; ai < 4; ai++)
             for(unsigned int aj = 0; aj < 4; aj++)
-              alpha[ai] += T_inv[ai][aj] * num_flux->get_q()[aj];
+              alpha[ai] += T_inv[ai][aj] * ws.q[aj];
 
           for(unsigned int bi = 0; bi < 4; bi++)
             for(unsigned int bj = 0; bj < 4; bj++)
@@ -2665,7 +2427,7 @@ public:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, 
       Geom<Ord> *e, ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::limit(v->val[0] * v->val[0]);
     }
 
     StegerWarmingNumericalFlux* num_flux;
@@ -2687,7 +2449,7 @@ public:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, 
       ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(v->val[0] * ext->fn[0]->val[0]);
     }
   };
 
@@ -2784,7 +2546,7 @@ public:
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
-      return Ord(24);
+      return EulerFormsOrder::limit(u->val[0] * v->val[0]);
     }
 
     // Members.
@@ -2800,7 +2562,7 @@ public:
       Geom<double> *e, ExtData<double> *ext, Hermes::vector<double>& result) const 
     {
       double result_i = 0.;
-      if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf)->discreteIndicator[e->id]) 
+      if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf)->stabilization_indicator->is_discontinuous(e->id)) 
         result_i = int_grad_u_grad_v<double, double>(n, wt, u, v) * nu_1 * e->diam;
       result.push_back(result_i);
       result.push_back(result_i);
@@ -2810,7 +2572,7 @@ public:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
       ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(u->val[0] * v->val[0]);
     }
   private:
     double nu_1;
@@ -2828,7 +2590,7 @@ public:
       Hermes::vector<double>& result) const {
         double result_i = 0;
 
-        if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf)->discreteIndicator[e->id] && static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf)->discreteIndicator[e->get_neighbor_id()])
+        if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf)->stabilization_indicator->is_discontinuous(e->id) && static_cast<EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder*>(wf)->stabilization_indicator->is_discontinuous(e->get_neighbor_id()))
           for (int i = 0;i < n;i++)
             result_i += wt[i] * (u->get_val_central(i) - u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * nu_2;
 
@@ -2855,7 +2617,7 @@ public:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, 
       Geom<Ord> *e, ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(u->get_val_central(0) * v->get_val_central(0) + u->get_val_neighbor(0) * v->get_val_neighbor(0));
     }
 
     double nu_2;
@@ -2906,7 +2668,7 @@ public:
   double pressure_ext;
   double energy_ext;
   EulerFluxes* euler_fluxes;
-  bool* discreteIndicator;
+  StabilizationIndicator* stabilization_indicator;
   double tau_k, tau_k_minus_one;
 };
 
@@ -2923,7 +2685,7 @@ public:
     energy_ext1(QuantityCalculator::calc_energy(rho_ext1, rho_ext1* v1_ext1, rho_ext1 * v2_ext1, pressure_ext1, kappa)), 
     rho_ext2(rho_ext2), v1_ext2(v1_ext2), v2_ext2(v2_ext2), pressure_ext2(pressure_ext2), 
     energy_ext2(QuantityCalculator::calc_energy(rho_ext2, rho_ext2 * v1_ext2, rho_ext2 * v2_ext2, pressure_ext2, kappa)), 
-    euler_fluxes(new EulerFluxes(kappa))
+    euler_fluxes(new EulerFluxes(kappa)), stabilization_indicator(NULL)
   {
     Hermes::vector<std::pair<unsigned int, unsigned int> > matrix_coordinates;
     matrix_coordinates.push_back(std::pair<unsigned int, unsigned int>(0, 0));
@@ -3070,11 +2832,25 @@ public:
     surf_form->ext.push_back(prev_energy_1);
 
     add_multicomponent_matrix_form_surf(surf_form);
+
+    delete stabilization_indicator;
+    stabilization_indicator = new StabilizationIndicator(prev_density_1);
   }
 
-  void set_discreteIndicator(bool* discreteIndicator)
+  ~EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows()
   {
-    this->discreteIndicator = discreteIndicator;
+    delete stabilization_indicator;
+  }
+
+  // Updates the shock indicator of the stabilization, coeff_vec are the coefficients the density was set from (NULL if none).
+  void update_stabilization_indicator(Space<double>* density_space, double* coeff_vec = NULL)
+  {
+    stabilization_indicator->update(density_space, coeff_vec);
+  }
+
+  const StabilizationIndicator* get_stabilization_indicator() const
+  {
+    return stabilization_indicator;
   }
 
 protected:
@@ -3106,146 +2882,25 @@ protected:
 
     void value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, Geom<double> *e, 
       ExtData<double> *ext, Hermes::vector<double>& result) const {
-        double result_0_0 = 0;
-        double result_0_1 = 0;
-        double result_0_2 = 0;
-        double result_0_3 = 0;
-
-        double result_1_0 = 0;
-        double result_1_1 = 0;
-        double result_1_2 = 0;
-        double result_1_3 = 0;
-
-        double result_2_0 = 0;
-        double result_2_1 = 0;
-        double result_2_2 = 0;
-        double result_2_3 = 0;
-
-        double result_3_0 = 0;
-        double result_3_1 = 0;
-        double result_3_2 = 0;
-        double result_3_3 = 0;
-
-        for (int i = 0;i < n;i++) {
-          result_0_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_0_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_0_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_0_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_0_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_0_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_0_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_0_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_0_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_0_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_0_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        // Both flux Jacobians in all points at once.
+        FormScratch<double[4][4], 2 * EULER_MAX_VOLUME_POINTS> scratch(2 * n);
+        double (*A_1)[4][4] = scratch.get();
+        double (*A_2)[4][4] = A_1 + n;
+        (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A(n, ext->fn[0]->val, ext->fn[1]->val, ext->fn[2]->val, ext->fn[3]->val, A_1, A_2);
 
-          result_1_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_1_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_1_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_1_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_1_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_1_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_1_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_1_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_1_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_1_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_1_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        double result_j_k[4][4];
+        for (int j = 0; j < 4; j++)
+          for (int k = 0; k < 4; k++)
+            result_j_k[j][k] = 0;
 
-          result_2_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_2_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_2_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_2_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_2_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_2_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_2_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_2_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_2_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_2_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_2_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
+        for (int i = 0;i < n;i++)
+          for (int j = 0; j < 4; j++)
+            for (int k = 0; k < 4; k++)
+              result_j_k[j][k] += wt[i] * u->val[i] * (A_1[i][j][k] * v->dx[i] + A_2[i][j][k] * v->dy[i]);
 
-          result_3_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_3_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dx[i];
-          result_3_0 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_3_0<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dy[i];
-          result_3_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_3_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dx[i];
-          result_3_1 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_3_1<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-          result_3_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_3_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_3_2 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_3_2<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], ext->fn[3]->val[i]) 
-            * v->dy[i];
-          result_3_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_1_3_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dx[i];
-          result_3_3 += wt[i] * u->val[i]
-          * (static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf))->euler_fluxes->A_2_3_3<double>(ext->fn[0]->val[i], ext->fn[1]->val[i], ext->fn[2]->val[i], 0) 
-            * v->dy[i];
-        }
-        result.push_back(-result_0_0 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_0_1 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_0_2 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_0_3 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-
-        result.push_back(-result_1_0 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_1_1 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_1_2 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_1_3 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-
-        result.push_back(-result_2_0 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_2_1 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_2_2 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_2_3 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-
-        result.push_back(-result_3_0 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_3_1 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_3_2 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
-        result.push_back(-result_3_3 * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
+        for (int j = 0; j < 4; j++)
+          for (int k = 0; k < 4; k++)
+            result.push_back(-result_j_k[j][k] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const {
@@ -3304,40 +2959,28 @@ protected:
           w_L[3] = ext->fn[3]->get_val_central(i);
           w_R[3] = ext->fn[3]->get_val_neighbor(i);
 
-          double e_1_1_1[4] = {1, 0, 0, 0};
-          double e_2_2_1[4] = {0, 1, 0, 0};
-          double e_3_3_1[4] = {0, 0, 1, 0};
-          double e_4_4_1[4] = {0, 0, 0, 1};
-
-          double P_plus_1[4];
-          double P_plus_2[4];
-          double P_plus_3[4];
-          double P_plus_4[4];
-
-          num_flux->P_plus(P_plus_1, w_L, e_1_1_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_2, w_L, e_2_2_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_3, w_L, e_3_3_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_4, w_L, e_4_4_1, e->nx[i], e->ny[i]);
-
-          result_0_0 += wt[i] * (P_plus_1[0] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_1 += wt[i] * (P_plus_2[0] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_2 += wt[i] * (P_plus_3[0] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_3 += wt[i] * (P_plus_4[0] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_1_0 += wt[i] * (P_plus_1[1] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_1 += wt[i] * (P_plus_2[1] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_2 += wt[i] * (P_plus_3[1] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_3 += wt[i] * (P_plus_4[1] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_2_0 += wt[i] * (P_plus_1[2] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_1 += wt[i] * (P_plus_2[2] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_2 += wt[i] * (P_plus_3[2] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_3 += wt[i] * (P_plus_4[2] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_3_0 += wt[i] * (P_plus_1[3] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_1 += wt[i] * (P_plus_2[3] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_2 += wt[i] * (P_plus_3[3] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_3 += wt[i] * (P_plus_4[3] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          double P_plus_cols[4][4];
+          num_flux->P_plus_columns(P_plus_cols, w_L, e->nx[i], e->ny[i]);
+
+          result_0_0 += wt[i] * (P_plus_cols[0][0] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_1 += wt[i] * (P_plus_cols[1][0] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_2 += wt[i] * (P_plus_cols[2][0] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_3 += wt[i] * (P_plus_cols[3][0] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_1_0 += wt[i] * (P_plus_cols[0][1] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_1 += wt[i] * (P_plus_cols[1][1] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_2 += wt[i] * (P_plus_cols[2][1] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_3 += wt[i] * (P_plus_cols[3][1] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_2_0 += wt[i] * (P_plus_cols[0][2] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_1 += wt[i] * (P_plus_cols[1][2] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_2 += wt[i] * (P_plus_cols[2][2] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_3 += wt[i] * (P_plus_cols[3][2] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_3_0 += wt[i] * (P_plus_cols[0][3] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_1 += wt[i] * (P_plus_cols[1][3] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_2 += wt[i] * (P_plus_cols[2][3] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_3 += wt[i] * (P_plus_cols[3][3] * u->get_val_central(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
         }
 
         result.push_back(result_0_0);
@@ -3423,40 +3066,28 @@ protected:
           w_L[3] = ext->fn[3]->get_val_central(i);
           w_R[3] = ext->fn[3]->get_val_neighbor(i);
 
-          double e_1_1_2[4] = {1, 0, 0, 0};
-          double e_2_2_2[4] = {0, 1, 0, 0};
-          double e_3_3_2[4] = {0, 0, 1, 0};
-          double e_4_4_2[4] = {0, 0, 0, 1};
-
-          double P_minus_1[4];
-          double P_minus_2[4];
-          double P_minus_3[4];
-          double P_minus_4[4];
-
-          num_flux->P_minus(P_minus_1, w_R, e_1_1_2, e->nx[i], e->ny[i]);
-          num_flux->P_minus(P_minus_2, w_R, e_2_2_2, e->nx[i], e->ny[i]);
-          num_flux->P_minus(P_minus_3, w_R, e_3_3_2, e->nx[i], e->ny[i]);
-          num_flux->P_minus(P_minus_4, w_R, e_4_4_2, e->nx[i], e->ny[i]);
-
-          result_0_0 += wt[i] * (P_minus_1[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_1 += wt[i] * (P_minus_2[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_2 += wt[i] * (P_minus_3[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_3 += wt[i] * (P_minus_4[0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_1_0 += wt[i] * (P_minus_1[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_1 += wt[i] * (P_minus_2[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_2 += wt[i] * (P_minus_3[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_3 += wt[i] * (P_minus_4[1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_2_0 += wt[i] * (P_minus_1[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_1 += wt[i] * (P_minus_2[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_2 += wt[i] * (P_minus_3[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_3 += wt[i] * (P_minus_4[2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_3_0 += wt[i] * (P_minus_1[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_1 += wt[i] * (P_minus_2[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_2 += wt[i] * (P_minus_3[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_3 += wt[i] * (P_minus_4[3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          double P_minus_cols[4][4];
+          num_flux->P_minus_columns(P_minus_cols, w_R, e->nx[i], e->ny[i]);
+
+          result_0_0 += wt[i] * (P_minus_cols[0][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_1 += wt[i] * (P_minus_cols[1][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_2 += wt[i] * (P_minus_cols[2][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_3 += wt[i] * (P_minus_cols[3][0] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_1_0 += wt[i] * (P_minus_cols[0][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_1 += wt[i] * (P_minus_cols[1][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_2 += wt[i] * (P_minus_cols[2][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_3 += wt[i] * (P_minus_cols[3][1] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_2_0 += wt[i] * (P_minus_cols[0][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_1 += wt[i] * (P_minus_cols[1][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_2 += wt[i] * (P_minus_cols[2][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_3 += wt[i] * (P_minus_cols[3][2] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_3_0 += wt[i] * (P_minus_cols[0][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_1 += wt[i] * (P_minus_cols[1][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_2 += wt[i] * (P_minus_cols[2][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_3 += wt[i] * (P_minus_cols[3][3] * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
 
         }
 
@@ -3534,40 +3165,28 @@ protected:
           w_L[2] = ext->fn[2]->val[i];
           w_L[3] = ext->fn[3]->val[i];
 
-          double e_1[4] = {1, 0, 0, 0};
-          double e_2[4] = {0, 1, 0, 0};
-          double e_3[4] = {0, 0, 1, 0};
-          double e_4[4] = {0, 0, 0, 1};
-
-          double P_plus_1[4];
-          double P_plus_2[4];
-          double P_plus_3[4];
-          double P_plus_4[4];
-
-          num_flux->P_plus(P_plus_1, w_L, e_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_2, w_L, e_2, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_3, w_L, e_3, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_4, w_L, e_4, e->nx[i], e->ny[i]);
-
-          result_0_0 += wt[i] * P_plus_1[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_1 += wt[i] * P_plus_2[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_2 += wt[i] * P_plus_3[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_3 += wt[i] * P_plus_4[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_1_0 += wt[i] * P_plus_1[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_1 += wt[i] * P_plus_2[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_2 += wt[i] * P_plus_3[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_3 += wt[i] * P_plus_4[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_2_0 += wt[i] * P_plus_1[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_1 += wt[i] * P_plus_2[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_2 += wt[i] * P_plus_3[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_3 += wt[i] * P_plus_4[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_3_0 += wt[i] * P_plus_1[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_1 += wt[i] * P_plus_2[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_2 += wt[i] * P_plus_3[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_3 += wt[i] * P_plus_4[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          double P_plus_cols[4][4];
+          num_flux->P_plus_columns(P_plus_cols, w_L, e->nx[i], e->ny[i]);
+
+          result_0_0 += wt[i] * P_plus_cols[0][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_1 += wt[i] * P_plus_cols[1][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_2 += wt[i] * P_plus_cols[2][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_3 += wt[i] * P_plus_cols[3][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_1_0 += wt[i] * P_plus_cols[0][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_1 += wt[i] * P_plus_cols[1][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_2 += wt[i] * P_plus_cols[2][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_3 += wt[i] * P_plus_cols[3][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_2_0 += wt[i] * P_plus_cols[0][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_1 += wt[i] * P_plus_cols[1][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_2 += wt[i] * P_plus_cols[2][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_3 += wt[i] * P_plus_cols[3][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_3_0 += wt[i] * P_plus_cols[0][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_1 += wt[i] * P_plus_cols[1][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_2 += wt[i] * P_plus_cols[2][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_3 += wt[i] * P_plus_cols[3][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
         }
 
         result.push_back(result_0_0);
@@ -3626,7 +3245,8 @@ protected:
           w_L[3] = ext->fn[3]->val[i];
 
           // Transformation of the inner state to the local coordinates.
-          num_flux->Q(num_flux->get_q(), w_L, e->nx[i], e->ny[i]);
+          NumericalFluxWorkspace ws;
+          num_flux->Q(ws.q, w_L, e->nx[i], e->ny[i]);
 
           // Initialize the matrices.
           double T[4][4];
@@ -3644,15 +3264,15 @@ protected:
           }
 
           // Calculate Lambda^-.
-          num_flux->Lambda(eigenvalues);
-          num_flux->T_1(T);
-          num_flux->T_2(T);
-          num_flux->T_3(T);
-          num_flux->T_4(T);
-          num_flux->T_inv_1(T_inv);
-          num_flux->T_inv_2(T_inv);
-          num_flux->T_inv_3(T_inv);
-          num_flux->T_inv_4(T_inv);
+          num_flux->Lambda(ws, eigenvalues);
+          num_flux->T_1(ws, T);
+          num_flux->T_2(ws, T);
+          num_flux->T_3(ws, T);
+          num_flux->T_4(ws, T);
+          num_flux->T_inv_1(ws, T_inv);
+          num_flux->T_inv_2(ws, T_inv);
+          num_flux->T_inv_3(ws, T_inv);
+          num_flux->T_inv_4(ws, T_inv);
 
           // "Prescribed" boundary state.
           w_B[0] = static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->rho_ext1;
@@ -3666,7 +3286,7 @@ protected:
 
           for(unsigned int ai = 0; ai < 4; ai++)
             for(unsigned int aj = 0; aj < 4; aj++)
-              alpha[ai] += T_inv[ai][aj] * num_flux->get_q()[aj];
+              alpha[ai] += T_inv[ai][aj] * ws.q[aj];
 
           for(unsigned int bi = 0; bi < 4; bi++)
             for(unsigned int bj = 0; bj < 4; bj++)
@@ -3751,40 +3371,28 @@ protected:
           w_L[2] = ext->fn[2]->val[i];
           w_L[3] = ext->fn[3]->val[i];
 
-          double e_1[4] = {1, 0, 0, 0};
-          double e_2[4] = {0, 1, 0, 0};
-          double e_3[4] = {0, 0, 1, 0};
-          double e_4[4] = {0, 0, 0, 1};
-
-          double P_plus_1[4];
-          double P_plus_2[4];
-          double P_plus_3[4];
-          double P_plus_4[4];
-
-          num_flux->P_plus(P_plus_1, w_L, e_1, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_2, w_L, e_2, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_3, w_L, e_3, e->nx[i], e->ny[i]);
-          num_flux->P_plus(P_plus_4, w_L, e_4, e->nx[i], e->ny[i]);
-
-          result_0_0 += wt[i] * P_plus_1[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_1 += wt[i] * P_plus_2[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_2 += wt[i] * P_plus_3[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_0_3 += wt[i] * P_plus_4[0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_1_0 += wt[i] * P_plus_1[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_1 += wt[i] * P_plus_2[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_2 += wt[i] * P_plus_3[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_1_3 += wt[i] * P_plus_4[1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_2_0 += wt[i] * P_plus_1[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_1 += wt[i] * P_plus_2[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_2 += wt[i] * P_plus_3[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_2_3 += wt[i] * P_plus_4[2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-
-          result_3_0 += wt[i] * P_plus_1[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_1 += wt[i] * P_plus_2[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_2 += wt[i] * P_plus_3[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
-          result_3_3 += wt[i] * P_plus_4[3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          double P_plus_cols[4][4];
+          num_flux->P_plus_columns(P_plus_cols, w_L, e->nx[i], e->ny[i]);
+
+          result_0_0 += wt[i] * P_plus_cols[0][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_1 += wt[i] * P_plus_cols[1][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_2 += wt[i] * P_plus_cols[2][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_0_3 += wt[i] * P_plus_cols[3][0] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_1_0 += wt[i] * P_plus_cols[0][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_1 += wt[i] * P_plus_cols[1][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_2 += wt[i] * P_plus_cols[2][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_1_3 += wt[i] * P_plus_cols[3][1] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_2_0 += wt[i] * P_plus_cols[0][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_1 += wt[i] * P_plus_cols[1][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_2 += wt[i] * P_plus_cols[2][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_2_3 += wt[i] * P_plus_cols[3][2] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+
+          result_3_0 += wt[i] * P_plus_cols[0][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_1 += wt[i] * P_plus_cols[1][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_2 += wt[i] * P_plus_cols[2][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
+          result_3_3 += wt[i] * P_plus_cols[3][3] * u->val[i] * v->val[i] * static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->get_tau();
         }
 
         result.push_back(result_0_0);
@@ -3843,7 +3451,8 @@ protected:
           w_L[3] = ext->fn[3]->val[i];
 
           // Transformation of the inner state to the local coordinates.
-          num_flux->Q(num_flux->get_q(), w_L, e->nx[i], e->ny[i]);
+          NumericalFluxWorkspace ws;
+          num_flux->Q(ws.q, w_L, e->nx[i], e->ny[i]);
 
           // Initialize the matrices.
           double T[4][4];
@@ -3861,15 +3470,15 @@ protected:
           }
 
           // Calculate Lambda^-.
-          num_flux->Lambda(eigenvalues);
-          num_flux->T_1(T);
-          num_flux->T_2(T);
-          num_flux->T_3(T);
-          num_flux->T_4(T);
-          num_flux->T_inv_1(T_inv);
-          num_flux->T_inv_2(T_inv);
-          num_flux->T_inv_3(T_inv);
-          num_flux->T_inv_4(T_inv);
+          num_flux->Lambda(ws, eigenvalues);
+          num_flux->T_1(ws, T);
+          num_flux->T_2(ws, T);
+          num_flux->T_3(ws, T);
+          num_flux->T_4(ws, T);
+          num_flux->T_inv_1(ws, T_inv);
+          num_flux->T_inv_2(ws, T_inv);
+          num_flux->T_inv_3(ws, T_inv);
+          num_flux->T_inv_4(ws, T_inv);
 
           // "Prescribed" boundary state.
           w_B[0] = static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->rho_ext2;
@@ -3883,7 +3492,7 @@ protected:
 
           for(unsigned int ai = 0; ai < 4; ai++)
             for(unsigned int aj = 0; aj < 4; aj++)
-              alpha[ai] += T_inv[ai][aj] * num_flux->get_q()[aj];
+              alpha[ai] += T_inv[ai][aj] * ws.q[aj];
 
           for(unsigned int bi = 0; bi < 4; bi++)
             for(unsigned int bj = 0; bj < 4; bj++)
@@ -4066,7 +3675,7 @@ protected:
       Geom<double> *e, ExtData<double> *ext, Hermes::vector<double>& result) const 
     {
       double result_i = 0.;
-      if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->discreteIndicator[e->id]) 
+      if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->stabilization_indicator->is_discontinuous(e->id)) 
         result_i = int_grad_u_grad_v<double, double>(n, wt, u, v) * nu_1 * e->diam;
       result.push_back(result_i);
       result.push_back(result_i);
@@ -4076,7 +3685,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
       ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(u->val[0] * v->val[0]);
     }
   private:
     double nu_1;
@@ -4094,7 +3703,7 @@ protected:
       Hermes::vector<double>& result) const {
         double result_i = 0;
 
-        if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->discreteIndicator[e->id] && static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->discreteIndicator[e->get_neighbor_id()])
+        if(static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->stabilization_indicator->is_discontinuous(e->id) && static_cast<EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows*>(wf)->stabilization_indicator->is_discontinuous(e->get_neighbor_id()))
           for (int i = 0;i < n;i++)
             result_i += wt[i] * (u->get_val_central(i) - u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i)) * nu_2;
 
@@ -4121,7 +3730,7 @@ protected:
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, 
       Geom<Ord> *e, ExtData<Ord> *ext) const {
-        return Ord(24);
+        return EulerFormsOrder::exact(u->get_val_central(0) * v->get_val_central(0) + u->get_val_neighbor(0) * v->get_val_neighbor(0));
     }
 
     double nu_2;
@@ -4142,7 +3751,7 @@ protected:
 
   double tau;
   EulerFluxes* euler_fluxes;
-  bool* discreteIndicator;
+  StabilizationIndicator* stabilization_indicator;
 };
 
 class EulerEquationsWeakFormExplicitCoupled : public EulerEquationsWeakFormExplicitMultiComponent
@@ -4280,6 +3889,90 @@ protected:
   };
 };
 
+// The concentration forms of EulerEquationsWeakFormSemiImplicitCoupled and ConcentrationWeakFormSemiImplicit,
+// the time step is taken from the weak form WeakFormType (its get_tau()).
+template<typename WeakFormType>
+class MatrixFormConcentrationAdvectionDiffusion : public MatrixFormVol<double>
+{
+public:
+  MatrixFormConcentrationAdvectionDiffusion(int i, int j, double epsilon) 
+    : MatrixFormVol<double>(i, j), epsilon(epsilon) {}
+
+  template<typename Real, typename Scalar>
+  Scalar matrix_form(int n, double *wt, Func<Scalar> *u_ext[], Func<Real> *u, Func<Real> *v, Geom<Real> *e, ExtData<Scalar> *ext) const {
+    Scalar result = Scalar(0);
+    Real h_e = e->diam;
+    Real s_c = Real(0.9);
+
+    Func<Real>* density = ext->fn[0];
+    Func<Real>* density_vel_x = ext->fn[1];
+    Func<Real>* density_vel_y = ext->fn[2];
+
+    for (int i=0; i < n; i++) {
+      Scalar v_1 = density_vel_x->val[i] / density->val[i];
+      Scalar v_2 = density_vel_y->val[i] / density->val[i];
+
+      result += wt[i] * (epsilon * (u->dx[i]*v->dx[i] + u->dy[i]*v->dy[i])
+        - (v_1 * u->val[i] * v->dx[i] + v_2 * u->val[i] * v->dy[i]));
+
+      Real R_squared = Hermes::pow(v_1 * u->dx[i] + v_2 * u->dy[i], 2.);
+      Real R = Hermes::sqrt(R_squared); //This just does fabs(b1 * u->dx[i] + b2 * u->dy[i]); but it can be parsed
+      result += wt[i] * s_c * 0.5 * h_e * R * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]) / (Hermes::sqrt(Hermes::pow(u->dx[i], 2) + Hermes::pow(u->dy[i], 2)) + 1.e-8);
+
+      Scalar b_norm = Hermes::sqrt(v_1 * v_1 + v_2 * v_2);
+      Real tau = 1. / Hermes::sqrt( 9 * Hermes::pow(4 * epsilon / Hermes::pow(h_e, 2), 2) + Hermes::pow(2 * b_norm / h_e, 2));
+      result += wt[i] * tau * (-v_1 * v->dx[i] - v_2 * v->dy[i] + epsilon * v->laplace[i]) * (-v_1 * u->dx[i] - v_2 * u->dy[i] + epsilon * u->laplace[i]);
+    }
+    return result * static_cast<WeakFormType*>(wf)->get_tau();
+  }
+
+  double value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, 
+    Geom<double> *e, ExtData<double> *ext) const {
+      return matrix_form<double, double>(n, wt, u_ext, u, v, e, ext);
+  }
+
+  Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
+    ExtData<Ord> *ext) const {
+      return matrix_form<Ord, Ord>(n, wt, u_ext, u, v, e, ext);
+  }
+
+  // Member.
+  double epsilon;
+};
+
+template<typename WeakFormType>
+class MatrixFormConcentrationNatural : public MatrixFormSurf<double>
+{
+public:
+  MatrixFormConcentrationNatural(int i, int j, std::string marker) 
+    : MatrixFormSurf<double>(i, j, marker) {}
+
+  template<typename Real, typename Scalar>
+  Scalar matrix_form(int n, double *wt, Func<Scalar> *u_ext[], Func<Real> *u, Func<Real> *v, 
+    Geom<Real> *e, ExtData<Scalar> *ext) const {
+      Func<Real>* density = ext->fn[0];
+      Func<Real>* density_vel_x = ext->fn[1];
+      Func<Real>* density_vel_y = ext->fn[2];
+
+      Scalar result = Scalar(0);
+      for (int i = 0;i < n;i++)
+        result += wt[i] * v->val[i] * u->val[i]
+      * (density_vel_x->val[i] * e->nx[i] + density_vel_y->val[i] * e->ny[i])
+        / density->val[i];
+      return result * static_cast<WeakFormType*>(wf)->get_tau();
+  }
+
+  double value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, 
+    Geom<double> *e, ExtData<double> *ext) const {
+      return matrix_form<double, double>(n, wt, u_ext, u, v, e, ext);
+  }
+
+  Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
+    ExtData<Ord> *ext) const {
+      return matrix_form<Ord, Ord>(n, wt, u_ext, u, v, e, ext);
+  }
+};
+
 class EulerEquationsWeakFormSemiImplicitCoupled : public EulerEquationsWeakFormSemiImplicitMultiComponent
 {
 public:
@@ -4299,7 +3992,7 @@ public:
 
       add_matrix_form(new EulerEquationsWeakFormExplicit::EulerEquationsBilinearFormTime(4));
 
-      add_matrix_form(new MatrixFormConcentrationAdvectionDiffusion(4, 4, epsilon));
+      add_matrix_form(new MatrixFormConcentrationAdvectionDiffusion<EulerEquationsWeakFormSemiImplicitCoupled>(4, 4, epsilon));
       mfvol.back()->ext.push_back(prev_density);
       mfvol.back()->ext.push_back(prev_density_vel_x);
       mfvol.back()->ext.push_back(prev_density_vel_y);
@@ -4314,7 +4007,7 @@ public:
       */
 
       for(unsigned int i = 0;i < natural_bc_concentration_markers.size();i++) {
-        add_matrix_form_surf(new MatrixFormConcentrationNatural(4, 4, natural_bc_concentration_markers[i]));
+        add_matrix_form_surf(new MatrixFormConcentrationNatural<EulerEquationsWeakFormSemiImplicitCoupled>(4, 4, natural_bc_concentration_markers[i]));
         mfsurf.back()->ext.push_back(prev_density);
         mfsurf.back()->ext.push_back(prev_density_vel_x);
         mfsurf.back()->ext.push_back(prev_density_vel_y);
@@ -4340,89 +4033,53 @@ public:
 
   // Destructor.
   ~EulerEquationsWeakFormSemiImplicitCoupled() {};
-protected:
-
-  class MatrixFormConcentrationAdvectionDiffusion : public MatrixFormVol<double>
-  {
-  public:
-    MatrixFormConcentrationAdvectionDiffusion(int i, int j, double epsilon) 
-      : MatrixFormVol<double>(i, j), epsilon(epsilon) {}
-
-    template<typename Real, typename Scalar>
-    Scalar matrix_form(int n, double *wt, Func<Scalar> *u_ext[], Func<Real> *u, Func<Real> *v, Geom<Real> *e, ExtData<Scalar> *ext) const {
-      Scalar result = Scalar(0);
-      Real h_e = e->diam;
-      Real s_c = Real(0.9);
-
-      Func<Real>* density_prev = ext->fn[0];
-      Func<Real>* density_vel_x_prev = ext->fn[1];
-      Func<Real>* density_vel_y_prev = ext->fn[2];
-
-      for (int i=0; i < n; i++) {
-        Scalar v_1 = density_vel_x_prev->val[i] / density_prev->val[i];
-        Scalar v_2 = density_vel_y_prev->val[i] / density_prev->val[i];
+};
 
+// The concentration part of EulerEquationsWeakFormSemiImplicitCoupled alone, for the multirate coupling:
+// the flow (density, momentum, energy) the concentration is advected by is given as external solutions
+// (the flow interpolated in time), the concentration has its own time step.
+class ConcentrationWeakFormSemiImplicit : public WeakForm<double>
+{
+public:
+  // Constructor.
+  ConcentrationWeakFormSemiImplicit(Hermes::vector<std::string> natural_bc_concentration_markers,
+    Solution<double>* density, Solution<double>* density_vel_x,
+    Solution<double>* density_vel_y, Solution<double>* energy,
+    Solution<double>* prev_concentration, double epsilon)
+    : WeakForm<double>(1), tau(0.0) {
 
-        result += wt[i] * (epsilon * (u->dx[i]*v->dx[i] + u->dy[i]*v->dy[i])
-          - (v_1 * u->val[i] * v->dx[i] + v_2 * u->val[i] * v->dy[i]));
+      add_matrix_form(new EulerEquationsWeakFormExplicit::EulerEquationsBilinearFormTime(0));
 
-        Real R_squared = Hermes::pow(v_1 * u->dx[i] + v_2 * u->dy[i], 2.);
-        Real R = Hermes::sqrt(R_squared); //This just does fabs(b1 * u->dx[i] + b2 * u->dy[i]); but it can be parsed
-        result += wt[i] * s_c * 0.5 * h_e * R * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]) / (Hermes::sqrt(Hermes::pow(u->dx[i], 2) + Hermes::pow(u->dy[i], 2)) + 1.e-8);
+      add_matrix_form(new MatrixFormConcentrationAdvectionDiffusion<ConcentrationWeakFormSemiImplicit>(0, 0, epsilon));
+      mfvol.back()->ext.push_back(density);
+      mfvol.back()->ext.push_back(density_vel_x);
+      mfvol.back()->ext.push_back(density_vel_y);
+      mfvol.back()->ext.push_back(energy);
 
-        Scalar b_norm = Hermes::sqrt(v_1 * v_1 + v_2 * v_2);
-        Real tau = 1. / Hermes::sqrt( 9 * Hermes::pow(4 * epsilon / Hermes::pow(h_e, 2), 2) + Hermes::pow(2 * b_norm / h_e, 2));
-        result += wt[i] * tau * (-v_1 * v->dx[i] - v_2 * v->dy[i] + epsilon * v->laplace[i]) * (-v_1 * u->dx[i] - v_2 * u->dy[i] + epsilon * u->laplace[i]);
+      for(unsigned int i = 0;i < natural_bc_concentration_markers.size();i++) {
+        add_matrix_form_surf(new MatrixFormConcentrationNatural<ConcentrationWeakFormSemiImplicit>(0, 0, natural_bc_concentration_markers[i]));
+        mfsurf.back()->ext.push_back(density);
+        mfsurf.back()->ext.push_back(density_vel_x);
+        mfsurf.back()->ext.push_back(density_vel_y);
+        mfsurf.back()->ext.push_back(energy);
       }
-      return result * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
-    }
-
-    double value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, 
-      Geom<double> *e, ExtData<double> *ext) const {
-        return matrix_form<double, double>(n, wt, u_ext, u, v, e, ext);
-    }
-
-    Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
-      ExtData<Ord> *ext) const {
-        return matrix_form<Ord, Ord>(n, wt, u_ext, u, v, e, ext);
-    }
 
-    // Member.
-    double epsilon;
+      EulerEquationsWeakFormExplicit::EulerEquationsLinearFormTime* vector_form_time = new EulerEquationsWeakFormExplicit::EulerEquationsLinearFormTime(0);
+      vector_form_time->ext.push_back(prev_concentration);
+      add_vector_form(vector_form_time);
   };
 
-  class MatrixFormConcentrationNatural : public MatrixFormSurf<double>
-  {
-  public:
-    MatrixFormConcentrationNatural(int i, int j, std::string marker) 
-      : MatrixFormSurf<double>(i, j, marker) {}
-
-    template<typename Real, typename Scalar>
-    Scalar matrix_form(int n, double *wt, Func<Scalar> *u_ext[], Func<Real> *u, Func<Real> *v, 
-      Geom<Real> *e, ExtData<Scalar> *ext) const {
-        Func<Real>* density_prev = ext->fn[0];
-        Func<Real>* density_vel_x_prev = ext->fn[1];
-        Func<Real>* density_vel_y_prev = ext->fn[2];
-
-        Scalar result = Scalar(0);
-        for (int i = 0;i < n;i++)
-          result += wt[i] * v->val[i] * u->val[i]
-        * (density_vel_x_prev->val[i] * e->nx[i] + density_vel_y_prev->val[i] * e->ny[i])
-          / density_prev->val[i];
-        // (OR: for inlet/outlet) result += wt[i] * v->val[i] * concentration_prev->val[i] 
-        //      * (V1_EXT * e->nx[i] + V2_EXT * e->ny[i]);
-        return result * static_cast<EulerEquationsWeakFormExplicit*>(wf)->get_tau();
-
-    }
+  void set_time_step(double tau) {
+    this->tau = tau;
+  }
 
-    double value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, 
-      Geom<double> *e, ExtData<double> *ext) const {
-        return matrix_form<double, double>(n, wt, u_ext, u, v, e, ext);
-    }
+  double get_tau() const {
+    return tau;
+  }
 
-    Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, Geom<Ord> *e, 
-      ExtData<Ord> *ext) const {
-        return matrix_form<Ord, Ord>(n, wt, u_ext, u, v, e, ext);
-    }
-  };
+  // Destructor.
+  ~ConcentrationWeakFormSemiImplicit() {};
+protected:
+  // Member.
+  double tau;
 };
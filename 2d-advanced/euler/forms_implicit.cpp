@@ -541,7 +541,7 @@ public:
     std::string inlet_marker, std::string outlet_marker, 
     Solution<double>* prev_density, Solution<double>* prev_density_vel_x, Solution<double>* prev_density_vel_y, 
     Solution<double>* prev_energy, bool preconditioning, bool fvm_only = false, int num_of_equations = 4) :
-  WeakForm<double>(num_of_equations, true), rho_ext(rho_ext), v1_ext(v1_ext), v2_ext(v2_ext), 
+  WeakForm<double>(num_of_equations, !preconditioning), rho_ext(rho_ext), v1_ext(v1_ext), v2_ext(v2_ext), 
     pressure_ext(pressure_ext), energy_ext(QuantityCalculator::calc_energy(rho_ext, 
     rho_ext * v1_ext, rho_ext * v2_ext, pressure_ext, kappa)), euler_fluxes(new EulerFluxes(kappa))
   {
@@ -575,16 +575,14 @@ public:
     vector_coordinates.push_back(2);
     vector_coordinates.push_back(3);
 
+    // The preconditioning matrix approximates the negative Jacobian of the residual: the mass matrix,
+    // the flux Jacobians in the volume, and their Steger-Warming splitting on the inner edges.
     if(preconditioning)
-    {      /*
-           EulerEquationsMatrixFormVol<double>Preconditioning* precon_vol 
-           = new EulerEquationsMatrixFormVol<double>Preconditioning(matrix_coordinates_precon_vol, kappa);
-           EulerEquationsMatrixFormSurf<double>Preconditioning* precon_surf 
-           = new EulerEquationsMatrixFormSurf<double>Preconditioning(matrix_coordinates, kappa);
-           add_multicomponent_matrix_form(precon_vol);
-           add_multicomponent_matrix_form_surf(precon_surf);
-           */
+    {
       add_multicomponent_matrix_form(new EulerEquationsMatrixFormVolPreconditioningSimple(matrix_coordinates));
+      if(!fvm_only)
+        add_multicomponent_matrix_form(new EulerEquationsMatrixFormVolPreconditioning(matrix_coordinates_precon_vol, kappa));
+      add_multicomponent_matrix_form_surf(new EulerEquationsMatrixFormSurfPreconditioning(matrix_coordinates_precon_vol, kappa));
     }
 
     add_multicomponent_vector_form(new EulerEquationsLinearFormTime(vector_coordinates));
@@ -635,6 +633,7 @@ protected:
       unsigned int> >coordinates, double kappa) 
       : MultiComponentMatrixFormVol<double>(coordinates), kappa(kappa) {}
 
+    // The derivative of the volume term of the residual is subtracted (the matrix approximates -dF/dw).
     void value(int n, double *wt, Func<double> *u_ext[], Func<double> *u, Func<double> *v, Geom<double> *e, 
       ExtData<double> *ext, Hermes::vector<double>& result) const
     {
@@ -759,25 +758,25 @@ protected:
         * (static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_3<double>(u_ext[0]->val[i], u_ext[1]->val[i], u_ext[2]->val[i], 0) 
           * v->dy[i];
       }
-      result.push_back(result_0_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_0_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_0_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_0_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-
-      result.push_back(result_1_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_1_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_1_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_1_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-
-      result.push_back(result_2_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_2_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_2_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_2_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-
-      result.push_back(result_3_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_3_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_3_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
-      result.push_back(result_3_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_0_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_0_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_0_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_0_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+
+      result.push_back(-result_1_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_1_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_1_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_1_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+
+      result.push_back(-result_2_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_2_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_2_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_2_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+
+      result.push_back(-result_3_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_3_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_3_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(-result_3_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v, 
@@ -839,60 +838,46 @@ protected:
         w_L[3] = u_ext[3]->get_val_central(i);
         w_R[3] = u_ext[3]->get_val_neighbor(i);
 
-        double P_plus_1[4] = {1, 0, 0, 0};
-        double P_plus_2[4] = {0, 1, 0, 0};
-        double P_plus_3[4] = {0, 0, 1, 0};
-        double P_plus_4[4] = {0, 0, 0, 1};
-
-        double P_minus_1[4] = {1, 0, 0, 0};
-        double P_minus_2[4] = {0, 1, 0, 0};
-        double P_minus_3[4] = {0, 0, 1, 0};
-        double P_minus_4[4] = {0, 0, 0, 1};
-
-        num_flux->P_plus(P_plus_1, w_L, P_plus_1, e->nx[i], e->ny[i]);
-        num_flux->P_plus(P_plus_2, w_L, P_plus_2, e->nx[i], e->ny[i]);
-        num_flux->P_plus(P_plus_3, w_L, P_plus_3, e->nx[i], e->ny[i]);
-        num_flux->P_plus(P_plus_4, w_L, P_plus_4, e->nx[i], e->ny[i]);
+        double P_plus_cols[4][4];
+        num_flux->P_plus_columns(P_plus_cols, w_L, e->nx[i], e->ny[i]);
 
-        num_flux->P_minus(P_minus_1, w_R, P_minus_1, e->nx[i], e->ny[i]);
-        num_flux->P_minus(P_minus_2, w_R, P_minus_2, e->nx[i], e->ny[i]);
-        num_flux->P_minus(P_minus_3, w_R, P_minus_3, e->nx[i], e->ny[i]);
-        num_flux->P_minus(P_minus_4, w_R, P_minus_4, e->nx[i], e->ny[i]);
+        double P_minus_cols[4][4];
+        num_flux->P_minus_columns(P_minus_cols, w_R, e->nx[i], e->ny[i]);
 
-        result_0_0 += wt[i] * (P_plus_1[0] * u->get_val_central(i) + P_minus_1[0] 
+        result_0_0 += wt[i] * (P_plus_cols[0][0] * u->get_val_central(i) + P_minus_cols[0][0] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_0_1 += wt[i] * (P_plus_1[1] * u->get_val_central(i) + P_minus_1[1] 
+        result_0_1 += wt[i] * (P_plus_cols[0][1] * u->get_val_central(i) + P_minus_cols[0][1] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_0_2 += wt[i] * (P_plus_1[2] * u->get_val_central(i) + P_minus_1[2] 
+        result_0_2 += wt[i] * (P_plus_cols[0][2] * u->get_val_central(i) + P_minus_cols[0][2] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_0_3 += wt[i] * (P_plus_1[3] * u->get_val_central(i) + P_minus_1[3] 
+        result_0_3 += wt[i] * (P_plus_cols[0][3] * u->get_val_central(i) + P_minus_cols[0][3] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
 
-        result_1_0 += wt[i] * (P_plus_2[0] * u->get_val_central(i) + P_minus_2[0] 
+        result_1_0 += wt[i] * (P_plus_cols[1][0] * u->get_val_central(i) + P_minus_cols[1][0] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_1_1 += wt[i] * (P_plus_2[1] * u->get_val_central(i) + P_minus_2[1] 
+        result_1_1 += wt[i] * (P_plus_cols[1][1] * u->get_val_central(i) + P_minus_cols[1][1] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_1_2 += wt[i] * (P_plus_2[2] * u->get_val_central(i) + P_minus_2[2] 
+        result_1_2 += wt[i] * (P_plus_cols[1][2] * u->get_val_central(i) + P_minus_cols[1][2] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_1_3 += wt[i] * (P_plus_2[3] * u->get_val_central(i) + P_minus_2[3] 
+        result_1_3 += wt[i] * (P_plus_cols[1][3] * u->get_val_central(i) + P_minus_cols[1][3] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
 
-        result_2_0 += wt[i] * (P_plus_3[0] * u->get_val_central(i) + P_minus_3[0] 
+        result_2_0 += wt[i] * (P_plus_cols[2][0] * u->get_val_central(i) + P_minus_cols[2][0] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_2_1 += wt[i] * (P_plus_3[1] * u->get_val_central(i) + P_minus_3[1] 
+        result_2_1 += wt[i] * (P_plus_cols[2][1] * u->get_val_central(i) + P_minus_cols[2][1] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_2_2 += wt[i] * (P_plus_3[2] * u->get_val_central(i) + P_minus_3[2] 
+        result_2_2 += wt[i] * (P_plus_cols[2][2] * u->get_val_central(i) + P_minus_cols[2][2] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_2_3 += wt[i] * (P_plus_3[3] * u->get_val_central(i) + P_minus_3[3] 
+        result_2_3 += wt[i] * (P_plus_cols[2][3] * u->get_val_central(i) + P_minus_cols[2][3] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
 
-        result_3_0 += wt[i] * (P_plus_4[0] * u->get_val_central(i) + P_minus_4[0] 
+        result_3_0 += wt[i] * (P_plus_cols[3][0] * u->get_val_central(i) + P_minus_cols[3][0] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_3_1 += wt[i] * (P_plus_4[1] * u->get_val_central(i) + P_minus_4[1] 
+        result_3_1 += wt[i] * (P_plus_cols[3][1] * u->get_val_central(i) + P_minus_cols[3][1] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_3_2 += wt[i] * (P_plus_4[2] * u->get_val_central(i) + P_minus_4[2] 
+        result_3_2 += wt[i] * (P_plus_cols[3][2] * u->get_val_central(i) + P_minus_cols[3][2] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
-        result_3_3 += wt[i] * (P_plus_4[3] * u->get_val_central(i) + P_minus_4[3] 
+        result_3_3 += wt[i] * (P_plus_cols[3][3] * u->get_val_central(i) + P_minus_cols[3][3] 
         * u->get_val_neighbor(i)) * (v->get_val_central(i) - v->get_val_neighbor(i));
       }
 
@@ -1071,10 +1056,10 @@ protected:
         * (static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf))->euler_fluxes->A_2_3_3<double>(u_ext[0]->val[i], u_ext[1]->val[i], u_ext[2]->val[i], 0) 
           * v->dy[i];
       }
-      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
+      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const
@@ -1192,10 +1177,10 @@ protected:
         result_2 -= wt[i] * v->val[i] * flux[2];
         result_3 -= wt[i] * v->val[i] * flux[3];
       }
-      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
+      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const
@@ -1236,10 +1221,10 @@ protected:
         result_2 -= wt[i] * v->val[i] * flux[2];
         result_3 -= wt[i] * v->val[i] * flux[3];
       }
-      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
+      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const
@@ -1289,10 +1274,10 @@ protected:
         result_2 -= wt[i] * v->val[i] * flux[2];
         result_3 -= wt[i] * v->val[i] * flux[3];
       }
-      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
+      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const
@@ -1334,10 +1319,10 @@ protected:
         result_3 -= wt[i] * v->val[i] * flux[3];
       }
 
-      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
-      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicit*>(wf)->get_tau());
+      result.push_back(result_0 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_1 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_2 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
+      result.push_back(result_3 * static_cast<EulerEquationsWeakFormImplicitMultiComponent*>(wf)->get_tau());
     }
 
     Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v, Geom<Ord> *e, ExtData<Ord> *ext) const
@@ -34,6 +34,8 @@ double DISCONTINUITY_DETECTOR_PARAM = 1.0;
 
 // For saving/loading of solution.
 bool REUSE_SOLUTION = true;
+// Compression of the saved solution (needs the build WITH_ZLIB).
+const bool COMPRESS_SAVED_SOLUTION = false;
 
 // Initial polynomial degree.     
 const int P_INIT = 0;                                              
@@ -175,6 +177,7 @@ int main(int argc, char* argv[])
   MachNumberFilter Mach_number(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   PressureFilter pressure(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   EntropyFilter entropy(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_EXT, P_EXT);
+  EulerVTUExport vtu_export(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_EXT, P_EXT);
 
   ScalarView pressure_view("Pressure", new WinGeom(0, 0, 600, 300));
   ScalarView Mach_number_view("Mach number", new WinGeom(700, 0, 600, 300));
@@ -184,21 +187,34 @@ int main(int argc, char* argv[])
   L2ProjBasedSelector<double> selector(CAND_LIST, CONV_EXP, MAX_P_ORDER);
   selector.set_error_weights(1.0, 1.0, 1.0);
 
+  // Reference spaces of the adaptivity.
+  ReferenceSpaceManager ref_space_manager(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
+
+  // Transfer of the previous time level solution onto the reference spaces (element by element).
+  L2Transfer l2_transfer(matrix_solver);
+
   // Set up CFL calculation class.
   CFLCalculation CFL(CFL_NUMBER, KAPPA);
 
   // Look for a saved solution on the disk.
   Continuity<double> continuity(Continuity<double>::onlyTime);
+  BinaryCheckpoint checkpoint(COMPRESS_SAVED_SOLUTION);
+  char checkpoint_filename[40];
   int iteration = 0; double t = 0;
   bool loaded_now = false;
 
+  // Elements limited to the linear (1) and constant (0) functions in the time steps, appended to when restarted.
+  ShockIndicatorLog shock_indicator_log("shock_indicators.sil", REUSE_SOLUTION && continuity.have_record_available());
+
   if(REUSE_SOLUTION && continuity.have_record_available())
   {
     continuity.get_last_record()->load_mesh(&mesh);
     continuity.get_last_record()->load_spaces(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
       &space_rho_v_y, &space_e), Hermes::vector<SpaceType>(HERMES_L2_SPACE, HERMES_L2_SPACE, HERMES_L2_SPACE, HERMES_L2_SPACE), Hermes::vector<Mesh *>(&mesh, &mesh, 
       &mesh, &mesh));
-    continuity.get_last_record()->load_time_step_length(time_step);
+    sprintf(checkpoint_filename, "Checkpoint-%i.hcp", continuity.get_num());
+    checkpoint.open(checkpoint_filename);
+    time_step = checkpoint.get_record_time_step();
     t = continuity.get_last_record()->get_time() + time_step;
     iteration = (continuity.get_num() - 1) * EVERY_NTH_STEP + 1;
     loaded_now = true;
@@ -235,11 +251,8 @@ int main(int argc, char* argv[])
     {
       info("---- Adaptivity step %d:", as);
 
-      // Construct globally refined reference mesh and setup reference space.
-      int order_increase = 1;
-
-      Hermes::vector<Space<double> *>* ref_spaces = Space<double>::construct_refined_spaces(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-        &space_rho_v_y, &space_e), order_increase);
+      // Globally refined reference mesh and reference spaces (rebuilt only if the coarse ones changed).
+      Hermes::vector<Space<double> *>* ref_spaces = ref_space_manager.get_ref_spaces();
 
       if(ndofs_prev != 0)
         if(Space<double>::get_num_dofs(*ref_spaces) == ndofs_prev)
@@ -255,34 +268,23 @@ int main(int argc, char* argv[])
       {
         loaded_now = false;
 
-        continuity.get_last_record()->load_solutions(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), 
-          Hermes::vector<Space<double> *>((*ref_spaces)[0], (*ref_spaces)[1], (*ref_spaces)[2], (*ref_spaces)[3]));
+        if(!checkpoint.load(*ref_spaces, Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), matrix_solver))
+          info("The saved solution was projected onto the reference spaces.");
+        checkpoint.close();
       }
       else
       {
-        OGProjection<double>::project_global(*ref_spaces, Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), 
-            Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), matrix_solver, Hermes::vector<Hermes::Hermes2D::ProjNormType>());
-        if(iteration > std::max((int)(continuity.get_num() * EVERY_NTH_STEP + 2), 1) && as > 1)
-        {
-          delete rsln_rho.get_mesh();
-          delete rsln_rho.get_space();
-          rsln_rho.own_mesh = false;
-          delete rsln_rho_v_x.get_mesh();
-          delete rsln_rho_v_x.get_space();
-          rsln_rho_v_x.own_mesh = false;
-          delete rsln_rho_v_y.get_mesh();
-          delete rsln_rho_v_y.get_space();
-          rsln_rho_v_y.own_mesh = false;
-          delete rsln_e.get_mesh();
-          delete rsln_e.get_space();
-          rsln_e.own_mesh = false;
-        }
+        l2_transfer.transfer(*ref_spaces, Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), 
+            Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+        info("%d elements copied, %d projected in %g s.", l2_transfer.get_copied_elements(), l2_transfer.get_projected_elements(), 
+          l2_transfer.get_last_time());
       }
 
       // Report NDOFs.
-      info("ndof_coarse: %d, ndof_fine: %d.", 
+      info("ndof_coarse: %d, ndof_fine: %d (reference spaces %s in %g s).", 
         Space<double>::get_num_dofs(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-        &space_rho_v_y, &space_e)), Space<double>::get_num_dofs(*ref_spaces));
+        &space_rho_v_y, &space_e)), Space<double>::get_num_dofs(*ref_spaces), 
+        ref_space_manager.get_last_reused() ? "reused" : "built", ref_space_manager.get_last_time());
 
       // Assemble the reference problem.
       info("Solving on reference mesh.");
@@ -311,26 +313,12 @@ int main(int argc, char* argv[])
           flux_limiter.limit_second_orders_according_to_detector(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
             &space_rho_v_y, &space_e));
 
-          std::stringstream ss;
-          ss << "discontinuous_limit_to_1_" << iteration << ".h2d";
-          std::ofstream out(ss.str().c_str());
-          for(std::set<int>::iterator it = static_cast<KuzminDiscontinuityDetector*>(flux_limiter.detector)->second_order_discontinuous_element_ids.begin(); it != static_cast<KuzminDiscontinuityDetector*>(flux_limiter.detector)->second_order_discontinuous_element_ids.end(); it++) 
-            out << *it << std::endl;
-          out.close();
+          shock_indicator_log.add(iteration, 1, static_cast<KuzminDiscontinuityDetector*>(flux_limiter.detector)->second_order_discontinuous_element_ids);
 
           flux_limiter.limit_according_to_detector(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
             &space_rho_v_y, &space_e));
           
-          ss.clear();
-          ss << "discontinuous_limit_to_0_" << iteration << ".h2d";
-          std::ofstream out_1(ss.str().c_str());
-          for(std::set<int>::iterator it = flux_limiter.detector->get_discontinuous_element_ids().begin(); it != flux_limiter.detector->get_discontinuous_element_ids().end(); it++) 
-            out_1 << *it << std::endl;
-          out_1.close();
-
-          flux_limiter.detector->get_discontinuous_element_ids();
-
-          
+          shock_indicator_log.add(iteration, 0, flux_limiter.detector->get_discontinuous_element_ids());
 
           flux_limiter.get_limited_solutions(Hermes::vector<Solution<double>*>(&rsln_rho, &rsln_rho_v_x, &rsln_rho_v_y, &rsln_e));
         }
@@ -394,17 +382,9 @@ int main(int argc, char* argv[])
         // Output solution in VTK format.
         if(VTK_VISUALIZATION)
         {
-          pressure.reinit();
-          Mach_number.reinit();
-          entropy.reinit();
-          Linearizer lin;
           char filename[40];
-          sprintf(filename, "Pressure-%i.vtk", iteration - 1);
-          lin.save_solution_vtk(&pressure, filename, "Pressure", false);
-          sprintf(filename, "Mach number-%i.vtk", iteration - 1);
-          lin.save_solution_vtk(&Mach_number, filename, "MachNumber", false);
-          sprintf(filename, "Entropy-%i.vtk", iteration - 1);
-          lin.save_solution_vtk(&entropy, filename, "Entropy", false);
+          sprintf(filename, "Flow-%i.vtu", iteration - 1);
+          vtu_export.save(filename);
         }
         // Save a current state on the disk.
         if(iteration > 1)
@@ -413,11 +393,17 @@ int main(int argc, char* argv[])
           continuity.get_last_record()->save_mesh(&mesh);
           continuity.get_last_record()->save_spaces(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
             &space_rho_v_y, &space_e));
-          continuity.get_last_record()->save_solutions(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
-          continuity.get_last_record()->save_time_step_length(time_step);
+          // The reference solution of this step (the previous time level solution of the next one), written in the background.
+          sprintf(checkpoint_filename, "Checkpoint-%i.hcp", continuity.get_num());
+          checkpoint.save(checkpoint_filename, t, time_step, *ref_spaces, solver->get_sln_vector());
         }
       }
 
+      // The (limited) reference solution becomes the previous time level one below.
+      if(done)
+        l2_transfer.set_coefficients(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), 
+          *ref_spaces, solver->get_sln_vector());
+
       // Clean up.
       delete solver;
       delete matrix;
@@ -431,19 +417,6 @@ int main(int argc, char* argv[])
     prev_rho_v_x.copy(&rsln_rho_v_x);
     prev_rho_v_y.copy(&rsln_rho_v_y);
     prev_e.copy(&rsln_e);
-
-    delete rsln_rho.get_mesh();
-    delete rsln_rho.get_space();
-    rsln_rho.own_mesh = false;
-    delete rsln_rho_v_x.get_mesh();
-    delete rsln_rho_v_x.get_space();
-    rsln_rho_v_x.own_mesh = false;
-    delete rsln_rho_v_y.get_mesh();
-    delete rsln_rho_v_y.get_space();
-    rsln_rho_v_y.own_mesh = false;
-    delete rsln_e.get_mesh();
-    delete rsln_e.get_space();
-    rsln_e.own_mesh = false;
   }
 
   pressure_view.close();
@@ -179,6 +179,7 @@ int main(int argc, char* argv[])
   MachNumberFilter Mach_number(Hermes::vector<MeshFunction<double>*>(rsln_rho, rsln_rho_v_x, rsln_rho_v_y, rsln_e), KAPPA);
   PressureFilter pressure(Hermes::vector<MeshFunction<double>*>(rsln_rho, rsln_rho_v_x, rsln_rho_v_y, rsln_e), KAPPA);
   EntropyFilter entropy(Hermes::vector<MeshFunction<double>*>(rsln_rho, rsln_rho_v_x, rsln_rho_v_y, rsln_e), KAPPA, RHO_EXT, P_EXT);
+  EulerVTUExport vtu_export(Hermes::vector<Solution<double>*>(rsln_rho, rsln_rho_v_x, rsln_rho_v_y, rsln_e), KAPPA, RHO_EXT, P_EXT);
 
   // Numerical flux.
   VijayasundaramNumericalFlux num_flux(KAPPA);
@@ -195,6 +196,13 @@ int main(int argc, char* argv[])
   L2ProjBasedSelector<double> selector(CAND_LIST, CONV_EXP, MAX_P_ORDER);
   selector.set_error_weights(1.0, 1.0, 1.0);
 
+  // Reference spaces of the adaptivity.
+  ReferenceSpaceManager ref_space_manager(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), 
+    CAND_LIST == H2D_HP_ANISO ? 1 : 0);
+
+  // Transfer of the previous time level solutions onto the reference spaces (element by element).
+  L2Transfer l2_transfer(matrix_solver), l2_transfer2(matrix_solver);
+
   // Set up CFL calculation class.
   CFLCalculation CFL(CFL_NUMBER, KAPPA);
 
@@ -244,13 +252,8 @@ int main(int argc, char* argv[])
     {
       info("---- Adaptivity step %d:", as);
 
-      // Construct globally refined reference mesh and setup reference space.
-      int order_increase = CAND_LIST == H2D_HP_ANISO ? 1 : 0;
-
-      Hermes::vector<Space<double> *>* ref_spaces = Space<double>::construct_refined_spaces(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-        &space_rho_v_y, &space_e), order_increase);
-
-      L2Space<double> refspace_stabilization((*ref_spaces)[0]->get_mesh(), 0);
+      // Globally refined reference mesh and reference spaces (rebuilt only if the coarse ones changed).
+      Hermes::vector<Space<double> *>* ref_spaces = ref_space_manager.get_ref_spaces();
 
       if(ndofs_prev != 0)
         if(Space<double>::get_num_dofs(*ref_spaces) == ndofs_prev)
@@ -293,8 +296,10 @@ int main(int argc, char* argv[])
       }
       else
       {
-        OGProjection<double>::project_global(*ref_spaces, Hermes::vector<Solution<double>*>(prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e), 
-          Hermes::vector<Solution<double>*>(prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e), matrix_solver, Hermes::vector<Hermes::Hermes2D::ProjNormType>(), iteration > 1);
+        l2_transfer.transfer(*ref_spaces, Hermes::vector<Solution<double>*>(prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e), 
+          Hermes::vector<Solution<double>*>(prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e));
+        info("%d elements copied, %d projected in %g s.", l2_transfer.get_copied_elements(), l2_transfer.get_projected_elements(), 
+          l2_transfer.get_last_time());
         
         if(iteration == 2)
         {
@@ -309,52 +314,37 @@ int main(int argc, char* argv[])
           prev_e2 = new ConstantSolution<double>((*ref_spaces)[0]->get_mesh(), QuantityCalculator::calc_energy(RHO_EXT, RHO_EXT * V1_EXT, RHO_EXT * V2_EXT, P_EXT, KAPPA));
         }
         else
-          OGProjection<double>::project_global(*ref_spaces, Hermes::vector<Solution<double>*>(prev_rho2, prev_rho_v_x2, prev_rho_v_y2, prev_e2), 
-            Hermes::vector<Solution<double>*>(prev_rho2, prev_rho_v_x2, prev_rho_v_y2, prev_e2), matrix_solver, Hermes::vector<Hermes::Hermes2D::ProjNormType>());
+          l2_transfer2.transfer(*ref_spaces, Hermes::vector<Solution<double>*>(prev_rho2, prev_rho_v_x2, prev_rho_v_y2, prev_e2), 
+            Hermes::vector<Solution<double>*>(prev_rho2, prev_rho_v_x2, prev_rho_v_y2, prev_e2));
       }
 
       // Initialize weak formulation.
       EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder wf(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, BDY_SOLID_WALL_BOTTOM, BDY_SOLID_WALL_TOP, 
         BDY_INLET, BDY_OUTLET, prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e, prev_rho2, prev_rho_v_x2, prev_rho_v_y2, prev_e2, (P_INIT == 0 && CAND_LIST == H2D_H_ANISO));
 
-      EulerEquationsWeakFormStabilization wf_stabilization(prev_rho);
-
       if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
         wf.set_stabilization(prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e, prev_rho2, prev_rho_v_x2, prev_rho_v_y2, prev_e2, NU_1, NU_2);
       
       // Report NDOFs.
-      info("ndof_coarse: %d, ndof_fine: %d.", 
+      info("ndof_coarse: %d, ndof_fine: %d (reference spaces %s in %g s).", 
         Space<double>::get_num_dofs(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-        &space_rho_v_y, &space_e)), Space<double>::get_num_dofs(*ref_spaces));
+        &space_rho_v_y, &space_e)), Space<double>::get_num_dofs(*ref_spaces), 
+        ref_space_manager.get_last_reused() ? "reused" : "built", ref_space_manager.get_last_time());
 
       // Assemble the reference problem.
       info("Solving on reference mesh.");
       DiscreteProblem<double> dp(&wf, *ref_spaces);
-      DiscreteProblem<double> dp_stabilization(&wf_stabilization, &refspace_stabilization);
-      bool* discreteIndicator = NULL;
 
       SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
       Vector<double>* rhs = create_vector<double>(matrix_solver);
-      Vector<double>* rhs_stabilization = create_vector<double>(matrix_solver);
       LinearSolver<double>* solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
 
       if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
       {
-        dp_stabilization.assemble(rhs_stabilization);
-        if(discreteIndicator != NULL)
-          delete [] discreteIndicator;
-        discreteIndicator = new bool[refspace_stabilization.get_mesh()->get_max_element_id() + 1];
-        for(unsigned int i = 0; i < refspace_stabilization.get_mesh()->get_max_element_id() + 1; i++)
-          discreteIndicator[i] = false;
-        Element* e;
-        for_all_active_elements(e, refspace_stabilization.get_mesh())
-        {
-          AsmList<double> al;
-          refspace_stabilization.get_element_assembly_list(e, &al);
-          if(rhs_stabilization->get(al.get_dof()[0]) >= 1)
-            discreteIndicator[e->id] = true;
-        }
-        wf.set_discreteIndicator(discreteIndicator);
+        // The density was projected onto the reference space, all elements are evaluated.
+        wf.update_stabilization_indicator((*ref_spaces)[0]);
+        info("Shock indicator: %d discontinuous elements (%d evaluated in %g s).", wf.get_stabilization_indicator()->get_discontinuous_count(), 
+          wf.get_stabilization_indicator()->get_last_evaluated(), wf.get_stabilization_indicator()->get_last_time());
       }
 
       // Set the current time step.
@@ -376,6 +366,7 @@ int main(int argc, char* argv[])
           prev_rho_v_x2->copy(prev_rho_v_x);
           prev_rho_v_y2->copy(prev_rho_v_y);
           prev_e2->copy(prev_e);
+          l2_transfer2.set_coefficients(Hermes::vector<Solution<double>*>(prev_rho2, prev_rho_v_x2, prev_rho_v_y2, prev_e2), l2_transfer);
         }
 
         if(!SHOCK_CAPTURING || SHOCK_CAPTURING_TYPE == FEISTAUER)
@@ -471,25 +462,21 @@ int main(int argc, char* argv[])
         // Output solution in VTK format.
         if(VTK_VISUALIZATION)
         {
-          pressure.reinit();
-          Mach_number.reinit();
-          entropy.reinit();
-          Linearizer lin;
           char filename[40];
-          sprintf(filename, "Pressure-%i.vtk", iteration - 1);
-          lin.save_solution_vtk(&pressure, filename, "Pressure", false);
-          sprintf(filename, "Mach number-%i.vtk", iteration - 1);
-          lin.save_solution_vtk(&Mach_number, filename, "MachNumber", false);
-          sprintf(filename, "Entropy-%i.vtk", iteration - 1);
-          lin.save_solution_vtk(&entropy, filename, "Entropy", false);
+          sprintf(filename, "Flow-%i.vtu", iteration - 1);
+          vtu_export.save(filename);
         }
       }
 
+      // The (limited) reference solution becomes the previous time level one below.
+      if(done)
+        l2_transfer.set_coefficients(Hermes::vector<Solution<double>*>(prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e), 
+          *ref_spaces, solver->get_sln_vector());
+
       // Clean up.
       delete solver;
       delete matrix;
       delete rhs;
-      delete rhs_stabilization;
       delete adaptivity;
     }
     while (done == false);
@@ -499,15 +486,6 @@ int main(int argc, char* argv[])
     prev_rho_v_x->copy(rsln_rho_v_x);
     prev_rho_v_y->copy(rsln_rho_v_y);
     prev_e->copy(rsln_e);
-
-    delete rsln_rho->get_mesh();
-    rsln_rho->own_mesh = false;
-    delete rsln_rho_v_x->get_mesh();
-    rsln_rho_v_x->own_mesh = false;
-    delete rsln_rho_v_y->get_mesh();
-    rsln_rho_v_y->own_mesh = false;
-    delete rsln_e->get_mesh();
-    rsln_e->own_mesh = false;
   }
 
   pressure_view.close();
@@ -61,6 +61,26 @@ double time_step_n_minus_one = 1E-6;
 // SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
 // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
 MatrixSolverType matrix_solver = SOLVER_UMFPACK;  
+// Reuse of the factorization over the time steps: the symbolic analysis only in the first step,
+// and if STALE_FACTORIZATION_STEPS > 0, reuse of a factorization (as a preconditioner of an iterative refinement)
+// in up to STALE_FACTORIZATION_STEPS following steps, in which the time step changed relatively by less than STALE_FACTORIZATION_THRESHOLD.
+const bool REUSE_SYMBOLIC_FACTORIZATION = true;
+const int STALE_FACTORIZATION_STEPS = 0;
+const double STALE_FACTORIZATION_THRESHOLD = 0.05;
+// Time integration: false - the semi-implicit scheme, true - the implicit (backward Euler) scheme solved by the Jacobian-free
+// Newton-Krylov method, which allows CFL numbers (JFNK_CFL_NUMBER) far above the semi-implicit limit
+// (the Feistauer's shock capturing is available only with the semi-implicit scheme).
+const bool JFNK = false;
+const double JFNK_CFL_NUMBER = 50.0;
+// Preconditioner of GMRES: false - block Jacobi (element blocks), true - the factorization of the preconditioning matrix.
+const bool JFNK_FACTORIZED_PRECONDITIONER = false;
+// Relative decrease of the residual norm in the Newton's method, and the maximum number of iterations.
+const double NEWTON_TOLERANCE = 1E-6;
+const int NEWTON_MAX_ITER = 20;
+// Relative tolerance, Krylov subspace dimension and the maximum number of restarts of GMRES.
+const double GMRES_TOLERANCE = 1E-3;
+const int GMRES_KRYLOV_DIMENSION = 30;
+const int GMRES_MAX_RESTARTS = 5;
 
 // Equation parameters.
 // Exterior pressure (dimensionless).
@@ -80,8 +100,15 @@ const std::string BDY_OUTLET = "2";
 const std::string BDY_SOLID_WALL_BOTTOM = "3";
 const std::string BDY_SOLID_WALL_TOP = "4";
 
+// Integration order of the forms - increase over the polynomial order of the integrand, and its cap.
+const int INTEGRATION_ORDER_INCREASE = 2;
+const int INTEGRATION_ORDER_MAX = 24;
+// If positive, the forms are integrated with this fixed order instead (24 - the former behaviour, for timing comparisons).
+const int INTEGRATION_ORDER_FIXED = 0;
+
 // Weak forms.
 #include "../forms_explicit.cpp"
+#include "../forms_implicit.cpp"
 
 // Initial condition.
 #include "../initial_condition.cpp"
@@ -102,7 +129,6 @@ int main(int argc, char* argv[])
   L2Space<double> space_rho_v_x(&mesh, P_INIT);
   L2Space<double> space_rho_v_y(&mesh, P_INIT);
   L2Space<double> space_e(&mesh, P_INIT);
-  L2Space<double> space_stabilization(&mesh, 0);
   int ndof = Space<double>::get_num_dofs(Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
   info("ndof: %d", ndof);
 
@@ -124,6 +150,7 @@ int main(int argc, char* argv[])
   MachNumberFilter Mach_number(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   PressureFilter pressure(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   EntropyFilter entropy(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_EXT, P_EXT);
+  EulerVTUExport vtu_export(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_EXT, P_EXT);
 
   ScalarView pressure_view("Pressure", new WinGeom(0, 0, 600, 300));
   ScalarView Mach_number_view("Mach number", new WinGeom(700, 0, 600, 300));
@@ -136,8 +163,10 @@ int main(int argc, char* argv[])
   // Set up the solver, matrix, and rhs according to the solver selection.
   SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
   Vector<double>* rhs = create_vector<double>(matrix_solver);
-  Vector<double>* rhs_stabilization = create_vector<double>(matrix_solver);
   LinearSolver<double>* solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
+  FactorizationReuse factorization_reuse(solver, matrix, rhs, REUSE_SYMBOLIC_FACTORIZATION);
+  if(STALE_FACTORIZATION_STEPS > 0)
+    factorization_reuse.set_stale_factorization_reuse(STALE_FACTORIZATION_STEPS, STALE_FACTORIZATION_THRESHOLD);
 
   // Set up CFL calculation class.
   CFLCalculation CFL(CFL_NUMBER, KAPPA);
@@ -164,91 +193,145 @@ int main(int argc, char* argv[])
   EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder wf(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, BDY_SOLID_WALL_BOTTOM, BDY_SOLID_WALL_TOP, 
     BDY_INLET, BDY_OUTLET, &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_rho2, &prev_rho_v_x2, &prev_rho_v_y2, &prev_e2, (P_INIT == 0));
 
-  EulerEquationsWeakFormStabilization wf_stabilization(&prev_rho);
-
   if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
     wf.set_stabilization(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_rho2, &prev_rho_v_x2, &prev_rho_v_y2, &prev_e2, NU_1, NU_2);
 
   // Initialize the FE problem.
   DiscreteProblem<double> dp(&wf, Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
-  DiscreteProblem<double> dp_stabilization(&wf_stabilization, &space_stabilization);
-  bool* discreteIndicator = NULL;
 
   // If the FE problem is in fact a FV problem.
   if(P_INIT == 0) 
     dp.set_fvm();
 
+  // Implicit weak formulation (with the preconditioning forms) and the Jacobian-free Newton-Krylov solver.
+  EulerEquationsWeakFormImplicitMultiComponent wf_implicit(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, BDY_SOLID_WALL_BOTTOM, BDY_SOLID_WALL_TOP, 
+    BDY_INLET, BDY_OUTLET, &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, true, (P_INIT == 0));
+  DiscreteProblem<double> dp_implicit(&wf_implicit, Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
+  if(P_INIT == 0) 
+    dp_implicit.set_fvm();
+  JacobianFreeNewtonKrylov jfnk(&dp_implicit, Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), 
+    JFNK_FACTORIZED_PRECONDITIONER ? JacobianFreeNewtonKrylov::Factorization : JacobianFreeNewtonKrylov::BlockJacobi, matrix_solver);
+  jfnk.set_newton_parameters(NEWTON_TOLERANCE, NEWTON_MAX_ITER);
+  jfnk.set_gmres_parameters(GMRES_TOLERANCE, GMRES_KRYLOV_DIMENSION, GMRES_MAX_RESTARTS);
+  CFLCalculation CFL_implicit(JFNK_CFL_NUMBER, KAPPA);
+
+  // Coefficients of the current time level for the implicit scheme (the initial guess of the Newton's method).
+  double* sln_vector = NULL;
+  if(JFNK)
+  {
+    if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
+      error("The Feistauer's shock capturing is available only with the semi-implicit scheme.");
+    sln_vector = new double[ndof];
+    OGProjection<double>::project_global(Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), 
+      Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), sln_vector, matrix_solver);
+  }
+
+  // Integration order of the forms.
+  EulerFormsOrder::nonlinearity_increase = INTEGRATION_ORDER_INCREASE;
+  EulerFormsOrder::max_order = INTEGRATION_ORDER_MAX;
+  EulerFormsOrder::fixed_order = INTEGRATION_ORDER_FIXED;
+
+  // Timer for the assembly.
+  Hermes::TimePeriod assembly_time;
+
+  // Timer for the whole time step.
+  Hermes::TimePeriod step_time;
+
   // Time stepping loop.
   for(; t < 3.0; t += time_step_n)
   {
     info("---- Time step %d, time %3.5f.", iteration++, t);
+    step_time.tick(Hermes::HERMES_SKIP);
 
-    if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
+    if(JFNK)
     {
-      dp_stabilization.assemble(rhs_stabilization);
-      if(discreteIndicator != NULL)
-        delete [] discreteIndicator;
-      discreteIndicator = new bool[space_stabilization.get_num_dofs()];
-      for(unsigned int i = 0; i < space_stabilization.get_num_dofs(); i++)
-        discreteIndicator[i] = false;
-      Element* e;
-      for_all_active_elements(e, space_stabilization.get_mesh())
+      wf_implicit.set_time_step(time_step_n);
+      if(!jfnk.solve(sln_vector))
+        warning("The Newton's method did not converge.");
+      info("Newton's method: %d iterations, %d GMRES iterations, %d residual assemblies, %g s.", jfnk.get_newton_iterations(), 
+        jfnk.get_gmres_iterations(), jfnk.get_residual_evaluations(), jfnk.get_last_time());
+
+      if(!SHOCK_CAPTURING)
+        Solution<double>::vector_to_solutions(sln_vector, Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+          &space_rho_v_y, &space_e), Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+      else
       {
-        AsmList<double> al;
-        space_stabilization.get_element_assembly_list(e, &al);
-        if(rhs_stabilization->get(al.get_dof()[0]) >= 1)
-          discreteIndicator[e->id] = true;
+        FluxLimiter flux_limiter(SHOCK_CAPTURING_TYPE == KUZMIN ? FluxLimiter::Kuzmin : FluxLimiter::Krivodonova, sln_vector, 
+          Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
+        if(SHOCK_CAPTURING_TYPE == KUZMIN)
+          flux_limiter.limit_second_orders_according_to_detector();
+        flux_limiter.limit_according_to_detector();
+        flux_limiter.get_limited_solutions(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
       }
-      wf.set_discreteIndicator(discreteIndicator);
-    }
-
-    // Set the current time step.
-    wf.set_time_step(time_step_n, time_step_n_minus_one);
-
-    // Assemble the stiffness matrix and rhs.
-    info("Assembling the stiffness matrix and right-hand side vector.");
-    dp.assemble(matrix, rhs);
 
-    // Solve the matrix problem.
-    info("Solving the matrix problem.");
-    if(solver->solve())
+      CFL_implicit.calculate_semi_implicit(sln_vector, Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), time_step_n);
+    }
+    else
     {
-      if(iteration > 1)
+      if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
       {
-        prev_rho2.copy(&prev_rho);
-        prev_rho_v_x2.copy(&prev_rho_v_x);
-        prev_rho_v_y2.copy(&prev_rho_v_y);
-        prev_e2.copy(&prev_e);
+        // Only the elements whose density changed since the last time step are evaluated.
+        wf.update_stabilization_indicator(&space_rho, factorization_reuse.get_sln_vector());
+        info("Shock indicator: %d discontinuous elements (%d evaluated in %g s).", wf.get_stabilization_indicator()->get_discontinuous_count(), 
+          wf.get_stabilization_indicator()->get_last_evaluated(), wf.get_stabilization_indicator()->get_last_time());
       }
 
-      if(!SHOCK_CAPTURING || SHOCK_CAPTURING_TYPE == FEISTAUER)
+      // Set the current time step.
+      wf.set_time_step(time_step_n, time_step_n_minus_one);
+
+      // Assemble the stiffness matrix and rhs.
+      info("Assembling the stiffness matrix and right-hand side vector.");
+      assembly_time.tick(Hermes::HERMES_SKIP);
+      dp.assemble(matrix, rhs);
+      assembly_time.tick();
+      info("Assembly time: %g s (total %g s).", assembly_time.last(), assembly_time.accumulated());
+
+      // Solve the matrix problem.
+      info("Solving the matrix problem.");
+      if(factorization_reuse.solve(time_step_n))
       {
-        Solution<double>::vector_to_solutions(solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-          &space_rho_v_y, &space_e), Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+        if(iteration > 1)
+        {
+          prev_rho2.copy(&prev_rho);
+          prev_rho_v_x2.copy(&prev_rho_v_x);
+          prev_rho_v_y2.copy(&prev_rho_v_y);
+          prev_e2.copy(&prev_e);
+        }
+
+        if(!SHOCK_CAPTURING || SHOCK_CAPTURING_TYPE == FEISTAUER)
+        {
+          Solution<double>::vector_to_solutions(factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+            &space_rho_v_y, &space_e), Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+        }
+        else
+        {
+          FluxLimiter* flux_limiter;
+          if(SHOCK_CAPTURING_TYPE == KUZMIN)
+            flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+            &space_rho_v_y, &space_e));
+          else
+            flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+            &space_rho_v_y, &space_e));
+
+          if(SHOCK_CAPTURING_TYPE == KUZMIN)
+            flux_limiter->limit_second_orders_according_to_detector();
+
+          flux_limiter->limit_according_to_detector();
+
+          flux_limiter->get_limited_solutions(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+        }
       }
       else
-      {
-        FluxLimiter* flux_limiter;
-        if(SHOCK_CAPTURING_TYPE == KUZMIN)
-          flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-          &space_rho_v_y, &space_e));
-        else
-          flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-          &space_rho_v_y, &space_e));
+        error ("Matrix solver failed.\n");
 
-        if(SHOCK_CAPTURING_TYPE == KUZMIN)
-          flux_limiter->limit_second_orders_according_to_detector();
-
-        flux_limiter->limit_according_to_detector();
-
-        flux_limiter->get_limited_solutions(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
-      }
+      time_step_n_minus_one = time_step_n;
+      CFL.calculate_semi_implicit(factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), time_step_n);
     }
-    else
-      error ("Matrix solver failed.\n");
 
-    time_step_n_minus_one = time_step_n;
-    CFL.calculate_semi_implicit(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), &mesh, time_step_n);
+    // Time of the step (without the output).
+    step_time.tick();
+    info("Step time: %g s (solution %g s, %d solutions with a stale factorization so far).", step_time.last(), 
+      factorization_reuse.get_last_time(), factorization_reuse.get_stale_solves());
 
     // Visualization.
     if((iteration - 1) % EVERY_NTH_STEP == 0) 
@@ -268,15 +351,9 @@ int main(int argc, char* argv[])
       // Output solution in VTK format.
       if(VTK_VISUALIZATION) 
       {
-        pressure.reinit();
-        Mach_number.reinit();
-        Linearizer lin_pressure;
         char filename[40];
-        sprintf(filename, "pressure-3D-%i.vtk", iteration - 1);
-        lin_pressure.save_solution_vtk(&pressure, filename, "Pressure", true);
-        Linearizer lin_mach;
-        sprintf(filename, "Mach number-3D-%i.vtk", iteration - 1);
-        lin_mach.save_solution_vtk(&Mach_number, filename, "MachNumber", true);
+        sprintf(filename, "Flow-%i.vtu", iteration - 1);
+        vtu_export.save(filename);
       }
     }
     // Save a current state on the disk.
@@ -292,6 +369,9 @@ int main(int argc, char* argv[])
     }
   }
 
+  if(sln_vector != NULL)
+    delete [] sln_vector;
+
   pressure_view.close();
   entropy_production_view.close();
   Mach_number_view.close();
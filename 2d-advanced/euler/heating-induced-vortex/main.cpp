@@ -56,6 +56,12 @@ double time_step = 1E-4;
 // Matrix solver: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
 // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
 const MatrixSolverType matrix_solver = SOLVER_UMFPACK;  
+// Reuse of the factorization over the time steps: the symbolic analysis only in the first step,
+// and if STALE_FACTORIZATION_STEPS > 0, reuse of a factorization (as a preconditioner of an iterative refinement)
+// in up to STALE_FACTORIZATION_STEPS following steps, in which the time step changed relatively by less than STALE_FACTORIZATION_THRESHOLD.
+const bool REUSE_SYMBOLIC_FACTORIZATION = true;
+const int STALE_FACTORIZATION_STEPS = 0;
+const double STALE_FACTORIZATION_THRESHOLD = 0.05;
 
 // Equation parameters.
 // Exterior pressure (dimensionless).
@@ -107,7 +113,6 @@ int main(int argc, char* argv[])
   L2Space<double> space_rho_v_x(&mesh, P_INIT);
   L2Space<double> space_rho_v_y(&mesh, P_INIT);
   L2Space<double> space_e(&mesh, P_INIT);
-  L2Space<double> space_stabilization(&mesh, 0);
   int ndof = Space<double>::get_num_dofs(Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
   info("ndof: %d", ndof);
 
@@ -124,6 +129,7 @@ int main(int argc, char* argv[])
   MachNumberFilter Mach_number(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   PressureFilter pressure(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   EntropyFilter entropy(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_INITIAL_HIGH, P_INITIAL_HIGH);
+  EulerVTUExport vtu_export(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_INITIAL_HIGH, P_INITIAL_HIGH);
 
   ScalarView pressure_view("Pressure", new WinGeom(0, 0, 600, 300));
   ScalarView Mach_number_view("Mach number", new WinGeom(700, 0, 600, 300));
@@ -137,8 +143,10 @@ int main(int argc, char* argv[])
   // Set up the solver, matrix, and rhs according to the solver selection.
   SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
   Vector<double>* rhs = create_vector<double>(matrix_solver);
-  Vector<double>* rhs_stabilization = create_vector<double>(matrix_solver);
   LinearSolver<double>* solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
+  FactorizationReuse factorization_reuse(solver, matrix, rhs, REUSE_SYMBOLIC_FACTORIZATION);
+  if(STALE_FACTORIZATION_STEPS > 0)
+    factorization_reuse.set_stale_factorization_reuse(STALE_FACTORIZATION_STEPS, STALE_FACTORIZATION_THRESHOLD);
 
   // Set up CFL calculation class.
   CFLCalculation CFL(CFL_NUMBER, KAPPA);
@@ -163,39 +171,32 @@ int main(int argc, char* argv[])
   // Initialize weak formulation.
   EulerEquationsWeakFormSemiImplicitMultiComponent wf(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, BDY_SOLID_WALL, BDY_SOLID_WALL, 
     BDY_INLET, "Outlet marker not used", &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e);
-  EulerEquationsWeakFormStabilization wf_stabilization(&prev_rho);
 
   if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
     wf.set_stabilization(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, NU_1, NU_2);
 
   // Initialize the FE problem.
   DiscreteProblem<double> dp(&wf, Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
-  DiscreteProblem<double> dp_stabilization(&wf_stabilization, &space_stabilization);
 
   // If the FE problem is in fact a FV problem.
   if(P_INIT == 0) 
     dp.set_fvm();
 
+  // Timer for the whole time step.
+  Hermes::TimePeriod step_time;
+
   // Time stepping loop.
   for(; t < 10.0; t += time_step)
   {
     info("---- Time step %d, time %3.5f.", iteration++, t);
+    step_time.tick(Hermes::HERMES_SKIP);
 
     if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
     {
-      assert(space_stabilization.get_num_dofs() == space_stabilization.get_mesh()->get_num_active_elements());
-      dp_stabilization.assemble(rhs_stabilization);
-      bool* discreteIndicator = new bool[space_stabilization.get_num_dofs()];
-      memset(discreteIndicator, 0, space_stabilization.get_num_dofs() * sizeof(bool));
-      Element* e;
-      for_all_active_elements(e, space_stabilization.get_mesh())
-      {
-        AsmList<double> al;
-        space_stabilization.get_element_assembly_list(e, &al);
-        if(rhs_stabilization->get(al.get_dof()[0]) >= 1)
-          discreteIndicator[e->id] = true;
-      }
-      wf.set_discreteIndicator(discreteIndicator);
+      // Only the elements whose density changed since the last time step are evaluated.
+      wf.update_stabilization_indicator(&space_rho, factorization_reuse.get_sln_vector());
+      info("Shock indicator: %d discontinuous elements (%d evaluated in %g s).", wf.get_stabilization_indicator()->get_discontinuous_count(), 
+        wf.get_stabilization_indicator()->get_last_evaluated(), wf.get_stabilization_indicator()->get_last_time());
     }
 
     // Set the current time step.
@@ -207,21 +208,21 @@ int main(int argc, char* argv[])
 
     // Solve the matrix problem.
     info("Solving the matrix problem.");
-    if(solver->solve())
+    if(factorization_reuse.solve(time_step))
     {
       if(!SHOCK_CAPTURING || SHOCK_CAPTURING_TYPE == FEISTAUER)
       {
-        Solution<double>::vector_to_solutions(solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+        Solution<double>::vector_to_solutions(factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
           &space_rho_v_y, &space_e), Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
       }
       else
       {      
         FluxLimiter* flux_limiter;
         if(SHOCK_CAPTURING_TYPE == KUZMIN)
-          flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+          flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
           &space_rho_v_y, &space_e));
         else
-          flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+          flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
           &space_rho_v_y, &space_e));
 
         if(SHOCK_CAPTURING_TYPE == KUZMIN)
@@ -235,7 +236,12 @@ int main(int argc, char* argv[])
     else
       error ("Matrix solver failed.\n");
 
-    CFL.calculate_semi_implicit(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), &mesh, time_step);
+    CFL.calculate_semi_implicit(factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), time_step);
+
+    // Time of the step (without the output).
+    step_time.tick();
+    info("Step time: %g s (solution %g s, %d solutions with a stale factorization so far).", step_time.last(), 
+      factorization_reuse.get_last_time(), factorization_reuse.get_stale_solves());
 
     // Visualization.
     if((iteration - 1) % EVERY_NTH_STEP == 0) 
@@ -255,15 +261,9 @@ int main(int argc, char* argv[])
       // Output solution in VTK format.
       if(VTK_VISUALIZATION) 
       {
-        pressure.reinit();
-        Mach_number.reinit();
-        Linearizer lin_pressure;
         char filename[40];
-        sprintf(filename, "pressure-3D-%i.vtk", iteration - 1);
-        lin_pressure.save_solution_vtk(&pressure, filename, "Pressure", true);
-        Linearizer lin_mach;
-        sprintf(filename, "Mach number-3D-%i.vtk", iteration - 1);
-        lin_mach.save_solution_vtk(&Mach_number, filename, "MachNumber", true);
+        sprintf(filename, "Flow-%i.vtu", iteration - 1);
+        vtu_export.save(filename);
       }
     }
     // Save a current state on the disk.
@@ -0,0 +1,250 @@
+#define HERMES_REPORT_INFO
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This is not a PDE example, it compares the assembly of the semi-implicit DG scheme with the
+// integration orders derived from the polynomial degrees (EulerFormsOrder) to the former fixed
+// order 24 of all the forms, on the meshes and with the weak forms of forward-step, gamm-channel
+// and reflected-shock, for the polynomial degrees 0 - P_MAX. The state is a smooth perturbation
+// of the inlet state. For each example and degree, the mean assembly time with both orders,
+// the speed-up and the difference of the solutions of one time step (relative to the maximum
+// of the solution with the fixed order) are reported.
+//
+// The following parameters can be changed:
+
+// Maximum polynomial degree.
+const int P_MAX = 2;
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM_FFS = 2;
+const int INIT_REF_NUM_GAMM = 3;
+const int INIT_REF_NUM_CHANNEL = 3;
+// Number of assemblies with each order.
+const int ASSEMBLIES = 5;
+// Time step.
+const double TIME_STEP = 1E-4;
+// Relative amplitude of the perturbation of the inlet state.
+const double PERTURBATION = 0.1;
+// The former fixed order.
+const int FIXED_ORDER = 24;
+// Integration order of the forms - increase over the polynomial order of the integrand, and its cap.
+const int INTEGRATION_ORDER_INCREASE = 2;
+const int INTEGRATION_ORDER_MAX = 24;
+// Matrix solver: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+// SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;
+
+// Kappa.
+const double KAPPA = 1.4;
+
+// Weak forms.
+#include "../forms_explicit.cpp"
+
+// Smooth perturbation of a constant.
+class PerturbedState : public ExactSolutionScalar<double>
+{
+public:
+  PerturbedState(Mesh* mesh, double base) : ExactSolutionScalar<double>(mesh), base(base) {};
+
+  virtual double value (double x, double y) const {
+    return base * (1.0 + PERTURBATION * std::sin(x) * std::cos(y));
+  };
+
+  virtual void derivatives (double x, double y, double& dx, double& dy) const {
+    dx = PERTURBATION * base * std::cos(x) * std::cos(y);
+    dy = -PERTURBATION * base * std::sin(x) * std::sin(y);
+  };
+
+  virtual Ord ord(Ord x, Ord y) const {
+    return Ord(10);
+  }
+
+  double base;
+};
+
+struct Result
+{
+  // Mean assembly times with the fixed and the derived orders.
+  double fixed, derived;
+  // Maximum difference of the solutions relative to the maximum of the solution with the fixed order.
+  double difference;
+};
+
+// Sets the solutions to the perturbed state (rho, v1, v2, p).
+void set_state(Hermes::vector<Space<double>*> spaces, Hermes::vector<Solution<double>*> solutions, double rho, double v1, double v2, double p)
+{
+  Mesh* mesh = spaces[0]->get_mesh();
+  PerturbedState state_rho(mesh, rho);
+  PerturbedState state_rho_v_x(mesh, rho * v1);
+  PerturbedState state_rho_v_y(mesh, rho * v2);
+  PerturbedState state_e(mesh, QuantityCalculator::calc_energy(rho, rho * v1, rho * v2, p, KAPPA));
+
+  double* coeff_vec = new double[Space<double>::get_num_dofs(spaces)];
+  OGProjection<double>::project_global(spaces, Hermes::vector<MeshFunction<double>*>(&state_rho, &state_rho_v_x, &state_rho_v_y, &state_e),
+    coeff_vec, matrix_solver);
+  Solution<double>::vector_to_solutions(coeff_vec, spaces, solutions);
+  delete [] coeff_vec;
+}
+
+// Assembles and solves the system of wf with both orders.
+Result compare(WeakForm<double>* wf, Hermes::vector<Space<double>*> spaces, bool fvm)
+{
+  int ndof = Space<double>::get_num_dofs(spaces);
+  double* sln_vectors[2];
+  double times[2];
+
+  for(int order_i = 0; order_i < 2; order_i++)
+  {
+    EulerFormsOrder::fixed_order = (order_i == 0) ? FIXED_ORDER : 0;
+
+    DiscreteProblem<double> dp(wf, spaces);
+    if(fvm)
+      dp.set_fvm();
+
+    SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
+    Vector<double>* rhs = create_vector<double>(matrix_solver);
+    LinearSolver<double>* solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
+
+    Hermes::TimePeriod cpu_time;
+    for(int assembly_i = 0; assembly_i < ASSEMBLIES; assembly_i++)
+    {
+      cpu_time.tick(Hermes::HERMES_SKIP);
+      dp.assemble(matrix, rhs);
+      cpu_time.tick();
+    }
+    times[order_i] = cpu_time.accumulated() / ASSEMBLIES;
+
+    if(!solver->solve())
+      error ("Matrix solver failed.\n");
+    sln_vectors[order_i] = new double[ndof];
+    memcpy(sln_vectors[order_i], solver->get_sln_vector(), ndof * sizeof(double));
+
+    delete solver;
+    delete matrix;
+    delete rhs;
+  }
+  EulerFormsOrder::fixed_order = 0;
+
+  double max_difference = 0.0, max_value = 0.0;
+  for(int i = 0; i < ndof; i++)
+  {
+    max_difference = std::max(max_difference, std::abs(sln_vectors[0][i] - sln_vectors[1][i]));
+    max_value = std::max(max_value, std::abs(sln_vectors[0][i]));
+  }
+
+  Result result;
+  result.fixed = times[0];
+  result.derived = times[1];
+  result.difference = max_difference / max_value;
+
+  delete [] sln_vectors[0];
+  delete [] sln_vectors[1];
+  return result;
+}
+
+// Forward facing step (see forward-step).
+Result forward_step(int p_init)
+{
+  const double P_EXT = 1.0, RHO_EXT = 1.4, V1_EXT = 3.0, V2_EXT = 0.0;
+
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("ffs.mesh", &mesh);
+  for (int i = 0; i < INIT_REF_NUM_FFS; i++)
+    mesh.refine_all_elements(0, true);
+
+  L2Space<double> space_rho(&mesh, p_init);
+  L2Space<double> space_rho_v_x(&mesh, p_init);
+  L2Space<double> space_rho_v_y(&mesh, p_init);
+  L2Space<double> space_e(&mesh, p_init);
+  Hermes::vector<Space<double>*> spaces(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e);
+
+  Solution<double> prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e;
+  set_state(spaces, Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), RHO_EXT, V1_EXT, V2_EXT, P_EXT);
+
+  VijayasundaramNumericalFlux num_flux(KAPPA);
+  EulerEquationsWeakFormSemiImplicitMultiComponent wf(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, "1", "3", "4", "2",
+    &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e);
+  wf.set_time_step(TIME_STEP);
+
+  return compare(&wf, spaces, p_init == 0);
+}
+
+// GAMM channel (see gamm-channel).
+Result gamm_channel(int p_init)
+{
+  const double P_EXT = 2.5, RHO_EXT = 1.0, V1_EXT = 1.25, V2_EXT = 0.0;
+
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("GAMM-channel.mesh", &mesh);
+  for (int i = 0; i < INIT_REF_NUM_GAMM; i++)
+    mesh.refine_all_elements(0, true);
+
+  L2Space<double> space_rho(&mesh, p_init);
+  L2Space<double> space_rho_v_x(&mesh, p_init);
+  L2Space<double> space_rho_v_y(&mesh, p_init);
+  L2Space<double> space_e(&mesh, p_init);
+  Hermes::vector<Space<double>*> spaces(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e);
+
+  // Both time levels are the same state.
+  Solution<double> prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e;
+  set_state(spaces, Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), RHO_EXT, V1_EXT, V2_EXT, P_EXT);
+
+  VijayasundaramNumericalFlux num_flux(KAPPA);
+  EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder wf(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, "3", "4", "1", "2",
+    &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, (p_init == 0));
+  wf.set_time_step(TIME_STEP, TIME_STEP);
+
+  return compare(&wf, spaces, p_init == 0);
+}
+
+// Reflected shock (see reflected-shock).
+Result reflected_shock(int p_init)
+{
+  const double RHO_LEFT = 1.0, V1_LEFT = 2.9, V2_LEFT = 0.0, PRESSURE_LEFT = 0.714286;
+  const double RHO_TOP = 1.7, V1_TOP = 2.619334, V2_TOP = -0.5063, PRESSURE_TOP = 1.52819;
+
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("channel.mesh", &mesh);
+  for (int i = 0; i < INIT_REF_NUM_CHANNEL; i++)
+    mesh.refine_all_elements(0, true);
+
+  L2Space<double> space_rho(&mesh, p_init);
+  L2Space<double> space_rho_v_x(&mesh, p_init);
+  L2Space<double> space_rho_v_y(&mesh, p_init);
+  L2Space<double> space_e(&mesh, p_init);
+  Hermes::vector<Space<double>*> spaces(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e);
+
+  Solution<double> prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e;
+  set_state(spaces, Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), RHO_LEFT, V1_LEFT, V2_LEFT, PRESSURE_LEFT);
+
+  OsherSolomonNumericalFlux num_flux(KAPPA);
+  EulerEquationsWeakFormSemiImplicitMultiComponentTwoInflows wf(&num_flux, KAPPA, RHO_LEFT, V1_LEFT, V2_LEFT, PRESSURE_LEFT, RHO_TOP, V1_TOP, V2_TOP, PRESSURE_TOP,
+    "1", "4", "3", "2", &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, (p_init == 0));
+  wf.set_time_step(TIME_STEP);
+
+  return compare(&wf, spaces, p_init == 0);
+}
+
+int main(int argc, char* argv[])
+{
+  EulerFormsOrder::nonlinearity_increase = INTEGRATION_ORDER_INCREASE;
+  EulerFormsOrder::max_order = INTEGRATION_ORDER_MAX;
+
+  const char* names[3] = { "forward-step", "gamm-channel", "reflected-shock" };
+  Result (*examples[3])(int) = { forward_step, gamm_channel, reflected_shock };
+
+  for(int example_i = 0; example_i < 3; example_i++)
+    for(int p_init = 0; p_init <= P_MAX; p_init++)
+    {
+      Result result = examples[example_i](p_init);
+      info("%s, P%d: assembly %g s with the order %d, %g s with the derived orders (speed-up %g), relative difference of the solutions %g.",
+        names[example_i], p_init, result.fixed, FIXED_ORDER, result.derived, result.fixed / result.derived, result.difference);
+    }
+
+  return 0;
+}
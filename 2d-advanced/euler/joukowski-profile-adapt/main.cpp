@@ -34,6 +34,8 @@ double DISCONTINUITY_DETECTOR_PARAM = 1.0;
 
 // For saving/loading of solution.
 bool REUSE_SOLUTION = true;
+// Compression of the saved solution (needs the build WITH_ZLIB).
+const bool COMPRESS_SAVED_SOLUTION = false;
 
 // Initial polynomial degree.        
 const int P_INIT = 0;                                           
@@ -167,6 +169,7 @@ int main(int argc, char* argv[])
   MachNumberFilter Mach_number(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   PressureFilter pressure(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   EntropyFilter entropy(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_EXT, P_EXT);
+  EulerVTUExport vtu_export(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_EXT, P_EXT);
 
   ScalarView pressure_view("Pressure", new WinGeom(0, 0, 600, 300));
   ScalarView Mach_number_view("Mach number", new WinGeom(700, 0, 600, 300));
@@ -180,8 +183,14 @@ int main(int argc, char* argv[])
   // Set up CFL calculation class.
   CFLCalculation CFL(CFL_NUMBER, KAPPA);
 
+  // Geometry of the (curved) elements for the shock capturing. The reference mesh is new
+  // in every adaptivity step, so the geometry is reused only within the step.
+  CurvedGeometryCache geometry_cache;
+
   // Look for a saved solution on the disk.
   Continuity<double> continuity(Continuity<double>::onlyTime);
+  BinaryCheckpoint checkpoint(COMPRESS_SAVED_SOLUTION);
+  char checkpoint_filename[40];
   int iteration = 0; double t = 0;
   bool loaded_now = false;
 
@@ -191,7 +200,9 @@ int main(int argc, char* argv[])
     continuity.get_last_record()->load_spaces(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
       &space_rho_v_y, &space_e), Hermes::vector<SpaceType>(HERMES_L2_SPACE, HERMES_L2_SPACE, HERMES_L2_SPACE, HERMES_L2_SPACE), Hermes::vector<Mesh *>(&mesh, &mesh, 
       &mesh, &mesh));
-    continuity.get_last_record()->load_time_step_length(time_step);
+    sprintf(checkpoint_filename, "Checkpoint-%i.hcp", continuity.get_num());
+    checkpoint.open(checkpoint_filename);
+    time_step = checkpoint.get_record_time_step();
     t = continuity.get_last_record()->get_time() + time_step;
     iteration = continuity.get_num() * EVERY_NTH_STEP + 1;
     loaded_now = true;
@@ -245,8 +256,9 @@ int main(int argc, char* argv[])
       {
         loaded_now = false;
 
-        continuity.get_last_record()->load_solutions(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), 
-          Hermes::vector<Space<double> *>((*ref_spaces)[0], (*ref_spaces)[1], (*ref_spaces)[2], (*ref_spaces)[3]));
+        if(!checkpoint.load(*ref_spaces, Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), matrix_solver))
+          info("The saved solution was projected onto the reference spaces.");
+        checkpoint.close();
       }
       else
       {
@@ -297,6 +309,7 @@ int main(int argc, char* argv[])
         else
         {      
           FluxLimiter flux_limiter(FluxLimiter::Kuzmin, solver->get_sln_vector(), *ref_spaces, true);
+          flux_limiter.set_geometry_cache(&geometry_cache);
           
           flux_limiter.limit_second_orders_according_to_detector(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
             &space_rho_v_y, &space_e));
@@ -366,14 +379,9 @@ int main(int argc, char* argv[])
         // Output solution in VTK format.
         if(VTK_VISUALIZATION) 
         {
-          pressure.reinit();
-          Mach_number.reinit();
-          Linearizer lin;
           char filename[40];
-          sprintf(filename, "Pressure-%i.vtk", iteration - 1);
-          lin.save_solution_vtk(&pressure, filename, "Pressure", false);
-          sprintf(filename, "Mach number-%i.vtk", iteration - 1);
-          lin.save_solution_vtk(&Mach_number, filename, "MachNumber", false);
+          sprintf(filename, "Flow-%i.vtu", iteration - 1);
+          vtu_export.save(filename);
         }
         // Save a current state on the disk.
         if(iteration > 1)
@@ -382,8 +390,9 @@ int main(int argc, char* argv[])
           continuity.get_last_record()->save_mesh(&mesh);
           continuity.get_last_record()->save_spaces(Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
             &space_rho_v_y, &space_e));
-          continuity.get_last_record()->save_solutions(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
-          continuity.get_last_record()->save_time_step_length(time_step);
+          // The reference solution of this step (the previous time level solution of the next one), written in the background.
+          sprintf(checkpoint_filename, "Checkpoint-%i.hcp", continuity.get_num());
+          checkpoint.save(checkpoint_filename, t, time_step, *ref_spaces, solver->get_sln_vector());
         }
       }
 
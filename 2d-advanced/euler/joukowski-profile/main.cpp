@@ -45,6 +45,11 @@ const double NU_2 = 0.1;
 // For saving/loading of solution.
 bool REUSE_SOLUTION = true;
 
+// Mesh: domain.xml (straight edges), domain-arcs.xml (circular arcs), domain-nurbs.xml (NURBS).
+const char* MESH_FILE = "domain-arcs.xml";
+// Cache of the geometry of the (curved) elements, shared by the CFL calculation and the shock capturing.
+const bool CACHE_GEOMETRY = true;
+
 // Initial polynomial degree.       
 const int P_INIT = 1;                                                  
 // Number of initial uniform mesh refinements.
@@ -62,6 +67,12 @@ double time_step_n_minus_one = 1E-6;
 // SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
 // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
 MatrixSolverType matrix_solver = SOLVER_UMFPACK;  
+// Reuse of the factorization over the time steps: the symbolic analysis only in the first step,
+// and if STALE_FACTORIZATION_STEPS > 0, reuse of a factorization (as a preconditioner of an iterative refinement)
+// in up to STALE_FACTORIZATION_STEPS following steps, in which the time step changed relatively by less than STALE_FACTORIZATION_THRESHOLD.
+const bool REUSE_SYMBOLIC_FACTORIZATION = true;
+const int STALE_FACTORIZATION_STEPS = 0;
+const double STALE_FACTORIZATION_THRESHOLD = 0.05;
 
 // Equation parameters.
 // Exterior pressure (dimensionless).
@@ -92,7 +103,7 @@ int main(int argc, char* argv[])
   // Load the mesh.
   Mesh mesh;
   MeshReaderH2DXML mloader;
-  mloader.load("domain-arcs.xml", &mesh);
+  mloader.load(MESH_FILE, &mesh);
   
   mesh.refine_towards_boundary(BDY_SOLID_WALL_PROFILE, INIT_REF_NUM_BOUNDARY_ANISO);
   mesh.refine_towards_vertex(0, INIT_REF_NUM_VERTEX);
@@ -102,7 +113,6 @@ int main(int argc, char* argv[])
   L2Space<double> space_rho_v_x(&mesh, P_INIT);
   L2Space<double> space_rho_v_y(&mesh, P_INIT);
   L2Space<double> space_e(&mesh, P_INIT);
-  L2Space<double> space_stabilization(&mesh, 0);
   int ndof = Space<double>::get_num_dofs(Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
   info("ndof: %d", ndof);
         
@@ -124,6 +134,7 @@ int main(int argc, char* argv[])
   MachNumberFilter Mach_number(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   PressureFilter pressure(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA);
   EntropyFilter entropy(Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_EXT, P_EXT);
+  EulerVTUExport vtu_export(Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), KAPPA, RHO_EXT, P_EXT);
 
   ScalarView pressure_view("Pressure", new WinGeom(0, 0, 600, 300));
   ScalarView Mach_number_view("Mach number", new WinGeom(700, 0, 600, 300));
@@ -136,12 +147,19 @@ int main(int argc, char* argv[])
   // Set up the solver, matrix, and rhs according to the solver selection.
   SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
   Vector<double>* rhs = create_vector<double>(matrix_solver);
-  Vector<double>* rhs_stabilization = create_vector<double>(matrix_solver);
   LinearSolver<double>* solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
+  FactorizationReuse factorization_reuse(solver, matrix, rhs, REUSE_SYMBOLIC_FACTORIZATION);
+  if(STALE_FACTORIZATION_STEPS > 0)
+    factorization_reuse.set_stale_factorization_reuse(STALE_FACTORIZATION_STEPS, STALE_FACTORIZATION_THRESHOLD);
 
   // Set up CFL calculation class.
   CFLCalculation CFL(CFL_NUMBER, KAPPA);
 
+  // Geometry of the elements.
+  CurvedGeometryCache geometry_cache;
+  if(CACHE_GEOMETRY)
+    CFL.set_geometry_cache(&geometry_cache);
+
   // Look for a saved solution on the disk.
   Continuity<double> continuity(Continuity<double>::onlyTime);
   int iteration = 0; double t = 0;
@@ -164,40 +182,32 @@ int main(int argc, char* argv[])
   EulerEquationsWeakFormSemiImplicitMultiComponent2ndOrder wf(&num_flux, KAPPA, RHO_EXT, V1_EXT, V2_EXT, P_EXT, BDY_SOLID_WALL, BDY_SOLID_WALL_PROFILE, 
     BDY_INLET, BDY_OUTLET, &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_rho2, &prev_rho_v_x2, &prev_rho_v_y2, &prev_e2, (P_INIT == 0));
 
-  EulerEquationsWeakFormStabilization wf_stabilization(&prev_rho);
-
   if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
     wf.set_stabilization(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, &prev_rho2, &prev_rho_v_x2, &prev_rho_v_y2, &prev_e2, NU_1, NU_2);
 
   // Initialize the FE problem.
   DiscreteProblem<double> dp(&wf, Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
-  DiscreteProblem<double> dp_stabilization(&wf_stabilization, &space_stabilization);
 
   // If the FE problem is in fact a FV problem.
   if(P_INIT == 0) 
     dp.set_fvm();
 
+  // Timer for the whole time step.
+  Hermes::TimePeriod step_time;
+
   // Time stepping loop.
   for(; t < 5.0; t += time_step_n)
   {
     info("---- Time step %d, time %3.5f.", iteration++, t);
+    step_time.tick(Hermes::HERMES_SKIP);
     CFL.set_number(0.1 + (t/2.5) * 1000.0);
 
     if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
     {
-      assert(space_stabilization.get_num_dofs() == space_stabilization.get_mesh()->get_num_active_elements());
-      dp_stabilization.assemble(rhs_stabilization);
-      bool* discreteIndicator = new bool[space_stabilization.get_num_dofs()];
-      memset(discreteIndicator, 0, space_stabilization.get_num_dofs() * sizeof(bool));
-      Element* e;
-      for_all_active_elements(e, space_stabilization.get_mesh())
-      {
-        AsmList<double> al;
-        space_stabilization.get_element_assembly_list(e, &al);
-        if(rhs_stabilization->get(al.get_dof()[0]) >= 1)
-          discreteIndicator[e->id] = true;
-      }
-      wf.set_discreteIndicator(discreteIndicator);
+      // Only the elements whose density changed since the last time step are evaluated.
+      wf.update_stabilization_indicator(&space_rho, factorization_reuse.get_sln_vector());
+      info("Shock indicator: %d discontinuous elements (%d evaluated in %g s).", wf.get_stabilization_indicator()->get_discontinuous_count(), 
+        wf.get_stabilization_indicator()->get_last_evaluated(), wf.get_stabilization_indicator()->get_last_time());
     }
     
     // Set the current time step.
@@ -209,7 +219,7 @@ int main(int argc, char* argv[])
 
     // Solve the matrix problem.
     info("Solving the matrix problem.");
-    if(solver->solve())
+    if(factorization_reuse.solve(time_step_n))
       {
         if(iteration > 1)
         {
@@ -221,19 +231,22 @@ int main(int argc, char* argv[])
 
       if(!SHOCK_CAPTURING || SHOCK_CAPTURING_TYPE == FEISTAUER)
       {
-        Solution<double>::vector_to_solutions(solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+        Solution<double>::vector_to_solutions(factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
           &space_rho_v_y, &space_e), Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
       }
       else
         {      
         FluxLimiter* flux_limiter;
         if(SHOCK_CAPTURING_TYPE == KUZMIN)
-          flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+          flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
           &space_rho_v_y, &space_e));
         else
-          flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+          flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
             &space_rho_v_y, &space_e));
 
+        if(CACHE_GEOMETRY)
+          flux_limiter->set_geometry_cache(&geometry_cache);
+
         if(SHOCK_CAPTURING_TYPE == KUZMIN)
           flux_limiter->limit_second_orders_according_to_detector();
 
@@ -246,7 +259,12 @@ int main(int argc, char* argv[])
       error ("Matrix solver failed.\n");
 
     time_step_n_minus_one = time_step_n;
-    CFL.calculate_semi_implicit(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), &mesh, time_step_n);
+    CFL.calculate_semi_implicit(factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), time_step_n);
+
+    // Time of the step (without the output).
+    step_time.tick();
+    info("Step time: %g s (solution %g s, %d solutions with a stale factorization so far).", step_time.last(), 
+      factorization_reuse.get_last_time(), factorization_reuse.get_stale_solves());
     
     // Visualization.
     if((iteration - 1) % EVERY_NTH_STEP == 0) 
@@ -266,15 +284,9 @@ int main(int argc, char* argv[])
       // Output solution in VTK format.
       if(VTK_VISUALIZATION) 
       {
-        pressure.reinit();
-        Mach_number.reinit();
-        Linearizer lin_pressure;
         char filename[40];
-        sprintf(filename, "pressure-3D-%i.vtk", iteration - 1);
-        lin_pressure.save_solution_vtk(&pressure, filename, "Pressure", true);
-        Linearizer lin_mach;
-        sprintf(filename, "Mach number-3D-%i.vtk", iteration - 1);
-        lin_mach.save_solution_vtk(&Mach_number, filename, "MachNumber", true);
+        sprintf(filename, "Flow-%i.vtu", iteration - 1);
+        vtu_export.save(filename);
       }
     }
     // Save a current state on the disk.
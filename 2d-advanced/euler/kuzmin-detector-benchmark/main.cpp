@@ -0,0 +1,123 @@
+#define HERMES_REPORT_INFO
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+#include "../euler_util.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This is not a PDE example, it measures the time per element of the Kuzmin's
+// vertex-based discontinuity detector (both the first and the second order
+// detection) on a quadrilateral and a triangular mesh, both with hanging nodes.
+// The first pass includes building the vertex patches of the mesh, the
+// following passes reuse them. The detection is run both through the reference
+// mapping of the solutions and through the tabulated reference basis (on the
+// affine elements), and the flagged elements are compared.
+//
+// The following parameters can be changed:
+
+// Polynomial degree of the solutions (the second order detection needs at least 2).
+const int P_INIT = 2;
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 4;
+// Number of refinements towards the boundary "Inlet" (creates hanging nodes).
+const int INIT_REF_NUM_BDY = 3;
+// Number of repetitions of the detection.
+const int REPETITIONS = 10;
+// Matrix solver for the projections: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+// SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;
+
+// Smooth field with a jump along an oblique line, different for every quantity.
+class DiscontinuousField : public ExactSolutionScalar<double>
+{
+public:
+  DiscontinuousField(Mesh* mesh, double base, double jump) : ExactSolutionScalar<double>(mesh), base(base), jump(jump) {};
+
+  virtual double value (double x, double y) const {
+    return base * (1.0 + 0.1 * std::sin(x) * std::cos(y)) + (x + 0.5 * y > 2.0 ? jump : 0.0);
+  };
+
+  virtual void derivatives (double x, double y, double& dx, double& dy) const {
+    dx = 0.1 * base * std::cos(x) * std::cos(y);
+    dy = -0.1 * base * std::sin(x) * std::sin(y);
+  };
+
+  virtual Ord ord(Ord x, Ord y) const {
+    return Ord(10);
+  }
+
+  double base, jump;
+};
+
+void benchmark(Mesh* mesh, const char* name)
+{
+  L2Space<double> space_rho(mesh, P_INIT);
+  L2Space<double> space_rho_v_x(mesh, P_INIT);
+  L2Space<double> space_rho_v_y(mesh, P_INIT);
+  L2Space<double> space_e(mesh, P_INIT);
+  Hermes::vector<Space<double>*> spaces(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e);
+
+  DiscontinuousField field_rho(mesh, 1.4, 0.7);
+  DiscontinuousField field_rho_v_x(mesh, 4.2, -1.0);
+  DiscontinuousField field_rho_v_y(mesh, 0.5, 0.3);
+  DiscontinuousField field_e(mesh, 8.8, 4.0);
+
+  double* coeff_vec = new double[Space<double>::get_num_dofs(spaces)];
+  OGProjection<double>::project_global(spaces, Hermes::vector<MeshFunction<double>*>(&field_rho, &field_rho_v_x, &field_rho_v_y, &field_e),
+    coeff_vec, matrix_solver);
+
+  Solution<double> rho(mesh), rho_v_x(mesh), rho_v_y(mesh), e(mesh);
+  Hermes::vector<Solution<double>*> solutions(&rho, &rho_v_x, &rho_v_y, &e);
+  Solution<double>::vector_to_solutions(coeff_vec, spaces, solutions);
+
+  int element_count = mesh->get_num_active_elements();
+
+  std::vector<int> flagged[2];
+  for(int tabulated = 0; tabulated < 2; tabulated++)
+  {
+    Hermes::TimePeriod cpu_time;
+    double time_first = 0.0;
+    for(int rep = 0; rep < REPETITIONS; rep++)
+    {
+      cpu_time.tick(Hermes::HERMES_SKIP);
+      KuzminDiscontinuityDetector detector(spaces, solutions, true, tabulated ? coeff_vec : NULL);
+      detector.get_second_order_discontinuous_element_ids();
+      flagged[tabulated] = detector.get_discontinuous_element_ids();
+      cpu_time.tick();
+      if(rep == 0)
+        time_first = cpu_time.last();
+    }
+    double time_rest = (cpu_time.accumulated() - time_first) / (REPETITIONS - 1);
+
+    info("%s, %s: %d elements, %d discontinuous, %g us per element in the first pass, %g us per element in the following passes.",
+      name, tabulated ? "tabulated basis" : "reference mapping", element_count, (int)flagged[tabulated].size(), 
+      1E6 * time_first / element_count, 1E6 * time_rest / element_count);
+  }
+  info("%s: the flagged elements %s.", name, flagged[0] == flagged[1] ? "agree" : "differ");
+
+  delete [] coeff_vec;
+}
+
+int main(int argc, char* argv[])
+{
+  // Quadrilaterals.
+  Mesh mesh_quads;
+  MeshReaderH2D mloader;
+  mloader.load("square.mesh", &mesh_quads);
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh_quads.refine_all_elements();
+  mesh_quads.refine_towards_boundary("Inlet", INIT_REF_NUM_BDY);
+  benchmark(&mesh_quads, "Quadrilaterals");
+
+  // Triangles.
+  Mesh mesh_triangles;
+  mloader.load("square.mesh", &mesh_triangles);
+  mesh_triangles.convert_quads_to_triangles();
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh_triangles.refine_all_elements();
+  mesh_triangles.refine_towards_boundary("Inlet", INIT_REF_NUM_BDY);
+  benchmark(&mesh_triangles, "Triangles");
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+#define HERMES_REPORT_INFO
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+#include "../euler_util.h"
+#include "../numerical_flux.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This is not a PDE example, it compares the global time step of the native finite volume
+// engine with the local time stepping (power-of-two time step levels of the cells)
+// on the forward facing step mesh strongly refined towards the corner of the step.
+// Both runs go from the constant inlet state to the same final time, the numbers of
+// cell updates, the times and the difference of the resulting densities are reported.
+//
+// The following parameters can be changed:
+
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 2;
+// Number of refinements towards the corner of the step.
+const int INIT_REF_NUM_CORNER = 6;
+// CFL value.
+const double CFL_NUMBER = 0.5;
+// Maximum number of the time step levels of the local time stepping.
+const int LOCAL_TIME_STEP_LEVELS = 8;
+// Number of the (macro) steps of the local time stepping, the global time stepping runs to the same time.
+const int LOCAL_STEPS = 20;
+// Matrix solver for the projection: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+// SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;
+
+// Equation parameters (see forward-step).
+const double P_EXT = 1.0;
+const double RHO_EXT = 1.4;
+const double V1_EXT = 3.0;
+const double V2_EXT = 0.0;
+const double KAPPA = 1.4;
+
+// Boundary markers.
+const std::string BDY_SOLID_WALL_BOTTOM = "1";
+const std::string BDY_OUTLET = "2";
+const std::string BDY_SOLID_WALL_TOP = "3";
+const std::string BDY_INLET = "4";
+
+// The corner of the step in ffs.mesh.
+const int CORNER_VERTEX = 5;
+
+int main(int argc, char* argv[])
+{
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("ffs.mesh", &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++)
+    mesh.refine_all_elements(0, true);
+  mesh.refine_towards_vertex(CORNER_VERTEX, INIT_REF_NUM_CORNER);
+
+  L2Space<double> space_rho(&mesh, 0);
+  L2Space<double> space_rho_v_x(&mesh, 0);
+  L2Space<double> space_rho_v_y(&mesh, 0);
+  L2Space<double> space_e(&mesh, 0);
+  Hermes::vector<Space<double>*> spaces(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e);
+  int ndof = Space<double>::get_num_dofs(spaces);
+
+  // Initial condition identical to the inlet state.
+  ConstantSolution<double> init_rho(&mesh, RHO_EXT);
+  ConstantSolution<double> init_rho_v_x(&mesh, RHO_EXT * V1_EXT);
+  ConstantSolution<double> init_rho_v_y(&mesh, RHO_EXT * V2_EXT);
+  ConstantSolution<double> init_e(&mesh, QuantityCalculator::calc_energy(RHO_EXT, RHO_EXT * V1_EXT, RHO_EXT * V2_EXT, P_EXT, KAPPA));
+  double* init_vector = new double[ndof];
+  OGProjection<double>::project_global(spaces, Hermes::vector<MeshFunction<double>*>(&init_rho, &init_rho_v_x, &init_rho_v_y, &init_e),
+    init_vector, matrix_solver);
+
+  VijayasundaramNumericalFlux num_flux(KAPPA);
+  FiniteVolumeEuler fvm_local(&num_flux, KAPPA), fvm_global(&num_flux, KAPPA);
+  FiniteVolumeEuler* engines[2] = { &fvm_local, &fvm_global };
+  for(int i = 0; i < 2; i++)
+  {
+    engines[i]->add_solid_wall(BDY_SOLID_WALL_BOTTOM);
+    engines[i]->add_solid_wall(BDY_SOLID_WALL_TOP);
+    engines[i]->add_inlet(BDY_INLET, RHO_EXT, V1_EXT, V2_EXT, P_EXT);
+    engines[i]->add_outlet(BDY_OUTLET, P_EXT);
+    engines[i]->set_state(init_vector, spaces);
+  }
+
+  // Local time stepping.
+  Hermes::TimePeriod cpu_time;
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  double t_local = 0.0;
+  for(int step = 0; step < LOCAL_STEPS; step++)
+    t_local += fvm_local.step_local(CFL_NUMBER, LOCAL_TIME_STEP_LEVELS);
+  cpu_time.tick();
+  double time_local = cpu_time.last();
+
+  const std::vector<int>& level_cell_counts = fvm_local.get_level_cell_counts();
+  for(unsigned int level = 0; level < level_cell_counts.size(); level++)
+    info("Level %d (time step 2^%d * the smallest one): %d cells.", level, level, level_cell_counts[level]);
+
+  // Global time stepping to the same time.
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  double t_global = 0.0;
+  while(t_global < t_local)
+  {
+    double time_step = std::min(fvm_global.calculate_time_step(CFL_NUMBER), t_local - t_global);
+    fvm_global.step(time_step);
+    t_global += time_step;
+  }
+  cpu_time.tick();
+  double time_global = cpu_time.last();
+
+  info("%d cells, final time %g.", fvm_local.get_cell_count(), t_local);
+  info("Global time step: %g cell updates, %g s.", fvm_global.get_cell_updates(), time_global);
+  info("Local time stepping: %g cell updates, %g s.", fvm_local.get_cell_updates(), time_local);
+  info("Cell updates saved: %g %%, speedup %g.", 100.0 * (1.0 - fvm_local.get_cell_updates() / fvm_global.get_cell_updates()), time_global / time_local);
+
+  // Difference of the densities.
+  double* local_vector = new double[ndof];
+  double* global_vector = new double[ndof];
+  fvm_local.get_state(local_vector);
+  fvm_global.get_state(global_vector);
+  Solution<double> rho_local(&mesh), rho_global(&mesh);
+  Solution<double>::vector_to_solution(local_vector, &space_rho, &rho_local);
+  Solution<double>::vector_to_solution(global_vector, &space_rho, &rho_global);
+  info("Relative L2 difference of the densities: %g.", Global<double>::calc_rel_error(&rho_local, &rho_global, HERMES_L2_NORM));
+
+  delete [] init_vector;
+  delete [] local_vector;
+  delete [] global_vector;
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+#define HERMES_REPORT_INFO
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+#include "../numerical_flux.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This is not a PDE example, it measures the throughput of the numerical fluxes
+// used in the Euler examples, both point by point and through the batched
+// (all quadrature points of an edge at once) entry point, and checks that both
+// give the same results (up to the rounding errors if the batches are vectorized,
+// see WITH_SIMD in CMake.vars).
+//
+// The following parameters can be changed:
+
+// Number of points per batch (roughly the number of quadrature points on an edge).
+const int POINTS_PER_EDGE = 13;
+// Number of edges (batches).
+const int EDGE_COUNT = 20000;
+// Number of repetitions of the whole sweep.
+const int REPETITIONS = 10;
+
+// Equation parameters.
+// Exterior pressure (dimensionless).
+const double P_EXT = 1.0;
+// Inlet density (dimensionless).
+const double RHO_EXT = 1.4;
+// Inlet x-velocity (dimensionless).
+const double V1_EXT = 0.5;
+// Inlet y-velocity (dimensionless).
+const double V2_EXT = 0.0;
+// Kappa.
+const double KAPPA = 1.4;
+
+// Fills a state close to the inlet state.
+void perturbed_state(double* state[4], int i)
+{
+  double rho = RHO_EXT * (1.0 + 0.1 * (std::rand() / (double)RAND_MAX - 0.5));
+  double v1 = V1_EXT + 0.1 * (std::rand() / (double)RAND_MAX - 0.5);
+  double v2 = V2_EXT + 0.1 * (std::rand() / (double)RAND_MAX - 0.5);
+  double p = P_EXT * (1.0 + 0.1 * (std::rand() / (double)RAND_MAX - 0.5));
+  state[0][i] = rho;
+  state[1][i] = rho * v1;
+  state[2][i] = rho * v2;
+  state[3][i] = QuantityCalculator::calc_energy(rho, rho * v1, rho * v2, p, KAPPA);
+}
+
+void benchmark(NumericalFlux* num_flux, const char* name)
+{
+  int n = POINTS_PER_EDGE * EDGE_COUNT;
+
+  double* storage = new double[18 * n];
+  double* w_L[4], *w_R[4], *result_point[4], *result_batch[4];
+  for(unsigned int k = 0; k < 4; k++) {
+    w_L[k] = storage + k * n;
+    w_R[k] = storage + (4 + k) * n;
+    result_point[k] = storage + (8 + k) * n;
+    result_batch[k] = storage + (12 + k) * n;
+  }
+  double* nx = storage + 16 * n;
+  double* ny = storage + 17 * n;
+
+  std::srand(0);
+  for(int i = 0; i < n; i++) {
+    perturbed_state(w_L, i);
+    perturbed_state(w_R, i);
+    double angle = 2 * M_PI * std::rand() / (double)RAND_MAX;
+    nx[i] = std::cos(angle);
+    ny[i] = std::sin(angle);
+  }
+
+  Hermes::TimePeriod cpu_time;
+
+  // Point by point, as the surface forms did it.
+  NumericalFluxWorkspace ws;
+  double w_L_i[4], w_R_i[4], result_i[4];
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  for(int rep = 0; rep < REPETITIONS; rep++)
+    for(int i = 0; i < n; i++) {
+      for(unsigned int k = 0; k < 4; k++) {
+        w_L_i[k] = w_L[k][i];
+        w_R_i[k] = w_R[k][i];
+      }
+      num_flux->numerical_flux(ws, result_i, w_L_i, w_R_i, nx[i], ny[i]);
+      for(unsigned int k = 0; k < 4; k++)
+        result_point[k][i] = result_i[k];
+    }
+  cpu_time.tick();
+  double time_point = cpu_time.last();
+
+  // Edge by edge.
+  for(int rep = 0; rep < REPETITIONS; rep++)
+    for(int edge = 0; edge < EDGE_COUNT; edge++) {
+      int offset = edge * POINTS_PER_EDGE;
+      double* w_L_edge[4], *w_R_edge[4], *result_edge[4];
+      for(unsigned int k = 0; k < 4; k++) {
+        w_L_edge[k] = w_L[k] + offset;
+        w_R_edge[k] = w_R[k] + offset;
+        result_edge[k] = result_batch[k] + offset;
+      }
+      num_flux->numerical_flux_batch(POINTS_PER_EDGE, result_edge, w_L_edge, w_R_edge, nx + offset, ny + offset);
+    }
+  cpu_time.tick();
+  double time_batch = cpu_time.last();
+
+  // The vectorized batches (WITH_SIMD) round differently.
+  int differences = 0;
+  double max_relative_difference = 0.0;
+  for(unsigned int k = 0; k < 4; k++)
+    for(int i = 0; i < n; i++)
+      if(result_point[k][i] != result_batch[k][i]) {
+        differences++;
+        double scale = std::max(std::abs(result_point[k][i]), 1.0);
+        max_relative_difference = std::max(max_relative_difference, std::abs(result_point[k][i] - result_batch[k][i]) / scale);
+      }
+
+  info("%s: %g fluxes/s point by point, %g fluxes/s batched (%gx), %d differing values (at most %g relative).", name, 
+    REPETITIONS * n / time_point, REPETITIONS * n / time_batch, time_point / time_batch, differences, max_relative_difference);
+
+  delete [] storage;
+}
+
+int main(int argc, char* argv[])
+{
+  info("Instruction set of the batches: %s.", NumericalFlux::batch_instruction_set());
+
+  StegerWarmingNumericalFlux steger_warming(KAPPA);
+  benchmark(&steger_warming, "Steger-Warming");
+
+  VijayasundaramNumericalFlux vijayasundaram(KAPPA);
+  benchmark(&vijayasundaram, "Vijayasundaram");
+
+  OsherSolomonNumericalFlux osher_solomon(KAPPA);
+  benchmark(&osher_solomon, "Osher-Solomon");
+
+  RusanovNumericalFlux rusanov(KAPPA);
+  benchmark(&rusanov, "Rusanov");
+
+  HLLNumericalFlux hll(KAPPA);
+  benchmark(&hll, "HLL");
+
+  HLLCNumericalFlux hllc(KAPPA);
+  benchmark(&hllc, "HLLC");
+
+  return 0;
+}
@@ -0,0 +1,210 @@
+#define HERMES_REPORT_INFO
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+#include "../numerical_flux.h"
+#include <cstring>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This is not a PDE example, it checks that the numerical fluxes used in the Euler
+// examples can be shared by threads. Every flux (interface, solid wall, inlet, outlet
+// and the batched entry point) is evaluated by all threads at once on the same flux
+// instance, each thread with its own workspace, and the results of every thread are
+// compared bit by bit (memcmp) to the results of a serial run.
+// Needs WITH_OPENMP in CMake.vars, otherwise it only runs in one thread.
+//
+// The following parameters can be changed:
+
+// Number of threads (0 = the OpenMP default).
+const int THREAD_COUNT = 0;
+// Number of points per batch (roughly the number of quadrature points on an edge).
+const int POINTS_PER_EDGE = 13;
+// Number of edges (batches).
+const int EDGE_COUNT = 2000;
+// Number of repetitions of the whole sweep in every thread.
+const int REPETITIONS = 10;
+
+// Equation parameters.
+// Exterior pressure (dimensionless).
+const double P_EXT = 1.0;
+// Inlet density (dimensionless).
+const double RHO_EXT = 1.4;
+// Inlet x-velocity (dimensionless).
+const double V1_EXT = 0.5;
+// Inlet y-velocity (dimensionless).
+const double V2_EXT = 0.0;
+// Kappa.
+const double KAPPA = 1.4;
+
+// Number of evaluated entry points, each storing four components per point.
+const int ENTRY_POINTS = 5;
+
+// Fills a state close to the inlet state, supersonic in some of the points.
+void perturbed_state(double* state[4], int i)
+{
+  double rho = RHO_EXT * (1.0 + 0.5 * (std::rand() / (double)RAND_MAX - 0.5));
+  double v1 = V1_EXT + 2.0 * (std::rand() / (double)RAND_MAX - 0.5);
+  double v2 = V2_EXT + 2.0 * (std::rand() / (double)RAND_MAX - 0.5);
+  double p = P_EXT * (1.0 + 0.5 * (std::rand() / (double)RAND_MAX - 0.5));
+  state[0][i] = rho;
+  state[1][i] = rho * v1;
+  state[2][i] = rho * v2;
+  state[3][i] = QuantityCalculator::calc_energy(rho, rho * v1, rho * v2, p, KAPPA);
+}
+
+// Evaluates all entry points in all points, the edges starting with first_edge.
+// results holds 4 * ENTRY_POINTS arrays of n values.
+void evaluate(NumericalFlux* num_flux, NumericalFluxWorkspace& ws, int first_edge, double* w_L[4], double* w_R[4],
+  double* pressure, double* nx, double* ny, double* results)
+{
+  int n = POINTS_PER_EDGE * EDGE_COUNT;
+  double w_L_i[4], w_R_i[4], result_i[4];
+
+  for(int edge_i = 0; edge_i < EDGE_COUNT; edge_i++) {
+    int offset = ((first_edge + edge_i) % EDGE_COUNT) * POINTS_PER_EDGE;
+    for(int i = offset; i < offset + POINTS_PER_EDGE; i++) {
+      for(unsigned int k = 0; k < 4; k++) {
+        w_L_i[k] = w_L[k][i];
+        w_R_i[k] = w_R[k][i];
+      }
+
+      num_flux->numerical_flux(ws, result_i, w_L_i, w_R_i, nx[i], ny[i]);
+      for(unsigned int k = 0; k < 4; k++)
+        results[k * n + i] = result_i[k];
+
+      num_flux->numerical_flux_solid_wall(ws, result_i, w_L_i, nx[i], ny[i]);
+      for(unsigned int k = 0; k < 4; k++)
+        results[(4 + k) * n + i] = result_i[k];
+
+      num_flux->numerical_flux_inlet(ws, result_i, w_L_i, w_R_i, nx[i], ny[i]);
+      for(unsigned int k = 0; k < 4; k++)
+        results[(8 + k) * n + i] = result_i[k];
+
+      num_flux->numerical_flux_outlet(ws, result_i, w_L_i, pressure[i], nx[i], ny[i]);
+      for(unsigned int k = 0; k < 4; k++)
+        results[(12 + k) * n + i] = result_i[k];
+    }
+
+    double* w_L_edge[4], *w_R_edge[4], *result_edge[4];
+    for(unsigned int k = 0; k < 4; k++) {
+      w_L_edge[k] = w_L[k] + offset;
+      w_R_edge[k] = w_R[k] + offset;
+      result_edge[k] = results + (16 + k) * n + offset;
+    }
+    num_flux->numerical_flux_batch(POINTS_PER_EDGE, result_edge, w_L_edge, w_R_edge, nx + offset, ny + offset);
+  }
+}
+
+// Returns the number of threads whose results differed from the serial ones.
+int test(NumericalFlux* num_flux, const char* name, int thread_count)
+{
+  int n = POINTS_PER_EDGE * EDGE_COUNT;
+  int result_size = 4 * ENTRY_POINTS * n;
+
+  double* storage = new double[11 * n];
+  double* w_L[4], *w_R[4];
+  for(unsigned int k = 0; k < 4; k++) {
+    w_L[k] = storage + k * n;
+    w_R[k] = storage + (4 + k) * n;
+  }
+  double* pressure = storage + 8 * n;
+  double* nx = storage + 9 * n;
+  double* ny = storage + 10 * n;
+
+  std::srand(0);
+  for(int i = 0; i < n; i++) {
+    perturbed_state(w_L, i);
+    perturbed_state(w_R, i);
+    pressure[i] = P_EXT * (1.0 + 0.5 * (std::rand() / (double)RAND_MAX - 0.5));
+    double angle = 2 * M_PI * std::rand() / (double)RAND_MAX;
+    nx[i] = std::cos(angle);
+    ny[i] = std::sin(angle);
+  }
+
+  // The reference.
+  double* serial_results = new double[result_size];
+  NumericalFluxWorkspace serial_ws;
+  evaluate(num_flux, serial_ws, 0, w_L, w_R, pressure, nx, ny, serial_results);
+
+  double* thread_results = new double[thread_count * result_size];
+  int failed_threads = 0;
+
+  Hermes::TimePeriod cpu_time;
+  cpu_time.tick(Hermes::HERMES_SKIP);
+
+#pragma omp parallel num_threads(thread_count)
+  {
+    int thread_num = 0;
+#ifdef _OPENMP
+    thread_num = omp_get_thread_num();
+#endif
+    double* results = thread_results + thread_num * result_size;
+    NumericalFluxWorkspace ws;
+    bool failed = false;
+    for(int rep = 0; rep < REPETITIONS; rep++) {
+      // The threads start at different edges, so that they do not run in lockstep.
+      evaluate(num_flux, ws, (thread_num * EDGE_COUNT) / thread_count + rep, w_L, w_R, pressure, nx, ny, results);
+      if(std::memcmp(results, serial_results, result_size * sizeof(double)) != 0)
+        failed = true;
+      // Garbage for the next repetition, so that a skipped value is not mistaken for a correct one.
+      std::memset(results, 0xff, result_size * sizeof(double));
+    }
+    if(failed)
+#pragma omp atomic
+      failed_threads++;
+  }
+
+  cpu_time.tick();
+
+  info("%s: %d threads x %d repetitions x %d points, %d threads differing from the serial run (%g s).",
+    name, thread_count, REPETITIONS, n, failed_threads, cpu_time.last());
+
+  delete [] thread_results;
+  delete [] serial_results;
+  delete [] storage;
+
+  return failed_threads;
+}
+
+int main(int argc, char* argv[])
+{
+  int thread_count = THREAD_COUNT;
+#ifdef _OPENMP
+  if(thread_count == 0)
+    thread_count = omp_get_max_threads();
+#else
+  warning("Compiled without OpenMP, running in one thread only.");
+  thread_count = 1;
+#endif
+
+  int failed_threads = 0;
+
+  StegerWarmingNumericalFlux steger_warming(KAPPA);
+  failed_threads += test(&steger_warming, "Steger-Warming", thread_count);
+
+  VijayasundaramNumericalFlux vijayasundaram(KAPPA);
+  failed_threads += test(&vijayasundaram, "Vijayasundaram", thread_count);
+
+  OsherSolomonNumericalFlux osher_solomon(KAPPA);
+  failed_threads += test(&osher_solomon, "Osher-Solomon", thread_count);
+
+  RusanovNumericalFlux rusanov(KAPPA);
+  failed_threads += test(&rusanov, "Rusanov", thread_count);
+
+  HLLNumericalFlux hll(KAPPA);
+  failed_threads += test(&hll, "HLL", thread_count);
+
+  HLLCNumericalFlux hllc(KAPPA);
+  failed_threads += test(&hllc, "HLLC", thread_count);
+
+  if(failed_threads > 0)
+    error("The numerical fluxes are not thread-safe.");
+
+  info("All numerical fluxes gave the serial results in all threads.");
+
+  return 0;
+}
@@ -1,10 +1,448 @@
 #include "numerical_flux.h"
+#include <cfloat>
+#if defined(WITH_AVX512) || defined(WITH_AVX2)
+#include <immintrin.h>
+#define NUMERICAL_FLUX_SIMD
+#endif
+
+#ifdef NUMERICAL_FLUX_SIMD
+// Vectorized kernels of the batched fluxes (Steger-Warming, Vijayasundaram, Osher-Solomon), selected by WITH_SIMD
+// in CMake. The kernels evaluate SIMD_WIDTH points at once without branching, the cases of the scalar code
+// are blended by masks. The results agree with the scalar code up to the rounding errors.
+
+#ifdef WITH_AVX512
+static const int SIMD_WIDTH = 8;
+typedef __m512d simd_register;
+typedef __mmask8 simd_mask_register;
+typedef __m512i simd_int;
+#else
+static const int SIMD_WIDTH = 4;
+typedef __m256d simd_register;
+typedef __m256d simd_mask_register;
+typedef __m256i simd_int;
+#endif
+
+// SIMD_WIDTH doubles.
+struct SimdDouble
+{
+  SimdDouble() {}
+  SimdDouble(simd_register v) : v(v) {}
+  SimdDouble(double x);
+  simd_register v;
+};
+
+// Result of a comparison of two SimdDouble.
+struct SimdMask
+{
+  SimdMask(simd_mask_register m) : m(m) {}
+  simd_mask_register m;
+};
+
+#ifdef WITH_AVX512
+inline SimdDouble::SimdDouble(double x) : v(_mm512_set1_pd(x)) {}
+inline SimdDouble simd_load(const double* p) { return _mm512_loadu_pd(p); }
+inline void simd_store(double* p, SimdDouble x) { _mm512_storeu_pd(p, x.v); }
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) { return _mm512_add_pd(a.v, b.v); }
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) { return _mm512_sub_pd(a.v, b.v); }
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) { return _mm512_mul_pd(a.v, b.v); }
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) { return _mm512_div_pd(a.v, b.v); }
+inline SimdDouble simd_sqrt(SimdDouble a) { return _mm512_sqrt_pd(a.v); }
+inline SimdDouble simd_max(SimdDouble a, SimdDouble b) { return _mm512_max_pd(a.v, b.v); }
+inline SimdDouble simd_min(SimdDouble a, SimdDouble b) { return _mm512_min_pd(a.v, b.v); }
+inline SimdDouble simd_round(SimdDouble a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline SimdMask operator<(SimdDouble a, SimdDouble b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ); }
+inline SimdMask operator<=(SimdDouble a, SimdDouble b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_LE_OQ); }
+inline SimdMask operator>(SimdDouble a, SimdDouble b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ); }
+inline SimdMask operator>=(SimdDouble a, SimdDouble b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_GE_OQ); }
+inline SimdMask operator&(SimdMask a, SimdMask b) { return (__mmask8)(a.m & b.m); }
+inline SimdMask operator|(SimdMask a, SimdMask b) { return (__mmask8)(a.m | b.m); }
+inline SimdMask operator!(SimdMask a) { return (__mmask8)~a.m; }
+inline bool simd_any(SimdMask a) { return a.m != 0; }
+// a where mask is set, b elsewhere.
+inline SimdDouble simd_select(SimdMask mask, SimdDouble a, SimdDouble b) { return _mm512_mask_blend_pd(mask.m, b.v, a.v); }
+
+// Bit manipulation of the IEEE representation (exp / log).
+inline simd_int simd_bits(SimdDouble a) { return _mm512_castpd_si512(a.v); }
+inline SimdDouble simd_from_bits(simd_int a) { return _mm512_castsi512_pd(a); }
+inline simd_int simd_int_set(long long a) { return _mm512_set1_epi64(a); }
+inline simd_int simd_int_and(simd_int a, simd_int b) { return _mm512_and_si512(a, b); }
+inline simd_int simd_int_or(simd_int a, simd_int b) { return _mm512_or_si512(a, b); }
+inline simd_int simd_int_add(simd_int a, simd_int b) { return _mm512_add_epi64(a, b); }
+inline simd_int simd_int_sub(simd_int a, simd_int b) { return _mm512_sub_epi64(a, b); }
+inline simd_int simd_int_shift_left(simd_int a, int count) { return _mm512_slli_epi64(a, count); }
+inline simd_int simd_int_shift_right(simd_int a, int count) { return _mm512_srli_epi64(a, count); }
+#else
+inline SimdDouble::SimdDouble(double x) : v(_mm256_set1_pd(x)) {}
+inline SimdDouble simd_load(const double* p) { return _mm256_loadu_pd(p); }
+inline void simd_store(double* p, SimdDouble x) { _mm256_storeu_pd(p, x.v); }
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) { return _mm256_add_pd(a.v, b.v); }
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) { return _mm256_sub_pd(a.v, b.v); }
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) { return _mm256_mul_pd(a.v, b.v); }
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) { return _mm256_div_pd(a.v, b.v); }
+inline SimdDouble simd_sqrt(SimdDouble a) { return _mm256_sqrt_pd(a.v); }
+inline SimdDouble simd_max(SimdDouble a, SimdDouble b) { return _mm256_max_pd(a.v, b.v); }
+inline SimdDouble simd_min(SimdDouble a, SimdDouble b) { return _mm256_min_pd(a.v, b.v); }
+inline SimdDouble simd_round(SimdDouble a) { return _mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline SimdMask operator<(SimdDouble a, SimdDouble b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+inline SimdMask operator<=(SimdDouble a, SimdDouble b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ); }
+inline SimdMask operator>(SimdDouble a, SimdDouble b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+inline SimdMask operator>=(SimdDouble a, SimdDouble b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ); }
+inline SimdMask operator&(SimdMask a, SimdMask b) { return _mm256_and_pd(a.m, b.m); }
+inline SimdMask operator|(SimdMask a, SimdMask b) { return _mm256_or_pd(a.m, b.m); }
+inline SimdMask operator!(SimdMask a) { return _mm256_xor_pd(a.m, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))); }
+inline bool simd_any(SimdMask a) { return _mm256_movemask_pd(a.m) != 0; }
+// a where mask is set, b elsewhere.
+inline SimdDouble simd_select(SimdMask mask, SimdDouble a, SimdDouble b) { return _mm256_blendv_pd(b.v, a.v, mask.m); }
+
+// Bit manipulation of the IEEE representation (exp / log).
+inline simd_int simd_bits(SimdDouble a) { return _mm256_castpd_si256(a.v); }
+inline SimdDouble simd_from_bits(simd_int a) { return _mm256_castsi256_pd(a); }
+inline simd_int simd_int_set(long long a) { return _mm256_set1_epi64x(a); }
+inline simd_int simd_int_and(simd_int a, simd_int b) { return _mm256_and_si256(a, b); }
+inline simd_int simd_int_or(simd_int a, simd_int b) { return _mm256_or_si256(a, b); }
+inline simd_int simd_int_add(simd_int a, simd_int b) { return _mm256_add_epi64(a, b); }
+inline simd_int simd_int_sub(simd_int a, simd_int b) { return _mm256_sub_epi64(a, b); }
+inline simd_int simd_int_shift_left(simd_int a, int count) { return _mm256_slli_epi64(a, count); }
+inline simd_int simd_int_shift_right(simd_int a, int count) { return _mm256_srli_epi64(a, count); }
+#endif
+
+inline SimdDouble operator-(SimdDouble a) { return SimdDouble(0.0) - a; }
+
+// Natural logarithm of positive normal numbers (the algorithm of fdlibm).
+static SimdDouble simd_log(SimdDouble x)
+{
+  // x = 2^k * m, 1 <= m < 2, the biased exponent is turned into a double by the 2^52 trick.
+  simd_int bits = simd_bits(x);
+  SimdDouble two_52(4503599627370496.0);
+  SimdDouble k = simd_from_bits(simd_int_or(simd_int_shift_right(bits, 52), simd_bits(two_52))) - two_52 - 1023.0;
+  SimdDouble m = simd_from_bits(simd_int_or(simd_int_and(bits, simd_int_set(0x000fffffffffffffLL)), simd_bits(1.0)));
+
+  // sqrt(2) / 2 < m <= sqrt(2).
+  SimdMask large = m > 1.41421356237309504880;
+  m = simd_select(large, 0.5 * m, m);
+  k = simd_select(large, k + 1.0, k);
+
+  SimdDouble f = m - 1.0;
+  SimdDouble s = f / (2.0 + f);
+  SimdDouble z = s * s;
+  SimdDouble w = z * z;
+  SimdDouble t_1 = w * (3.999999999940941908e-01 + w * (2.222219843214978396e-01 + w * 1.531383769920937332e-01));
+  SimdDouble t_2 = z * (6.666666666666735130e-01 + w * (2.857142874366239149e-01 + w * (1.818357216161805012e-01 + w * 1.479819860511658591e-01)));
+  SimdDouble R = t_2 + t_1;
+  SimdDouble hfsq = 0.5 * f * f;
+  return k * 6.93147180369123816490e-01 - ((hfsq - (s * (hfsq + R) + k * 1.90821492927058770002e-10)) - f);
+}
+
+// Exponential (the algorithm of fdlibm), the argument is clamped to the range of normal results.
+static SimdDouble simd_exp(SimdDouble x)
+{
+  x = simd_min(simd_max(x, -708.0), 709.0);
+
+  // x = k * ln(2) + r, |r| <= ln(2) / 2.
+  SimdDouble k = simd_round(x * 1.44269504088896338700e+00);
+  SimdDouble hi = x - k * 6.93147180369123816490e-01;
+  SimdDouble lo = k * 1.90821492927058770002e-10;
+  SimdDouble r = hi - lo;
+
+  SimdDouble t = r * r;
+  SimdDouble c = r - t * (1.66666666666666019037e-01 + t * (-2.77777777770155933842e-03 + t * (6.61375632143793436117e-05
+    + t * (-1.65339022054652515390e-06 + t * 4.13813679705723846039e-08))));
+  SimdDouble y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+
+  // 2^k, the integer k is read from the mantissa of k + 1.5 * 2^52.
+  SimdDouble magic(6755399441055744.0);
+  simd_int k_int = simd_int_sub(simd_bits(k + magic), simd_bits(magic));
+  return y * simd_from_bits(simd_int_shift_left(simd_int_add(k_int, simd_int_set(1023)), 52));
+}
+
+// std::pow() for the bases outside of the positive normal numbers (the lanes are calculated one by one).
+static SimdDouble simd_pow(SimdDouble x, double y)
+{
+  if(simd_any(!(x >= DBL_MIN) | (x > DBL_MAX))) {
+    double lanes[SIMD_WIDTH];
+    simd_store(lanes, x);
+    for(int lane = 0; lane < SIMD_WIDTH; lane++)
+      lanes[lane] = std::pow(lanes[lane], y);
+    return simd_load(lanes);
+  }
+  return simd_exp(y * simd_log(x));
+}
+
+// The functions of QuantityCalculator.
+static SimdDouble simd_calc_pressure(const SimdDouble q[4], double kappa)
+{
+  SimdDouble p = (kappa - 1.0) * (q[3] - (q[1]*q[1] + q[2]*q[2]) / (2.0*q[0]));
+  return simd_select(p < 1E-12, 1E-12, p);
+}
+
+static SimdDouble simd_calc_sound_speed(const SimdDouble q[4], double kappa)
+{
+  SimdDouble a = simd_sqrt(kappa * simd_calc_pressure(q, kappa) / q[0]);
+  return simd_select(a < 1E-12, 1E-12, a);
+}
+
+static SimdDouble simd_calc_energy(SimdDouble rho, SimdDouble rho_v_x, SimdDouble rho_v_y, SimdDouble pressure, double kappa)
+{
+  SimdDouble energy = pressure/(kappa - 1.0) + (rho_v_x*rho_v_x+rho_v_y*rho_v_y) / (2.0*rho);
+  return simd_select(energy < 1E-12, 1E-12, energy);
+}
+
+// NumericalFlux::Q() of the points i, ..., i + SIMD_WIDTH - 1.
+static void simd_Q(SimdDouble result[4], double* state_vector[4], int i, SimdDouble nx, SimdDouble ny)
+{
+  SimdDouble w_1 = simd_load(state_vector[1] + i);
+  SimdDouble w_2 = simd_load(state_vector[2] + i);
+  result[0] = simd_load(state_vector[0] + i);
+  result[1] = nx * w_1 + ny * w_2;
+  result[2] = -ny * w_1 + nx * w_2;
+  result[3] = simd_load(state_vector[3] + i);
+}
+
+// NumericalFlux::Q_inv(), the result is stored to the points i, ..., i + SIMD_WIDTH - 1.
+static void simd_Q_inv_store(double* result[4], int i, const SimdDouble state_vector[4], SimdDouble nx, SimdDouble ny)
+{
+  simd_store(result[0] + i, state_vector[0]);
+  simd_store(result[1] + i, nx * state_vector[1] - ny * state_vector[2]);
+  simd_store(result[2] + i, ny * state_vector[1] + nx * state_vector[2]);
+  simd_store(result[3] + i, state_vector[3]);
+}
+
+// NumericalFlux::f_1().
+static void simd_f_1(SimdDouble result[4], const SimdDouble state[4], double kappa)
+{
+  SimdDouble p = simd_calc_pressure(state, kappa);
+  result[0] = state[1];
+  result[1] = state[1] * state[1] / state[0] + p;
+  result[2] = state[2] * state[1] / state[0];
+  result[3] = (state[1] / state[0]) * (state[3] + p);
+}
+
+// A^+(q) p_plus + A^-(q) p_minus in the rotated frame, A^{+-} = T Lambda^{+-} T^{-1} as in
+// StegerWarmingNumericalFlux::A_plus() / A_minus(), applied without assembling the matrices.
+// p_plus or p_minus may be NULL.
+static void simd_split_jacobians_times(const SimdDouble q[4], const SimdDouble* p_plus, const SimdDouble* p_minus,
+  SimdDouble result[4], double kappa)
+{
+  SimdDouble a = simd_calc_sound_speed(q, kappa);
+  SimdDouble u = q[1] / q[0];
+  SimdDouble v = q[2] / q[0];
+  SimdDouble V = u*u + v*v;
+  SimdDouble a_2_inv = 1.0 / (a * a);
+
+  SimdDouble lambda[4] = { u - a, u, u, u + a };
+
+  // Rows of T^{-1} (T_inv_1, ..., T_inv_4).
+  SimdDouble T_inv[4][4] = {
+    { a_2_inv * (0.5 * (((kappa - 1) * V / 2.0) + u * a)), a_2_inv * (-(a + u * (kappa - 1.0)) / 2.0),
+      a_2_inv * (-(v * (kappa - 1.0)) / 2.0), a_2_inv * ((kappa - 1.0) / 2.0) },
+    { a_2_inv * (a * a - v * a - (kappa - 1.0) * (V / 2.0)), a_2_inv * u * (kappa - 1.0),
+      a_2_inv * (a + v * (kappa - 1.0)), a_2_inv * (1.0 - kappa) },
+    { a_2_inv * v * a, 0.0, a_2_inv * (-a), 0.0 },
+    { a_2_inv * (0.5 * (((kappa - 1.0) * V / 2.0) - u * a)), a_2_inv * (a - u * (kappa - 1.0)) / 2.0,
+      a_2_inv * (-(v * (kappa - 1.0)) / 2.0), a_2_inv * ((kappa - 1.0) / 2.0) }
+  };
+
+  // Columns of T (T_1, ..., T_4).
+  SimdDouble T[4][4] = {
+    { 1.0, u - a, v, (V / 2.0) + (a*a / (kappa - 1.0)) - (u * a) },
+    { 1.0, u, v, V / 2.0 },
+    { 1.0, u, v - a, (V / 2.0) - v * a },
+    { 1.0, u + a, v, (V / 2.0) + (a * a / (kappa - 1.0)) + (u * a) }
+  };
+
+  for(unsigned int j = 0; j < 4; j++)
+    result[j] = 0.0;
+  for(unsigned int k = 0; k < 4; k++) {
+    SimdDouble coefficient = 0.0;
+    if(p_plus != NULL)
+      coefficient = coefficient + simd_max(lambda[k], 0.0) 
+        * (T_inv[k][0] * p_plus[0] + T_inv[k][1] * p_plus[1] + T_inv[k][2] * p_plus[2] + T_inv[k][3] * p_plus[3]);
+    if(p_minus != NULL)
+      coefficient = coefficient + simd_min(lambda[k], 0.0) 
+        * (T_inv[k][0] * p_minus[0] + T_inv[k][1] * p_minus[1] + T_inv[k][2] * p_minus[2] + T_inv[k][3] * p_minus[3]);
+    for(unsigned int j = 0; j < 4; j++)
+      result[j] = result[j] + T[k][j] * coefficient;
+  }
+}
+
+// Evaluates the flux in the points i, ..., i + SIMD_WIDTH - 1.
+typedef void (*SimdFluxKernel)(double* result[4], double* w_L[4], double* w_R[4], double* nx, double* ny, int i, double kappa);
+
+static void steger_warming_simd(double* result[4], double* w_L[4], double* w_R[4], double* nx, double* ny, int i, double kappa)
+{
+  SimdDouble n_x = simd_load(nx + i);
+  SimdDouble n_y = simd_load(ny + i);
+  SimdDouble q_L[4], q_R[4], flux[4];
+  simd_Q(q_L, w_L, i, n_x, n_y);
+  simd_Q(q_R, w_R, i, n_x, n_y);
+
+  // P^+(w_L) w_L + P^-(w_R) w_R, rotated back at once.
+  SimdDouble flux_plus[4], flux_minus[4];
+  simd_split_jacobians_times(q_L, q_L, NULL, flux_plus, kappa);
+  simd_split_jacobians_times(q_R, NULL, q_R, flux_minus, kappa);
+  for(unsigned int k = 0; k < 4; k++)
+    flux[k] = flux_minus[k] + flux_plus[k];
+  simd_Q_inv_store(result, i, flux, n_x, n_y);
+}
+
+static void vijayasundaram_simd(double* result[4], double* w_L[4], double* w_R[4], double* nx, double* ny, int i, double kappa)
+{
+  SimdDouble n_x = simd_load(nx + i);
+  SimdDouble n_y = simd_load(ny + i);
+  SimdDouble q_L[4], q_R[4], q_mean[4], flux[4];
+  simd_Q(q_L, w_L, i, n_x, n_y);
+  simd_Q(q_R, w_R, i, n_x, n_y);
+  // The Jacobians are homogeneous of degree 0, so the sum stands for the mean as in numerical_flux().
+  for(unsigned int k = 0; k < 4; k++)
+    q_mean[k] = q_L[k] + q_R[k];
+
+  // P^+(w_mean) w_L + P^-(w_mean) w_R with one eigen-decomposition.
+  simd_split_jacobians_times(q_mean, q_L, q_R, flux, kappa);
+  simd_Q_inv_store(result, i, flux, n_x, n_y);
+}
+
+static void osher_solomon_simd(double* result[4], double* w_L[4], double* w_R[4], double* nx, double* ny, int i, double kappa)
+{
+  SimdDouble n_x = simd_load(nx + i);
+  SimdDouble n_y = simd_load(ny + i);
+  SimdDouble q_L[4], q_R[4];
+  simd_Q(q_L, w_L, i, n_x, n_y);
+  simd_Q(q_R, w_R, i, n_x, n_y);
+
+  SimdDouble a_L = simd_calc_sound_speed(q_L, kappa);
+  SimdDouble a_R = simd_calc_sound_speed(q_R, kappa);
+  SimdDouble u_L = q_L[1] / q_L[0];
+  SimdDouble u_R = q_R[1] / q_R[0];
+
+  if(simd_any(a_L + a_R + ((kappa - 1) * (u_L - u_R) / 2) <= 0.0))
+    error("Osher-Solomon numerical flux is not possible to construct according to the table.");
+
+  // Utility numbers.
+  SimdDouble z_L = (0.5 * (kappa - 1) * q_L[1] / q_L[0]) + a_L;
+  SimdDouble z_R = (0.5 * (kappa - 1) * q_R[1] / q_R[0]) - a_R;
+  SimdDouble s_L = simd_calc_pressure(q_L, kappa) / simd_pow(q_L[0], kappa);
+  SimdDouble s_R = simd_calc_pressure(q_R, kappa) / simd_pow(q_R[0], kappa);
+  SimdDouble alpha = simd_pow(s_R / s_L, 1 / (2 * kappa));
+
+  // q_1, a_1, a_3 (calculate_q_1_a_1_a_3()).
+  SimdDouble q_1[4];
+  SimdDouble a_1 = (z_L - z_R) / (1 + alpha);
+  q_1[0] = simd_pow(a_1 / a_L, 2 / (kappa - 1)) * q_L[0];
+  q_1[1] = q_1[0] * 2 * (z_L - a_1) / (kappa - 1);
+  q_1[2] = q_1[0] * q_L[2] / q_L[0];
+  q_1[3] = simd_calc_energy(q_1[0], q_1[1], q_1[2], a_1 * a_1 * q_1[0] / kappa, kappa);
+  SimdDouble a_3 = alpha * a_1;
+  SimdDouble u_1 = q_1[1] / q_1[0];
+
+  // Columns (left / right supersonic) and rows (position of 0 in the waves) of the table 3.4.1 on the page 233 in Feist (2003).
+  SimdMask left_supersonic = u_L > a_L;
+  SimdMask right_supersonic = u_R < -a_R;
+  SimdMask row_1 = a_1 <= u_1;
+  SimdMask row_2 = !row_1 & (0.0 < u_1);
+  SimdMask row_3 = !row_1 & !row_2 & (-a_3 <= u_1);
+  SimdMask row_4 = !row_1 & !row_2 & !row_3;
+
+  // Only the states some of the points need.
+  SimdDouble f_L[4], f_R[4], f_L_star[4], f_R_star[4], f_q_1[4], f_q_3[4];
+  for(unsigned int k = 0; k < 4; k++)
+    f_L_star[k] = f_R_star[k] = f_q_1[k] = f_q_3[k] = 0.0;
+  simd_f_1(f_L, q_L, kappa);
+  simd_f_1(f_R, q_R, kappa);
+  if(simd_any(row_2))
+    simd_f_1(f_q_1, q_1, kappa);
+  if(simd_any(row_1 | left_supersonic)) {
+    SimdDouble q_L_star[4];
+    SimdDouble a_L_star = 2 * z_L / (kappa + 1);
+    q_L_star[0] = simd_pow(a_L_star / a_L, 2 / (kappa - 1)) * q_L[0];
+    q_L_star[1] = q_L_star[0] * a_L_star;
+    q_L_star[2] = q_1[0] * q_L[2] / q_L[0];
+    q_L_star[3] = simd_calc_energy(q_L_star[0], q_L_star[1], q_L_star[2], a_L_star * a_L_star * q_L_star[0] / kappa, kappa);
+    simd_f_1(f_L_star, q_L_star, kappa);
+  }
+  if(simd_any(row_3)) {
+    SimdDouble q_3[4];
+    q_3[0] = q_1[0] / (alpha * alpha);
+    q_3[1] = q_3[0] * q_1[1] / q_1[0];
+    q_3[2] = q_3[0] * q_R[2] / q_R[0];
+    q_3[3] = simd_calc_energy(q_3[0], q_3[1], q_3[2], a_3 * a_3 * q_3[0] / kappa, kappa);
+    simd_f_1(f_q_3, q_3, kappa);
+  }
+  if(simd_any(row_4 | right_supersonic)) {
+    SimdDouble q_R_star[4];
+    SimdDouble a_R_star = - 2 * z_R / (kappa + 1);
+    q_R_star[0] = simd_pow(a_R_star / a_R, 2 / (kappa - 1)) * q_R[0];
+    q_R_star[1] = q_R_star[0] * -a_R_star;
+    q_R_star[2] = q_1[0] * q_R[2] / q_R[0];
+    q_R_star[3] = simd_calc_energy(q_R_star[0], q_R_star[1], q_R_star[2], a_R_star * a_R_star * q_R_star[0] / kappa, kappa);
+    simd_f_1(f_R_star, q_R_star, kappa);
+  }
+
+  SimdDouble flux[4];
+  for(unsigned int k = 0; k < 4; k++) {
+    // The first column, the flux in the state the row picks.
+    SimdDouble row_flux = simd_select(row_1, f_L_star[k], simd_select(row_2, f_q_1[k], simd_select(row_3, f_q_3[k], f_R_star[k])));
+    SimdDouble column_2 = simd_select(row_1, f_L[k], f_L[k] - f_L_star[k] + row_flux);
+    SimdDouble column_3 = simd_select(row_4, f_R[k], f_R[k] - f_R_star[k] + row_flux);
+    SimdDouble column_4 = simd_select(row_1, f_L[k] - f_R_star[k] + f_R[k], 
+      simd_select(row_4, f_L[k] + f_R[k] - f_L_star[k], f_L[k] - f_R_star[k] + f_R[k] - f_L_star[k] + row_flux));
+    flux[k] = simd_select(left_supersonic, simd_select(right_supersonic, column_4, column_2), 
+      simd_select(right_supersonic, column_3, row_flux));
+  }
+  simd_Q_inv_store(result, i, flux, n_x, n_y);
+}
+
+// Runs the kernel over all n points, the last incomplete vector is padded by repeating the last point.
+static void simd_numerical_flux_batch(SimdFluxKernel kernel, int n, double* result[4], double* w_L[4], double* w_R[4],
+          double* nx, double* ny, double kappa)
+{
+  int i = 0;
+  for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+    kernel(result, w_L, w_R, nx, ny, i, kappa);
+  if(i == n)
+    return;
+
+  double storage[14][SIMD_WIDTH];
+  double* tail_w_L[4], *tail_w_R[4], *tail_result[4];
+  for(unsigned int k = 0; k < 4; k++) {
+    tail_w_L[k] = storage[k];
+    tail_w_R[k] = storage[4 + k];
+    tail_result[k] = storage[8 + k];
+  }
+  double* tail_nx = storage[12];
+  double* tail_ny = storage[13];
+  for(int lane = 0; lane < SIMD_WIDTH; lane++) {
+    int point = std::min(i + lane, n - 1);
+    for(unsigned int k = 0; k < 4; k++) {
+      tail_w_L[k][lane] = w_L[k][point];
+      tail_w_R[k][lane] = w_R[k][point];
+    }
+    tail_nx[lane] = nx[point];
+    tail_ny[lane] = ny[point];
+  }
+  kernel(tail_result, tail_w_L, tail_w_R, tail_nx, tail_ny, 0, kappa);
+  for(int lane = 0; i + lane < n; lane++)
+    for(unsigned int k = 0; k < 4; k++)
+      result[k][i + lane] = tail_result[k][lane];
+}
+#endif
+
+const char* NumericalFlux::batch_instruction_set()
+{
+#if defined(WITH_AVX512)
+  return "AVX-512";
+#elif defined(WITH_AVX2)
+  return "AVX2";
+#else
+  return "none (scalar)";
+#endif
+}
 
 NumericalFlux::NumericalFlux(double kappa) : kappa(kappa)
 {
 }
 
-void NumericalFlux::Q(double result[4], double state_vector[4], double nx, double ny)
+
+void NumericalFlux::Q(double result[4], double state_vector[4], double nx, double ny) const
 {
   result[0] = state_vector[0];
   double temp_result_1 = nx * state_vector[1] + ny * state_vector[2];
@@ -14,7 +452,7 @@ void NumericalFlux::Q(double result[4], double state_vector[4], double nx, doubl
   result[3] = state_vector[3];
 }
 
-void NumericalFlux::Q_inv(double result[4], double state_vector[4], double nx, double ny)
+void NumericalFlux::Q_inv(double result[4], double state_vector[4], double nx, double ny) const
 {
   result[0] = state_vector[0];
   double temp_result_1 = nx * state_vector[1] - ny * state_vector[2];
@@ -24,7 +462,7 @@ void NumericalFlux::Q_inv(double result[4], double state_vector[4], double nx, d
   result[3] = state_vector[3];
 }
 
-void NumericalFlux::f_1(double result[4], double state[4])
+void NumericalFlux::f_1(double result[4], double state[4]) const
 {
   result[0] = state[1];
   result[1] = state[1] * state[1] / state[0] + QuantityCalculator::calc_pressure(state[0], state[1], state[2], state[3], kappa);
@@ -32,13 +470,194 @@ void NumericalFlux::f_1(double result[4], double state[4])
   result[3] = (state[1] / state[0]) * (state[3] + QuantityCalculator::calc_pressure(state[0], state[1], state[2], state[3], kappa));
 }
 
+void NumericalFlux::numerical_flux(double result[4], double w_L[4], double w_R[4],
+          double nx, double ny)
+{
+  numerical_flux(workspace, result, w_L, w_R, nx, ny);
+}
 
-VijayasundaramNumericalFlux::VijayasundaramNumericalFlux(double kappa) : StegerWarmingNumericalFlux(kappa)
+double NumericalFlux::numerical_flux_i(int component, double w_L[4], double w_R[4],
+          double nx, double ny)
 {
+  double result[4];
+  numerical_flux(workspace, result, w_L, w_R, nx, ny);
+  return result[component];
 }
 
-void VijayasundaramNumericalFlux::numerical_flux(double result[4], double w_L[4], double w_R[4],
+void NumericalFlux::numerical_flux_solid_wall(double result[4], double w_L[4], double nx, double ny)
+{
+  numerical_flux_solid_wall(workspace, result, w_L, nx, ny);
+}
+
+double NumericalFlux::numerical_flux_solid_wall_i(int component, double w_L[4], double nx, double ny)
+{
+  double result[4];
+  numerical_flux_solid_wall(workspace, result, w_L, nx, ny);
+  return result[component];
+}
+
+void NumericalFlux::numerical_flux_inlet(double result[4], double w_L[4], double w_B[4],
           double nx, double ny)
+{
+  numerical_flux_inlet(workspace, result, w_L, w_B, nx, ny);
+}
+
+double NumericalFlux::numerical_flux_inlet_i(int component, double w_L[4], double w_B[4],
+          double nx, double ny)
+{
+  double result[4];
+  numerical_flux_inlet(workspace, result, w_L, w_B, nx, ny);
+  return result[component];
+}
+
+void NumericalFlux::numerical_flux_outlet(double result[4], double w_L[4], double pressure, double nx, double ny)
+{
+  numerical_flux_outlet(workspace, result, w_L, pressure, nx, ny);
+}
+
+double NumericalFlux::numerical_flux_outlet_i(int component, double w_L[4], double pressure, double nx, double ny)
+{
+  double result[4];
+  numerical_flux_outlet(workspace, result, w_L, pressure, nx, ny);
+  return result[component];
+}
+
+void NumericalFlux::numerical_flux_batch(int n, double* result[4], double* w_L[4], double* w_R[4],
+          double* nx, double* ny) const
+{
+  NumericalFluxWorkspace ws;
+  double w_L_i[4], w_R_i[4], result_i[4];
+  for(int i = 0; i < n; i++) {
+    for(unsigned int k = 0; k < 4; k++) {
+      w_L_i[k] = w_L[k][i];
+      w_R_i[k] = w_R[k][i];
+    }
+    numerical_flux(ws, result_i, w_L_i, w_R_i, nx[i], ny[i]);
+    for(unsigned int k = 0; k < 4; k++)
+      result[k][i] = result_i[k];
+  }
+}
+
+void NumericalFlux::numerical_flux_solid_wall(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double nx, double ny) const
+{
+  Q(ws.q_L, w_L, nx, ny);
+  ws.a_B = QuantityCalculator::calc_sound_speed(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa) + ((kappa - 1) * ws.q_L[1] / (2 * ws.q_L[0]));
+  double rho_B = std::pow(ws.a_B * ws.a_B * ws.q_L[0] / (kappa * QuantityCalculator::calc_pressure(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa)), (1 / (kappa - 1))) * ws.q_L[0];
+  ws.q_R[0] = 0;
+  ws.q_R[1] = rho_B * ws.a_B * ws.a_B / kappa;
+  ws.q_R[2] = 0;
+  ws.q_R[3] = 0;
+  Q_inv(result, ws.q_R, nx, ny);
+}
+  
+void NumericalFlux::numerical_flux_inlet(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_B[4],
+        double nx, double ny) const
+{
+  // At the beginning, rotate the states into the local coordinate system and store the left and right state
+  // in the workspace so we do not have to pass it around.
+  Q(ws.q_L, w_L, nx, ny);
+  Q(ws.q_B, w_B, nx, ny);
+
+  // Speeds of sound.
+  ws.a_L = QuantityCalculator::calc_sound_speed(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa);
+  ws.a_B = QuantityCalculator::calc_sound_speed(ws.q_B[0], ws.q_B[1], ws.q_B[2], ws.q_B[3], kappa);
+
+  if(ws.q_L[1] / ws.q_L[0] > ws.a_L) {// Supersonic inlet - everything is prescribed.
+    f_1(result, ws.q_B);
+    Q_inv(result, result, nx, ny);
+    return;
+  }
+  else {// Subsonic inlet - only rho_b, v_x, v_y are prescribed, pressure is calculated as follows. The pressure is prescribed always so that one can know if the
+    // inlet is subsonic or supersonic.
+    double a_1 = ws.a_L + ((kappa - 1) / 2) * (ws.q_L[1] / ws.q_L[0] - ws.q_B[1] / ws.q_B[0]);
+    ws.q_1[0] = std::pow(a_1 * a_1 * ws.q_L[0] / (kappa * QuantityCalculator::calc_pressure(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa)), 1 / (kappa - 1)) * ws.q_L[0];
+    ws.q_1[1] = ws.q_1[0] * ws.q_B[1] / ws.q_B[0];
+    ws.q_1[2] = ws.q_1[0] * ws.q_L[2] / ws.q_L[0];
+    ws.q_1[3] = QuantityCalculator::calc_energy(ws.q_1[0], ws.q_1[1], ws.q_1[2], a_1 * a_1 * ws.q_1[0] / kappa, kappa);
+    if(ws.q_B[1] / ws.q_B[0] < 0)
+      if(ws.q_B[1] / ws.q_B[0] < a_1) {
+        f_1(result, ws.q_B);
+        Q_inv(result, result, nx, ny);
+        return;
+      }
+      else {
+        double a_l_star = (((kappa - 1) / (kappa + 1)) * ws.q_L[1] / ws.q_L[0]) + 2 * ws.a_L / (kappa + 1);
+        ws.q_L_star[0] = std::pow(a_l_star / ws.a_L, 2 / (kappa - 1)) * ws.q_L[0];
+        ws.q_L_star[1] = a_l_star;
+        ws.q_L_star[2] = ws.q_L_star[0] * ws.q_L[2] / ws.q_L[0];
+        ws.q_L_star[3] = QuantityCalculator::calc_energy(ws.q_L_star[0], ws.q_L_star[1], ws.q_L_star[2], ws.q_L_star[0] * a_l_star * a_l_star / kappa, kappa);
+        double first_f_1[4];
+        double second_f_1[4];
+        double third_f_1[4];
+        f_1(first_f_1, ws.q_B);
+        f_1(second_f_1, ws.q_L_star);
+        f_1(third_f_1, ws.q_1);
+        for(unsigned int i = 0; i < 4; i++)
+          result[i] = first_f_1[i] + second_f_1[i] - third_f_1[i];
+        Q_inv(result, result, nx, ny);
+        return;
+      }
+    else
+      if(ws.q_B[1] / ws.q_B[0] < a_1) {
+        f_1(result, ws.q_1);
+        Q_inv(result, result, nx, ny);
+        return;
+      }
+      else {
+        double a_l_star = (((kappa - 1) / (kappa + 1)) * ws.q_L[1] / ws.q_L[0]) + 2 * ws.a_L / (kappa + 1);
+        ws.q_L_star[0] = std::pow(a_l_star / ws.a_L, 2 / (kappa - 1)) * ws.q_L[0];
+        ws.q_L_star[1] = a_l_star;
+        ws.q_L_star[2] = ws.q_L_star[0] * ws.q_L[2] / ws.q_L[0];
+        ws.q_L_star[3] = QuantityCalculator::calc_energy(ws.q_L_star[0], ws.q_L_star[1], ws.q_L_star[2], ws.q_L_star[0] * a_l_star * a_l_star / kappa, kappa);
+        f_1(result, ws.q_L_star);
+        Q_inv(result, result, nx, ny);
+        return;
+      }
+  }
+}
+  
+void NumericalFlux::numerical_flux_outlet(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double pressure, double nx, double ny) const
+{
+  // At the beginning, rotate the states into the local coordinate system and store the left and right state
+  // in the workspace so we do not have to pass it around.
+  Q(ws.q_L, w_L, nx, ny);
+
+  ws.a_L = QuantityCalculator::calc_sound_speed(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa);
+
+  if(ws.q_L[1] / ws.q_L[0] > ws.a_L) {// Supersonic inlet - everything is prescribed.
+    f_1(result, ws.q_L);
+    Q_inv(result, result, nx, ny);
+    return;
+  }
+  else {
+    ws.q_B[0] = ws.q_L[0] * std::pow(pressure / QuantityCalculator::calc_pressure(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa), 1 / kappa);
+    ws.q_B[1] = ws.q_B[0] * (ws.q_L[1] / ws.q_L[0] + (2 / (kappa - 1)) * (ws.a_L - std::sqrt(kappa * pressure / ws.q_B[0])));
+    ws.q_B[2] = ws.q_B[0] * ws.q_L[2] / ws.q_L[0];
+    ws.q_B[3] = QuantityCalculator::calc_energy(ws.q_B[0], ws.q_B[1], ws.q_B[2], pressure, kappa);
+    if(ws.q_B[1] / ws.q_B[0] < QuantityCalculator::calc_sound_speed(ws.q_B[0], ws.q_B[1], ws.q_B[2], ws.q_B[3], kappa)) {
+      f_1(result, ws.q_B);
+      Q_inv(result, result, nx, ny);
+      return;
+    }
+    else {
+      double a_l_star = (((kappa - 1) / (kappa + 1)) * ws.q_L[1] / ws.q_L[0]) + 2 * ws.a_L / (kappa + 1);
+      ws.q_L_star[0] = std::pow(a_l_star / ws.a_L, 2 / (kappa - 1)) * ws.q_L[0];
+      ws.q_L_star[1] = a_l_star;
+      ws.q_L_star[2] = ws.q_L_star[0] * ws.q_L[2] / ws.q_L[0];
+      ws.q_L_star[3] = QuantityCalculator::calc_energy(ws.q_L_star[0], ws.q_L_star[1], ws.q_L_star[2], ws.q_L_star[0] * a_l_star * a_l_star / kappa, kappa);
+      f_1(result, ws.q_L_star);
+      Q_inv(result, result, nx, ny);
+      return;
+    }
+  }
+}
+
+VijayasundaramNumericalFlux::VijayasundaramNumericalFlux(double kappa) : StegerWarmingNumericalFlux(kappa)
+{
+}
+
+void VijayasundaramNumericalFlux::numerical_flux(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_R[4],
+          double nx, double ny) const
 {
   double result_temp[4];
   double w_mean[4];
@@ -46,82 +665,109 @@ void VijayasundaramNumericalFlux::numerical_flux(double result[4], double w_L[4]
   w_mean[1] = w_L[1] + w_R[1];
   w_mean[2] = w_L[2] + w_R[2];
   w_mean[3] = w_L[3] + w_R[3];
-  P_plus(result_temp, w_mean, w_L, nx, ny);
-  P_minus(result, w_mean, w_R, nx, ny);
+  P_plus(ws, result_temp, w_mean, w_L, nx, ny);
+  P_minus(ws, result, w_mean, w_R, nx, ny);
   for(unsigned int i = 0; i < 4; i++)
     result[i] += result_temp[i];
 }
 
+void VijayasundaramNumericalFlux::numerical_flux_batch(int n, double* result[4], double* w_L[4], double* w_R[4],
+          double* nx, double* ny) const
+{
+#ifdef NUMERICAL_FLUX_SIMD
+  simd_numerical_flux_batch(vijayasundaram_simd, n, result, w_L, w_R, nx, ny, kappa);
+#else
+  // The same as numerical_flux(), without a virtual call per point.
+  NumericalFluxWorkspace ws;
+  double w_mean[4], w_L_i[4], w_R_i[4], result_temp[4], result_i[4];
+  for(int i = 0; i < n; i++) {
+    for(unsigned int k = 0; k < 4; k++) {
+      w_L_i[k] = w_L[k][i];
+      w_R_i[k] = w_R[k][i];
+      w_mean[k] = w_L_i[k] + w_R_i[k];
+    }
+    P_plus(ws, result_temp, w_mean, w_L_i, nx[i], ny[i]);
+    P_minus(ws, result_i, w_mean, w_R_i, nx[i], ny[i]);
+    for(unsigned int k = 0; k < 4; k++)
+      result[k][i] = result_i[k] + result_temp[k];
+  }
+#endif
+}
+
 StegerWarmingNumericalFlux::StegerWarmingNumericalFlux(double kappa) : NumericalFlux(kappa) {};
 
 
-void StegerWarmingNumericalFlux::numerical_flux(double result[4], double w_L[4], double w_R[4],
-        double nx, double ny)
+void StegerWarmingNumericalFlux::numerical_flux(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_R[4],
+        double nx, double ny) const
 {
   double result_temp[4];
-  P_plus(result_temp, w_L, w_L, nx, ny);
-  P_minus(result, w_R, w_R, nx, ny);
+  P_plus(ws, result_temp, w_L, w_L, nx, ny);
+  P_minus(ws, result, w_R, w_R, nx, ny);
   for(unsigned int i = 0; i < 4; i++)
     result[i] += result_temp[i];
 }
-  
-double StegerWarmingNumericalFlux::numerical_flux_i(int component, double w_L[4], double w_R[4],
-          double nx, double ny)
+
+void StegerWarmingNumericalFlux::numerical_flux_batch(int n, double* result[4], double* w_L[4], double* w_R[4],
+          double* nx, double* ny) const
 {
-  double result[4];
-  numerical_flux(result, w_L, w_R, nx, ny);
-  return result[component];
+#ifdef NUMERICAL_FLUX_SIMD
+  simd_numerical_flux_batch(steger_warming_simd, n, result, w_L, w_R, nx, ny, kappa);
+#else
+  // The same as numerical_flux(), without a virtual call per point.
+  NumericalFluxWorkspace ws;
+  double w_L_i[4], w_R_i[4], result_temp[4], result_i[4];
+  for(int i = 0; i < n; i++) {
+    for(unsigned int k = 0; k < 4; k++) {
+      w_L_i[k] = w_L[k][i];
+      w_R_i[k] = w_R[k][i];
+    }
+    P_plus(ws, result_temp, w_L_i, w_L_i, nx[i], ny[i]);
+    P_minus(ws, result_i, w_R_i, w_R_i, nx[i], ny[i]);
+    for(unsigned int k = 0; k < 4; k++)
+      result[k][i] = result_i[k] + result_temp[k];
+  }
+#endif
 }
 
 void StegerWarmingNumericalFlux::P_plus(double result[4], double w[4], double param[4],
-          double nx, double ny)
+          double nx, double ny) const
 {
-  Q(q, w, nx, ny);
+  NumericalFluxWorkspace ws;
+  P_plus(ws, result, w, param, nx, ny);
+}
 
-  // Initialize the matrices.
-  double T[4][4];
-  for(unsigned int i = 0; i < 4; i++)
-    for(unsigned int j = 0; j < 4; j++)
-      T[i][j] = 0.0;
+void StegerWarmingNumericalFlux::P_plus(NumericalFluxWorkspace& ws, double result[4], double w[4], double param[4],
+          double nx, double ny) const
+{
+  Q(ws.q, w, nx, ny);
 
-  double T_inv[4][4];
-  for(unsigned int i = 0; i < 4; i++)
+  double A_1[4][4];
+  A_plus(ws, A_1);
+
+  // Finale.
+  Q(param, param, nx, ny);
+  for(unsigned int i = 0; i < 4; i++) {
+    result[i] = 0;
     for(unsigned int j = 0; j < 4; j++)
-      T_inv[i][j] = 0.0;
+      result[i] +=A_1[i][j] * param[j];
+  }
+  Q_inv(result, result, nx, ny);
+}
 
-  // Calculate Lambda^+.
-  Lambda_plus(result);
+void StegerWarmingNumericalFlux::P_minus(double result[4], double w[4], double param[4],
+          double nx, double ny) const
+{
+  NumericalFluxWorkspace ws;
+  P_minus(ws, result, w, param, nx, ny);
+}
 
-  // Calculate the necessary rows / columns of T(T_inv).
-  if(result[0] > 0) {
-    T_1(T);
-    T_inv_1(T_inv);
-  }
-  if(result[1] > 0) {
-    T_2(T);
-    T_inv_2(T_inv);
-  }
-  if(result[2] > 0) {
-    T_3(T);
-    T_inv_3(T_inv);
-  }
-  if(result[3] > 0) {
-    T_4(T);
-    T_inv_4(T_inv);
-  }
+void StegerWarmingNumericalFlux::P_minus(NumericalFluxWorkspace& ws, double result[4], double w[4], double param[4],
+          double nx, double ny) const
+{
+  Q(ws.q, w, nx, ny);
 
-  // The matrix T * Lambda * T^{-1}
-  double diag_inv[4][4];
   double A_1[4][4];
-  for(unsigned int i = 0; i < 4; i++)
-    for(unsigned int j = 0; j < 4; j++)
-      diag_inv[i][j] = result[i] * T_inv[i][j];
-  for(unsigned int i = 0; i < 4; i++)
-    for(unsigned int j = 0; j < 4; j++) {
-      A_1[i][j] = 0;
-      for(unsigned int k = 0; k < 4; k++)
-        A_1[i][j] += T[i][k] * diag_inv[k][j];
-    }
+  A_minus(ws, A_1);
 
   // Finale.
   Q(param, param, nx, ny);
@@ -133,11 +779,46 @@ void StegerWarmingNumericalFlux::P_plus(double result[4], double w[4], double pa
   Q_inv(result, result, nx, ny);
 }
 
-void StegerWarmingNumericalFlux::P_minus(double result[4], double w[4], double param[4],
-          double nx, double ny)
+void StegerWarmingNumericalFlux::P_plus_columns(double result[4][4], double w[4],
+          double nx, double ny) const
+{
+  NumericalFluxWorkspace ws;
+  Q(ws.q, w, nx, ny);
+
+  double A_1[4][4];
+  A_plus(ws, A_1);
+
+  rotate_columns(result, A_1, nx, ny);
+}
+
+void StegerWarmingNumericalFlux::P_minus_columns(double result[4][4], double w[4],
+          double nx, double ny) const
 {
-  Q(q, w, nx, ny);
+  NumericalFluxWorkspace ws;
+  Q(ws.q, w, nx, ny);
+
+  double A_1[4][4];
+  A_minus(ws, A_1);
 
+  rotate_columns(result, A_1, nx, ny);
+}
+
+void StegerWarmingNumericalFlux::A_plus(NumericalFluxWorkspace& ws, double result[4][4]) const
+{
+  double lambda[4];
+  Lambda_plus(ws, lambda);
+  A_from_eigenvalues(ws, result, lambda, true);
+}
+
+void StegerWarmingNumericalFlux::A_minus(NumericalFluxWorkspace& ws, double result[4][4]) const
+{
+  double lambda[4];
+  Lambda_minus(ws, lambda);
+  A_from_eigenvalues(ws, result, lambda, false);
+}
+
+void StegerWarmingNumericalFlux::A_from_eigenvalues(NumericalFluxWorkspace& ws, double result[4][4], double lambda[4], bool positive) const
+{
   // Initialize the matrices.
   double T[4][4];
   for(unsigned int i = 0; i < 4; i++)
@@ -149,284 +830,146 @@ void StegerWarmingNumericalFlux::P_minus(double result[4], double w[4], double p
     for(unsigned int j = 0; j < 4; j++)
       T_inv[i][j] = 0.0;
 
-  // Calculate Lambda^-.
-  Lambda_minus(result);
-
   // Calculate the necessary rows / columns of T(T_inv).
-  if(result[0] < 0) {
-    T_1(T);
-    T_inv_1(T_inv);
+  if(positive ? lambda[0] > 0 : lambda[0] < 0) {
+    T_1(ws, T);
+    T_inv_1(ws, T_inv);
   }
-  if(result[1] < 0) {
-    T_2(T);
-    T_inv_2(T_inv);
+  if(positive ? lambda[1] > 0 : lambda[1] < 0) {
+    T_2(ws, T);
+    T_inv_2(ws, T_inv);
   }
-  if(result[2] < 0) {
-    T_3(T);
-    T_inv_3(T_inv);
+  if(positive ? lambda[2] > 0 : lambda[2] < 0) {
+    T_3(ws, T);
+    T_inv_3(ws, T_inv);
   }
-  if(result[3] < 0) {
-    T_4(T);
-    T_inv_4(T_inv);
+  if(positive ? lambda[3] > 0 : lambda[3] < 0) {
+    T_4(ws, T);
+    T_inv_4(ws, T_inv);
   }
 
-
   // The matrix T * Lambda * T^{-1}
   double diag_inv[4][4];
-  double A_1[4][4];
   for(unsigned int i = 0; i < 4; i++)
     for(unsigned int j = 0; j < 4; j++)
-      diag_inv[i][j] = result[i] * T_inv[i][j];
+      diag_inv[i][j] = lambda[i] * T_inv[i][j];
   for(unsigned int i = 0; i < 4; i++)
     for(unsigned int j = 0; j < 4; j++) {
-      A_1[i][j] = 0;
+      result[i][j] = 0;
       for(unsigned int k = 0; k < 4; k++)
-        A_1[i][j] += T[i][k] * diag_inv[k][j];
+        result[i][j] += T[i][k] * diag_inv[k][j];
     }
+}
 
-  // Finale.
-  Q(param, param, nx, ny);
-  for(unsigned int i = 0; i < 4; i++) {
-    result[i] = 0;
-    for(unsigned int j = 0; j < 4; j++)
-      result[i] +=A_1[i][j] * param[j];
+void StegerWarmingNumericalFlux::rotate_columns(double result[4][4], double A[4][4], double nx, double ny) const
+{
+  // Same sequence of operations as the Finale of P_plus / P_minus, applied to every unit vector,
+  // so that the columns are bit-for-bit identical to four separate calls.
+  for(unsigned int k = 0; k < 4; k++) {
+    double param[4] = {0, 0, 0, 0};
+    param[k] = 1;
+    Q(param, param, nx, ny);
+    for(unsigned int i = 0; i < 4; i++) {
+      result[k][i] = 0;
+      for(unsigned int j = 0; j < 4; j++)
+        result[k][i] += A[i][j] * param[j];
+    }
+    Q_inv(result[k], result[k], nx, ny);
   }
-  Q_inv(result, result, nx, ny);
 }
 
-void StegerWarmingNumericalFlux::Lambda_plus(double result[4])
+void StegerWarmingNumericalFlux::Lambda_plus(NumericalFluxWorkspace& ws, double result[4]) const
 {
-  a = QuantityCalculator::calc_sound_speed(q[0], q[1], q[2], q[3], kappa);
-  u = q[1] / q[0];
-  v = q[2] / q[0];
-  V = u*u + v*v;
-  result[0] = u - a < 0 ? 0 : u - a;
-  result[1] = u < 0 ? 0 : u;
-  result[2] = u < 0 ? 0 : u;
-  result[3] = u + a < 0 ? 0 : u + a;
+  ws.a = QuantityCalculator::calc_sound_speed(ws.q[0], ws.q[1], ws.q[2], ws.q[3], kappa);
+  ws.u = ws.q[1] / ws.q[0];
+  ws.v = ws.q[2] / ws.q[0];
+  ws.V = ws.u*ws.u + ws.v*ws.v;
+  result[0] = ws.u - ws.a < 0 ? 0 : ws.u - ws.a;
+  result[1] = ws.u < 0 ? 0 : ws.u;
+  result[2] = ws.u < 0 ? 0 : ws.u;
+  result[3] = ws.u + ws.a < 0 ? 0 : ws.u + ws.a;
 }
 
-void StegerWarmingNumericalFlux::Lambda_minus(double result[4])
+void StegerWarmingNumericalFlux::Lambda_minus(NumericalFluxWorkspace& ws, double result[4]) const
 {
-  a = QuantityCalculator::calc_sound_speed(q[0], q[1], q[2], q[3], kappa);
-  u = q[1] / q[0];
-  v = q[2] / q[0];
-  V = u*u + v*v;
-  result[0] = u - a < 0 ? u - a : 0;
-  result[1] = u < 0 ? u : 0;
-  result[2] = u < 0 ? u : 0;
-  result[3] = u + a < 0 ? u + a : 0;
+  ws.a = QuantityCalculator::calc_sound_speed(ws.q[0], ws.q[1], ws.q[2], ws.q[3], kappa);
+  ws.u = ws.q[1] / ws.q[0];
+  ws.v = ws.q[2] / ws.q[0];
+  ws.V = ws.u*ws.u + ws.v*ws.v;
+  result[0] = ws.u - ws.a < 0 ? ws.u - ws.a : 0;
+  result[1] = ws.u < 0 ? ws.u : 0;
+  result[2] = ws.u < 0 ? ws.u : 0;
+  result[3] = ws.u + ws.a < 0 ? ws.u + ws.a : 0;
 }
 
-void StegerWarmingNumericalFlux::Lambda(double result[4])
+void StegerWarmingNumericalFlux::Lambda(NumericalFluxWorkspace& ws, double result[4]) const
 {
-  a = QuantityCalculator::calc_sound_speed(q[0], q[1], q[2], q[3], kappa);
-  u = q[1] / q[0];
-  v = q[2] / q[0];
-  V = u*u + v*v;
-  result[0] = u - a ;
-  result[1] = u;
-  result[2] = u;
-  result[3] = u + a;
+  ws.a = QuantityCalculator::calc_sound_speed(ws.q[0], ws.q[1], ws.q[2], ws.q[3], kappa);
+  ws.u = ws.q[1] / ws.q[0];
+  ws.v = ws.q[2] / ws.q[0];
+  ws.V = ws.u*ws.u + ws.v*ws.v;
+  result[0] = ws.u - ws.a ;
+  result[1] = ws.u;
+  result[2] = ws.u;
+  result[3] = ws.u + ws.a;
 }
 
-void StegerWarmingNumericalFlux::T_1(double result[4][4])
+void StegerWarmingNumericalFlux::T_1(const NumericalFluxWorkspace& ws, double result[4][4]) const
 {
   result[0][0] = 1.0;
-  result[1][0] = u - a;
-  result[2][0] = v;
-  result[3][0] = (V / 2.0) + (a*a / (kappa - 1.0)) - (u * a);
+  result[1][0] = ws.u - ws.a;
+  result[2][0] = ws.v;
+  result[3][0] = (ws.V / 2.0) + (ws.a*ws.a / (kappa - 1.0)) - (ws.u * ws.a);
 }
-void StegerWarmingNumericalFlux::T_2(double result[4][4])
+void StegerWarmingNumericalFlux::T_2(const NumericalFluxWorkspace& ws, double result[4][4]) const
 {
   result[0][1] = 1.0;
-  result[1][1] = u;
-  result[2][1] = v;
-  result[3][1] = V / 2.0;
+  result[1][1] = ws.u;
+  result[2][1] = ws.v;
+  result[3][1] = ws.V / 2.0;
 }
-void StegerWarmingNumericalFlux::T_3(double result[4][4])
+void StegerWarmingNumericalFlux::T_3(const NumericalFluxWorkspace& ws, double result[4][4]) const
 {
   result[0][2] = 1.0;
-  result[1][2] = u;
-  result[2][2] = v - a;
-  result[3][2] = (V / 2.0)  - v * a;
+  result[1][2] = ws.u;
+  result[2][2] = ws.v - ws.a;
+  result[3][2] = (ws.V / 2.0)  - ws.v * ws.a;
 }
-void StegerWarmingNumericalFlux::T_4(double result[4][4])
+void StegerWarmingNumericalFlux::T_4(const NumericalFluxWorkspace& ws, double result[4][4]) const
 {
   result[0][3] = 1.0;
-  result[1][3] = u + a;
-  result[2][3] = v;
-  result[3][3] = (V / 2.0) + (a * a / (kappa - 1.0)) + (u * a);
-}
-
-void StegerWarmingNumericalFlux::T_inv_1(double result[4][4])
-{
-  result[0][0] = (1.0 / (a * a)) * (0.5 * (((kappa - 1) * V / 2.0) + u * a));
-  result[0][1] = (1.0 / (a * a)) * (- (a + u * (kappa - 1.0)) / 2.0);
-  result[0][2] = (1.0 / (a * a)) * (- (v * (kappa - 1.0)) / 2.0);
-  result[0][3] = (1.0 / (a * a)) * (kappa - 1.0) / 2.0;
-}
-void StegerWarmingNumericalFlux::T_inv_2(double result[4][4])
-{
-  result[1][0] = (1.0 / (a * a)) * (a * a - v * a - (kappa - 1.0) * (V / 2.0));
-  result[1][1] = (1.0 / (a * a)) * u * (kappa - 1.0);
-  result[1][2] = (1.0 / (a * a)) * (a + v * (kappa - 1.0));
-  result[1][3] = (1.0 / (a * a)) * (1.0 - kappa);
-}
-void StegerWarmingNumericalFlux::T_inv_3(double result[4][4])
-{
-  result[2][0] = (1.0 / (a * a)) * v * a;
-  result[2][1] = (1.0 / (a * a)) * 0.0;
-  result[2][2] = (1.0 / (a * a)) * (-a);
-  result[2][3] = (1.0 / (a * a)) * 0.0;
+  result[1][3] = ws.u + ws.a;
+  result[2][3] = ws.v;
+  result[3][3] = (ws.V / 2.0) + (ws.a * ws.a / (kappa - 1.0)) + (ws.u * ws.a);
 }
-void StegerWarmingNumericalFlux::T_inv_4(double result[4][4])
-{
-  result[3][0] = (1.0 / (a * a)) * (0.5 * (((kappa - 1.0) * V / 2.0) - u * a));
-  result[3][1] = (1.0 / (a * a)) * (a - u * (kappa - 1.0)) / 2.0;
-  result[3][2] = (1.0 / (a * a)) * (- (v * (kappa - 1.0)) / 2.0);
-  result[3][3] = (1.0 / (a * a)) * (kappa - 1.0) / 2.0;
-}
-
-void StegerWarmingNumericalFlux::numerical_flux_solid_wall(double result[4], double w_L[4], double nx, double ny)
-{
-  Q(q_L, w_L, nx, ny);
-  a_B = QuantityCalculator::calc_sound_speed(q_L[0], q_L[1], q_L[2], q_L[3], kappa) + ((kappa - 1) * q_L[1] / (2 * q_L[0]));
-  double rho_B = std::pow(a_B * a_B * q_L[0] / (kappa * QuantityCalculator::calc_pressure(q_L[0], q_L[1], q_L[2], q_L[3], kappa)), (1 / (kappa - 1))) * q_L[0];
-  q_R[0] = 0;
-  q_R[1] = rho_B * a_B * a_B / kappa;
-  q_R[2] = 0;
-  q_R[3] = 0;
-  Q_inv(result, q_R, nx, ny);
-}
-  
-double StegerWarmingNumericalFlux::numerical_flux_solid_wall_i(int component, double w_L[4], double nx, double ny)
-{
-  double result[4];
-  numerical_flux_solid_wall(result, w_L, nx, ny);
-  return result[component];
-}
-
-void StegerWarmingNumericalFlux::numerical_flux_inlet(double result[4], double w_L[4], double w_B[4],
-        double nx, double ny)
-{
-  // At the beginning, rotate the states into the local coordinate system and store the left and right state
-  // so we do not have to pass it around.
-  Q(q_L, w_L, nx, ny);
-  Q(q_B, w_B, nx, ny);
-
-  // Speeds of sound.
-  a_L = QuantityCalculator::calc_sound_speed(q_L[0], q_L[1], q_L[2], q_L[3], kappa);
-  a_B = QuantityCalculator::calc_sound_speed(q_B[0], q_B[1], q_B[2], q_B[3], kappa);
 
-  if(q_L[1] / q_L[0] > a_L) {// Supersonic inlet - everything is prescribed.
-    f_1(result, q_B);
-    Q_inv(result, result, nx, ny);
-    return;
-  }
-  else {// Subsonic inlet - only rho_b, v_x, v_y are prescribed, pressure is calculated as follows. The pressure is prescribed always so that one can know if the
-    // inlet is subsonic or supersonic.
-    double a_1 = a_L + ((kappa - 1) / 2) * (q_L[1] / q_L[0] - q_B[1] / q_B[0]);
-    q_1[0] = std::pow(a_1 * a_1 * q_L[0] / (kappa * QuantityCalculator::calc_pressure(q_L[0], q_L[1], q_L[2], q_L[3], kappa)), 1 / (kappa - 1)) * q_L[0];
-    q_1[1] = q_1[0] * q_B[1] / q_B[0];
-    q_1[2] = q_1[0] * q_L[2] / q_L[0];
-    q_1[3] = QuantityCalculator::calc_energy(q_1[0], q_1[1], q_1[2], a_1 * a_1 * q_1[0] / kappa, kappa);
-    if(q_B[1] / q_B[0] < 0)
-      if(q_B[1] / q_B[0] < a_1) {
-        f_1(result, q_B);
-        Q_inv(result, result, nx, ny);
-        return;
-      }
-      else {
-        double a_l_star = (((kappa - 1) / (kappa + 1)) * q_L[1] / q_L[0]) + 2 * a_L / (kappa + 1);
-        q_L_star[0] = std::pow(a_l_star / a_L, 2 / (kappa - 1)) * q_L[0];
-        q_L_star[1] = a_l_star;
-        q_L_star[2] = q_L_star[0] * q_L[2] / q_L[0];
-        q_L_star[3] = QuantityCalculator::calc_energy(q_L_star[0], q_L_star[1], q_L_star[2], q_L_star[0] * a_l_star * a_l_star / kappa, kappa);
-        double first_f_1[4];
-        double second_f_1[4];
-        double third_f_1[4];
-        f_1(first_f_1, q_B);
-        f_1(second_f_1, q_L_star);
-        f_1(third_f_1, q_1);
-        for(unsigned int i = 0; i < 4; i++)
-          result[i] = first_f_1[i] + second_f_1[i] - third_f_1[i];
-        Q_inv(result, result, nx, ny);
-        return;
-      }
-    else
-      if(q_B[1] / q_B[0] < a_1) {
-        f_1(result, q_1);
-        Q_inv(result, result, nx, ny);
-        return;
-      }
-      else {
-        double a_l_star = (((kappa - 1) / (kappa + 1)) * q_L[1] / q_L[0]) + 2 * a_L / (kappa + 1);
-        q_L_star[0] = std::pow(a_l_star / a_L, 2 / (kappa - 1)) * q_L[0];
-        q_L_star[1] = a_l_star;
-        q_L_star[2] = q_L_star[0] * q_L[2] / q_L[0];
-        q_L_star[3] = QuantityCalculator::calc_energy(q_L_star[0], q_L_star[1], q_L_star[2], q_L_star[0] * a_l_star * a_l_star / kappa, kappa);
-        f_1(result, q_L_star);
-        Q_inv(result, result, nx, ny);
-        return;
-      }
-  }
-}
-  
-double StegerWarmingNumericalFlux::numerical_flux_inlet_i(int component, double w_L[4], double w_B[4],
-        double nx, double ny)
+void StegerWarmingNumericalFlux::T_inv_1(const NumericalFluxWorkspace& ws, double result[4][4]) const
 {
-  double result[4];
-  numerical_flux_inlet(result, w_L, w_B, nx, ny);
-  return result[component];
+  result[0][0] = (1.0 / (ws.a * ws.a)) * (0.5 * (((kappa - 1) * ws.V / 2.0) + ws.u * ws.a));
+  result[0][1] = (1.0 / (ws.a * ws.a)) * (- (ws.a + ws.u * (kappa - 1.0)) / 2.0);
+  result[0][2] = (1.0 / (ws.a * ws.a)) * (- (ws.v * (kappa - 1.0)) / 2.0);
+  result[0][3] = (1.0 / (ws.a * ws.a)) * (kappa - 1.0) / 2.0;
 }
-
-void StegerWarmingNumericalFlux::numerical_flux_outlet(double result[4], double w_L[4], double pressure, double nx, double ny)
+void StegerWarmingNumericalFlux::T_inv_2(const NumericalFluxWorkspace& ws, double result[4][4]) const
 {
-  // At the beginning, rotate the states into the local coordinate system and store the left and right state
-  // so we do not have to pass it around.
-  Q(q_L, w_L, nx, ny);
-
-  double a_L = QuantityCalculator::calc_sound_speed(q_L[0], q_L[1], q_L[2], q_L[3], kappa);
-
-  if(q_L[1] / q_L[0] > a_L) {// Supersonic inlet - everything is prescribed.
-    f_1(result, q_L);
-    Q_inv(result, result, nx, ny);
-    return;
-  }
-  else {
-    this->q_B[0] = q_L[0] * std::pow(pressure / QuantityCalculator::calc_pressure(this->q_L[0], this->q_L[1], this->q_L[2], this->q_L[3], kappa), 1 / kappa);
-    this->q_B[1] = this->q_B[0] * (q_L[1] / q_L[0] + (2 / (kappa - 1)) * (a_L - std::sqrt(kappa * pressure / q_B[0])));
-    this->q_B[2] = this->q_B[0] * this->q_L[2] / this->q_L[0];
-    this->q_B[3] = QuantityCalculator::calc_energy(this->q_B[0], this->q_B[1], this->q_B[2], pressure, kappa);
-    if(q_B[1] / q_B[0] < QuantityCalculator::calc_sound_speed(this->q_B[0], this->q_B[1], this->q_B[2], this->q_B[3], kappa)) {
-      f_1(result, q_B);
-      Q_inv(result, result, nx, ny);
-      return;
-    }
-    else {
-      double a_l_star = (((kappa - 1) / (kappa + 1)) * q_L[1] / q_L[0]) + 2 * a_L / (kappa + 1);
-      q_L_star[0] = std::pow(a_l_star / a_L, 2 / (kappa - 1)) * q_L[0];
-      q_L_star[1] = a_l_star;
-      q_L_star[2] = q_L_star[0] * q_L[2] / q_L[0];
-      q_L_star[3] = QuantityCalculator::calc_energy(q_L_star[0], q_L_star[1], q_L_star[2], q_L_star[0] * a_l_star * a_l_star / kappa, kappa);
-      f_1(result, q_L_star);
-      Q_inv(result, result, nx, ny);
-      return;
-    }
-  }
+  result[1][0] = (1.0 / (ws.a * ws.a)) * (ws.a * ws.a - ws.v * ws.a - (kappa - 1.0) * (ws.V / 2.0));
+  result[1][1] = (1.0 / (ws.a * ws.a)) * ws.u * (kappa - 1.0);
+  result[1][2] = (1.0 / (ws.a * ws.a)) * (ws.a + ws.v * (kappa - 1.0));
+  result[1][3] = (1.0 / (ws.a * ws.a)) * (1.0 - kappa);
 }
-  
-double StegerWarmingNumericalFlux::numerical_flux_outlet_i(int component, double w_L[4], double pressure, double nx, double ny)
+void StegerWarmingNumericalFlux::T_inv_3(const NumericalFluxWorkspace& ws, double result[4][4]) const
 {
-  double result[4];
-  numerical_flux_outlet(result, w_L, pressure, nx, ny);
-  return result[component];
+  result[2][0] = (1.0 / (ws.a * ws.a)) * ws.v * ws.a;
+  result[2][1] = (1.0 / (ws.a * ws.a)) * 0.0;
+  result[2][2] = (1.0 / (ws.a * ws.a)) * (-ws.a);
+  result[2][3] = (1.0 / (ws.a * ws.a)) * 0.0;
 }
-
-double* StegerWarmingNumericalFlux::get_q()
+void StegerWarmingNumericalFlux::T_inv_4(const NumericalFluxWorkspace& ws, double result[4][4]) const
 {
-  return q;
+  result[3][0] = (1.0 / (ws.a * ws.a)) * (0.5 * (((kappa - 1.0) * ws.V / 2.0) - ws.u * ws.a));
+  result[3][1] = (1.0 / (ws.a * ws.a)) * (ws.a - ws.u * (kappa - 1.0)) / 2.0;
+  result[3][2] = (1.0 / (ws.a * ws.a)) * (- (ws.v * (kappa - 1.0)) / 2.0);
+  result[3][3] = (1.0 / (ws.a * ws.a)) * (kappa - 1.0) / 2.0;
 }
 
 
@@ -435,115 +978,115 @@ OsherSolomonNumericalFlux::OsherSolomonNumericalFlux(double kappa) : NumericalFl
 {
 }
 
-void OsherSolomonNumericalFlux::numerical_flux(double result[4], double w_L[4], double w_R[4],
-          double nx, double ny)
+void OsherSolomonNumericalFlux::numerical_flux(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_R[4],
+          double nx, double ny) const
 {
 
   // At the beginning, rotate the states into the local coordinate system and store the left and right state
-  // so we do not have to pass it around.
-  Q(q_L, w_L, nx, ny);
-  Q(q_R, w_R, nx, ny);
+  // in the workspace so we do not have to pass it around.
+  Q(ws.q_L, w_L, nx, ny);
+  Q(ws.q_R, w_R, nx, ny);
 
   // Decide what we have to calculate.
   // Speeds of sound.
-  a_L = QuantityCalculator::calc_sound_speed(q_L[0], q_L[1], q_L[2], q_L[3], kappa);
-  a_R = QuantityCalculator::calc_sound_speed(q_R[0], q_R[1], q_R[2], q_R[3], kappa);
+  ws.a_L = QuantityCalculator::calc_sound_speed(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa);
+  ws.a_R = QuantityCalculator::calc_sound_speed(ws.q_R[0], ws.q_R[1], ws.q_R[2], ws.q_R[3], kappa);
   
   // Check that we can use the following.
   double right_hand_side = 0;
-  if((q_L[2] / q_L[0]) - (q_R[2] / q_R[0]) > 0)
-    right_hand_side = (q_L[2] / q_L[0] - q_R[2] / q_R[0] > 0) / 2;
-  if(a_L + a_R + ((kappa - 1) * (q_L[1] / q_L[0] - q_R[1] / q_R[0]) / 2) <= right_hand_side)
+  if((ws.q_L[2] / ws.q_L[0]) - (ws.q_R[2] / ws.q_R[0]) > 0)
+    right_hand_side = (ws.q_L[2] / ws.q_L[0] - ws.q_R[2] / ws.q_R[0] > 0) / 2;
+  if(ws.a_L + ws.a_R + ((kappa - 1) * (ws.q_L[1] / ws.q_L[0] - ws.q_R[1] / ws.q_R[0]) / 2) <= right_hand_side)
     error("Osher-Solomon numerical flux is not possible to construct according to the table.");
 
   // Utility numbers.
-  this->z_L = (0.5 * (kappa - 1) * q_L[1] / q_L[0]) + a_L;
-  this->z_R = (0.5 * (kappa - 1) * q_R[1] / q_R[0]) - a_R;
-  this->s_L = QuantityCalculator::calc_pressure(q_L[0], q_L[1], q_L[2], q_L[3], kappa) / std::pow(q_L[0], kappa);
-  this->s_R = QuantityCalculator::calc_pressure(q_R[0], q_R[1], q_R[2], q_R[3], kappa) / std::pow(q_R[0], kappa);
-  this->alpha = std::pow(s_R / s_L, 1 / (2 * kappa));
+  ws.z_L = (0.5 * (kappa - 1) * ws.q_L[1] / ws.q_L[0]) + ws.a_L;
+  ws.z_R = (0.5 * (kappa - 1) * ws.q_R[1] / ws.q_R[0]) - ws.a_R;
+  ws.s_L = QuantityCalculator::calc_pressure(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa) / std::pow(ws.q_L[0], kappa);
+  ws.s_R = QuantityCalculator::calc_pressure(ws.q_R[0], ws.q_R[1], ws.q_R[2], ws.q_R[3], kappa) / std::pow(ws.q_R[0], kappa);
+  ws.alpha = std::pow(ws.s_R / ws.s_L, 1 / (2 * kappa));
 
   // We always need to calculate q_1, a_1, a_3, as we are going to decide what to return based on this.
-  calculate_q_1_a_1_a_3();
+  calculate_q_1_a_1_a_3(ws);
 
   // First column in table 3.4.1 on the page 233 in Feist (2003).
-  if(q_R[1] / q_R[0] >= - a_R && q_L[1] / q_L[0] <= a_L) {
+  if(ws.q_R[1] / ws.q_R[0] >= - ws.a_R && ws.q_L[1] / ws.q_L[0] <= ws.a_L) {
     // First row.
-    if(a_1 <= q_1[1] / q_1[0]) {
-      calculate_q_L_star();
-      f_1(result, q_L_star);
+    if(ws.a_1 <= ws.q_1[1] / ws.q_1[0]) {
+      calculate_q_L_star(ws);
+      f_1(result, ws.q_L_star);
       Q_inv(result, result, nx, ny);
       return;
     }
     // Second row.
-    if(0 < q_1[1] / q_1[0] && q_1[1] / q_1[0] < a_1) {
-      f_1(result, q_1);
+    if(0 < ws.q_1[1] / ws.q_1[0] && ws.q_1[1] / ws.q_1[0] < ws.a_1) {
+      f_1(result, ws.q_1);
       Q_inv(result, result, nx, ny);
       return;
     }
     // Third row.
-    if(-a_3 <= q_1[1] / q_1[0] && q_1[1] / q_1[0] <= 0) {
-      calculate_q_3();
-      f_1(result, q_3);
+    if(-ws.a_3 <= ws.q_1[1] / ws.q_1[0] && ws.q_1[1] / ws.q_1[0] <= 0) {
+      calculate_q_3(ws);
+      f_1(result, ws.q_3);
       Q_inv(result, result, nx, ny);
       return;
     }
     // Fourth row.
-    if(q_1[1] / q_1[0] < -a_3) {
-      calculate_q_R_star();
-      f_1(result, q_R_star);
+    if(ws.q_1[1] / ws.q_1[0] < -ws.a_3) {
+      calculate_q_R_star(ws);
+      f_1(result, ws.q_R_star);
       Q_inv(result, result, nx, ny);
       return;
     }
   }
 
   // Second column in table 3.4.1 on the page 233 in Feist (2003).
-  if(q_R[1] / q_R[0] >= - a_R && q_L[1] / q_L[0] > a_L) {
+  if(ws.q_R[1] / ws.q_R[0] >= - ws.a_R && ws.q_L[1] / ws.q_L[0] > ws.a_L) {
     // First row.
-    if(a_1 <= q_1[1] / q_1[0]) {
-      f_1(result, q_L);
+    if(ws.a_1 <= ws.q_1[1] / ws.q_1[0]) {
+      f_1(result, ws.q_L);
       Q_inv(result, result, nx, ny);
       return;
     }
     // Second row.
-    if(0 < q_1[1] / q_1[0] && q_1[1] / q_1[0] < a_1) {
-      calculate_q_L_star();
+    if(0 < ws.q_1[1] / ws.q_1[0] && ws.q_1[1] / ws.q_1[0] < ws.a_1) {
+      calculate_q_L_star(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
-      f_1(first_f_1, q_L);
-      f_1(second_f_1, q_L_star);
-      f_1(third_f_1, q_1);
+      f_1(first_f_1, ws.q_L);
+      f_1(second_f_1, ws.q_L_star);
+      f_1(third_f_1, ws.q_1);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] - second_f_1[i] + third_f_1[i];
       Q_inv(result, result, nx, ny);
       return;
     }
     // Third row.
-    if(-a_3 <= q_1[1] / q_1[0] && q_1[1] / q_1[0] <= 0) {
-      calculate_q_L_star();
-      calculate_q_3();
+    if(-ws.a_3 <= ws.q_1[1] / ws.q_1[0] && ws.q_1[1] / ws.q_1[0] <= 0) {
+      calculate_q_L_star(ws);
+      calculate_q_3(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
-      f_1(first_f_1, q_L);
-      f_1(second_f_1, q_L_star);
-      f_1(third_f_1, q_3);
+      f_1(first_f_1, ws.q_L);
+      f_1(second_f_1, ws.q_L_star);
+      f_1(third_f_1, ws.q_3);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] - second_f_1[i] + third_f_1[i];
       Q_inv(result, result, nx, ny);
       return;
     }
     // Fourth row.
-    if(q_1[1] / q_1[0] < -a_3) {
-      calculate_q_L_star();
-      calculate_q_R_star();
+    if(ws.q_1[1] / ws.q_1[0] < -ws.a_3) {
+      calculate_q_L_star(ws);
+      calculate_q_R_star(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
-      f_1(first_f_1, q_L);
-      f_1(second_f_1, q_L_star);
-      f_1(third_f_1, q_R_star);
+      f_1(first_f_1, ws.q_L);
+      f_1(second_f_1, ws.q_L_star);
+      f_1(third_f_1, ws.q_R_star);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] - second_f_1[i] + third_f_1[i];
       Q_inv(result, result, nx, ny);
@@ -552,122 +1095,123 @@ void OsherSolomonNumericalFlux::numerical_flux(double result[4], double w_L[4],
   }
 
   // Third column in table 3.4.1 on the page 233 in Feist (2003).
-  if(q_R[1] / q_R[0] < - a_R && q_L[1] / q_L[0] <= a_L) {
+  if(ws.q_R[1] / ws.q_R[0] < - ws.a_R && ws.q_L[1] / ws.q_L[0] <= ws.a_L) {
     // First row.
-    if(a_1 <= q_1[1] / q_1[0]) {
-      calculate_q_R_star();
-      calculate_q_L_star();
+    if(ws.a_1 <= ws.q_1[1] / ws.q_1[0]) {
+      calculate_q_R_star(ws);
+      calculate_q_L_star(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
-      f_1(first_f_1, q_R);
-      f_1(second_f_1, q_R_star);
-      f_1(third_f_1, q_L_star);
+      f_1(first_f_1, ws.q_R);
+      f_1(second_f_1, ws.q_R_star);
+      f_1(third_f_1, ws.q_L_star);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] - second_f_1[i] + third_f_1[i];
       Q_inv(result, result, nx, ny);
       return;
     }
     // Second row.
-    if(0 < q_1[1] / q_1[0] && q_1[1] / q_1[0] < a_1) {
-      calculate_q_R_star();
+    if(0 < ws.q_1[1] / ws.q_1[0] && ws.q_1[1] / ws.q_1[0] < ws.a_1) {
+      calculate_q_R_star(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
-      f_1(first_f_1, q_R);
-      f_1(second_f_1, q_R_star);
-      f_1(third_f_1, q_1);
+      f_1(first_f_1, ws.q_R);
+      f_1(second_f_1, ws.q_R_star);
+      f_1(third_f_1, ws.q_1);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] - second_f_1[i] + third_f_1[i];
       Q_inv(result, result, nx, ny);
       return;
     }
     // Third row.
-    if(-a_3 <= q_1[1] / q_1[0] && q_1[1] / q_1[0] <= 0) {
-      calculate_q_R_star();
-      calculate_q_3();
+    if(-ws.a_3 <= ws.q_1[1] / ws.q_1[0] && ws.q_1[1] / ws.q_1[0] <= 0) {
+      calculate_q_R_star(ws);
+      calculate_q_3(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
-      f_1(first_f_1, q_R);
-      f_1(second_f_1, q_R_star);
-      f_1(third_f_1, q_3);
+      f_1(first_f_1, ws.q_R);
+      f_1(second_f_1, ws.q_R_star);
+      f_1(third_f_1, ws.q_3);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] - second_f_1[i] + third_f_1[i];
+      Q_inv(result, result, nx, ny);
       return;
     }
     // Fourth row.
-    if(q_1[1] / q_1[0] < -a_3) {
-      f_1(result, q_R);
+    if(ws.q_1[1] / ws.q_1[0] < -ws.a_3) {
+      f_1(result, ws.q_R);
       Q_inv(result, result, nx, ny);
       return;
     }
   }
 
   // Fourth column in table 3.4.1 on the page 233 in Feist (2003).
-  if(q_R[1] / q_R[0] < - a_R && q_L[1] / q_L[0] > a_L) {
+  if(ws.q_R[1] / ws.q_R[0] < - ws.a_R && ws.q_L[1] / ws.q_L[0] > ws.a_L) {
     // First row.
-    if(a_1 <= q_1[1] / q_1[0]) {
-      calculate_q_R_star();
+    if(ws.a_1 <= ws.q_1[1] / ws.q_1[0]) {
+      calculate_q_R_star(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
-      f_1(first_f_1, q_L);
-      f_1(second_f_1, q_R_star);
-      f_1(third_f_1, q_R);
+      f_1(first_f_1, ws.q_L);
+      f_1(second_f_1, ws.q_R_star);
+      f_1(third_f_1, ws.q_R);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] - second_f_1[i] + third_f_1[i];
       Q_inv(result, result, nx, ny);
       return;
     }
     // Second row.
-    if(0 < q_1[1] / q_1[0] && q_1[1] / q_1[0] < a_1) {
-      calculate_q_R_star();
-      calculate_q_L_star();
+    if(0 < ws.q_1[1] / ws.q_1[0] && ws.q_1[1] / ws.q_1[0] < ws.a_1) {
+      calculate_q_R_star(ws);
+      calculate_q_L_star(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
       double fourth_f_1[4];
       double fifth_f_1[4];
-      f_1(first_f_1, q_L);
-      f_1(second_f_1, q_R_star);
-      f_1(third_f_1, q_R);
-      f_1(fourth_f_1, q_L_star);
-      f_1(fifth_f_1, q_1);
+      f_1(first_f_1, ws.q_L);
+      f_1(second_f_1, ws.q_R_star);
+      f_1(third_f_1, ws.q_R);
+      f_1(fourth_f_1, ws.q_L_star);
+      f_1(fifth_f_1, ws.q_1);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] - second_f_1[i] + third_f_1[i] - fourth_f_1[i] + fifth_f_1[i];
       Q_inv(result, result, nx, ny);
       return;
     }
     // Third row.
-    if(-a_3 <= q_1[1] / q_1[0] && q_1[1] / q_1[0] <= 0) {
-      calculate_q_R_star();
-      calculate_q_L_star();
-      calculate_q_3();
+    if(-ws.a_3 <= ws.q_1[1] / ws.q_1[0] && ws.q_1[1] / ws.q_1[0] <= 0) {
+      calculate_q_R_star(ws);
+      calculate_q_L_star(ws);
+      calculate_q_3(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
       double fourth_f_1[4];
       double fifth_f_1[4];
-      f_1(first_f_1, q_L);
-      f_1(second_f_1, q_R_star);
-      f_1(third_f_1, q_R);
-      f_1(fourth_f_1, q_L_star);
-      f_1(fifth_f_1, q_3);
+      f_1(first_f_1, ws.q_L);
+      f_1(second_f_1, ws.q_R_star);
+      f_1(third_f_1, ws.q_R);
+      f_1(fourth_f_1, ws.q_L_star);
+      f_1(fifth_f_1, ws.q_3);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] - second_f_1[i] + third_f_1[i] - fourth_f_1[i] + fifth_f_1[i];
       Q_inv(result, result, nx, ny);
       return;
     }
     // Fourth row.
-    if(q_1[1] / q_1[0] < -a_3) {
-      calculate_q_L_star();
+    if(ws.q_1[1] / ws.q_1[0] < -ws.a_3) {
+      calculate_q_L_star(ws);
       double first_f_1[4];
       double second_f_1[4];
       double third_f_1[4];
-      f_1(first_f_1, q_L);
-      f_1(second_f_1, q_R);
-      f_1(third_f_1, q_L_star);
+      f_1(first_f_1, ws.q_L);
+      f_1(second_f_1, ws.q_R);
+      f_1(third_f_1, ws.q_L_star);
       for(unsigned int i = 0; i < 4; i++)
         result[i] = first_f_1[i] + second_f_1[i] - third_f_1[i];
       Q_inv(result, result, nx, ny);
@@ -676,207 +1220,224 @@ void OsherSolomonNumericalFlux::numerical_flux(double result[4], double w_L[4],
   }
 }
 
-void OsherSolomonNumericalFlux::numerical_flux_solid_wall(double result[4], double w_L[4], double nx, double ny)
+void OsherSolomonNumericalFlux::numerical_flux_batch(int n, double* result[4], double* w_L[4], double* w_R[4],
+          double* nx, double* ny) const
 {
-  Q(q_L, w_L, nx, ny);
-  a_B = QuantityCalculator::calc_sound_speed(q_L[0], q_L[1], q_L[2], q_L[3], kappa) + ((kappa - 1) * q_L[1] / (2 * q_L[0]));
-  double rho_B = std::pow(a_B * a_B * q_L[0] / (kappa * QuantityCalculator::calc_pressure(q_L[0], q_L[1], q_L[2], q_L[3], kappa)), (1 / (kappa - 1))) * q_L[0];
-  q_R[0] = 0;
-  q_R[1] = rho_B * a_B * a_B / kappa;
-  q_R[2] = 0;
-  q_R[3] = 0;
-  Q_inv(result, q_R, nx, ny);
+#ifdef NUMERICAL_FLUX_SIMD
+  simd_numerical_flux_batch(osher_solomon_simd, n, result, w_L, w_R, nx, ny, kappa);
+#else
+  // The same as numerical_flux(), without a virtual call per point.
+  NumericalFluxWorkspace ws;
+  double w_L_i[4], w_R_i[4], result_i[4];
+  for(int i = 0; i < n; i++) {
+    for(unsigned int k = 0; k < 4; k++) {
+      w_L_i[k] = w_L[k][i];
+      w_R_i[k] = w_R[k][i];
+    }
+    OsherSolomonNumericalFlux::numerical_flux(ws, result_i, w_L_i, w_R_i, nx[i], ny[i]);
+    for(unsigned int k = 0; k < 4; k++)
+      result[k][i] = result_i[k];
+  }
+#endif
 }
-  
-double OsherSolomonNumericalFlux::numerical_flux_solid_wall_i(int component, double w_L[4], double nx, double ny)
+
+void OsherSolomonNumericalFlux::calculate_q_1_a_1_a_3(NumericalFluxWorkspace& ws) const
 {
-  double result[4];
-  numerical_flux_solid_wall(result, w_L, nx, ny);
-  return result[component];
+  ws.a_1 = (ws.z_L - ws.z_R) / (1 + ws.alpha);
+  ws.q_1[0] = std::pow(ws.a_1 / ws.a_L, 2 / (kappa - 1)) * ws.q_L[0];
+  ws.q_1[1] = ws.q_1[0] * 2 * (ws.z_L - ws.a_1) / (kappa - 1);
+  ws.q_1[2] = ws.q_1[0] * ws.q_L[2] / ws.q_L[0] ;
+  ws.q_1[3] = QuantityCalculator::calc_energy(ws.q_1[0], ws.q_1[1], ws.q_1[2], ws.a_1 * ws.a_1 * ws.q_1[0] / kappa, kappa);
+  ws.a_3 = ws.alpha * ws.a_1;
 }
 
-void OsherSolomonNumericalFlux::numerical_flux_inlet(double result[4], double w_L[4], double w_B[4],
-        double nx, double ny)
+void OsherSolomonNumericalFlux::calculate_q_L_star(NumericalFluxWorkspace& ws) const
 {
-  // At the beginning, rotate the states into the local coordinate system and store the left and right state
-  // so we do not have to pass it around.
-  Q(q_L, w_L, nx, ny);
-  Q(q_B, w_B, nx, ny);
-
-  // Speeds of sound.
-  a_L = QuantityCalculator::calc_sound_speed(q_L[0], q_L[1], q_L[2], q_L[3], kappa);
-  a_B = QuantityCalculator::calc_sound_speed(q_B[0], q_B[1], q_B[2], q_B[3], kappa);
-
-  if(q_L[1] / q_L[0] > a_L) {// Supersonic inlet - everything is prescribed.
-    f_1(result, q_B);
-    Q_inv(result, result, nx, ny);
-    return;
-  }
-  else {// Subsonic inlet - only rho_b, v_x, v_y are prescribed, pressure is calculated as follows. The pressure is prescribed always so that one can know if the
-    // inlet is subsonic or supersonic.
-    double a_1 = a_L + ((kappa - 1) / 2) * (q_L[1] / q_L[0] - q_B[1] / q_B[0]);
-    q_1[0] = std::pow(a_1 * a_1 * q_L[0] / (kappa * QuantityCalculator::calc_pressure(q_L[0], q_L[1], q_L[2], q_L[3], kappa)), 1 / (kappa - 1)) * q_L[0];
-    q_1[1] = q_1[0] * q_B[1] / q_B[0];
-    q_1[2] = q_1[0] * q_L[2] / q_L[0];
-    q_1[3] = QuantityCalculator::calc_energy(q_1[0], q_1[1], q_1[2], a_1 * a_1 * q_1[0] / kappa, kappa);
-    if(q_B[1] / q_B[0] < 0)
-      if(q_B[1] / q_B[0] < a_1) {
-        f_1(result, q_B);
-        Q_inv(result, result, nx, ny);
-        return;
-      }
-      else {
-        double a_l_star = (((kappa - 1) / (kappa + 1)) * q_L[1] / q_L[0]) + 2 * a_L / (kappa + 1);
-        q_L_star[0] = std::pow(a_l_star / a_L, 2 / (kappa - 1)) * q_L[0];
-        q_L_star[1] = a_l_star;
-        q_L_star[2] = q_L_star[0] * q_L[2] / q_L[0];
-        q_L_star[3] = QuantityCalculator::calc_energy(q_L_star[0], q_L_star[1], q_L_star[2], q_L_star[0] * a_l_star * a_l_star / kappa, kappa);
-        double first_f_1[4];
-        double second_f_1[4];
-        double third_f_1[4];
-        f_1(first_f_1, q_B);
-        f_1(second_f_1, q_L_star);
-        f_1(third_f_1, q_1);
-        for(unsigned int i = 0; i < 4; i++)
-          result[i] = first_f_1[i] + second_f_1[i] - third_f_1[i];
-        Q_inv(result, result, nx, ny);
-        return;
-      }
-    else
-      if(q_B[1] / q_B[0] < a_1) {
-        f_1(result, q_1);
-        Q_inv(result, result, nx, ny);
-        return;
-      }
-      else {
-        double a_l_star = (((kappa - 1) / (kappa + 1)) * q_L[1] / q_L[0]) + 2 * a_L / (kappa + 1);
-        q_L_star[0] = std::pow(a_l_star / a_L, 2 / (kappa - 1)) * q_L[0];
-        q_L_star[1] = a_l_star;
-        q_L_star[2] = q_L_star[0] * q_L[2] / q_L[0];
-        q_L_star[3] = QuantityCalculator::calc_energy(q_L_star[0], q_L_star[1], q_L_star[2], q_L_star[0] * a_l_star * a_l_star / kappa, kappa);
-        f_1(result, q_L_star);
-        Q_inv(result, result, nx, ny);
-        return;
-      }
-  }
+  ws.a_L_star = 2 * ws.z_L / (kappa + 1);
+  ws.q_L_star[0] = std::pow(ws.a_L_star / ws.a_L, 2 / (kappa -1 )) * ws.q_L[0];
+  ws.q_L_star[1] = ws.q_L_star[0] * ws.a_L_star;
+  ws.q_L_star[2] = ws.q_1[0] * ws.q_L[2] / ws.q_L[0] ;
+  ws.q_L_star[3] = QuantityCalculator::calc_energy(ws.q_L_star[0], ws.q_L_star[1], ws.q_L_star[2], ws.a_L_star * ws.a_L_star * ws.q_L_star[0] / kappa, kappa);
 }
-  
-double OsherSolomonNumericalFlux::numerical_flux_inlet_i(int component, double w_L[4], double w_B[4],
-        double nx, double ny)
+
+void OsherSolomonNumericalFlux::calculate_q_3(NumericalFluxWorkspace& ws) const
 {
-  double result[4];
-  numerical_flux_inlet(result, w_L, w_B, nx, ny);
-  return result[component];
+  // a_3 already calculated.
+  ws.q_3[0] = ws.q_1[0] / (ws.alpha * ws.alpha);
+  ws.q_3[1] = ws.q_3[0] * ws.q_1[1] / ws.q_1[0] ;
+  ws.q_3[2] = ws.q_3[0] * ws.q_R[2] / ws.q_R[0] ;
+  ws.q_3[3] = QuantityCalculator::calc_energy(ws.q_3[0], ws.q_3[1], ws.q_3[2], ws.a_3 * ws.a_3 * ws.q_3[0] / kappa, kappa);
 }
 
-void OsherSolomonNumericalFlux::numerical_flux_outlet(double result[4], double w_L[4], double pressure, double nx, double ny)
+void OsherSolomonNumericalFlux::calculate_q_R_star(NumericalFluxWorkspace& ws) const
 {
-  // At the beginning, rotate the states into the local coordinate system and store the left and right state
-  // so we do not have to pass it around.
-  Q(q_L, w_L, nx, ny);
-
-  double a_L = QuantityCalculator::calc_sound_speed(q_L[0], q_L[1], q_L[2], q_L[3], kappa);
-
-  if(q_L[1] / q_L[0] > a_L) {// Supersonic inlet - everything is prescribed.
-    f_1(result, q_L);
-    Q_inv(result, result, nx, ny);
-    return;
-  }
-  else {
-    this->q_B[0] = q_L[0] * std::pow(pressure / QuantityCalculator::calc_pressure(this->q_L[0], this->q_L[1], this->q_L[2], this->q_L[3], kappa), 1 / kappa);
-    this->q_B[1] = this->q_B[0] * (q_L[1] / q_L[0] + (2 / (kappa - 1)) * (a_L - std::sqrt(kappa * pressure / q_B[0])));
-    this->q_B[2] = this->q_B[0] * this->q_L[2] / this->q_L[0];
-    this->q_B[3] = QuantityCalculator::calc_energy(this->q_B[0], this->q_B[1], this->q_B[2], pressure, kappa);
-    if(q_B[1] / q_B[0] < QuantityCalculator::calc_sound_speed(this->q_B[0], this->q_B[1], this->q_B[2], this->q_B[3], kappa)) {
-      f_1(result, q_B);
-      Q_inv(result, result, nx, ny);
-      return;
-    }
-    else {
-      double a_l_star = (((kappa - 1) / (kappa + 1)) * q_L[1] / q_L[0]) + 2 * a_L / (kappa + 1);
-      q_L_star[0] = std::pow(a_l_star / a_L, 2 / (kappa - 1)) * q_L[0];
-      q_L_star[1] = a_l_star;
-      q_L_star[2] = q_L_star[0] * q_L[2] / q_L[0];
-      q_L_star[3] = QuantityCalculator::calc_energy(q_L_star[0], q_L_star[1], q_L_star[2], q_L_star[0] * a_l_star * a_l_star / kappa, kappa);
-      f_1(result, q_L_star);
-      Q_inv(result, result, nx, ny);
-      return;
-    }
-  }
+  ws.a_R_star = - 2 * ws.z_R / (kappa + 1);
+  ws.q_R_star[0] = std::pow(ws.a_R_star / ws.a_R, 2 / (kappa -1 )) * ws.q_R[0];
+  ws.q_R_star[1] = ws.q_R_star[0] * -ws.a_R_star;
+  ws.q_R_star[2] = ws.q_1[0] * ws.q_R[2] / ws.q_R[0] ;
+  ws.q_R_star[3] = QuantityCalculator::calc_energy(ws.q_R_star[0], ws.q_R_star[1], ws.q_R_star[2], ws.a_R_star * ws.a_R_star * ws.q_R_star[0] / kappa, kappa);
 }
-  
-double OsherSolomonNumericalFlux::numerical_flux_outlet_i(int component, double w_L[4], double pressure, double nx, double ny)
+
+ApproximateRiemannSolverNumericalFlux::ApproximateRiemannSolverNumericalFlux(double kappa) : NumericalFlux(kappa)
 {
-  double result[4];
-  numerical_flux_outlet(result, w_L, pressure, nx, ny);
-  return result[component];
 }
 
-void OsherSolomonNumericalFlux::calculate_q_1_a_1_a_3()
+void ApproximateRiemannSolverNumericalFlux::numerical_flux(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_R[4],
+          double nx, double ny) const
 {
-  this->a_1 = (z_L - z_R) / (1 + alpha);
-  this->q_1[0] = std::pow(a_1 / a_L, 2 / (kappa - 1)) * q_L[0];
-  this->q_1[1] = this->q_1[0] * 2 * (z_L - a_1) / (kappa - 1);
-  this->q_1[2] = this->q_1[0] * this->q_L[2] / this->q_L[0] ;
-  this->q_1[3] = QuantityCalculator::calc_energy(this->q_1[0], this->q_1[1], this->q_1[2], a_1 * a_1 * q_1[0] / kappa, kappa);
-  this->a_3 = alpha * a_1;
+  Q(ws.q_L, w_L, nx, ny);
+  Q(ws.q_R, w_R, nx, ny);
+  rotated_flux(ws, result);
+  Q_inv(result, result, nx, ny);
 }
 
-void OsherSolomonNumericalFlux::calculate_q_L_star()
+void ApproximateRiemannSolverNumericalFlux::numerical_flux_solid_wall(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double nx, double ny) const
 {
-  this->a_L_star = 2 * z_L / (kappa + 1);
-  this->q_L_star[0] = std::pow(a_L_star / a_L, 2 / (kappa -1 )) * q_L[0];
-  this->q_L_star[1] = this->q_L_star[0] * a_L_star;
-  this->q_L_star[2] = this->q_1[0] * this->q_L[2] / this->q_L[0] ;
-  this->q_L_star[3] = QuantityCalculator::calc_energy(this->q_L_star[0], this->q_L_star[1], this->q_L_star[2], a_L_star * a_L_star * q_L_star[0] / kappa, kappa);
+  // The mirrored state, the mass flux is zero.
+  Q(ws.q_L, w_L, nx, ny);
+  ws.q_R[0] = ws.q_L[0];
+  ws.q_R[1] = -ws.q_L[1];
+  ws.q_R[2] = ws.q_L[2];
+  ws.q_R[3] = ws.q_L[3];
+  rotated_flux(ws, result);
+  result[0] = 0.0;
+  Q_inv(result, result, nx, ny);
 }
 
-void OsherSolomonNumericalFlux::calculate_q_3()
+void ApproximateRiemannSolverNumericalFlux::numerical_flux_inlet(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_B[4],
+        double nx, double ny) const
 {
-  // a_3 already calculated.
-  this->q_3[0] = q_1[0] / (alpha * alpha);
-  this->q_3[1] = this->q_3[0] * this->q_1[1] / this->q_1[0] ;
-  this->q_3[2] = this->q_3[0] * this->q_R[2] / this->q_R[0] ;
-  this->q_3[3] = QuantityCalculator::calc_energy(this->q_3[0], this->q_3[1], this->q_3[2], a_3 * a_3 * q_3[0] / kappa, kappa);
+  Q(ws.q_L, w_L, nx, ny);
+  Q(ws.q_B, w_B, nx, ny);
+  ws.a_B = QuantityCalculator::calc_sound_speed(ws.q_B[0], ws.q_B[1], ws.q_B[2], ws.q_B[3], kappa);
+
+  for(unsigned int i = 0; i < 3; i++)
+    ws.q_R[i] = ws.q_B[i];
+  // Supersonic inlet - everything is prescribed, subsonic - the pressure from the inside.
+  if(-ws.q_B[1] / ws.q_B[0] >= ws.a_B)
+    ws.q_R[3] = ws.q_B[3];
+  else
+    ws.q_R[3] = QuantityCalculator::calc_energy(ws.q_B[0], ws.q_B[1], ws.q_B[2], 
+      QuantityCalculator::calc_pressure(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa), kappa);
+  rotated_flux(ws, result);
+  Q_inv(result, result, nx, ny);
 }
 
-void OsherSolomonNumericalFlux::calculate_q_R_star()
+void ApproximateRiemannSolverNumericalFlux::numerical_flux_outlet(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double pressure, double nx, double ny) const
 {
-  this->a_R_star = - 2 * z_R / (kappa + 1);
-  this->q_R_star[0] = std::pow(a_R_star / a_R, 2 / (kappa -1 )) * q_R[0];
-  this->q_R_star[1] = this->q_R_star[0] * -a_R_star;
-  this->q_R_star[2] = this->q_1[0] * this->q_R[2] / this->q_R[0] ;
-  this->q_R_star[3] = QuantityCalculator::calc_energy(this->q_R_star[0], this->q_R_star[1], this->q_R_star[2], a_R_star * a_R_star * q_R_star[0] / kappa, kappa);
+  Q(ws.q_L, w_L, nx, ny);
+  ws.a_L = QuantityCalculator::calc_sound_speed(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa);
+
+  for(unsigned int i = 0; i < 3; i++)
+    ws.q_R[i] = ws.q_L[i];
+  // Supersonic outlet - nothing is prescribed, subsonic - the pressure.
+  if(ws.q_L[1] / ws.q_L[0] >= ws.a_L)
+    ws.q_R[3] = ws.q_L[3];
+  else
+    ws.q_R[3] = QuantityCalculator::calc_energy(ws.q_L[0], ws.q_L[1], ws.q_L[2], pressure, kappa);
+  rotated_flux(ws, result);
+  Q_inv(result, result, nx, ny);
 }
 
-double OsherSolomonNumericalFlux::numerical_flux_i(int component, double w_L[4], double w_R[4],
-          double nx, double ny)
+void ApproximateRiemannSolverNumericalFlux::wave_speeds(NumericalFluxWorkspace& ws, double& s_L, double& s_R) const
 {
-  double result[4];
-  numerical_flux(result, w_L, w_R, nx, ny);
-  return result[component];
+  ws.a_L = QuantityCalculator::calc_sound_speed(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa);
+  ws.a_R = QuantityCalculator::calc_sound_speed(ws.q_R[0], ws.q_R[1], ws.q_R[2], ws.q_R[3], kappa);
+  double u_L = ws.q_L[1] / ws.q_L[0];
+  double u_R = ws.q_R[1] / ws.q_R[0];
+  s_L = std::min(u_L - ws.a_L, u_R - ws.a_R);
+  s_R = std::max(u_L + ws.a_L, u_R + ws.a_R);
 }
 
+RusanovNumericalFlux::RusanovNumericalFlux(double kappa) : ApproximateRiemannSolverNumericalFlux(kappa)
+{
+}
 
+void RusanovNumericalFlux::rotated_flux(NumericalFluxWorkspace& ws, double result[4]) const
+{
+  double s_L, s_R;
+  wave_speeds(ws, s_L, s_R);
+  double s = std::max(-s_L, s_R);
 
+  double f_L[4], f_R[4];
+  f_1(f_L, ws.q_L);
+  f_1(f_R, ws.q_R);
+  for(unsigned int i = 0; i < 4; i++)
+    result[i] = 0.5 * (f_L[i] + f_R[i]) - 0.5 * s * (ws.q_R[i] - ws.q_L[i]);
+}
 
+HLLNumericalFlux::HLLNumericalFlux(double kappa) : ApproximateRiemannSolverNumericalFlux(kappa)
+{
+}
 
+void HLLNumericalFlux::rotated_flux(NumericalFluxWorkspace& ws, double result[4]) const
+{
+  double s_L, s_R;
+  wave_speeds(ws, s_L, s_R);
 
+  if(s_L >= 0) {
+    f_1(result, ws.q_L);
+    return;
+  }
+  if(s_R <= 0) {
+    f_1(result, ws.q_R);
+    return;
+  }
 
+  double f_L[4], f_R[4];
+  f_1(f_L, ws.q_L);
+  f_1(f_R, ws.q_R);
+  for(unsigned int i = 0; i < 4; i++)
+    result[i] = (s_R * f_L[i] - s_L * f_R[i] + s_L * s_R * (ws.q_R[i] - ws.q_L[i])) / (s_R - s_L);
+}
 
+HLLCNumericalFlux::HLLCNumericalFlux(double kappa) : ApproximateRiemannSolverNumericalFlux(kappa)
+{
+}
 
+void HLLCNumericalFlux::rotated_flux(NumericalFluxWorkspace& ws, double result[4]) const
+{
+  double s_L, s_R;
+  wave_speeds(ws, s_L, s_R);
 
+  if(s_L >= 0) {
+    f_1(result, ws.q_L);
+    return;
+  }
+  if(s_R <= 0) {
+    f_1(result, ws.q_R);
+    return;
+  }
 
-
-
-
-
-
-
-
-
-
-
+  double u_L = ws.q_L[1] / ws.q_L[0];
+  double u_R = ws.q_R[1] / ws.q_R[0];
+  double p_L = QuantityCalculator::calc_pressure(ws.q_L[0], ws.q_L[1], ws.q_L[2], ws.q_L[3], kappa);
+  double p_R = QuantityCalculator::calc_pressure(ws.q_R[0], ws.q_R[1], ws.q_R[2], ws.q_R[3], kappa);
+
+  // Speed of the contact wave.
+  double m_L = ws.q_L[0] * (s_L - u_L);
+  double m_R = ws.q_R[0] * (s_R - u_R);
+  double s_M = (p_R - p_L + m_L * u_L - m_R * u_R) / (m_L - m_R);
+
+  // The star state on the side of the origin.
+  bool left = (s_M >= 0);
+  double* q = left ? ws.q_L : ws.q_R;
+  double* q_star = left ? ws.q_L_star : ws.q_R_star;
+  double s = left ? s_L : s_R;
+  double u = left ? u_L : u_R;
+  double p = left ? p_L : p_R;
+  double m = left ? m_L : m_R;
+
+  double factor = m / (s - s_M);
+  q_star[0] = factor;
+  q_star[1] = factor * s_M;
+  q_star[2] = factor * q[2] / q[0];
+  q_star[3] = factor * (q[3] / q[0] + (s_M - u) * (s_M + p / m));
+
+  f_1(result, q);
+  for(unsigned int i = 0; i < 4; i++)
+    result[i] += s * (q_star[i] - q[i]);
+}
 
 /*
 double NumericalFlux::f_x(int component, double w0, double w1, double w3, double w4)
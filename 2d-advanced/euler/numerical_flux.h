@@ -2,45 +2,105 @@
 #define NUMERICAL_FLUX_H
 #include "euler_util.h"
 
+/// Scratch data of a numerical flux evaluation (rotated states, speeds of sound, ...).
+/// The flux classes keep no evaluation state of their own when one of these is passed explicitly,
+/// so a single flux instance can be shared by threads each using their own (e.g. stack-allocated) workspace.
+struct NumericalFluxWorkspace
+{
+  // States.
+  double q[4];
+  double q_L[4];
+  double q_R[4];
+  double q_L_star[4];
+  double q_R_star[4];
+  double q_1[4];
+  double q_3[4];
+  double q_B[4]; // Boundary
+
+  // Speeds of sound.
+  double a;
+  double a_L;
+  double a_R;
+  double a_L_star;
+  double a_R_star;
+  double a_1;
+  double a_3;
+  double a_B; // Boundary.
+
+  // x-velocity, y-velocity, magnitude.
+  double u, v, V;
+
+  // Utility quantities (Osher-Solomon).
+  double z_L, z_R, s_L, s_R, alpha;
+};
+
 class NumericalFlux
 {
 public:
   NumericalFlux(double kappa);
 
+  /// Reentrant versions, all intermediate results are stored in ws.
   /// Calculates all components of the flux.
   /// Stores the result in the array result.
-  virtual void numerical_flux(double result[4], double w_L[4], double w_R[4],
-          double nx, double ny) = 0;
+  virtual void numerical_flux(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_R[4],
+          double nx, double ny) const = 0;
+
+  virtual void numerical_flux_solid_wall(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double nx, double ny) const;
+
+  virtual void numerical_flux_inlet(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_B[4],
+          double nx, double ny) const;
+
+  virtual void numerical_flux_outlet(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double pressure, double nx, double ny) const;
+
+  /// Calculates all components of the flux in n points (typically all quadrature points of an edge) at once.
+  /// States, normals and results are stored component-wise, e.g. w_L[k][i] is the k-th component
+  /// of the left state in the i-th point. Reentrant.
+  virtual void numerical_flux_batch(int n, double* result[4], double* w_L[4], double* w_R[4],
+          double* nx, double* ny) const;
+
+  /// The instruction set of the vectorized batches of Steger-Warming, Vijayasundaram and Osher-Solomon
+  /// (WITH_SIMD in CMake), these agree with the point by point fluxes up to the rounding errors.
+  static const char* batch_instruction_set();
+
+  /// Versions using the workspace of this instance, i.e. not thread-safe.
+  /// Calculates all components of the flux.
+  /// Stores the result in the array result.
+  void numerical_flux(double result[4], double w_L[4], double w_R[4],
+          double nx, double ny);
   
   /// Calculates a specified component of the flux.
   /// Returns the result.
-  virtual double numerical_flux_i(int component, double w_L[4], double w_R[4],
-          double nx, double ny) = 0;
+  double numerical_flux_i(int component, double w_L[4], double w_R[4],
+          double nx, double ny);
 
-  virtual void numerical_flux_solid_wall(double result[4], double w_L[4], double nx, double ny) = 0;
+  void numerical_flux_solid_wall(double result[4], double w_L[4], double nx, double ny);
   
-  virtual double numerical_flux_solid_wall_i(int component, double w_L[4], double nx, double ny) = 0;
+  double numerical_flux_solid_wall_i(int component, double w_L[4], double nx, double ny);
 
-  virtual void numerical_flux_inlet(double result[4], double w_L[4], double w_B[4],
-          double nx, double ny) = 0;
+  void numerical_flux_inlet(double result[4], double w_L[4], double w_B[4],
+          double nx, double ny);
   
-  virtual double numerical_flux_inlet_i(int component, double w_L[4], double w_B[4],
-          double nx, double ny) = 0;
+  double numerical_flux_inlet_i(int component, double w_L[4], double w_B[4],
+          double nx, double ny);
 
-  virtual void numerical_flux_outlet(double result[4], double w_L[4], double pressure, double nx, double ny) = 0;
+  void numerical_flux_outlet(double result[4], double w_L[4], double pressure, double nx, double ny);
   
-  virtual double numerical_flux_outlet_i(int component, double w_L[4], double pressure, double nx, double ny) = 0;
+  double numerical_flux_outlet_i(int component, double w_L[4], double pressure, double nx, double ny);
 
   /// Rotates the state_vector into the local coordinate system.
-  void Q(double result[4], double state_vector[4], double nx, double ny);
+  void Q(double result[4], double state_vector[4], double nx, double ny) const;
 
   /// Rotates the state_vector back from the local coordinate system.
-  void Q_inv(double result[4], double state_vector[4], double nx, double ny);
+  void Q_inv(double result[4], double state_vector[4], double nx, double ny) const;
 
-  void f_1(double result[4], double state[4]);
+  void f_1(double result[4], double state[4]) const;
 
   // Poisson adiabatic ant = c_p/c_v = 1 + R/c_v.
   double kappa;
+
+protected:
+  // Used by the non-reentrant versions.
+  NumericalFluxWorkspace workspace;
 };
 
 class StegerWarmingNumericalFlux : public NumericalFlux
@@ -48,73 +108,64 @@ class StegerWarmingNumericalFlux : public NumericalFlux
 public:
   StegerWarmingNumericalFlux(double kappa);
 
-  virtual void numerical_flux(double result[4], double w_L[4], double w_R[4],
-          double nx, double ny);
-  
-  virtual double numerical_flux_i(int component, double w_L[4], double w_R[4],
-          double nx, double ny);
+  using NumericalFlux::numerical_flux;
+
+  virtual void numerical_flux(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_R[4],
+          double nx, double ny) const;
 
+  virtual void numerical_flux_batch(int n, double* result[4], double* w_L[4], double* w_R[4],
+          double* nx, double* ny) const;
+
+  /// These use a workspace of their own on the stack.
   void P_plus(double result[4], double w[4], double param[4],
-          double nx, double ny);
+          double nx, double ny) const;
 
   void P_minus(double result[4], double w[4], double param[4],
-          double nx, double ny);
+          double nx, double ny) const;
 
-  // Also calculates the speed of sound.
-  void Lambda_plus(double result[4]);
+  void P_plus(NumericalFluxWorkspace& ws, double result[4], double w[4], double param[4],
+          double nx, double ny) const;
 
-  // Also calculates the speed of sound.
-  void Lambda_minus(double result[4]);
+  void P_minus(NumericalFluxWorkspace& ws, double result[4], double w[4], double param[4],
+          double nx, double ny) const;
 
-  // Calculates all eigenvalues.
-  void Lambda(double result[4]);
+  /// Calculates P_plus(result[k], w, e_k, nx, ny) for all four unit vectors e_k
+  /// with a single eigen-decomposition.
+  void P_plus_columns(double result[4][4], double w[4],
+          double nx, double ny) const;
 
-  void T_1(double result[4][4]);
-  void T_2(double result[4][4]);
-  void T_3(double result[4][4]);
-  void T_4(double result[4][4]);
+  /// The same for P_minus.
+  void P_minus_columns(double result[4][4], double w[4],
+          double nx, double ny) const;
 
-  void T_inv_1(double result[4][4]);
-  void T_inv_2(double result[4][4]);
-  void T_inv_3(double result[4][4]);
-  void T_inv_4(double result[4][4]);
+  // Also calculates the speed of sound.
+  void Lambda_plus(NumericalFluxWorkspace& ws, double result[4]) const;
 
-  virtual void numerical_flux_solid_wall(double result[4], double w_L[4], double nx, double ny);
-  
-  virtual double numerical_flux_solid_wall_i(int component, double w_L[4], double nx, double ny);
+  // Also calculates the speed of sound.
+  void Lambda_minus(NumericalFluxWorkspace& ws, double result[4]) const;
 
-  virtual void numerical_flux_inlet(double result[4], double w_L[4], double w_B[4],
-          double nx, double ny);
-  
-  virtual double numerical_flux_inlet_i(int component, double w_L[4], double w_B[4],
-          double nx, double ny);
+  // Calculates all eigenvalues.
+  void Lambda(NumericalFluxWorkspace& ws, double result[4]) const;
 
-  virtual void numerical_flux_outlet(double result[4], double w_L[4], double pressure, double nx, double ny);
-  
-  virtual double numerical_flux_outlet_i(int component, double w_L[4], double pressure, double nx, double ny);
+  // Use the quantities calculated by Lambda*.
+  void T_1(const NumericalFluxWorkspace& ws, double result[4][4]) const;
+  void T_2(const NumericalFluxWorkspace& ws, double result[4][4]) const;
+  void T_3(const NumericalFluxWorkspace& ws, double result[4][4]) const;
+  void T_4(const NumericalFluxWorkspace& ws, double result[4][4]) const;
 
-  double* get_q();
+  void T_inv_1(const NumericalFluxWorkspace& ws, double result[4][4]) const;
+  void T_inv_2(const NumericalFluxWorkspace& ws, double result[4][4]) const;
+  void T_inv_3(const NumericalFluxWorkspace& ws, double result[4][4]) const;
+  void T_inv_4(const NumericalFluxWorkspace& ws, double result[4][4]) const;
 
 protected:
-  // States.
-  double q[4];
-  double q_1[4];
-  double q_L[4];
-  double q_R[4];
-  double q_L_star[4];
-  double q_R_star[4];
-  double q_B[4]; // Boundary
-
-  // Speeds of sound.
-  double a;
-  double a_L;
-  double a_R;
-  double a_L_star;
-  double a_R_star;
-  double a_B; // Boundary.
+  // The matrix T * Lambda^{+-} * T^{-1} in the rotated frame, for the state in ws.q.
+  void A_plus(NumericalFluxWorkspace& ws, double result[4][4]) const;
+  void A_minus(NumericalFluxWorkspace& ws, double result[4][4]) const;
+  void A_from_eigenvalues(NumericalFluxWorkspace& ws, double result[4][4], double lambda[4], bool positive) const;
 
-  // x-velocity, y-velocity, magnitude.
-  double u, v, V;
+  // Applies Q^{-1} * A * Q to all unit vectors.
+  void rotate_columns(double result[4][4], double A[4][4], double nx, double ny) const;
 };
 
 class VijayasundaramNumericalFlux : public StegerWarmingNumericalFlux
@@ -122,8 +173,13 @@ class VijayasundaramNumericalFlux : public StegerWarmingNumericalFlux
 public:
   VijayasundaramNumericalFlux(double kappa);
 
-  virtual void numerical_flux(double result[4], double w_L[4], double w_R[4],
-          double nx, double ny);
+  using StegerWarmingNumericalFlux::numerical_flux;
+
+  virtual void numerical_flux(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_R[4],
+          double nx, double ny) const;
+
+  virtual void numerical_flux_batch(int n, double* result[4], double* w_L[4], double* w_R[4],
+          double* nx, double* ny) const;
 };
 
 
@@ -132,57 +188,85 @@ class OsherSolomonNumericalFlux : public NumericalFlux
 public:
   OsherSolomonNumericalFlux(double kappa);
 
-  virtual void numerical_flux(double result[4], double w_L[4], double w_R[4],
-          double nx, double ny);
-  
-  virtual double numerical_flux_i(int component, double w_L[4], double w_R[4],
-          double nx, double ny);
+  using NumericalFlux::numerical_flux;
 
-  virtual void numerical_flux_solid_wall(double result[4], double w_L[4], double nx, double ny);
-  
-  virtual double numerical_flux_solid_wall_i(int component, double w_L[4], double nx, double ny);
+  virtual void numerical_flux(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_R[4],
+          double nx, double ny) const;
 
-  virtual void numerical_flux_inlet(double result[4], double w_L[4], double w_R[4],
-          double nx, double ny);
-  
-  virtual double numerical_flux_inlet_i(int component, double w_L[4], double w_R[4],
-          double nx, double ny);
+  virtual void numerical_flux_batch(int n, double* result[4], double* w_L[4], double* w_R[4],
+          double* nx, double* ny) const;
 
-  virtual void numerical_flux_outlet(double result[4], double w_L[4], double pressure, double nx, double ny);
+protected:
+  void calculate_q_1_a_1_a_3(NumericalFluxWorkspace& ws) const;
   
-  virtual double numerical_flux_outlet_i(int component, double w_L[4], double pressure, double nx, double ny);
+  void calculate_q_L_star(NumericalFluxWorkspace& ws) const;
+
+  void calculate_q_3(NumericalFluxWorkspace& ws) const;
+
+  void calculate_q_R_star(NumericalFluxWorkspace& ws) const;
+};
+
+/// Base of the approximate Riemann solvers given by the estimates of the wave speeds (Rusanov, HLL, HLLC),
+/// which solve the one-dimensional problem in the rotated frame (ws.q_L, ws.q_R).
+/// The boundary fluxes solve the same problem with a ghost state: the mirrored state on the solid walls,
+/// the prescribed state (the pressure from the inside if subsonic) on the inlets, the inside state with
+/// the prescribed pressure on the subsonic outlets.
+class ApproximateRiemannSolverNumericalFlux : public NumericalFlux
+{
+public:
+  ApproximateRiemannSolverNumericalFlux(double kappa);
+
+  using NumericalFlux::numerical_flux;
+  using NumericalFlux::numerical_flux_solid_wall;
+  using NumericalFlux::numerical_flux_inlet;
+  using NumericalFlux::numerical_flux_outlet;
+
+  virtual void numerical_flux(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_R[4],
+          double nx, double ny) const;
+
+  virtual void numerical_flux_solid_wall(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double nx, double ny) const;
+
+  virtual void numerical_flux_inlet(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double w_B[4],
+          double nx, double ny) const;
+
+  virtual void numerical_flux_outlet(NumericalFluxWorkspace& ws, double result[4], double w_L[4], double pressure, double nx, double ny) const;
 
 protected:
-  void calculate_q_1_a_1_a_3();
-  
-  void calculate_q_L_star();
+  /// The flux in the rotated frame between ws.q_L and ws.q_R.
+  virtual void rotated_flux(NumericalFluxWorkspace& ws, double result[4]) const = 0;
 
-  void calculate_q_3();
+  /// Davis' estimates of the smallest and the largest wave speeds (also calculates ws.a_L, ws.a_R).
+  void wave_speeds(NumericalFluxWorkspace& ws, double& s_L, double& s_R) const;
+};
 
-  void calculate_q_R_star();
+/// Rusanov (local Lax-Friedrichs): the central flux with the dissipation of the largest wave speed.
+class RusanovNumericalFlux : public ApproximateRiemannSolverNumericalFlux
+{
+public:
+  RusanovNumericalFlux(double kappa);
 
+protected:
+  virtual void rotated_flux(NumericalFluxWorkspace& ws, double result[4]) const;
+};
 
-  // States.
-  double q_L[4];
-  double q_R[4];
-  double q_L_star[4];
-  double q_R_star[4];
-  double q_1[4];
-  double q_3[4];
-  double q_B[4]; // Boundary
+/// Harten, Lax, van Leer: one intermediate state between the smallest and the largest wave speed.
+class HLLNumericalFlux : public ApproximateRiemannSolverNumericalFlux
+{
+public:
+  HLLNumericalFlux(double kappa);
 
-  // Speeds of sound.
-  double a_L;
-  double a_R;
-  double a_L_star;
-  double a_R_star;
-  double a_1;
-  double a_3;
-  double a_B; // Boundary.
+protected:
+  virtual void rotated_flux(NumericalFluxWorkspace& ws, double result[4]) const;
+};
 
-  // Utility quantities.
-  double z_L, z_R, s_L, s_R, alpha;
+/// HLL with the contact wave restored (Toro): two intermediate states separated by the contact speed.
+class HLLCNumericalFlux : public ApproximateRiemannSolverNumericalFlux
+{
+public:
+  HLLCNumericalFlux(double kappa);
 
+protected:
+  virtual void rotated_flux(NumericalFluxWorkspace& ws, double result[4]) const;
 };
 
-#endif
\ No newline at end of file
+#endif
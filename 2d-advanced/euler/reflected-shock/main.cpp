@@ -54,9 +54,20 @@ const int INIT_REF_NUM = 5;
 double CFL_NUMBER = 0.1;                                
 // Initial time step.
 double time_step = 1E-4;                                
+// Time integration: false - the semi-implicit scheme (a linear system in each time step),
+// true - the matrix-free explicit SSP Runge-Kutta method with SSP_RK_STAGES stages (1 - 3),
+// limited after each stage (the Feistauer's shock capturing is available only with the semi-implicit scheme).
+const bool EXPLICIT_TIME_INTEGRATION = false;
+const int SSP_RK_STAGES = 3;
 // Matrix solver: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
 // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
 const MatrixSolverType matrix_solver = SOLVER_UMFPACK;  
+// Reuse of the factorization over the time steps: the symbolic analysis only in the first step,
+// and if STALE_FACTORIZATION_STEPS > 0, reuse of a factorization (as a preconditioner of an iterative refinement)
+// in up to STALE_FACTORIZATION_STEPS following steps, in which the time step changed relatively by less than STALE_FACTORIZATION_THRESHOLD.
+const bool REUSE_SYMBOLIC_FACTORIZATION = true;
+const int STALE_FACTORIZATION_STEPS = 0;
+const double STALE_FACTORIZATION_THRESHOLD = 0.05;
 
 double KAPPA = 1.4;
 
@@ -85,6 +96,12 @@ const std::string BDY_OUTLET = "2";
 const std::string BDY_INLET_TOP = "3";
 const std::string BDY_INLET_LEFT = "4";
 
+// Integration order of the forms - increase over the polynomial order of the integrand, and its cap.
+const int INTEGRATION_ORDER_INCREASE = 2;
+const int INTEGRATION_ORDER_MAX = 24;
+// If positive, the forms are integrated with this fixed order instead (24 - the former behaviour, for timing comparisons).
+const int INTEGRATION_ORDER_FIXED = 0;
+
 // Weak forms.
 #include "../forms_explicit.cpp"
 
@@ -107,7 +124,6 @@ int main(int argc, char* argv[])
   L2Space<double> space_rho_v_x(&mesh, P_INIT);
   L2Space<double> space_rho_v_y(&mesh, P_INIT);
   L2Space<double> space_e(&mesh, P_INIT);
-  L2Space<double> space_stabilization(&mesh, 0);
   int ndof = Space<double>::get_num_dofs(Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
   info("ndof: %d", ndof);
 
@@ -138,8 +154,10 @@ int main(int argc, char* argv[])
   // Set up the solver, matrix, and rhs according to the solver selection.
   SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
   Vector<double>* rhs = create_vector<double>(matrix_solver);
-  Vector<double>* rhs_stabilization = create_vector<double>(matrix_solver);
   LinearSolver<double>* solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
+  FactorizationReuse factorization_reuse(solver, matrix, rhs, REUSE_SYMBOLIC_FACTORIZATION);
+  if(STALE_FACTORIZATION_STEPS > 0)
+    factorization_reuse.set_stale_factorization_reuse(STALE_FACTORIZATION_STEPS, STALE_FACTORIZATION_THRESHOLD);
 
   // Set up CFL calculation class.
   CFLCalculation CFL(CFL_NUMBER, KAPPA);
@@ -161,79 +179,123 @@ int main(int argc, char* argv[])
     iteration = continuity.get_num();
   }
 
-  EulerEquationsWeakFormStabilization wf_stabilization(&prev_rho);
-
   if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
     wf.set_stabilization(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, NU_1, NU_2);
 
   // Initialize the FE problem.
   DiscreteProblem<double> dp(&wf, Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
-  DiscreteProblem<double> dp_stabilization(&wf_stabilization, &space_stabilization);
 
   // If the FE problem is in fact a FV problem.
   if(P_INIT == 0) 
     dp.set_fvm();
 
+  // Explicit weak formulation and the matrix-free time integration.
+  EulerEquationsWeakFormExplicitMultiComponentTwoInflows wf_explicit(&num_flux, KAPPA, RHO_LEFT, V1_LEFT, V2_LEFT, PRESSURE_LEFT, RHO_TOP, V1_TOP, V2_TOP, PRESSURE_TOP, 
+    BDY_SOLID_WALL, BDY_INLET_LEFT, BDY_INLET_TOP, BDY_OUTLET, &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, (P_INIT == 0));
+  DiscreteProblem<double> dp_explicit(&wf_explicit, Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e));
+  if(P_INIT == 0) 
+    dp_explicit.set_fvm();
+  ExplicitSSPRungeKutta ssp_rk(SSP_RK_STAGES, &dp_explicit, Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), 
+    Hermes::vector<Solution<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), matrix_solver);
+  if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == KUZMIN)
+    ssp_rk.set_limiting(FluxLimiter::Kuzmin, false);
+  if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == KRIVODONOVA)
+    ssp_rk.set_limiting(FluxLimiter::Krivodonova);
+
+  // Coefficients of the current time level for the explicit time integration.
+  double* sln_vector = NULL;
+  if(EXPLICIT_TIME_INTEGRATION)
+  {
+    if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
+      error("The Feistauer's shock capturing is available only with the semi-implicit scheme.");
+    sln_vector = new double[ndof];
+    OGProjection<double>::project_global(Hermes::vector<Space<double>*>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), 
+      Hermes::vector<MeshFunction<double>*>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), sln_vector, matrix_solver);
+  }
+
+  // Integration order of the forms.
+  EulerFormsOrder::nonlinearity_increase = INTEGRATION_ORDER_INCREASE;
+  EulerFormsOrder::max_order = INTEGRATION_ORDER_MAX;
+  EulerFormsOrder::fixed_order = INTEGRATION_ORDER_FIXED;
+
+  // Timer for the assembly.
+  Hermes::TimePeriod assembly_time;
+
+  // Timer for the whole time step.
+  Hermes::TimePeriod step_time;
+
   // Time stepping loop.
   for(; t < 6.0; t += time_step)
   {
     info("---- Time step %d, time %3.5f.", iteration++, t);
+    step_time.tick(Hermes::HERMES_SKIP);
 
-    if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
+    if(EXPLICIT_TIME_INTEGRATION)
+    {
+      wf_explicit.set_time_step(time_step);
+      ssp_rk.step(sln_vector);
+      info("SSP-RK%d: %g element updates per second.", SSP_RK_STAGES, ssp_rk.get_element_updates() / ssp_rk.get_time());
+
+      // The edge-based estimate.
+      CFL.calculate_semi_implicit(sln_vector, Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), time_step);
+    }
+    else
     {
-      assert(space_stabilization.get_num_dofs() == space_stabilization.get_mesh()->get_num_active_elements());
-      dp_stabilization.assemble(rhs_stabilization);
-      bool* discreteIndicator = new bool[space_stabilization.get_num_dofs()];
-      memset(discreteIndicator, 0, space_stabilization.get_num_dofs() * sizeof(bool));
-      Element* e;
-      for_all_active_elements(e, space_stabilization.get_mesh())
+      if(SHOCK_CAPTURING && SHOCK_CAPTURING_TYPE == FEISTAUER)
       {
-        AsmList<double> al;
-        space_stabilization.get_element_assembly_list(e, &al);
-        if(rhs_stabilization->get(al.get_dof()[0]) >= 1)
-          discreteIndicator[e->id] = true;
+        // Only the elements whose density changed since the last time step are evaluated.
+        wf.update_stabilization_indicator(&space_rho, factorization_reuse.get_sln_vector());
+        info("Shock indicator: %d discontinuous elements (%d evaluated in %g s).", wf.get_stabilization_indicator()->get_discontinuous_count(), 
+          wf.get_stabilization_indicator()->get_last_evaluated(), wf.get_stabilization_indicator()->get_last_time());
       }
-      wf.set_discreteIndicator(discreteIndicator);
-    }
 
-    // Set the current time step.
-    wf.set_time_step(time_step);
+      // Set the current time step.
+      wf.set_time_step(time_step);
 
-    // Assemble the stiffness matrix and rhs.
-    info("Assembling the stiffness matrix and right-hand side vector.");
-    dp.assemble(matrix, rhs);
+      // Assemble the stiffness matrix and rhs.
+      info("Assembling the stiffness matrix and right-hand side vector.");
+      assembly_time.tick(Hermes::HERMES_SKIP);
+      dp.assemble(matrix, rhs);
+      assembly_time.tick();
+      info("Assembly time: %g s (total %g s).", assembly_time.last(), assembly_time.accumulated());
 
-    // Solve the matrix problem.
-    info("Solving the matrix problem.");
-    if(solver->solve())
-    {
-      if(!SHOCK_CAPTURING || SHOCK_CAPTURING_TYPE == FEISTAUER)
+      // Solve the matrix problem.
+      info("Solving the matrix problem.");
+      if(factorization_reuse.solve(time_step))
       {
-        Solution<double>::vector_to_solutions(solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-          &space_rho_v_y, &space_e), Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+        if(!SHOCK_CAPTURING || SHOCK_CAPTURING_TYPE == FEISTAUER)
+        {
+          Solution<double>::vector_to_solutions(factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+            &space_rho_v_y, &space_e), Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+        }
+        else
+        {      
+          FluxLimiter* flux_limiter;
+          if(SHOCK_CAPTURING_TYPE == KUZMIN)
+            flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+            &space_rho_v_y, &space_e));
+          else
+            flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
+            &space_rho_v_y, &space_e));
+
+          if(SHOCK_CAPTURING_TYPE == KUZMIN)
+            flux_limiter->limit_second_orders_according_to_detector();
+
+          flux_limiter->limit_according_to_detector();
+
+          flux_limiter->get_limited_solutions(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
+        }
       }
       else
-      {      
-        FluxLimiter* flux_limiter;
-        if(SHOCK_CAPTURING_TYPE == KUZMIN)
-          flux_limiter = new FluxLimiter(FluxLimiter::Kuzmin, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-          &space_rho_v_y, &space_e));
-        else
-          flux_limiter = new FluxLimiter(FluxLimiter::Krivodonova, solver->get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, 
-          &space_rho_v_y, &space_e));
-
-        if(SHOCK_CAPTURING_TYPE == KUZMIN)
-          flux_limiter->limit_second_orders_according_to_detector();
+        error ("Matrix solver failed.\n");
 
-        flux_limiter->limit_according_to_detector();
+      CFL.calculate_semi_implicit(factorization_reuse.get_sln_vector(), Hermes::vector<Space<double> *>(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e), time_step);
 
-        flux_limiter->get_limited_solutions(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e));
-      }
+      // Time of the step (without the output).
+      step_time.tick();
+      info("Step time: %g s (solution %g s, %d solutions with a stale factorization so far).", step_time.last(), 
+        factorization_reuse.get_last_time(), factorization_reuse.get_stale_solves());
     }
-    else
-      error ("Matrix solver failed.\n");
-
-    CFL.calculate_semi_implicit(Hermes::vector<Solution<double> *>(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e), &mesh, time_step);
 
     // Visualization.
     if((iteration - 1) % EVERY_NTH_STEP == 0) 
@@ -274,5 +336,7 @@ int main(int argc, char* argv[])
   pressure_view.close();
   Mach_number_view.close();
 
+  delete [] sln_vector;
+
   return 0;
 }
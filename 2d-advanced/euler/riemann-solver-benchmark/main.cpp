@@ -0,0 +1,286 @@
+#define HERMES_REPORT_INFO
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This is not a PDE example, it compares the cost and the accuracy of the numerical fluxes
+// (the approximate Riemann solvers Rusanov, HLL, HLLC against Vijayasundaram and Osher-Solomon)
+// on the forward facing step and the GAMM channel, both solved by the native finite volume
+// engine to a fixed final time. For each flux, the wall time, the number of time steps,
+// the position of the shock and the entropy error are reported, the position of the shock
+// also relative to the Osher-Solomon flux.
+//
+// Forward facing step: the shock position is the smallest x-coordinate of the cells in which
+// the density exceeds SHOCK_DENSITY_RATIO * RHO_EXT (the bow shock in front of the step).
+// GAMM channel: the shock position is the x-coordinate of the cell with the highest Mach number
+// (the end of the supersonic region over the bump).
+// The entropy error is the L2 norm of p / rho^kappa relative to its inlet value, minus one,
+// divided by the square root of the area of the domain.
+//
+// With FEM_COMPARISON, the native finite volume engine is also compared to the DiscreteProblem
+// assembly and solution of the P0 semi-implicit scheme (the path of forward-step with P_INIT == 0
+// and NATIVE_FVM == false) on the fine forward facing step mesh: both make FEM_COMPARISON_STEPS
+// time steps of the same length (given by the CFL condition of the initial state) with the
+// Vijayasundaram flux, the times per time step and their ratio are reported.
+//
+// The following parameters can be changed:
+
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM_FFS = 3;
+const int INIT_REF_NUM_GAMM = 3;
+// CFL value.
+const double CFL_NUMBER = 0.5;
+// Final times.
+const double T_FINAL_FFS = 1.0;
+const double T_FINAL_GAMM = 5.0;
+// Density ratio marking the shock in the forward facing step.
+const double SHOCK_DENSITY_RATIO = 1.5;
+// Comparison with the DiscreteProblem path, number of initial uniform mesh refinements and of time steps.
+const bool FEM_COMPARISON = true;
+const int INIT_REF_NUM_FEM_COMPARISON = 4;
+const int FEM_COMPARISON_STEPS = 10;
+// Matrix solver for the projection: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+// SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;
+
+// Kappa.
+const double KAPPA = 1.4;
+
+// Weak forms.
+#include "../forms_explicit.cpp"
+
+// Equation parameters and boundary markers of the problems (see forward-step and gamm-channel).
+struct Problem
+{
+  const char* name;
+  const char* mesh_file;
+  int init_ref_num;
+  double t_final;
+  double rho_ext, v1_ext, v2_ext, p_ext;
+  std::string solid_wall_bottom, solid_wall_top, inlet, outlet;
+  // The forward facing step (true) or the GAMM channel.
+  bool ffs;
+};
+
+struct Result
+{
+  double time;
+  int steps;
+  double shock_position;
+  double entropy_error;
+};
+
+Result run(const Problem& problem, NumericalFlux* num_flux)
+{
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load(problem.mesh_file, &mesh);
+  for (int i = 0; i < problem.init_ref_num; i++)
+    mesh.refine_all_elements(0, true);
+
+  L2Space<double> space_rho(&mesh, 0);
+  L2Space<double> space_rho_v_x(&mesh, 0);
+  L2Space<double> space_rho_v_y(&mesh, 0);
+  L2Space<double> space_e(&mesh, 0);
+  Hermes::vector<Space<double>*> spaces(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e);
+  int ndof = Space<double>::get_num_dofs(spaces);
+
+  // Initial condition identical to the inlet state.
+  double e_ext = QuantityCalculator::calc_energy(problem.rho_ext, problem.rho_ext * problem.v1_ext, problem.rho_ext * problem.v2_ext, problem.p_ext, KAPPA);
+  ConstantSolution<double> init_rho(&mesh, problem.rho_ext);
+  ConstantSolution<double> init_rho_v_x(&mesh, problem.rho_ext * problem.v1_ext);
+  ConstantSolution<double> init_rho_v_y(&mesh, problem.rho_ext * problem.v2_ext);
+  ConstantSolution<double> init_e(&mesh, e_ext);
+  double* sln_vector = new double[ndof];
+  OGProjection<double>::project_global(spaces, Hermes::vector<MeshFunction<double>*>(&init_rho, &init_rho_v_x, &init_rho_v_y, &init_e),
+    sln_vector, matrix_solver);
+
+  FiniteVolumeEuler fvm(num_flux, KAPPA);
+  fvm.add_solid_wall(problem.solid_wall_bottom);
+  fvm.add_solid_wall(problem.solid_wall_top);
+  fvm.add_inlet(problem.inlet, problem.rho_ext, problem.v1_ext, problem.v2_ext, problem.p_ext);
+  fvm.add_outlet(problem.outlet, problem.p_ext);
+  fvm.set_state(sln_vector, spaces);
+
+  Result result;
+  result.steps = 0;
+  Hermes::TimePeriod cpu_time;
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  for(double t = 0.0; t < problem.t_final; result.steps++)
+  {
+    double time_step = std::min(fvm.calculate_time_step(CFL_NUMBER), problem.t_final - t);
+    fvm.step(time_step);
+    t += time_step;
+  }
+  cpu_time.tick();
+  result.time = cpu_time.last();
+
+  // The cell values.
+  fvm.get_state(sln_vector);
+  Solution<double> rho(&mesh), rho_v_x(&mesh), rho_v_y(&mesh), e(&mesh);
+  Hermes::vector<Solution<double>*> solutions(&rho, &rho_v_x, &rho_v_y, &e);
+  Solution<double>::vector_to_solutions(sln_vector, spaces, solutions);
+
+  double entropy_ext = problem.p_ext / std::pow(problem.rho_ext, KAPPA);
+  double entropy_integral = 0.0, area = 0.0, max_mach = 0.0;
+  result.shock_position = std::numeric_limits<double>::max();
+  Element* elem;
+  for_all_active_elements(elem, &mesh)
+  {
+    double w[4];
+    for(int i = 0; i < 4; i++)
+    {
+      solutions[i]->set_active_element(elem);
+      w[i] = solutions[i]->get_ref_value_transformed(elem, -0.5, -0.5, 0, 0);
+    }
+    double c_x = 0.0;
+    for(unsigned int i = 0; i < elem->get_num_surf(); i++)
+      c_x += elem->vn[i]->x / elem->get_num_surf();
+
+    double pressure = QuantityCalculator::calc_pressure(w[0], w[1], w[2], w[3], KAPPA);
+    double entropy_difference = pressure / std::pow(w[0], KAPPA) / entropy_ext - 1.0;
+    entropy_integral += entropy_difference * entropy_difference * elem->get_area();
+    area += elem->get_area();
+
+    if(problem.ffs)
+    {
+      if(w[0] > SHOCK_DENSITY_RATIO * problem.rho_ext)
+        result.shock_position = std::min(result.shock_position, c_x);
+    }
+    else
+    {
+      double mach = std::sqrt(w[1] * w[1] + w[2] * w[2]) / w[0] / QuantityCalculator::calc_sound_speed(w[0], w[1], w[2], w[3], KAPPA);
+      if(mach > max_mach)
+      {
+        max_mach = mach;
+        result.shock_position = c_x;
+      }
+    }
+  }
+  result.entropy_error = std::sqrt(entropy_integral / area);
+
+  info("%s, %d cells: %g s, %d time steps.", problem.name, fvm.get_cell_count(), result.time, result.steps);
+
+  delete [] sln_vector;
+  return result;
+}
+
+// The same time steps of the native finite volume engine and of the DiscreteProblem path.
+void compare_with_fem(const Problem& problem, NumericalFlux* num_flux)
+{
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load(problem.mesh_file, &mesh);
+  for (int i = 0; i < INIT_REF_NUM_FEM_COMPARISON; i++)
+    mesh.refine_all_elements(0, true);
+
+  L2Space<double> space_rho(&mesh, 0);
+  L2Space<double> space_rho_v_x(&mesh, 0);
+  L2Space<double> space_rho_v_y(&mesh, 0);
+  L2Space<double> space_e(&mesh, 0);
+  Hermes::vector<Space<double>*> spaces(&space_rho, &space_rho_v_x, &space_rho_v_y, &space_e);
+  int ndof = Space<double>::get_num_dofs(spaces);
+
+  // Initial condition identical to the inlet state.
+  double e_ext = QuantityCalculator::calc_energy(problem.rho_ext, problem.rho_ext * problem.v1_ext, problem.rho_ext * problem.v2_ext, problem.p_ext, KAPPA);
+  ConstantSolution<double> init_rho(&mesh, problem.rho_ext);
+  ConstantSolution<double> init_rho_v_x(&mesh, problem.rho_ext * problem.v1_ext);
+  ConstantSolution<double> init_rho_v_y(&mesh, problem.rho_ext * problem.v2_ext);
+  ConstantSolution<double> init_e(&mesh, e_ext);
+  double* sln_vector = new double[ndof];
+  OGProjection<double>::project_global(spaces, Hermes::vector<MeshFunction<double>*>(&init_rho, &init_rho_v_x, &init_rho_v_y, &init_e),
+    sln_vector, matrix_solver);
+
+  // The native finite volume engine.
+  FiniteVolumeEuler fvm(num_flux, KAPPA);
+  fvm.add_solid_wall(problem.solid_wall_bottom);
+  fvm.add_solid_wall(problem.solid_wall_top);
+  fvm.add_inlet(problem.inlet, problem.rho_ext, problem.v1_ext, problem.v2_ext, problem.p_ext);
+  fvm.add_outlet(problem.outlet, problem.p_ext);
+  fvm.set_state(sln_vector, spaces);
+  double time_step = fvm.calculate_time_step(CFL_NUMBER);
+
+  Hermes::TimePeriod cpu_time;
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  for(int step = 0; step < FEM_COMPARISON_STEPS; step++)
+    fvm.step(time_step);
+  cpu_time.tick();
+  double fvm_time = cpu_time.last() / FEM_COMPARISON_STEPS;
+
+  // The DiscreteProblem assembly and solution.
+  Solution<double> prev_rho, prev_rho_v_x, prev_rho_v_y, prev_e;
+  Hermes::vector<Solution<double>*> solutions(&prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e);
+  Solution<double>::vector_to_solutions(sln_vector, spaces, solutions);
+
+  EulerEquationsWeakFormSemiImplicitMultiComponent wf(num_flux, KAPPA, problem.rho_ext, problem.v1_ext, problem.v2_ext, problem.p_ext,
+    problem.solid_wall_bottom, problem.solid_wall_top, problem.inlet, problem.outlet, &prev_rho, &prev_rho_v_x, &prev_rho_v_y, &prev_e, true);
+  wf.set_time_step(time_step);
+  DiscreteProblem<double> dp(&wf, spaces);
+  dp.set_fvm();
+
+  SparseMatrix<double>* matrix = create_matrix<double>(matrix_solver);
+  Vector<double>* rhs = create_vector<double>(matrix_solver);
+  LinearSolver<double>* solver = create_linear_solver<double>(matrix_solver, matrix, rhs);
+  FactorizationReuse factorization_reuse(solver, matrix, rhs);
+
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  for(int step = 0; step < FEM_COMPARISON_STEPS; step++)
+  {
+    dp.assemble(matrix, rhs);
+    if(!factorization_reuse.solve(time_step))
+      error ("Matrix solver failed.\n");
+    Solution<double>::vector_to_solutions(factorization_reuse.get_sln_vector(), spaces, solutions);
+  }
+  cpu_time.tick();
+  double fem_time = cpu_time.last() / FEM_COMPARISON_STEPS;
+
+  // The schemes differ (explicit and semi-implicit), the difference only checks that both solve the same problem.
+  fvm.get_state(sln_vector);
+  Solution<double> rho_fvm(&mesh);
+  Solution<double>::vector_to_solution(sln_vector, &space_rho, &rho_fvm);
+
+  info("%s, %d cells, %d time steps of %g: DiscreteProblem %g s per time step, native finite volume %g s per time step (%g times faster), relative L2 difference of the densities %g.",
+    problem.name, fvm.get_cell_count(), FEM_COMPARISON_STEPS, time_step, fem_time, fvm_time, fem_time / fvm_time,
+    Global<double>::calc_rel_error(&rho_fvm, &prev_rho, HERMES_L2_NORM));
+
+  delete solver;
+  delete matrix;
+  delete rhs;
+  delete [] sln_vector;
+}
+
+int main(int argc, char* argv[])
+{
+  Problem problems[2] = {
+    { "Forward facing step", "ffs.mesh", INIT_REF_NUM_FFS, T_FINAL_FFS, 1.4, 3.0, 0.0, 1.0, "1", "3", "4", "2", true },
+    { "GAMM channel", "GAMM-channel.mesh", INIT_REF_NUM_GAMM, T_FINAL_GAMM, 1.0, 1.25, 0.0, 2.5, "3", "4", "1", "2", false }
+  };
+
+  RusanovNumericalFlux rusanov(KAPPA);
+  HLLNumericalFlux hll(KAPPA);
+  HLLCNumericalFlux hllc(KAPPA);
+  VijayasundaramNumericalFlux vijayasundaram(KAPPA);
+  OsherSolomonNumericalFlux osher_solomon(KAPPA);
+  // The reference (Osher-Solomon) is the last one.
+  NumericalFlux* fluxes[5] = { &rusanov, &hll, &hllc, &vijayasundaram, &osher_solomon };
+  const char* names[5] = { "Rusanov", "HLL", "HLLC", "Vijayasundaram", "Osher-Solomon" };
+
+  for(int problem_i = 0; problem_i < 2; problem_i++)
+  {
+    Result results[5];
+    for(int flux_i = 0; flux_i < 5; flux_i++)
+      results[flux_i] = run(problems[problem_i], fluxes[flux_i]);
+
+    for(int flux_i = 0; flux_i < 5; flux_i++)
+      info("%s, %s: %g s (%g of Osher-Solomon), %d time steps, shock position %g (difference %g), entropy error %g.",
+        problems[problem_i].name, names[flux_i], results[flux_i].time, results[flux_i].time / results[4].time, results[flux_i].steps,
+        results[flux_i].shock_position, results[flux_i].shock_position - results[4].shock_position, results[flux_i].entropy_error);
+  }
+
+  if(FEM_COMPARISON)
+    compare_with_fem(problems[0], &vijayasundaram);
+
+  return 0;
+}
@@ -0,0 +1,49 @@
+#define HERMES_REPORT_INFO
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+#include "../euler_util.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This is not a PDE example, it is the post-processing of the shock indicator log
+// written by forward-step-adapt (shock_indicators.sil). Without a time step given, the
+// numbers of the elements limited to the linear (1) and the constant (0) functions are
+// listed for every time step; with a time step, its element ids are written into the text
+// files discontinuous_limit_to_1_<time step>.h2d and discontinuous_limit_to_0_<time step>.h2d.
+//
+// Usage: shock-indicator-log [log file] [time step]
+
+int main(int argc, char* argv[])
+{
+  ShockIndicatorLogReader reader(argc > 1 ? argv[1] : "shock_indicators.sil");
+
+  std::vector<int> element_ids[2];
+  if(argc > 2)
+  {
+    int iteration = atoi(argv[2]);
+    for(int indicator = 0; indicator < 2; indicator++)
+    {
+      if(!reader.get_element_ids(iteration, indicator, element_ids[indicator]))
+        error("No entry of the time step %d.", iteration);
+      char filename[60];
+      sprintf(filename, "discontinuous_limit_to_%d_%d.h2d", indicator, iteration);
+      std::ofstream out(filename);
+      for(unsigned int i = 0; i < element_ids[indicator].size(); i++)
+        out << element_ids[indicator][i] << std::endl;
+      out.close();
+    }
+    return 0;
+  }
+
+  std::vector<int> iterations = reader.get_iterations();
+  for(unsigned int i = 0; i < iterations.size(); i++)
+  {
+    for(int indicator = 0; indicator < 2; indicator++)
+      reader.get_element_ids(iterations[i], indicator, element_ids[indicator]);
+    info("Time step %d: %d elements limited to linear, %d to constant functions.", iterations[i], 
+      (int)element_ids[1].size(), (int)element_ids[0].size());
+  }
+
+  return 0;
+}
@@ -41,16 +41,19 @@ double CustomWeakFormRichardsIE::CustomJacobianFormVol::value(int n, double *wt,
   double result = 0;
   Func<double>* h_prev_newton = u_ext[0];
   Func<double>* h_prev_time = ext->fn[0];
+  LocalConstitutiveValues values(n);
+  for (int i = 0; i < n; i++)
+    values.h[i] = h_prev_newton->val[i] - H_OFFSET;
+  static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->evaluate(n, values.h, values);
   for (int i = 0; i < n; i++)
   {
-    double h_val_i = h_prev_newton->val[i] - H_OFFSET;
-    result += wt[i] * (   static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->dCdh(h_val_i) * u->val[i] * (h_prev_newton->val[i] - h_prev_time->val[i]) 
-                          * v->val[i] + static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->C(h_val_i) * u->val[i] * v->val[i] 
-			  + static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->dKdh(h_val_i) * u->val[i] * (h_prev_newton->dx[i] * v->dx[i] 
+    result += wt[i] * (   values.dCdh[i] * u->val[i] * (h_prev_newton->val[i] - h_prev_time->val[i]) 
+                          * v->val[i] + values.C[i] * u->val[i] * v->val[i] 
+			  + values.dKdh[i] * u->val[i] * (h_prev_newton->dx[i] * v->dx[i] 
 							 + h_prev_newton->dy[i] * v->dy[i]) * time_step
-                        + static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->K(h_val_i) * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]) * time_step
-			- static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->ddKdhh(h_val_i) * u->val[i] * h_prev_newton->dy[i] * v->val[i] * time_step
-                        - static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->dKdh(h_val_i) * u->dy[i] * v->val[i] * time_step
+                        + values.K[i] * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]) * time_step
+			- values.ddKdhh[i] * u->val[i] * h_prev_newton->dy[i] * v->val[i] * time_step
+                        - values.dKdh[i] * u->dy[i] * v->val[i] * time_step
 		      );
   }
   return result;
@@ -73,12 +76,16 @@ double CustomWeakFormRichardsIE::CustomResidualFormVol::value(int n, double *wt,
   double result = 0;
   Func<double>* h_prev_newton = u_ext[0];
   Func<double>* h_prev_time = ext->fn[0];
+  LocalConstitutiveValues values(n);
+  for (int i = 0; i < n; i++)
+    values.h[i] = h_prev_newton->val[i] - H_OFFSET;
+  static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->evaluate(n, values.h, values);
   for (int i = 0; i < n; i++)
   {
-    double h_val_i = h_prev_newton->val[i] - H_OFFSET;
-    result += wt[i] * (   static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->C(h_val_i) * (h_val_i - (h_prev_time->val[i] - H_OFFSET)) * v->val[i]
-                        + static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->K(h_val_i) * (h_prev_newton->dx[i] * v->dx[i] + h_prev_newton->dy[i] * v->dy[i]) * time_step
-                        - static_cast<CustomWeakFormRichardsIE*>(wf)->constitutive->dKdh(h_val_i) * h_prev_newton->dy[i] * v->val[i] * time_step
+    double h_val_i = values.h[i];
+    result += wt[i] * (   values.C[i] * (h_val_i - (h_prev_time->val[i] - H_OFFSET)) * v->val[i]
+                        + values.K[i] * (h_prev_newton->dx[i] * v->dx[i] + h_prev_newton->dy[i] * v->dy[i]) * time_step
+                        - values.dKdh[i] * h_prev_newton->dy[i] * v->val[i] * time_step
                       );
   }
   return result;
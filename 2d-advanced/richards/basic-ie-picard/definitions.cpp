@@ -44,14 +44,15 @@ double CustomWeakFormRichardsIEPicard::CustomJacobian::value(int n, double *wt,
   Func<double>* h_prev_newton = u_ext[0];
   Func<double>* h_prev_time = ext->fn[0];
   Func<double>* h_prev_picard = ext->fn[1];
+  LocalConstitutiveValues values(n);
+  for (int i = 0; i < n; i++)
+    values.h[i] = h_prev_picard->val[i] - H_OFFSET;
+  static_cast<CustomWeakFormRichardsIEPicard*>(wf)->constitutive->evaluate(n, values.h, values);
   for (int i = 0; i < n; i++)
   {
-    double h_prev_newton_i = h_prev_newton->val[i] - H_OFFSET;
-    double h_prev_picard_i = h_prev_picard->val[i] - H_OFFSET;
-    double h_prev_time_i = h_prev_time->val[i] - H_OFFSET;
-    result += wt[i] * (   static_cast<CustomWeakFormRichardsIEPicard*>(wf)->constitutive->C(h_prev_picard_i) * u->val[i] * v->val[i]
-                        + static_cast<CustomWeakFormRichardsIEPicard*>(wf)->constitutive->K(h_prev_picard_i) * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]) * time_step
-                        - static_cast<CustomWeakFormRichardsIEPicard*>(wf)->constitutive->dKdh(h_prev_picard_i) * u->dy[i] * v->val[i] * time_step
+    result += wt[i] * (   values.C[i] * u->val[i] * v->val[i]
+                        + values.K[i] * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]) * time_step
+                        - values.dKdh[i] * u->dy[i] * v->val[i] * time_step
                       );
   }
   return result;
@@ -75,14 +76,17 @@ double CustomWeakFormRichardsIEPicard::CustomResidual::value(int n, double *wt,
   Func<double>* h_prev_newton = u_ext[0];
   Func<double>* h_prev_time = ext->fn[0];
   Func<double>* h_prev_picard = ext->fn[1];
+  LocalConstitutiveValues values(n);
+  for (int i = 0; i < n; i++)
+    values.h[i] = h_prev_picard->val[i] - H_OFFSET;
+  static_cast<CustomWeakFormRichardsIEPicard*>(wf)->constitutive->evaluate(n, values.h, values);
   for (int i = 0; i < n; i++)
   {
     double h_prev_newton_i = h_prev_newton->val[i] - H_OFFSET;
-    double h_prev_picard_i = h_prev_picard->val[i] - H_OFFSET;
     double h_prev_time_i = h_prev_time->val[i] - H_OFFSET;
-    result += wt[i] * (   static_cast<CustomWeakFormRichardsIEPicard*>(wf)->constitutive->C(h_prev_picard_i) * (h_prev_newton_i - h_prev_time_i) * v->val[i]
-                        + static_cast<CustomWeakFormRichardsIEPicard*>(wf)->constitutive->K(h_prev_picard_i) * (h_prev_newton->dx[i] * v->dx[i] + h_prev_newton->dy[i] * v->dy[i]) * time_step
-                        - static_cast<CustomWeakFormRichardsIEPicard*>(wf)->constitutive->dKdh(h_prev_picard_i) * h_prev_newton->dy[i] * v->val[i] * time_step
+    result += wt[i] * (   values.C[i] * (h_prev_newton_i - h_prev_time_i) * v->val[i]
+                        + values.K[i] * (h_prev_newton->dx[i] * v->dx[i] + h_prev_newton->dy[i] * v->dy[i]) * time_step
+                        - values.dKdh[i] * h_prev_newton->dy[i] * v->val[i] * time_step
                        );
   }
   return result;
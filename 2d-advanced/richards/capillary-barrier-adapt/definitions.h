@@ -60,8 +60,8 @@ public:
 class WeakFormRichardsNewtonEuler : public WeakForm<double>
 {
 public:
-  WeakFormRichardsNewtonEuler(ConstitutiveRelationsGenuchtenWithLayer* relations, double tau, Solution<double>* prev_time_sln, Mesh* mesh) 
-               : WeakForm<double>(1), mesh(mesh) {
+  WeakFormRichardsNewtonEuler(ConstitutiveRelationsGenuchtenWithLayer* relations, double tau, Solution<double>* prev_time_sln, Mesh* mesh, 
+    ConstitutiveCache* cache = NULL) : WeakForm<double>(1), mesh(mesh), cache(cache) {
     JacobianFormNewtonEuler* jac_form = new JacobianFormNewtonEuler(0, 0, relations, tau);
     jac_form->ext.push_back(prev_time_sln);
     add_matrix_form(jac_form);
@@ -85,22 +85,25 @@ private:
       double result = 0;
       Func<double>* h_prev_newton = u_ext[0];
       Func<double>* h_prev_time = ext->fn[0];
+      LocalConstitutiveValues local_values;
+      const ConstitutiveValues& values = ConstitutiveCache::get(static_cast<WeakFormRichardsNewtonEuler*>(wf)->cache, e->id, ConstitutiveCache::ITERATE, n, 
+        h_prev_newton->val, relations, atoi(elem_marker.c_str()), local_values);
 
       for (int i = 0; i < n; i++)
         result += wt[i] * (
-        relations->C(h_prev_newton->val[i], atoi(elem_marker.c_str())) * u->val[i] * v->val[i] / tau
-		             + relations->dCdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) 
+        values.C[i] * u->val[i] * v->val[i] / tau
+		             + values.dCdh[i] 
                                * u->val[i] * h_prev_newton->val[i] * v->val[i] / tau
-		             - relations->dCdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) 
+		             - values.dCdh[i] 
                                * u->val[i] * h_prev_time->val[i] * v->val[i] / tau
-			     + relations->K(h_prev_newton->val[i], atoi(elem_marker.c_str())) 
+			     + values.K[i] 
                                * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i])
-                             + relations->dKdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) 
+                             + values.dKdh[i] 
                                * u->val[i] * 
                                (h_prev_newton->dx[i]*v->dx[i] + h_prev_newton->dy[i]*v->dy[i])
-                             - relations->dKdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) 
+                             - values.dKdh[i] 
                                * u->dy[i] * v->val[i]
-                             - relations->ddKdhh(h_prev_newton->val[i], atoi(elem_marker.c_str())) 
+                             - values.ddKdhh[i] 
                                * u->val[i] * h_prev_newton->dy[i] * v->val[i]
                           );
       return result;
@@ -133,13 +136,16 @@ private:
       double result = 0;
       Func<double>* h_prev_newton = u_ext[0];
       Func<double>* h_prev_time = ext->fn[0];
+      LocalConstitutiveValues local_values;
+      const ConstitutiveValues& values = ConstitutiveCache::get(static_cast<WeakFormRichardsNewtonEuler*>(wf)->cache, e->id, ConstitutiveCache::ITERATE, n, 
+        h_prev_newton->val, relations, atoi(elem_marker.c_str()), local_values);
       for (int i = 0; i < n; i++) {
         result += wt[i] * (
-		           relations->C(h_prev_newton->val[i], atoi(elem_marker.c_str())) 
+		           values.C[i] 
                            * (h_prev_newton->val[i] - h_prev_time->val[i]) * v->val[i] / tau
-                           + relations->K(h_prev_newton->val[i], atoi(elem_marker.c_str())) 
+                           + values.K[i] 
                            * (h_prev_newton->dx[i] * v->dx[i] + h_prev_newton->dy[i] * v->dy[i])
-                           -relations->dKdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) * h_prev_newton->dy[i] * v->val[i]
+                           -values.dKdh[i] * h_prev_newton->dy[i] * v->val[i]
                           );
       }
       return result;
@@ -159,13 +165,16 @@ private:
   };
 
   Mesh* mesh;
+  // Constitutive values shared by the forms, NULL to evaluate them in every form.
+  ConstitutiveCache* cache;
 };
 
 
 class WeakFormRichardsNewtonCrankNicolson : public WeakForm<double>
 {
 public:
-  WeakFormRichardsNewtonCrankNicolson(ConstitutiveRelationsGenuchtenWithLayer* relations, double tau, Solution<double>* prev_time_sln, Mesh* mesh) : WeakForm<double>(1), mesh(mesh) {
+  WeakFormRichardsNewtonCrankNicolson(ConstitutiveRelationsGenuchtenWithLayer* relations, double tau, Solution<double>* prev_time_sln, Mesh* mesh, 
+    ConstitutiveCache* cache = NULL) : WeakForm<double>(1), mesh(mesh), cache(cache) {
     JacobianFormNewtonCrankNicolson* jac_form = new JacobianFormNewtonCrankNicolson(0, 0, relations, tau);
     jac_form->ext.push_back(prev_time_sln);
     add_matrix_form(jac_form);
@@ -189,19 +198,26 @@ private:
       double result = 0;
       Func<double>* h_prev_newton = u_ext[0];
       Func<double>* h_prev_time = ext->fn[0];
+      int layer = atoi(elem_marker.c_str());
+      ConstitutiveCache* cache = static_cast<WeakFormRichardsNewtonCrankNicolson*>(wf)->cache;
+      LocalConstitutiveValues local_values, local_values_prev_time;
+      const ConstitutiveValues& values = ConstitutiveCache::get(cache, e->id, ConstitutiveCache::ITERATE, n, h_prev_newton->val, relations, layer, 
+        local_values);
+      const ConstitutiveValues& values_prev_time = ConstitutiveCache::get(cache, e->id, ConstitutiveCache::PREVIOUS_TIME_LEVEL, n, h_prev_time->val, 
+        relations, layer, local_values_prev_time);
       for (int i = 0; i < n; i++)
         result += wt[i] * 0.5 * ( // implicit Euler part:
-		             relations->C(h_prev_newton->val[i], atoi(elem_marker.c_str())) * u->val[i] * v->val[i] / tau
-		             + relations->dCdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) * u->val[i] * h_prev_newton->val[i] * v->val[i] / tau
-		             - relations->dCdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) * u->val[i] * h_prev_time->val[i] * v->val[i] / tau
-			     + relations->K(h_prev_newton->val[i], atoi(elem_marker.c_str())) * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i])
-                             + relations->dKdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) * u->val[i] * 
+		             values.C[i] * u->val[i] * v->val[i] / tau
+		             + values.dCdh[i] * u->val[i] * h_prev_newton->val[i] * v->val[i] / tau
+		             - values.dCdh[i] * u->val[i] * h_prev_time->val[i] * v->val[i] / tau
+			     + values.K[i] * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i])
+                             + values.dKdh[i] * u->val[i] * 
                                (h_prev_newton->dx[i]*v->dx[i] + h_prev_newton->dy[i]*v->dy[i])
-                             - relations->dKdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) * u->dy[i] * v->val[i]
-                             - relations->ddKdhh(h_prev_newton->val[i], atoi(elem_marker.c_str())) * u->val[i] * h_prev_newton->dy[i] * v->val[i]
+                             - values.dKdh[i] * u->dy[i] * v->val[i]
+                             - values.ddKdhh[i] * u->val[i] * h_prev_newton->dy[i] * v->val[i]
                            )
                 + wt[i] * 0.5 * ( // explicit Euler part, 
-		             relations->C(h_prev_time->val[i], atoi(elem_marker.c_str())) * u->val[i] * v->val[i] / tau
+		             values_prev_time.C[i] * u->val[i] * v->val[i] / tau
                            );
       return result;
     }
@@ -230,16 +246,23 @@ private:
       std::string elem_marker = static_cast<WeakFormRichardsNewtonCrankNicolson*>(wf)->mesh->get_element_markers_conversion().get_user_marker(e->elem_marker).marker;
       Func<double>* h_prev_newton = u_ext[0];
       Func<double>* h_prev_time = ext->fn[0];
+      int layer = atoi(elem_marker.c_str());
+      ConstitutiveCache* cache = static_cast<WeakFormRichardsNewtonCrankNicolson*>(wf)->cache;
+      LocalConstitutiveValues local_values, local_values_prev_time;
+      const ConstitutiveValues& values = ConstitutiveCache::get(cache, e->id, ConstitutiveCache::ITERATE, n, h_prev_newton->val, relations, layer, 
+        local_values);
+      const ConstitutiveValues& values_prev_time = ConstitutiveCache::get(cache, e->id, ConstitutiveCache::PREVIOUS_TIME_LEVEL, n, h_prev_time->val, 
+        relations, layer, local_values_prev_time);
       for (int i = 0; i < n; i++) {
         result += wt[i] * 0.5 * ( // implicit Euler part
-		           relations->C(h_prev_newton->val[i], atoi(elem_marker.c_str())) * (h_prev_newton->val[i] - h_prev_time->val[i]) * v->val[i] / tau
-                           + relations->K(h_prev_newton->val[i], atoi(elem_marker.c_str())) * (h_prev_newton->dx[i] * v->dx[i] + h_prev_newton->dy[i] * v->dy[i])
-                           - relations->dKdh(h_prev_newton->val[i], atoi(elem_marker.c_str())) * h_prev_newton->dy[i] * v->val[i]
+		           values.C[i] * (h_prev_newton->val[i] - h_prev_time->val[i]) * v->val[i] / tau
+                           + values.K[i] * (h_prev_newton->dx[i] * v->dx[i] + h_prev_newton->dy[i] * v->dy[i])
+                           - values.dKdh[i] * h_prev_newton->dy[i] * v->val[i]
                           )
                 + wt[i] * 0.5 * ( // explicit Euler part
-		           relations->C(h_prev_time->val[i], atoi(elem_marker.c_str())) * (h_prev_newton->val[i] - h_prev_time->val[i]) * v->val[i] / tau
-                           + relations->K(h_prev_time->val[i], atoi(elem_marker.c_str())) * (h_prev_time->dx[i] * v->dx[i] + h_prev_time->dy[i] * v->dy[i])
-                           - relations->dKdh(h_prev_time->val[i], atoi(elem_marker.c_str())) * h_prev_time->dy[i] * v->val[i]
+		           values_prev_time.C[i] * (h_prev_newton->val[i] - h_prev_time->val[i]) * v->val[i] / tau
+                           + values_prev_time.K[i] * (h_prev_time->dx[i] * v->dx[i] + h_prev_time->dy[i] * v->dy[i])
+                           - values_prev_time.dKdh[i] * h_prev_time->dy[i] * v->val[i]
 		           );
       }
       return result;
@@ -259,13 +282,16 @@ private:
   };
 
   Mesh* mesh;
+  // Constitutive values shared by the forms, NULL to evaluate them in every form.
+  ConstitutiveCache* cache;
 };
 
 
 class WeakFormRichardsPicardEuler : public WeakForm<double>
 {
 public:
-  WeakFormRichardsPicardEuler(ConstitutiveRelationsGenuchtenWithLayer* relations, double tau, Solution<double>* prev_picard_sln, Solution<double>* prev_time_sln, Mesh* mesh) : WeakForm<double>(1), mesh(mesh) {
+  WeakFormRichardsPicardEuler(ConstitutiveRelationsGenuchtenWithLayer* relations, double tau, Solution<double>* prev_picard_sln, Solution<double>* prev_time_sln, Mesh* mesh, 
+    ConstitutiveCache* cache = NULL) : WeakForm<double>(1), mesh(mesh), cache(cache) {
     JacobianFormPicardEuler* jac_form = new JacobianFormPicardEuler(0, 0, relations, tau);
     jac_form->ext.push_back(prev_picard_sln);
     add_matrix_form(jac_form);
@@ -289,11 +315,14 @@ private:
       std::string elem_marker = static_cast<WeakFormRichardsPicardEuler*>(wf)->mesh->get_element_markers_conversion().get_user_marker(e->elem_marker).marker;
       double result = 0;
       Func<double>* h_prev_picard = ext->fn[0];
+      LocalConstitutiveValues local_values;
+      const ConstitutiveValues& values = ConstitutiveCache::get(static_cast<WeakFormRichardsPicardEuler*>(wf)->cache, e->id, ConstitutiveCache::ITERATE, n, 
+        h_prev_picard->val, relations, atoi(elem_marker.c_str()), local_values);
 
       for (int i = 0; i < n; i++) {
-        result += wt[i] * (  relations->C(h_prev_picard->val[i], atoi(elem_marker.c_str())) * u->val[i] * v->val[i] / tau
-                             + relations->K(h_prev_picard->val[i], atoi(elem_marker.c_str())) * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i])
-                             - relations->dKdh(h_prev_picard->val[i], atoi(elem_marker.c_str())) * u->dy[i] * v->val[i]);
+        result += wt[i] * (  values.C[i] * u->val[i] * v->val[i] / tau
+                             + values.K[i] * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i])
+                             - values.dKdh[i] * u->dy[i] * v->val[i]);
       }
       return result;
     }
@@ -322,8 +351,11 @@ private:
       double result = 0;
       Func<double>* h_prev_picard = ext->fn[0];
       Func<double>* h_prev_time = ext->fn[1];
+      LocalConstitutiveValues local_values;
+      const ConstitutiveValues& values = ConstitutiveCache::get(static_cast<WeakFormRichardsPicardEuler*>(wf)->cache, e->id, ConstitutiveCache::ITERATE, n, 
+        h_prev_picard->val, relations, atoi(elem_marker.c_str()), local_values);
       for (int i = 0; i < n; i++) 
-        result += wt[i] * relations->C(h_prev_picard->val[i], atoi(elem_marker.c_str())) * h_prev_time->val[i] * v->val[i] / tau;
+        result += wt[i] * values.C[i] * h_prev_time->val[i] * v->val[i] / tau;
       return result;
     }
 
@@ -341,6 +373,8 @@ private:
   };
 
   Mesh* mesh;
+  // Constitutive values shared by the forms, NULL to evaluate them in every form.
+  ConstitutiveCache* cache;
 };
 
 class RichardsEssentialBC : public EssentialBoundaryCondition<double> {
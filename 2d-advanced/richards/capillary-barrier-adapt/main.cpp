@@ -104,6 +104,9 @@ enum CONSTITUTIVE_RELATIONS {
 };
 // Use van Genuchten's constitutive relations, or Gardner's.
 CONSTITUTIVE_RELATIONS constitutive_relations_type = CONSTITUTIVE_GENUCHTEN;
+// Evaluate the constitutive relations once per element and nonlinear iterate
+// (ConstitutiveCache), not in every form and pair of basis functions.
+const bool CACHE_CONSTITUTIVE = true;
 
 // Newton's and Picard's methods.
 // Stopping criterion for Newton on fine mesh.
@@ -252,21 +255,23 @@ int main(int argc, char* argv[])
   InitialSolutionRichards sln_prev_iter(&mesh, H_INIT);
 
   // Initialize the weak formulation.
+  ConstitutiveCache constitutive_cache;
+  ConstitutiveCache* cache = CACHE_CONSTITUTIVE ? &constitutive_cache : NULL;
   WeakForm<double>* wf;
   if (ITERATIVE_METHOD == 1) {
     if (TIME_INTEGRATION == 1) {
       info("Creating weak formulation for the Newton's method (implicit Euler in time).");
-      wf = new WeakFormRichardsNewtonEuler(&constitutive_relations, time_step, &sln_prev_time, &mesh);
+      wf = new WeakFormRichardsNewtonEuler(&constitutive_relations, time_step, &sln_prev_time, &mesh, cache);
     }
     else {
       info("Creating weak formulation for the Newton's method (Crank-Nicolson in time).");
-      wf = new WeakFormRichardsNewtonCrankNicolson(&constitutive_relations, time_step, &sln_prev_time, &mesh);
+      wf = new WeakFormRichardsNewtonCrankNicolson(&constitutive_relations, time_step, &sln_prev_time, &mesh, cache);
     }
   }
   else {
     if (TIME_INTEGRATION == 1) {
       info("Creating weak formulation for the Picard's method (implicit Euler in time).");
-      wf = new WeakFormRichardsPicardEuler(&constitutive_relations, time_step, &sln_prev_iter, &sln_prev_time, &mesh);
+      wf = new WeakFormRichardsPicardEuler(&constitutive_relations, time_step, &sln_prev_iter, &sln_prev_time, &mesh, cache);
     }
     else {
       info("Creating weak formulation for the Picard's method (Crank-Nicolson in time).");
@@ -363,6 +368,7 @@ int main(int argc, char* argv[])
           save_coeff_vec[i] = coeff_vec[i];
 
         bc_essential.set_current_time(current_time);
+        constitutive_cache.update(ref_space->get_mesh());
         
         // Perform Newton's iteration.
         info("Solving nonlinear problem:");
@@ -421,6 +427,7 @@ int main(int argc, char* argv[])
         bool verbose = true;
 
         bc_essential.set_current_time(current_time);
+        constitutive_cache.update(ref_space->get_mesh());
 
         DiscreteProblem<double> dp(wf, ref_space);
         PicardSolver<double> picard(&dp, &sln_prev_iter, matrix_solver);
@@ -483,6 +490,8 @@ int main(int argc, char* argv[])
     graph_time_cpu.save("time_cpu.dat");
     graph_time_step.add_values(current_time, time_step);
     graph_time_step.save("time_step_history.dat");
+    if (CACHE_CONSTITUTIVE)
+      info("Constitutive cache: %d hits, %d misses.", constitutive_cache.get_hits(), constitutive_cache.get_misses());
 
     // Visualize the solution and mesh.
     char title[100];
@@ -26,20 +26,24 @@ double CustomWeakFormRichardsRK::CustomJacobianFormVol::value(int n, double *wt,
   info("1");
   double result = 0;
   Func<double>* h_prev_newton = u_ext[0];
+  LocalConstitutiveValues values(n);
+  for (int i = 0; i < n; i++)
+    values.h[i] = h_prev_newton->val[i] - H_OFFSET;
+  constitutive->evaluate(n, values.h, values);
   for (int i = 0; i < n; i++)
   {
-    double h_val_i = h_prev_newton->val[i] - H_OFFSET;
+    double C = values.C[i], dCdh = values.dCdh[i], K = values.K[i], dKdh = values.dKdh[i];
 
-    double C2 =  constitutive->C(h_val_i) * constitutive->C(h_val_i);
-    double a1_1 = (constitutive->dKdh(h_val_i) * constitutive->C(h_val_i) - constitutive->dCdh(h_val_i) * constitutive->K(h_val_i)) / C2;
-    double a1_2 = constitutive->K(h_val_i) / constitutive->C(h_val_i);
+    double C2 =  C * C;
+    double a1_1 = (dKdh * C - dCdh * K) / C2;
+    double a1_2 = K / C;
 
-    double a2_1 = ((constitutive->dKdh(h_val_i) * constitutive->dCdh(h_val_i) + constitutive->K(h_val_i) * constitutive->ddCdhh(h_val_i)) * C2 
-                  - 2 * constitutive->K(h_val_i) * constitutive->C(h_val_i) * constitutive->dCdh(h_val_i) * constitutive->dCdh(h_val_i)) / (C2 * C2);
-    double a2_2 = 2 * constitutive->K(h_val_i) * constitutive->dCdh(h_val_i) / C2;   
+    double a2_1 = ((dKdh * dCdh + K * values.ddCdhh[i]) * C2 
+                  - 2 * K * C * dCdh * dCdh) / (C2 * C2);
+    double a2_2 = 2 * K * dCdh / C2;   
 
-    double a3_1 = (constitutive->ddKdhh(h_val_i) * constitutive->C(h_val_i) - constitutive->dKdh(h_val_i) * constitutive->dCdh(h_val_i)) / C2;
-    double a3_2 = constitutive->dKdh(h_val_i) / constitutive->C(h_val_i);
+    double a3_1 = (values.ddKdhh[i] * C - dKdh * dCdh) / C2;
+    double a3_2 = dKdh / C;
 
     result += wt[i] * ( - a1_1 * u->val[i] * (h_prev_newton->dx[i] * v->dx[i] + h_prev_newton->dy[i] * v->dy[i])
                         - a1_2 * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i])
@@ -71,12 +75,15 @@ double CustomWeakFormRichardsRK::CustomResidualFormVol::value(int n, double *wt,
   info("2");
   double result = 0;
   Func<double>* h_prev_newton = u_ext[0];
+  LocalConstitutiveValues values(n);
+  for (int i = 0; i < n; i++)
+    values.h[i] = h_prev_newton->val[i] - H_OFFSET;
+  constitutive->evaluate(n, values.h, values);
   for (int i = 0; i < n; i++)
   {
-    double h_val_i = h_prev_newton->val[i] - H_OFFSET;
-    double r1 = (constitutive->K(h_val_i) / constitutive->C(h_val_i));
-    double r2 = constitutive->K(h_val_i) * constitutive->dCdh(h_val_i) / (constitutive->C(h_val_i) * constitutive->C(h_val_i));
-    double r3 = constitutive->dKdh(h_val_i) / constitutive->C(h_val_i);
+    double r1 = (values.K[i] / values.C[i]);
+    double r2 = values.K[i] * values.dCdh[i] / (values.C[i] * values.C[i]);
+    double r3 = values.dKdh[i] / values.C[i];
 
     result += wt[i] * ( - r1 * (h_prev_newton->dx[i] * v->dx[i] + h_prev_newton->dy[i] * v->dy[i])
                         + r2 * v->val[i] * (h_prev_newton->dx[i] * h_prev_newton->dx[i] 
@@ -0,0 +1,168 @@
+#define HERMES_REPORT_ALL
+#define HERMES_REPORT_FILE "application.log"
+#include "hermes2d.h"
+
+#include "../constitutive.h"
+
+using namespace Hermes;
+using namespace Hermes::Hermes2D;
+
+// This is not a PDE example, it measures the number of evaluations per second of the constitutive
+// relations (Gardner, van Genuchten, van Genuchten with layers evaluated exactly and approximated by
+// the polynomials of capillary-barrier-adapt) as the weak forms of the Richards equation need them:
+// K, dK/dh, ddK/dhh, C and dC/dh at all integration points of an element. The separate calls of the
+// functions per point are compared to one call of ConstitutiveRelations::evaluate() per element,
+// the largest relative difference of the values is reported as well.
+//
+// The following parameters can be changed:
+
+// Number of integration points per element.
+const int NUM_POINTS = 64;
+// Number of elements.
+const int NUM_ELEMENTS = 20000;
+// Number of passes over all elements.
+const int NUM_PASSES = 10;
+// Range of the pressure head.
+const double H_MIN = -999.0;
+const double H_MAX = 1.0;
+
+// Parameters of the layers (see capillary-barrier-adapt), the first one is used
+// for the Gardner's and van Genuchten's relations.
+const int MATERIAL_COUNT = 4;
+double K_S_vals[4] = {350.2, 712.8, 1.68, 18.64}; 
+double ALPHA_vals[4] = {0.01, 1.0, 0.01, 0.01};
+double N_vals[4] = {2.5, 2.0, 1.23, 2.5};
+double M_vals[4] = {0.864, 0.626, 0.187, 0.864};
+double THETA_R_vals[4] = {0.064, 0.0, 0.089, 0.064};
+double THETA_S_vals[4] = {0.14, 0.43, 0.43, 0.24};
+double STORATIVITY_vals[4] = {0.1, 0.1, 0.1, 0.1};
+
+// Polynomial approximation (CONSTITUTIVE_TABLE_METHOD == 2 in capillary-barrier-adapt).
+const int NUM_OF_INTERVALS = 16;
+double INTERVALS_4_APPROX[16] = 
+      {-1.0, -2.0, -3.0, -4.0, -5.0, -8.0, -10.0, -12.0, 
+      -15.0, -20.0, -30.0, -50.0, -75.0, -100.0,-300.0, -1000.0}; 
+const double LOW_LIMIT = -1.0;
+const int NUM_OF_INSIDE_PTS = 0;
+
+struct Result
+{
+  // Evaluations (of all five functions at one point) per second.
+  double separate_rate, fused_rate;
+  double max_difference;
+};
+
+// Relative difference of two values.
+double difference(double a, double b)
+{
+  return (a == b) ? 0.0 : std::abs(a - b) / std::max(std::abs(a), std::abs(b));
+}
+
+// With layers (layered != NULL), the layer of an element is its index modulo MATERIAL_COUNT.
+Result run(ConstitutiveRelations* relations, ConstitutiveRelationsGenuchtenWithLayer* layered, double* h)
+{
+  Result result;
+  Hermes::TimePeriod cpu_time;
+  double* separate = new double[5 * NUM_POINTS * NUM_ELEMENTS];
+  ConstitutiveValues values(NUM_POINTS);
+
+  // Separate calls.
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  for (int pass = 0; pass < NUM_PASSES; pass++)
+    for (int e = 0; e < NUM_ELEMENTS; e++)
+    {
+      double* h_e = h + e * NUM_POINTS;
+      double* separate_e = separate + 5 * e * NUM_POINTS;
+      int layer = e % MATERIAL_COUNT;
+      for (int i = 0; i < NUM_POINTS; i++)
+      {
+        if (layered != NULL)
+        {
+          separate_e[5 * i] = layered->K(h_e[i], layer);
+          separate_e[5 * i + 1] = layered->dKdh(h_e[i], layer);
+          separate_e[5 * i + 2] = layered->ddKdhh(h_e[i], layer);
+          separate_e[5 * i + 3] = layered->C(h_e[i], layer);
+          separate_e[5 * i + 4] = layered->dCdh(h_e[i], layer);
+        }
+        else
+        {
+          separate_e[5 * i] = relations->K(h_e[i]);
+          separate_e[5 * i + 1] = relations->dKdh(h_e[i]);
+          separate_e[5 * i + 2] = relations->ddKdhh(h_e[i]);
+          separate_e[5 * i + 3] = relations->C(h_e[i]);
+          separate_e[5 * i + 4] = relations->dCdh(h_e[i]);
+        }
+      }
+    }
+  cpu_time.tick();
+  result.separate_rate = double(NUM_PASSES) * NUM_ELEMENTS * NUM_POINTS / cpu_time.last();
+
+  // One call per element.
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  for (int pass = 0; pass < NUM_PASSES; pass++)
+    for (int e = 0; e < NUM_ELEMENTS; e++)
+      if (layered != NULL)
+        layered->evaluate(NUM_POINTS, h + e * NUM_POINTS, e % MATERIAL_COUNT, values);
+      else
+        relations->evaluate(NUM_POINTS, h + e * NUM_POINTS, values);
+  cpu_time.tick();
+  result.fused_rate = double(NUM_PASSES) * NUM_ELEMENTS * NUM_POINTS / cpu_time.last();
+
+  // Comparison.
+  result.max_difference = 0.0;
+  for (int e = 0; e < NUM_ELEMENTS; e++)
+  {
+    if (layered != NULL)
+      layered->evaluate(NUM_POINTS, h + e * NUM_POINTS, e % MATERIAL_COUNT, values);
+    else
+      relations->evaluate(NUM_POINTS, h + e * NUM_POINTS, values);
+    double* separate_e = separate + 5 * e * NUM_POINTS;
+    for (int i = 0; i < NUM_POINTS; i++)
+    {
+      double fused[5] = { values.K[i], values.dKdh[i], values.ddKdhh[i], values.C[i], values.dCdh[i] };
+      for (int j = 0; j < 5; j++)
+        result.max_difference = std::max(result.max_difference, difference(separate_e[5 * i + j], fused[j]));
+    }
+  }
+
+  delete [] separate;
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  // Pressure heads, evenly spread over the range in a scrambled order.
+  double* h = new double[NUM_POINTS * NUM_ELEMENTS];
+  for (int i = 0; i < NUM_POINTS * NUM_ELEMENTS; i++)
+    h[i] = H_MIN + (H_MAX - H_MIN) * ((i * 7919L) % (NUM_POINTS * NUM_ELEMENTS)) / (NUM_POINTS * NUM_ELEMENTS);
+
+  ConstitutiveRelationsGardner gardner(ALPHA_vals[0], THETA_S_vals[0], THETA_R_vals[0], K_S_vals[0]);
+  ConstitutiveRelationsGenuchten genuchten(ALPHA_vals[0], M_vals[0], N_vals[0], THETA_S_vals[0], THETA_R_vals[0], K_S_vals[0], STORATIVITY_vals[0]);
+  ConstitutiveRelationsGenuchtenWithLayer layered_exact(0, NUM_OF_INSIDE_PTS, LOW_LIMIT, 0.1, -1000.0, 
+    K_S_vals, ALPHA_vals, N_vals, M_vals, THETA_R_vals, THETA_S_vals, STORATIVITY_vals);
+  ConstitutiveRelationsGenuchtenWithLayer layered_polynomials(2, NUM_OF_INSIDE_PTS, LOW_LIMIT, 0.1, -1000.0, 
+    K_S_vals, ALPHA_vals, N_vals, M_vals, THETA_R_vals, THETA_S_vals, STORATIVITY_vals);
+  for (int i = 0; i < MATERIAL_COUNT; i++)
+  {
+    double* points = new double[NUM_OF_INSIDE_PTS];
+    init_polynomials(6 + NUM_OF_INSIDE_PTS, LOW_LIMIT, points, NUM_OF_INSIDE_PTS, i, &layered_polynomials, MATERIAL_COUNT, NUM_OF_INTERVALS, INTERVALS_4_APPROX);
+    delete [] points;
+  }
+  layered_polynomials.polynomials_ready = true;
+  layered_polynomials.constitutive_tables_ready = true;
+  layered_polynomials.table_limit = INTERVALS_4_APPROX[NUM_OF_INTERVALS-1];
+
+  const char* names[4] = { "Gardner", "van Genuchten", "van Genuchten with layers (exact)", "van Genuchten with layers (polynomials)" };
+  Result results[4];
+  results[0] = run(&gardner, NULL, h);
+  results[1] = run(&genuchten, NULL, h);
+  results[2] = run(NULL, &layered_exact, h);
+  results[3] = run(NULL, &layered_polynomials, h);
+
+  for (int i = 0; i < 4; i++)
+    info("%s: %g evaluations/s separately, %g evaluations/s in one call per element (%g times faster), largest relative difference %g.",
+      names[i], results[i].separate_rate, results[i].fused_rate, results[i].fused_rate / results[i].separate_rate, results[i].max_difference);
+
+  delete [] h;
+  return 0;
+}
@@ -0,0 +1,156 @@
+#define HERMES_REPORT_ALL
+#define HERMES_REPORT_FILE "application.log"
+#include "../capillary-barrier-adapt/definitions.h"
+
+// This is not a PDE example, it measures the time of the Newton's iterations of capillary-barrier-adapt
+// (implicit Euler, van Genuchten with layers) on a fixed mesh for the polynomial degrees P_INIT >= 2, with
+// the constitutive relations evaluated in every form (for every pair of basis functions) and once per
+// element and Newton's iterate (ConstitutiveCache). Both the exact relations and their polynomial
+// approximations (CONSTITUTIVE_TABLE_METHOD 0 and 2 in capillary-barrier-adapt) are used. The cache
+// hits and misses are reported, and the difference of the solutions, which should be zero.
+//
+// The following parameters can be changed:
+
+// Polynomial degrees.
+const int NUM_P_INIT = 2;
+const int P_INIT_vals[NUM_P_INIT] = {2, 3};
+// Number of initial uniform mesh refinements.
+const int INIT_REF_NUM = 1;
+// Number of initial mesh refinements towards the top edge.
+const int INIT_REF_NUM_BDY_TOP = 2;
+// Time step (in days) and number of time steps.
+const double TIME_STEP = 0.5;
+const int NUM_TIME_STEPS = 3;
+// Stopping criterion and maximum number of iterations for Newton.
+const double NEWTON_TOL = 1e-5;
+const int NEWTON_MAX_ITER = 10;
+// Matrix solver: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+// SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;
+
+// Problem parameters (see capillary-barrier-adapt), the top pressure head
+// is at its full value H_ELEVATION from the beginning.
+double H_INIT = -15.0;
+double H_ELEVATION = 10.0;
+const double STARTUP_TIME = 5.0;
+const double PULSE_END_TIME = 1000.0;
+double K_S_vals[4] = {350.2, 712.8, 1.68, 18.64}; 
+double ALPHA_vals[4] = {0.01, 1.0, 0.01, 0.01};
+double N_vals[4] = {2.5, 2.0, 1.23, 2.5};
+double M_vals[4] = {0.864, 0.626, 0.187, 0.864};
+double THETA_R_vals[4] = {0.064, 0.0, 0.089, 0.064};
+double THETA_S_vals[4] = {0.14, 0.43, 0.43, 0.24};
+double STORATIVITY_vals[4] = {0.1, 0.1, 0.1, 0.1};
+
+// Approximation of the constitutive relations (see capillary-barrier-adapt).
+const int MATERIAL_COUNT = 4;
+const int NUM_OF_INTERVALS = 16;
+double INTERVALS_4_APPROX[16] = 
+      {-1.0, -2.0, -3.0, -4.0, -5.0, -8.0, -10.0, -12.0, 
+      -15.0, -20.0, -30.0, -50.0, -75.0, -100.0,-300.0, -1000.0}; 
+double TABLE_LIMIT = -1000.0;
+const double TABLE_PRECISION = 0.1;
+const double LOW_LIMIT = -1.0;
+const int NUM_OF_INSIDE_PTS = 0;
+
+// Boundary markers.
+const std::string BDY_TOP = "1";
+
+struct Result
+{
+  int ndof;
+  double time;
+  int hits, misses;
+  double* coeff_vec;
+};
+
+Result run(int p_init, int table_method, bool cache_constitutive)
+{
+  ConstitutiveRelationsGenuchtenWithLayer constitutive_relations(table_method, NUM_OF_INSIDE_PTS, LOW_LIMIT, TABLE_PRECISION, TABLE_LIMIT, 
+    K_S_vals, ALPHA_vals, N_vals, M_vals, THETA_R_vals, THETA_S_vals, STORATIVITY_vals);
+  for (int i = 0; i < MATERIAL_COUNT; i++)
+  {
+    double* points = new double[NUM_OF_INSIDE_PTS];
+    init_polynomials(6 + NUM_OF_INSIDE_PTS, LOW_LIMIT, points, NUM_OF_INSIDE_PTS, i, &constitutive_relations, MATERIAL_COUNT, NUM_OF_INTERVALS, INTERVALS_4_APPROX);
+    delete [] points;
+  }
+  constitutive_relations.polynomials_ready = true;
+  if (table_method == 2)
+  {
+    constitutive_relations.constitutive_tables_ready = true;
+    constitutive_relations.table_limit = INTERVALS_4_APPROX[NUM_OF_INTERVALS-1];
+  }
+
+  Mesh mesh;
+  MeshReaderH2D mloader;
+  mloader.load("domain-half.mesh", &mesh);
+  for(int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary(BDY_TOP, INIT_REF_NUM_BDY_TOP);
+
+  RichardsEssentialBC bc_essential(BDY_TOP, H_ELEVATION, PULSE_END_TIME, H_INIT, STARTUP_TIME);
+  bc_essential.set_current_time(STARTUP_TIME);
+  EssentialBCs<double> bcs(&bc_essential);
+  H1Space<double> space(&mesh, &bcs, p_init);
+
+  Result result;
+  result.ndof = space.get_num_dofs();
+  result.coeff_vec = new double[result.ndof];
+  InitialSolutionRichards init_sln(&mesh, H_INIT);
+  OGProjection<double>::project_global(&space, &init_sln, result.coeff_vec, matrix_solver);
+  Solution<double> sln_prev_time;
+  Solution<double>::vector_to_solution(result.coeff_vec, &space, &sln_prev_time);
+
+  ConstitutiveCache constitutive_cache;
+  constitutive_cache.update(&mesh);
+  WeakFormRichardsNewtonEuler wf(&constitutive_relations, TIME_STEP, &sln_prev_time, &mesh, cache_constitutive ? &constitutive_cache : NULL);
+  DiscreteProblem<double> dp(&wf, &space);
+  Hermes::Hermes2D::NewtonSolver<double> newton(&dp, matrix_solver);
+
+  Hermes::TimePeriod cpu_time;
+  cpu_time.tick(Hermes::HERMES_SKIP);
+  for (int ts = 0; ts < NUM_TIME_STEPS; ts++)
+  {
+    try
+    {
+      newton.solve(result.coeff_vec, NEWTON_TOL, NEWTON_MAX_ITER);
+    }
+    catch(Hermes::Exceptions::Exception e)
+    {
+      e.printMsg();
+      error("Newton's iteration failed.");
+    }
+    memcpy(result.coeff_vec, newton.get_sln_vector(), result.ndof * sizeof(double));
+    Solution<double>::vector_to_solution(result.coeff_vec, &space, &sln_prev_time);
+  }
+  cpu_time.tick();
+  result.time = cpu_time.last();
+  result.hits = constitutive_cache.get_hits();
+  result.misses = constitutive_cache.get_misses();
+
+  info("P_INIT = %d, table method %d, %s: ndof %d, %g s, cache %d hits, %d misses.", p_init, table_method, 
+    cache_constitutive ? "cached" : "not cached", result.ndof, result.time, result.hits, result.misses);
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  const int table_methods[2] = {0, 2};
+  for (int p_i = 0; p_i < NUM_P_INIT; p_i++)
+    for (int method_i = 0; method_i < 2; method_i++)
+    {
+      Result not_cached = run(P_INIT_vals[p_i], table_methods[method_i], false);
+      Result cached = run(P_INIT_vals[p_i], table_methods[method_i], true);
+
+      double max_difference = 0.0;
+      for (int i = 0; i < cached.ndof; i++)
+        max_difference = std::max(max_difference, std::abs(cached.coeff_vec[i] - not_cached.coeff_vec[i]));
+      info("P_INIT = %d, table method %d: %g s not cached, %g s cached (%g times faster), %d cache hits per miss, solutions differ by %g.",
+        P_INIT_vals[p_i], table_methods[method_i], not_cached.time, cached.time, not_cached.time / cached.time, 
+        cached.hits / std::max(cached.misses, 1), max_difference);
+
+      delete [] not_cached.coeff_vec;
+      delete [] cached.coeff_vec;
+    }
+
+  return 0;
+}
@@ -1,5 +1,78 @@
 #define HERMES_REPORT_ALL
 
+// Values of all constitutive functions at the integration points of one element,
+// filled in one call by ConstitutiveRelations::evaluate(). The array h may be used
+// by the caller to store the pressure heads the functions are evaluated at.
+class ConstitutiveValues
+{
+public:
+  // The arrays are allocated on the heap (the entries of ConstitutiveCache), see also LocalConstitutiveValues.
+  ConstitutiveValues(int num_points = 0) : num_points(0), h(NULL), K(NULL), dKdh(NULL), ddKdhh(NULL), C(NULL), dCdh(NULL), ddCdhh(NULL), 
+    data(NULL), stack_data(NULL), stack_points(0)
+  {
+    resize(num_points);
+  }
+
+  ~ConstitutiveValues()
+  {
+    if (data != stack_data)
+      delete [] data;
+  }
+
+  // Reallocates the arrays if the number of points changes.
+  void resize(int num_points)
+  {
+    if (num_points == this->num_points)
+      return;
+    if (data != stack_data)
+      delete [] data;
+    this->num_points = num_points;
+    if (num_points == 0)
+      data = NULL;
+    else
+      data = (num_points <= stack_points) ? stack_data : new double[7 * num_points];
+    h = data;
+    K = h + num_points;
+    dKdh = K + num_points;
+    ddKdhh = dKdh + num_points;
+    C = ddKdhh + num_points;
+    dCdh = C + num_points;
+    ddCdhh = dCdh + num_points;
+  }
+
+  int num_points;
+  double *h, *K, *dKdh, *ddKdhh, *C, *dCdh, *ddCdhh;
+
+protected:
+  // The arrays are in stack_data up to stack_points points.
+  ConstitutiveValues(int num_points, double* stack_data, int stack_points) : num_points(0), h(NULL), K(NULL), dKdh(NULL), ddKdhh(NULL), 
+    C(NULL), dCdh(NULL), ddCdhh(NULL), data(NULL), stack_data(stack_data), stack_points(stack_points)
+  {
+    resize(num_points);
+  }
+
+  double* data;
+  double* stack_data;
+  int stack_points;
+
+private:
+  ConstitutiveValues(const ConstitutiveValues&);
+  ConstitutiveValues& operator=(const ConstitutiveValues&);
+};
+
+// The values evaluated in one form, on the stack (on the heap only above MAX_STACK_POINTS points).
+class LocalConstitutiveValues : public ConstitutiveValues
+{
+public:
+  LocalConstitutiveValues(int num_points = 0) : ConstitutiveValues(num_points, stack_storage, MAX_STACK_POINTS)
+  {}
+
+protected:
+  // Enough for the integration points of the highest quadrature order.
+  static const int MAX_STACK_POINTS = 256;
+  double stack_storage[7 * MAX_STACK_POINTS];
+};
+
 class ConstitutiveRelations
 {
 public:
@@ -12,6 +85,21 @@ public:
   virtual double C(double h) = 0;
   virtual double dCdh(double h) = 0;
   virtual double ddCdhh(double h) = 0;
+
+  // All constitutive functions at the num_points pressure heads h in one call, the relations
+  // override this to share the subexpressions of the functions.
+  virtual void evaluate(int num_points, const double* h, ConstitutiveValues& values)
+  {
+    for (int i = 0; i < num_points; i++)
+    {
+      values.K[i] = K(h[i]);
+      values.dKdh[i] = dKdh(h[i]);
+      values.ddKdhh[i] = ddKdhh(h[i]);
+      values.C[i] = C(h[i]);
+      values.dCdh[i] = dCdh(h[i]);
+      values.ddCdhh[i] = ddCdhh(h[i]);
+    }
+  }
 protected:
   double alpha, theta_s, theta_r, k_s;
 };
@@ -63,6 +151,23 @@ public:
     if (h < 0) return alpha * alpha * (theta_s - theta_r) * alpha * exp(alpha * h);
     else return 0;    
   }
+
+  // All functions (Gardner), one exponential per point.
+  void evaluate(int num_points, const double* h, ConstitutiveValues& values)
+  {
+    double c_s = alpha * (theta_s - theta_r);
+    for (int i = 0; i < num_points; i++)
+    {
+      bool unsaturated = h[i] < 0;
+      double exp_h = unsaturated ? exp(alpha * h[i]) : 1.0;
+      values.K[i] = k_s * exp_h;
+      values.dKdh[i] = unsaturated ? k_s * alpha * exp_h : 0.0;
+      values.ddKdhh[i] = unsaturated ? k_s * alpha * alpha * exp_h : 0.0;
+      values.C[i] = c_s * exp_h;
+      values.dCdh[i] = unsaturated ? c_s * alpha * exp_h : 0.0;
+      values.ddCdhh[i] = unsaturated ? c_s * alpha * alpha * exp_h : 0.0;
+    }
+  }
 };
 
 class ConstitutiveRelationsGenuchten : public ConstitutiveRelations
@@ -173,7 +278,63 @@ public:
   {
     return 0.0;
   }
+
+  // All functions (van Genuchten), see evaluate_genuchten().
+  void evaluate(int num_points, const double* h, ConstitutiveValues& values)
+  {
+    evaluate_genuchten(num_points, h, alpha, m, n, k_s, theta_s, theta_r, storativity, 0.0, 
+      values.K, values.dKdh, values.ddKdhh, values.C, values.dCdh, values.ddCdhh);
+  }
+
 protected:
+  // The van Genuchten functions for one set of parameters, c_unsaturated is added to C for h < 0. 
+  // With x = -alpha*h, p = x^n, s = 1 + p, q = s^(-m) and w = x^(m*n) * q, it is K = k_s * sqrt(q) * (1 - w)^2
+  // and the derivatives follow from the logarithmic derivatives of sqrt(q) and w, so that only three pow() 
+  // and one sqrt() are evaluated per point instead of tens of pow() in K(), dKdh(), ... The loop is branch-free.
+  static void evaluate_genuchten(int num_points, const double* h, double alpha, double m, double n, double k_s, 
+    double theta_s, double theta_r, double storativity, double c_unsaturated, 
+    double* K, double* dKdh, double* ddKdhh, double* C, double* dCdh, double* ddCdhh)
+  {
+    double mn = m * n;
+    double c_s = (theta_s - theta_r) * storativity / theta_s;
+    for (int i = 0; i < num_points; i++)
+    {
+      bool unsaturated = h[i] < 0;
+      // Any negative value for the saturated points, their values are not used.
+      double h_i = unsaturated ? h[i] : -1.0;
+      double p = std::pow(-alpha * h_i, n);
+      double s = 1 + p;
+      double q = std::pow(s, -m);
+      double w = std::pow(-alpha * h_i, mn) * q;
+      double g = std::sqrt(q);
+      double f = 1 - w;
+
+      // t = p / (h s), u = 1 / (h s) and their derivatives.
+      double u = 1 / (h_i * s);
+      double t = p * u;
+      double dt = t / h_i * (n - 1 - n * p / s);
+      double du = -u / h_i * (1 + n * p / s);
+
+      // g = sqrt(q): g' = g * L_g, w' = w * L_w.
+      double L_g = -0.5 * mn * t;
+      double dL_g = -0.5 * mn * dt;
+      double L_w = mn * u;
+      double dL_w = mn * du;
+      double dg = g * L_g;
+      double ddg = g * (L_g * L_g + dL_g);
+      double df = -w * L_w;
+      double ddf = -w * (L_w * L_w + dL_w);
+
+      K[i] = unsaturated ? k_s * g * f * f : k_s;
+      dKdh[i] = unsaturated ? k_s * (dg * f * f + 2 * g * f * df) : 0.0;
+      ddKdhh[i] = unsaturated ? k_s * (ddg * f * f + 4 * dg * f * df + 2 * g * (df * df + f * ddf)) : 0.0;
+      // q' = -mn * q * t.
+      C[i] = unsaturated ? c_s * q - mn * (theta_s - theta_r) * t * q + c_unsaturated : storativity;
+      dCdh[i] = unsaturated ? -mn * q * (c_s * t + (theta_s - theta_r) * (dt - mn * t * t)) : 0.0;
+      ddCdhh[i] = 0.0;
+    }
+  }
+
   double m, n, storativity;
 };
 
@@ -430,6 +591,68 @@ public:
 
   }
 
+  // All functions (van Genuchten) of the layer. If all points are evaluated exactly, it is
+  // one pass of evaluate_genuchten(), otherwise the table / polynomial approximations are
+  // looked up once per point for K, dK/dh, ddK/dhh and C, dC/dh together.
+  void evaluate(int num_points, const double* h, int layer, ConstitutiveValues& values)
+  {
+    double c_unsaturated = storativity_vals[layer] * theta_r_vals[layer] / theta_s_vals[layer];
+    bool exact = true;
+    for (int i = 0; i < num_points && exact; i++)
+      exact = (constitutive_table_method == 0 || !constitutive_tables_ready || h[i] < table_limit)
+        && !(h[i] > low_limit && h[i] < 0 && polynomials_ready && constitutive_table_method == 1);
+    if (exact)
+    {
+      evaluate_genuchten(num_points, h, alpha_vals[layer], m_vals[layer], n_vals[layer], k_s_vals[layer], theta_s_vals[layer], 
+        theta_r_vals[layer], storativity_vals[layer], c_unsaturated, values.K, values.dKdh, values.ddKdhh, values.C, values.dCdh, values.ddCdhh);
+      return;
+    }
+
+    for (int i = 0; i < num_points; i++)
+    {
+      double h_i = h[i];
+      values.ddCdhh[i] = 0.0;
+      if (constitutive_table_method == 0 || !constitutive_tables_ready || h_i < table_limit)
+        evaluate_genuchten(1, h + i, alpha_vals[layer], m_vals[layer], n_vals[layer], k_s_vals[layer], theta_s_vals[layer], theta_r_vals[layer], 
+          storativity_vals[layer], c_unsaturated, values.K + i, values.dKdh + i, values.ddKdhh + i, values.C + i, values.dCdh + i, values.ddCdhh + i);
+      else if (h_i < 0 && constitutive_table_method == 1)
+      {
+        int location = -int(h_i/table_precision);
+        double ratio = -h_i/table_precision - location;
+        values.K[i] = (k_table[layer][location+1] - k_table[layer][location]) * ratio + k_table[layer][location];
+        values.dKdh[i] = (dKdh_table[layer][location+1] - dKdh_table[layer][location]) * ratio + dKdh_table[layer][location];
+        values.ddKdhh[i] = (ddKdhh_table[layer][location+1] - ddKdhh_table[layer][location]) * ratio + ddKdhh_table[layer][location];
+        values.C[i] = (c_table[layer][location+1] - c_table[layer][location]) * ratio + c_table[layer][location];
+        values.dCdh[i] = (dCdh_table[layer][location+1] - dCdh_table[layer][location]) * ratio + dCdh_table[layer][location];
+      }
+      else if (h_i < 0 && constitutive_table_method == 2)
+      {
+        int location = pol_search_help[int(-h_i)];
+        values.K[i] = horner(k_pols[location][layer][0], h_i, 6);
+        values.dKdh[i] = horner(k_pols[location][layer][1], h_i, 5);
+        values.ddKdhh[i] = horner(k_pols[location][layer][2], h_i, 4);
+        values.C[i] = horner(c_pols[location][layer][0], h_i, 4);
+        values.dCdh[i] = horner(c_pols[location][layer][1], h_i, 3);
+      }
+      else
+      {
+        values.K[i] = k_s_vals[layer];
+        values.dKdh[i] = 0.0;
+        values.ddKdhh[i] = 0.0;
+        values.C[i] = storativity_vals[layer];
+        values.dCdh[i] = 0.0;
+      }
+
+      // K close to full saturation.
+      if (h_i > low_limit && h_i < 0 && polynomials_ready && constitutive_table_method == 1)
+      {
+        values.K[i] = horner(polynomials[layer][0], h_i, (6+num_inside_pts));
+        values.dKdh[i] = horner(polynomials[layer][1], h_i, (5+num_inside_pts));
+        values.ddKdhh[i] = horner(polynomials[layer][2], h_i, (4+num_inside_pts));
+      }
+    }
+  }
+
   int constitutive_table_method, num_inside_pts;
   bool polynomials_ready;
   double low_limit;
@@ -458,6 +681,128 @@ public:
 };
 
 
+// Values of the constitutive functions at the integration points of the elements, shared by all forms (and all pairs
+// of basis functions) evaluated on an element in the same linearization state. An entry is kept while the pressure 
+// heads at the points (and the layer) are the same, so it is recalculated for a new Newton's (Picard's) iterate. 
+// The values at the iterate and at the previous time level are cached separately.
+class ConstitutiveCache
+{
+public:
+  enum Level { ITERATE = 0, PREVIOUS_TIME_LEVEL = 1, NUM_LEVELS = 2 };
+
+  ConstitutiveCache() : cached_mesh(NULL), cached_mesh_seq(0), hits(0), misses(0)
+  {}
+
+  ~ConstitutiveCache()
+  {
+    clear();
+  }
+
+  // Drops the values if the mesh changed, to be called before assembling on the mesh.
+  void update(Mesh* mesh)
+  {
+    if (mesh != cached_mesh || mesh->get_seq() != cached_mesh_seq)
+    {
+      clear();
+      cached_mesh = mesh;
+      cached_mesh_seq = mesh->get_seq();
+    }
+    entries.resize(NUM_LEVELS * (mesh->get_max_element_id() + 1), NULL);
+  }
+
+  // The values at the num_points pressure heads h on the element.
+  const ConstitutiveValues& get(int element_id, Level level, int num_points, const double* h, ConstitutiveRelations* relations)
+  {
+    return get_values(element_id, level, num_points, h, relations, -1);
+  }
+
+  const ConstitutiveValues& get(int element_id, Level level, int num_points, const double* h, 
+    ConstitutiveRelationsGenuchtenWithLayer* relations, int layer)
+  {
+    return get_values(element_id, level, num_points, h, relations, layer);
+  }
+
+  // The values from the cache, or evaluated into values if there is no cache.
+  static const ConstitutiveValues& get(ConstitutiveCache* cache, int element_id, Level level, int num_points, const double* h, 
+    ConstitutiveRelations* relations, ConstitutiveValues& values)
+  {
+    if (cache != NULL)
+      return cache->get(element_id, level, num_points, h, relations);
+    values.resize(num_points);
+    relations->evaluate(num_points, h, values);
+    return values;
+  }
+
+  static const ConstitutiveValues& get(ConstitutiveCache* cache, int element_id, Level level, int num_points, const double* h, 
+    ConstitutiveRelationsGenuchtenWithLayer* relations, int layer, ConstitutiveValues& values)
+  {
+    if (cache != NULL)
+      return cache->get(element_id, level, num_points, h, relations, layer);
+    values.resize(num_points);
+    relations->evaluate(num_points, h, layer, values);
+    return values;
+  }
+
+  int get_hits() const { return hits; }
+  int get_misses() const { return misses; }
+
+protected:
+  void clear()
+  {
+    for (unsigned int i = 0; i < entries.size(); i++)
+      delete entries[i];
+    entries.clear();
+  }
+
+  // Layer -1 for the relations without layers.
+  const ConstitutiveValues& get_values(int element_id, Level level, int num_points, const double* h, ConstitutiveRelations* relations, 
+    int layer)
+  {
+    if (cached_mesh == NULL)
+      error("ConstitutiveCache: update() has to be called first.");
+    if (element_id < 0 || NUM_LEVELS * element_id >= (int) entries.size())
+      error("ConstitutiveCache: the element %d is not in the mesh.", element_id);
+
+    Entry*& entry = entries[NUM_LEVELS * element_id + level];
+    if (entry != NULL && entry->layer == layer && entry->values.num_points == num_points 
+      && std::equal(h, h + num_points, entry->values.h))
+    {
+#pragma omp atomic
+      hits++;
+      return entry->values;
+    }
+
+    if (entry == NULL)
+      entry = new Entry;
+    entry->layer = layer;
+    entry->values.resize(num_points);
+    std::copy(h, h + num_points, entry->values.h);
+    if (layer >= 0)
+      static_cast<ConstitutiveRelationsGenuchtenWithLayer*>(relations)->evaluate(num_points, entry->values.h, layer, entry->values);
+    else
+      relations->evaluate(num_points, entry->values.h, entry->values);
+#pragma omp atomic
+    misses++;
+    return entry->values;
+  }
+
+  struct Entry
+  {
+    int layer;
+    // The pressure heads are in values.h.
+    ConstitutiveValues values;
+  };
+
+  Mesh* cached_mesh;
+  unsigned int cached_mesh_seq;
+
+  // By the element id and the level.
+  std::vector<Entry*> entries;
+
+  int hits;
+  int misses;
+};
+
 bool init_polynomials(int n, double low_limit, double *points, int n_inside_points, int layer, ConstitutiveRelationsGenuchtenWithLayer* constitutive, int material_count, int num_of_intervals, double* intervals_4_approx);
 
 bool get_constitutive_tables(int method, ConstitutiveRelationsGenuchtenWithLayer* constitutive, int material_count);
\ No newline at end of file
@@ -10,7 +10,11 @@ macro(SET_COMMON_TARGET_PROPERTIES TRGT HERMES_VERSION)
 
 	target_link_libraries(${TRGT} ${HERMES_COMMON_LIBRARY})
 	target_link_libraries(${TRGT} ${HERMES_LIBRARY})
+	# The flow exporters of the Euler examples write the files in threads.
+	target_link_libraries(${TRGT} ${PTHREAD_LIBRARY})
 	# Is empty if WITH_TRILINOS = NO
 	target_link_libraries(${TRGT} ${TRILINOS_LIBRARIES})
+	# Is empty if WITH_ZLIB = NO
+	target_link_libraries(${TRGT} ${ZLIB_LIBRARIES})
 			
 endmacro(SET_COMMON_TARGET_PROPERTIES)